@@ -0,0 +1,43 @@
+#version 450
+
+// depth pre-pass; reads only the position stream of the model
+layout(location = 0) in vec3 aPosition;
+
+layout(binding = 0) uniform MatrixUBO
+{
+	mat4 model;
+	mat4 viewProj;
+	mat4 normal;
+}
+uMat;
+
+#if defined(INSTANCED)
+layout(std430, set = 1, binding = 0) readonly buffer InstanceBuffer
+{
+	mat4 models[];
+}
+uInstances;
+#elif !defined(PER_DRAW_UBO)
+layout(push_constant) uniform PerDrawData
+{
+	mat4 model;
+}
+uDraw;
+#endif
+
+// has to match the position of the shading pass exactly, it tests with `VK_COMPARE_OP_EQUAL`
+invariant gl_Position;
+
+void main()
+{
+#if defined(INSTANCED)
+	mat4 model = uInstances.models[gl_InstanceIndex];
+#elif defined(PER_DRAW_UBO)
+	mat4 model = uMat.model;
+#else
+	mat4 model = uDraw.model;
+#endif
+
+	vec3 fragPos = vec3(model * vec4(aPosition, 1.0));
+	gl_Position = uMat.viewProj * vec4(fragPos, 1.0);
+}
@@ -1,17 +1,61 @@
 #version 450
 
-const uint NUM_LIGHTS = 4;
+// clustered forward shading; only the point lights that `ClusteredLighting` assigned to the
+// fragment's cluster are shaded
+
+// specialized with `ClusteredLighting::MAX_LIGHTS_PER_CLUSTER` (`ShaderConstant`)
+layout(constant_id = 16) const uint MAX_LIGHTS_PER_CLUSTER = 256;
+// `ShaderFeature::NORMAL_MAPPING`; without it the interpolated vertex normal is shaded and the
+// normal map is never sampled
+layout(constant_id = 2) const bool NORMAL_MAPPING = true;
+
+struct PointLight
+{
+	vec4 positionRadius; // world space; xyz position, w range
+	vec4 color;
+};
 
 layout(binding = 1) uniform SceneUBO
 {
 	vec3 cameraPos;
-	vec3 lightPos[NUM_LIGHTS];
-	vec3 lightColors;
 }
 scene;
 
 layout(binding = 2) uniform sampler2D textureMaps[5];
 
+// written by cluster.comp
+layout(std140, binding = 3) uniform ClusterUniforms
+{
+	mat4 view;
+	mat4 inverseProjection;
+	uvec4 gridSize; // xyz clusters, w light count
+	vec2 tileSize; // pixels
+	vec2 screenSize;
+	float zNear;
+	float zFar;
+	float sliceScale;
+	float sliceBias;
+}
+uCluster;
+
+layout(std430, binding = 4) readonly buffer LightBuffer
+{
+	PointLight lights[];
+}
+uLights;
+
+layout(std430, binding = 5) readonly buffer LightGridBuffer
+{
+	uint counts[];
+}
+uLightGrid;
+
+layout(std430, binding = 6) readonly buffer LightIndexBuffer
+{
+	uint indices[];
+}
+uLightIndices;
+
 layout(location = 0) in FsIn
 {
 	vec2 texCoords;
@@ -59,6 +103,16 @@ float GeometrySmithGGX(vec3 normal, vec3 viewDir, vec3 lightDir, float roughness
 	return geometryView * geometryLight;
 }
 
+uint GetClusterIndex()
+{
+	float viewDepth = -(uCluster.view * vec4(fsIn.fragPos, 1.0)).z;
+	uint slice = uint(max(log(viewDepth) * uCluster.sliceScale + uCluster.sliceBias, 0.0));
+	uvec3 cluster = min(uvec3(uvec2(gl_FragCoord.xy / uCluster.tileSize), slice),
+		uCluster.gridSize.xyz - 1);
+	return cluster.x + cluster.y * uCluster.gridSize.x
+		   + cluster.z * uCluster.gridSize.x * uCluster.gridSize.y;
+}
+
 vec3 Pbr(vec3 albedo, float roughness, float metallic, float ao, vec3 normal)
 {
 	vec3 viewDir = normalize(scene.cameraPos - fsIn.fragPos);
@@ -70,15 +124,24 @@ vec3 Pbr(vec3 albedo, float roughness, float metallic, float ao, vec3 normal)
 	vec3 reflectivity = vec3(0.04);
 	reflectivity = mix(reflectivity, albedo, metallic);
 
-	for (int i = 0; i < NUM_LIGHTS; ++i)
+	uint clusterIndex = GetClusterIndex();
+	uint lightCount = min(uLightGrid.counts[clusterIndex], uint(MAX_LIGHTS_PER_CLUSTER));
+	for (uint i = 0; i < lightCount; ++i)
 	{
+		PointLight light =
+			uLights.lights[uLightIndices.indices[clusterIndex * MAX_LIGHTS_PER_CLUSTER + i]];
+
 		// calc per-light radiance
-		vec3 lightVec = scene.lightPos[i] - fsIn.fragPos;
+		vec3 lightVec = light.positionRadius.xyz - fsIn.fragPos;
 		vec3 lightDir = normalize(lightVec);
 		vec3 halfway = normalize(viewDir + lightDir);
 		float dist = length(lightVec);
-		float attenuation = 1.0 / (dist * dist);
-		vec3 radiance = scene.lightColors * attenuation;
+		// inverse square falloff windowed to reach 0 at the light's range, so a light doesn't
+		// affect the clusters outside of it
+		float distRatio = dist / light.positionRadius.w;
+		float window = clamp(1.0 - distRatio * distRatio * distRatio * distRatio, 0.0, 1.0);
+		float attenuation = window * window / (dist * dist + 1.0);
+		vec3 radiance = light.color.rgb * attenuation;
 
 		// Cook-Torrance BRDF
 		float NDF = DistributionGGX(normal, halfway, roughness);
@@ -112,9 +175,17 @@ void main()
 	float roughness = texture(textureMaps[1], fsIn.texCoords).r;
 	float metallic = texture(textureMaps[2], fsIn.texCoords).r;
 	float ao = texture(textureMaps[3], fsIn.texCoords).r;
-	vec3 normal = texture(textureMaps[4], fsIn.texCoords).rgb;
-	normal = (normal * 2.0 - 1.0); // [0, 1] to [-1, 1]
-	normal = normalize(fsIn.TBN * normal);
+	vec3 normal;
+	if (NORMAL_MAPPING)
+	{
+		normal = texture(textureMaps[4], fsIn.texCoords).rgb;
+		normal = (normal * 2.0 - 1.0); // [0, 1] to [-1, 1]
+		normal = normalize(fsIn.TBN * normal);
+	}
+	else
+	{
+		normal = normalize(fsIn.TBN[2]);
+	}
 
 	vec3 color = Pbr(albedo, roughness, metallic, ao, normal);
 
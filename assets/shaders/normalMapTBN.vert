@@ -11,8 +11,26 @@ layout(binding = 0) uniform MatrixUBO
 	mat4 viewProj;
 	mat4 normal;
 }
-mat;
+uMat;
 
+#if defined(INSTANCED)
+// the `INSTANCED` variant reads the model matrix of every instance from the instance buffer of
+// the draw; the gpu culling writes the index into `firstInstance` of its indirect draws
+layout(std430, set = 1, binding = 0) readonly buffer InstanceBuffer
+{
+	mat4 models[];
+}
+uInstances;
+#elif !defined(PER_DRAW_UBO)
+// per-draw data (`PerDrawData`); the `PER_DRAW_UBO` variant reads it from `uMat` instead
+layout(push_constant) uniform PerDrawData
+{
+	mat4 model;
+}
+uDraw;
+#endif
+
+// the lighting is done in world space, so the output doesn't grow with the number of lights
 layout(location = 0) out VsOut
 {
 	vec2 texCoords;
@@ -21,17 +39,29 @@ layout(location = 0) out VsOut
 }
 vsOut;
 
+// depthOnly.vert computes the same position, so the depth pre-pass depth is matched exactly
+invariant gl_Position;
+
 void main()
 {
+#if defined(INSTANCED)
+	mat4 model = uInstances.models[gl_InstanceIndex];
+#elif defined(PER_DRAW_UBO)
+	mat4 model = uMat.model;
+#else
+	mat4 model = uDraw.model;
+#endif
+
 	vsOut.texCoords = aTexCoords;
-	vsOut.fragPos = vec3(mat.model * vec4(aPosition, 1.0));
+	vsOut.fragPos = vec3(model * vec4(aPosition, 1.0));
 
-	vec3 T = normalize(vec3(mat.model * vec4(aTangent, 0.0)));
-	vec3 N = normalize(vec3(mat.model * vec4(aNormal, 0.0)));
+	vec3 T = normalize(vec3(model * vec4(aTangent, 0.0)));
+	vec3 N = normalize(vec3(model * vec4(aNormal, 0.0)));
 	// re-orthoganize T with respect to N
 	T = normalize(T - dot(T, N) * N);
 	vec3 B = cross(N, T);
+	// TBN mat converts the normal map from tangent space into world space
 	vsOut.TBN = mat3(T, B, N);
 
-	gl_Position = mat.viewProj * vec4(vsOut.fragPos, 1.0);
-}
\ No newline at end of file
+	gl_Position = uMat.viewProj * vec4(vsOut.fragPos, 1.0);
+}
@@ -1,7 +1,5 @@
 #version 450
 
-const uint NUM_LIGHTS = 1;
-
 layout(binding = 0) uniform MatrixUBO
 {
 	mat4 model;
@@ -10,10 +8,28 @@ layout(binding = 0) uniform MatrixUBO
 }
 uMat;
 
+#if defined(INSTANCED)
+// the `INSTANCED` variant reads the model matrix of every instance from the instance buffer of
+// the draw; the gpu culling writes the index into `firstInstance` of its indirect draws
+layout(std430, set = 1, binding = 0) readonly buffer InstanceBuffer
+{
+	mat4 models[];
+}
+uInstances;
+#elif !defined(PER_DRAW_UBO)
+// per-draw data (`PerDrawData`); the `PER_DRAW_UBO` variant reads it from `uMat` instead
+layout(push_constant) uniform PerDrawData
+{
+	mat4 model;
+	mat4 normal;
+}
+uDraw;
+#endif
+
 layout(binding = 1) uniform SceneUBO
 {
 	vec3 cameraPos;
-	vec3 lightPos[NUM_LIGHTS];
+	vec3 lightPos; // the single light, the clustered lights are only shaded by normalMapTBN
 	vec3 lightColors;
 }
 uScene;
@@ -29,17 +45,31 @@ layout(location = 2) out vec3 outFragPos;
 layout(location = 3) out vec3 outViewPos;
 layout(location = 4) out vec3 outLightPos;
 
+// depthOnly.vert computes the same position, so the depth pre-pass depth is matched exactly
+invariant gl_Position;
+
 void main()
 {
-	outFragPos = vec3(uMat.model * vec4(inPosition, 1.0));
+#if defined(INSTANCED)
+	mat4 model = uInstances.models[gl_InstanceIndex];
+	mat3 normalMat = mat3(transpose(inverse(model)));
+#elif defined(PER_DRAW_UBO)
+	mat4 model = uMat.model;
+	mat3 normalMat = mat3(uMat.normal);
+#else
+	mat4 model = uDraw.model;
+	mat3 normalMat = mat3(uDraw.normal);
+#endif
+
+	outFragPos = vec3(model * vec4(inPosition, 1.0));
 	gl_Position = uMat.viewProj * vec4(outFragPos, 1.0);
 
 	// we cannot simply multiply the normal vector by the model matrix,
 	// because we shouldnt translate the normal vector
 	// we use a normal matrix
-	outNormal = mat3(uMat.normal) * inNormal;
+	outNormal = normalMat * inNormal;
 
 	outTexCoord = inTexCoord;
 	outViewPos = uScene.cameraPos;
-	outLightPos = uScene.lightPos[0];
+	outLightPos = uScene.lightPos;
 }
\ No newline at end of file
@@ -0,0 +1,87 @@
+// standalone benchmark of the cpu frustum culling
+// usage: cullBenchmark [object count] [iterations]
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "core/jobSystem.h"
+#include "engine/frustum.h"
+#include "engine/cpuCulling.h"
+
+
+template<typename Fn>
+float MeasureMs(uint32_t iterations, Fn&& fn)
+{
+	// the fastest run, the others are slowed down by whatever else runs on the machine
+	float bestTime = std::numeric_limits<float>::max();
+	for (uint32_t i = 0; i < iterations; ++i)
+	{
+		const auto startTime = std::chrono::high_resolution_clock::now();
+		fn();
+		bestTime = std::min(bestTime,
+			std::chrono::duration<float, std::chrono::milliseconds::period>(
+				std::chrono::high_resolution_clock::now() - startTime)
+				.count());
+	}
+
+	return bestTime;
+}
+
+int main(int argc, char** argv)
+{
+	const auto objectCount =
+		static_cast<uint32_t>(argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1'000'000);
+	const auto iterations =
+		static_cast<uint32_t>(argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100);
+
+	// objects scattered in a cube around the camera, about a tenth of them is visible
+	std::mt19937 rng{ 1234 };
+	std::uniform_real_distribution<float> posDist{ -1000.0f, 1000.0f };
+	std::uniform_real_distribution<float> sizeDist{ 0.5f, 5.0f };
+
+	CullingBounds bounds;
+	bounds.Reserve(objectCount);
+	for (uint32_t i = 0; i < objectCount; ++i)
+	{
+		const glm::vec3 center{ posDist(rng), posDist(rng), posDist(rng) };
+		const glm::vec3 halfExtent{ sizeDist(rng), sizeDist(rng), sizeDist(rng) };
+		bounds.Add(glm::vec4{ center, glm::length(halfExtent) },
+			center - halfExtent,
+			center + halfExtent);
+	}
+
+	const glm::mat4 view = glm::lookAt(
+		glm::vec3{ 0.0f }, glm::vec3{ 0.0f, 0.0f, -1.0f }, glm::vec3{ 0.0f, 1.0f, 0.0f });
+	const glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 2000.0f);
+	const Frustum frustum = Frustum::FromViewProjection(proj * view);
+
+	const uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	JobSystem jobSystem{ hardwareThreads - 1 };
+	CpuCulling culling{ jobSystem };
+
+	std::vector<uint32_t> visible;
+	const float singleThreadTime = MeasureMs(iterations, [&]() {
+		visible.resize(objectCount);
+		visible.resize(CpuCulling::CullRange(bounds, frustum, 0, objectCount, visible.data()));
+	});
+	const auto singleThreadVisibleCount = static_cast<uint32_t>(visible.size());
+
+	const float parallelTime = MeasureMs(
+		iterations, [&]() { culling.Cull(bounds, frustum, objectCount, visible); });
+
+	std::printf("%u objects, %u visible (%u single threaded)\n",
+		objectCount,
+		static_cast<uint32_t>(visible.size()),
+		singleThreadVisibleCount);
+	std::printf("single threaded: %.3f ms\n", static_cast<double>(singleThreadTime));
+	std::printf("%u threads:      %.3f ms\n", hardwareThreads, static_cast<double>(parallelTime));
+
+	return visible.size() == singleThreadVisibleCount ? EXIT_SUCCESS : EXIT_FAILURE;
+}
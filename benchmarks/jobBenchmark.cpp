@@ -0,0 +1,118 @@
+// standalone benchmark of the job system: the overhead of small jobs queued from outside the pool
+// and from the workers, and the speedup of a parallel-for over a single thread
+// usage: jobBenchmark [job count] [iterations]
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include "core/jobSystem.h"
+
+
+template<typename Fn>
+float MeasureMs(uint32_t iterations, Fn&& fn)
+{
+	// the fastest run, the others are slowed down by whatever else runs on the machine
+	float bestTime = std::numeric_limits<float>::max();
+	for (uint32_t i = 0; i < iterations; ++i)
+	{
+		const auto startTime = std::chrono::high_resolution_clock::now();
+		fn();
+		bestTime = std::min(bestTime,
+			std::chrono::duration<float, std::chrono::milliseconds::period>(
+				std::chrono::high_resolution_clock::now() - startTime)
+				.count());
+	}
+
+	return bestTime;
+}
+
+static double GetJobsPerSecond(uint32_t jobCount, float timeMs)
+{
+	return static_cast<double>(jobCount) / (static_cast<double>(timeMs) / 1000.0);
+}
+
+int main(int argc, char** argv)
+{
+	const auto jobCount =
+		static_cast<uint32_t>(argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100'000);
+	const auto iterations =
+		static_cast<uint32_t>(argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20);
+
+	const uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	JobSystem jobSystem{ hardwareThreads - 1 };
+	bool isCorrect = true;
+
+	// empty jobs queued from the main thread into the shared queue
+	std::atomic<uint32_t> runCount{ 0 };
+	const float sharedQueueTime = MeasureMs(iterations, [&]() {
+		runCount = 0;
+		JobCounter counter;
+		for (uint32_t i = 0; i < jobCount; ++i)
+			jobSystem.Run([&runCount]() { ++runCount; }, &counter);
+		jobSystem.Wait(counter);
+	});
+	isCorrect &= runCount == jobCount;
+
+	// the same jobs queued by jobs into the deques of the workers, the idle workers steal them
+	const uint32_t spawnerCount = std::max(1u, jobSystem.GetWorkerCount());
+	const uint32_t jobsPerSpawner = jobCount / spawnerCount;
+	const float workerQueueTime = MeasureMs(iterations, [&]() {
+		runCount = 0;
+		JobCounter counter;
+		for (uint32_t s = 0; s < spawnerCount; ++s)
+		{
+			jobSystem.Run(
+				[&jobSystem, &runCount, &counter, jobsPerSpawner]() {
+					for (uint32_t i = 0; i < jobsPerSpawner; ++i)
+						jobSystem.Run([&runCount]() { ++runCount; }, &counter);
+				},
+				&counter);
+		}
+		jobSystem.Wait(counter);
+	});
+	isCorrect &= runCount == jobsPerSpawner * spawnerCount;
+
+	// some math per element, single threaded and split into batches
+	constexpr uint32_t batchSize = 256;
+	const uint32_t elementCount = jobCount * 16;
+	std::vector<float> values(elementCount);
+	const auto work = [&values](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i)
+			values[i] = std::sqrt(static_cast<float>(i)) * std::sin(static_cast<float>(i));
+	};
+	const float singleThreadTime = MeasureMs(iterations, [&]() { work(0, elementCount); });
+	const std::vector<float> reference = values;
+	std::fill(values.begin(), values.end(), 0.0f);
+	const float parallelForTime = MeasureMs(iterations, [&]() {
+		JobCounter counter;
+		jobSystem.ParallelFor(elementCount, batchSize, work, counter);
+		jobSystem.Wait(counter);
+	});
+	isCorrect &= values == reference;
+
+	std::printf("%u threads, %u jobs, %s\n",
+		hardwareThreads,
+		jobCount,
+		isCorrect ? "all jobs ran" : "JOBS MISSING");
+	std::printf("shared queue:  %.3f ms (%.2f M jobs/s)\n",
+		static_cast<double>(sharedQueueTime),
+		GetJobsPerSecond(jobCount, sharedQueueTime) / 1e6);
+	std::printf("worker deques: %.3f ms (%.2f M jobs/s)\n",
+		static_cast<double>(workerQueueTime),
+		GetJobsPerSecond(jobsPerSpawner * spawnerCount, workerQueueTime) / 1e6);
+	std::printf("%u elements, single threaded: %.3f ms\n",
+		elementCount,
+		static_cast<double>(singleThreadTime));
+	std::printf("%u elements, parallel for:     %.3f ms (batches of %u)\n",
+		elementCount,
+		static_cast<double>(parallelForTime),
+		batchSize);
+
+	return isCorrect ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,149 @@
+// standalone benchmark of the cpu software occlusion culling
+// usage: occlusionBenchmark [object count] [occluder count] [iterations]
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "core/jobSystem.h"
+#include "engine/frustum.h"
+#include "engine/cpuCulling.h"
+#include "engine/softwareOcclusion.h"
+
+
+constexpr uint32_t g_DepthWidth = 320;
+constexpr uint32_t g_DepthHeight = 180;
+
+template<typename Fn>
+float MeasureMs(uint32_t iterations, Fn&& fn)
+{
+	// the fastest run, the others are slowed down by whatever else runs on the machine
+	float bestTime = std::numeric_limits<float>::max();
+	for (uint32_t i = 0; i < iterations; ++i)
+	{
+		const auto startTime = std::chrono::high_resolution_clock::now();
+		fn();
+		bestTime = std::min(bestTime,
+			std::chrono::duration<float, std::chrono::milliseconds::period>(
+				std::chrono::high_resolution_clock::now() - startTime)
+				.count());
+	}
+
+	return bestTime;
+}
+
+int main(int argc, char** argv)
+{
+	const auto objectCount =
+		static_cast<uint32_t>(argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100'000);
+	const auto occluderCount =
+		static_cast<uint32_t>(argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 256);
+	const auto iterations =
+		static_cast<uint32_t>(argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 100);
+
+	// the matrices `Camera` starts with
+	const glm::mat4 view = glm::lookAt(glm::vec3{ 0.0f, 0.0f, 3.0f },
+		glm::vec3{ 0.0f, 0.0f, 2.0f },
+		glm::vec3{ 0.0f, 1.0f, 0.0f });
+	glm::mat4 proj = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.01f, 100.0f);
+	proj[1][1] *= -1;
+	const glm::mat4 viewProjection = proj * view;
+
+	// a wall right in front of the camera, pillars behind it and small objects scattered behind
+	// the pillars
+	std::mt19937 rng{ 1234 };
+	std::uniform_real_distribution<float> sideDist{ -30.0f, 30.0f };
+	std::uniform_real_distribution<float> pillarDepthDist{ -40.0f, -10.0f };
+	std::uniform_real_distribution<float> objectDepthDist{ -95.0f, -5.0f };
+	std::uniform_real_distribution<float> sizeDist{ 0.1f, 1.0f };
+
+	const uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	JobSystem jobSystem{ hardwareThreads - 1 };
+	SoftwareOcclusion occlusion{ jobSystem, g_DepthWidth, g_DepthHeight };
+	occlusion.AddOccluderBox(
+		glm::mat4{ 1.0f }, glm::vec3{ -2.0f, -1.0f, -6.0f }, glm::vec3{ 2.0f, 1.0f, -5.5f });
+	for (uint32_t i = 1; i < occluderCount; ++i)
+	{
+		const glm::vec3 base{ sideDist(rng), -10.0f, pillarDepthDist(rng) };
+		occlusion.AddOccluderBox(
+			glm::mat4{ 1.0f }, base, base + glm::vec3{ 1.0f, 20.0f, 1.0f });
+	}
+
+	// the AABBs are kept for the single threaded tests, `CullingBounds` has no accessors
+	CullingBounds bounds;
+	std::vector<glm::vec3> aabbMins;
+	std::vector<glm::vec3> aabbMaxs;
+	bounds.Reserve(objectCount + 2);
+	aabbMins.reserve(objectCount + 2);
+	aabbMaxs.reserve(objectCount + 2);
+	const auto addObject = [&](const glm::vec3& center, const glm::vec3& halfExtent) {
+		aabbMins.push_back(center - halfExtent);
+		aabbMaxs.push_back(center + halfExtent);
+		return bounds.Add(
+			glm::vec4{ center, glm::length(halfExtent) }, aabbMins.back(), aabbMaxs.back());
+	};
+	for (uint32_t i = 0; i < objectCount; ++i)
+	{
+		addObject(glm::vec3{ sideDist(rng), sideDist(rng) * 0.5f, objectDepthDist(rng) },
+			glm::vec3{ sizeDist(rng), sizeDist(rng), sizeDist(rng) });
+	}
+	// sanity checks: hidden behind the wall and in front of it
+	const uint32_t hiddenObject = addObject(glm::vec3{ 0.0f, 0.0f, -20.0f }, glm::vec3{ 0.5f });
+	const uint32_t frontObject = addObject(glm::vec3{ 0.0f, 0.0f, -4.0f }, glm::vec3{ 0.5f });
+
+	std::vector<uint32_t> inFrustum;
+	CpuCulling frustumCulling{ jobSystem };
+	frustumCulling.Cull(
+		bounds, Frustum::FromViewProjection(viewProjection), bounds.GetCount(), inFrustum);
+
+	const float rasterTime =
+		MeasureMs(iterations, [&]() { occlusion.Rasterize(viewProjection); });
+
+	std::vector<uint32_t> singleThreadVisible;
+	const float singleThreadTime = MeasureMs(iterations, [&]() {
+		singleThreadVisible.clear();
+		for (const uint32_t index : inFrustum)
+		{
+			if (!occlusion.IsOccluded(aabbMins[index], aabbMaxs[index]))
+				singleThreadVisible.push_back(index);
+		}
+	});
+
+	std::vector<uint32_t> visible;
+	const float parallelTime = MeasureMs(iterations, [&]() {
+		visible = inFrustum;
+		occlusion.Cull(bounds, visible);
+	});
+
+	const bool hiddenCulled =
+		!std::binary_search(visible.begin(), visible.end(), hiddenObject);
+	const bool frontKept = std::binary_search(visible.begin(), visible.end(), frontObject);
+
+	std::printf("%u objects, %u in the frustum, %u not occluded\n",
+		bounds.GetCount(),
+		static_cast<uint32_t>(inFrustum.size()),
+		static_cast<uint32_t>(visible.size()));
+	std::printf("%u occluder triangles into %ux%u\n",
+		occlusion.GetOccluderTriangleCount(),
+		g_DepthWidth,
+		g_DepthHeight);
+	std::printf("rasterization (%u threads): %.3f ms\n",
+		hardwareThreads,
+		static_cast<double>(rasterTime));
+	std::printf("tests single threaded:     %.3f ms\n", static_cast<double>(singleThreadTime));
+	std::printf("tests (%u threads):         %.3f ms\n",
+		hardwareThreads,
+		static_cast<double>(parallelTime));
+	std::printf("hidden object culled: %s, front object kept: %s\n",
+		hiddenCulled ? "yes" : "no",
+		frontKept ? "yes" : "no");
+
+	return visible == singleThreadVisible && hiddenCulled && frontKept ? EXIT_SUCCESS
+																		: EXIT_FAILURE;
+}
@@ -0,0 +1,327 @@
+// standalone benchmark of the per-draw data paths: records the per-draw data of every draw into a
+// command buffer with push constants and with dynamic UBO offsets; needs a Vulkan device, but no
+// window (`VK_ICD_FILENAMES` picks the driver, lavapipe works)
+// usage: perDrawBenchmark [draw count] [iterations]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <limits>
+#include <vector>
+#include <algorithm>
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "engine/types.h"
+
+
+template<typename Fn>
+float MeasureMs(uint32_t iterations, Fn&& fn)
+{
+	// the fastest run, the others are slowed down by whatever else runs on the machine
+	float bestTime = std::numeric_limits<float>::max();
+	for (uint32_t i = 0; i < iterations; ++i)
+	{
+		const auto startTime = std::chrono::high_resolution_clock::now();
+		fn();
+		bestTime = std::min(bestTime,
+			std::chrono::duration<float, std::chrono::milliseconds::period>(
+				std::chrono::high_resolution_clock::now() - startTime)
+				.count());
+	}
+
+	return bestTime;
+}
+
+static void Check(VkResult result, const char* call)
+{
+	if (result == VK_SUCCESS)
+		return;
+
+	std::fprintf(stderr, "%s failed: %d\n", call, static_cast<int>(result));
+	std::exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv)
+{
+	const auto drawCount =
+		static_cast<uint32_t>(argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 65536);
+	const auto iterations =
+		static_cast<uint32_t>(argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100);
+	if (drawCount == 0)
+		return EXIT_FAILURE;
+
+	// headless instance and device on the first gpu
+	VkApplicationInfo appInfo{};
+	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	appInfo.pApplicationName = "perDrawBenchmark";
+	appInfo.apiVersion = VK_API_VERSION_1_2;
+
+	VkInstanceCreateInfo instanceInfo{};
+	instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	instanceInfo.pApplicationInfo = &appInfo;
+	VkInstance instance{};
+	Check(vkCreateInstance(&instanceInfo, nullptr, &instance), "vkCreateInstance");
+
+	uint32_t physicalDeviceCount = 1;
+	VkPhysicalDevice physicalDevice{};
+	const VkResult enumerateResult =
+		vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, &physicalDevice);
+	if (enumerateResult != VK_INCOMPLETE)
+		Check(enumerateResult, "vkEnumeratePhysicalDevices");
+	if (physicalDeviceCount == 0)
+	{
+		std::fprintf(stderr, "no Vulkan device\n");
+		return EXIT_FAILURE;
+	}
+
+	VkPhysicalDeviceProperties properties{};
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(
+		physicalDevice, &queueFamilyCount, queueFamilies.data());
+	const auto graphicsFamily = std::find_if(queueFamilies.begin(),
+		queueFamilies.end(),
+		[](const VkQueueFamilyProperties& family) {
+			return (family.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+		});
+	if (graphicsFamily == queueFamilies.end())
+	{
+		std::fprintf(stderr, "no graphics queue\n");
+		return EXIT_FAILURE;
+	}
+
+	const float queuePriority = 1.0f;
+	VkDeviceQueueCreateInfo queueInfo{};
+	queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+	queueInfo.queueFamilyIndex = static_cast<uint32_t>(graphicsFamily - queueFamilies.begin());
+	queueInfo.queueCount = 1;
+	queueInfo.pQueuePriorities = &queuePriority;
+
+	VkDeviceCreateInfo deviceInfo{};
+	deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	deviceInfo.queueCreateInfoCount = 1;
+	deviceInfo.pQueueCreateInfos = &queueInfo;
+	VkDevice device{};
+	Check(vkCreateDevice(physicalDevice, &deviceInfo, nullptr, &device), "vkCreateDevice");
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = queueInfo.queueFamilyIndex;
+	VkCommandPool commandPool{};
+	Check(vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool), "vkCreateCommandPool");
+
+	VkCommandBufferAllocateInfo cmdBuffInfo{};
+	cmdBuffInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	cmdBuffInfo.commandPool = commandPool;
+	cmdBuffInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	cmdBuffInfo.commandBufferCount = 1;
+	VkCommandBuffer cmdBuff{};
+	Check(vkAllocateCommandBuffers(device, &cmdBuffInfo, &cmdBuff), "vkAllocateCommandBuffers");
+
+	// the layout of the engine: the matrix UBO with a dynamic offset and the push constants
+	VkDescriptorSetLayoutBinding matBinding{};
+	matBinding.binding = 0;
+	matBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	matBinding.descriptorCount = 1;
+	matBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+	VkDescriptorSetLayoutCreateInfo setLayoutInfo{};
+	setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	setLayoutInfo.bindingCount = 1;
+	setLayoutInfo.pBindings = &matBinding;
+	VkDescriptorSetLayout setLayout{};
+	Check(vkCreateDescriptorSetLayout(device, &setLayoutInfo, nullptr, &setLayout),
+		"vkCreateDescriptorSetLayout");
+
+	const bool pushConstantsSupported =
+		PerDrawData::FitsInPushConstants(properties.limits.maxPushConstantsSize);
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = PerDrawData::GetSize();
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &setLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = pushConstantsSupported ? 1 : 0;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+	VkPipelineLayout pipelineLayout{};
+	Check(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout),
+		"vkCreatePipelineLayout");
+
+	// a slot per draw, like `Engine::m_MatUniformBuffers`
+	const VkDeviceSize alignment = properties.limits.minUniformBufferOffsetAlignment;
+	const VkDeviceSize slotStride = (MatrixUBO::GetSize() + alignment - 1) / alignment * alignment;
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = slotStride * drawCount;
+	bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	VkBuffer buffer{};
+	Check(vkCreateBuffer(device, &bufferInfo, nullptr, &buffer), "vkCreateBuffer");
+
+	VkMemoryRequirements memRequirements{};
+	vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+	VkPhysicalDeviceMemoryProperties memProperties{};
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+	constexpr VkMemoryPropertyFlags hostVisible =
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	uint32_t memoryType = 0;
+	while (memoryType < memProperties.memoryTypeCount
+		   && ((memRequirements.memoryTypeBits & (1u << memoryType)) == 0
+			   || (memProperties.memoryTypes[memoryType].propertyFlags & hostVisible)
+					  != hostVisible))
+		++memoryType;
+	if (memoryType == memProperties.memoryTypeCount)
+	{
+		std::fprintf(stderr, "no host visible memory for the UBO\n");
+		return EXIT_FAILURE;
+	}
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memRequirements.size;
+	allocInfo.memoryTypeIndex = memoryType;
+	VkDeviceMemory bufferMemory{};
+	Check(vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory), "vkAllocateMemory");
+	Check(vkBindBufferMemory(device, buffer, bufferMemory, 0), "vkBindBufferMemory");
+	void* mapped = nullptr;
+	Check(vkMapMemory(device, bufferMemory, 0, bufferInfo.size, 0, &mapped), "vkMapMemory");
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	poolSize.descriptorCount = 1;
+	VkDescriptorPoolCreateInfo descriptorPoolInfo{};
+	descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	descriptorPoolInfo.maxSets = 1;
+	descriptorPoolInfo.poolSizeCount = 1;
+	descriptorPoolInfo.pPoolSizes = &poolSize;
+	VkDescriptorPool descriptorPool{};
+	Check(vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &descriptorPool),
+		"vkCreateDescriptorPool");
+
+	VkDescriptorSetAllocateInfo setAllocInfo{};
+	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setAllocInfo.descriptorPool = descriptorPool;
+	setAllocInfo.descriptorSetCount = 1;
+	setAllocInfo.pSetLayouts = &setLayout;
+	VkDescriptorSet descriptorSet{};
+	Check(vkAllocateDescriptorSets(device, &setAllocInfo, &descriptorSet),
+		"vkAllocateDescriptorSets");
+
+	VkDescriptorBufferInfo descriptorBufferInfo{};
+	descriptorBufferInfo.buffer = buffer;
+	descriptorBufferInfo.offset = 0;
+	descriptorBufferInfo.range = MatrixUBO::GetSize();
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = descriptorSet;
+	descriptorWrite.dstBinding = 0;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	descriptorWrite.pBufferInfo = &descriptorBufferInfo;
+	vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+
+	// a grid of scaled models, like the benchmark draws of the engine
+	std::vector<glm::mat4> models(drawCount);
+	for (uint32_t i = 0; i < drawCount; ++i)
+	{
+		const glm::vec3 gridPos{ static_cast<float>(i % 32),
+			static_cast<float>((i / 32) % 32),
+			-static_cast<float>(i / (32 * 32)) };
+		models[i] =
+			glm::scale(glm::translate(glm::mat4{ 1.0f }, gridPos * 2.0f), glm::vec3{ 0.5f });
+	}
+	const glm::mat4 view = glm::lookAt(
+		glm::vec3{ 0.0f, 0.0f, 5.0f }, glm::vec3{ 0.0f }, glm::vec3{ 0.0f, 1.0f, 0.0f });
+	const glm::mat4 viewProj =
+		glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f) * view;
+
+	// only what differs between the paths is recorded, the draws themselves are the same; the
+	// command buffer is never submitted
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	const auto record = [&](auto&& bindDraw) {
+		Check(vkBeginCommandBuffer(cmdBuff, &beginInfo), "vkBeginCommandBuffer");
+		for (uint32_t i = 0; i < drawCount; ++i)
+			bindDraw(i);
+		Check(vkEndCommandBuffer(cmdBuff), "vkEndCommandBuffer");
+		Check(vkResetCommandBuffer(cmdBuff, 0), "vkResetCommandBuffer");
+	};
+
+	float pushConstantTime = 0.0f;
+	if (pushConstantsSupported)
+	{
+		pushConstantTime = MeasureMs(iterations, [&]() {
+			record([&](uint32_t i) {
+				const PerDrawData drawData{ models[i], glm::inverseTranspose(models[i]) };
+				vkCmdPushConstants(cmdBuff,
+					pipelineLayout,
+					VK_SHADER_STAGE_VERTEX_BIT,
+					0,
+					PerDrawData::GetSize(),
+					&drawData);
+			});
+		});
+	}
+
+	const float uboTime = MeasureMs(iterations, [&]() {
+		record([&](uint32_t i) {
+			const MatrixUBO mat{ models[i], viewProj, glm::inverseTranspose(models[i]) };
+			const VkDeviceSize slotOffset = slotStride * i;
+			std::memcpy(static_cast<char*>(mapped) + slotOffset, &mat, MatrixUBO::GetSize());
+
+			const auto dynamicOffset = static_cast<uint32_t>(slotOffset);
+			vkCmdBindDescriptorSets(cmdBuff,
+				VK_PIPELINE_BIND_POINT_GRAPHICS,
+				pipelineLayout,
+				0,
+				1,
+				&descriptorSet,
+				1,
+				&dynamicOffset);
+		});
+	});
+
+	const double nsPerDraw = 1e6 / static_cast<double>(drawCount);
+	std::printf("%s, %u draws, %u bytes of per-draw data\n",
+		properties.deviceName,
+		drawCount,
+		PerDrawData::GetSize());
+	if (pushConstantsSupported)
+	{
+		std::printf("push constants: %.3f ms (%.1f ns per draw)\n",
+			static_cast<double>(pushConstantTime),
+			static_cast<double>(pushConstantTime) * nsPerDraw);
+	}
+	else
+	{
+		std::printf("push constants: not supported, maxPushConstantsSize is %u\n",
+			properties.limits.maxPushConstantsSize);
+	}
+	std::printf("dynamic UBO:    %.3f ms (%.1f ns per draw)\n",
+		static_cast<double>(uboTime),
+		static_cast<double>(uboTime) * nsPerDraw);
+
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	vkUnmapMemory(device, bufferMemory);
+	vkDestroyBuffer(device, buffer, nullptr);
+	vkFreeMemory(device, bufferMemory, nullptr);
+	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+	vkDestroyCommandPool(device, commandPool, nullptr);
+	vkDestroyDevice(device, nullptr);
+	vkDestroyInstance(instance, nullptr);
+
+	return EXIT_SUCCESS;
+}
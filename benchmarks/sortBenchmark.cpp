@@ -0,0 +1,93 @@
+// standalone benchmark of the draw list radix sort
+// usage: sortBenchmark [draw count] [iterations]
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include "core/jobSystem.h"
+#include "engine/drawList.h"
+
+
+template<typename Fn>
+float MeasureMs(uint32_t iterations, Fn&& fn)
+{
+	// the fastest run, the others are slowed down by whatever else runs on the machine
+	float bestTime = std::numeric_limits<float>::max();
+	for (uint32_t i = 0; i < iterations; ++i)
+	{
+		const auto startTime = std::chrono::high_resolution_clock::now();
+		fn();
+		bestTime = std::min(bestTime,
+			std::chrono::duration<float, std::chrono::milliseconds::period>(
+				std::chrono::high_resolution_clock::now() - startTime)
+				.count());
+	}
+
+	return bestTime;
+}
+
+int main(int argc, char** argv)
+{
+	const auto drawCount =
+		static_cast<uint32_t>(argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1'000'000);
+	const auto iterations =
+		static_cast<uint32_t>(argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100);
+
+	// a few pipelines and materials, many meshes and random depths
+	std::mt19937 rng{ 1234 };
+	std::uniform_int_distribution<uint32_t> pipelineDist{ 0, 3 };
+	std::uniform_int_distribution<uint32_t> materialDist{ 0, 31 };
+	std::uniform_int_distribution<uint32_t> meshDist{ 0, 255 };
+	std::uniform_real_distribution<float> depthDist{ 0.0f, 1.0f };
+
+	DrawList unsorted;
+	unsorted.Resize(drawCount);
+	for (uint32_t i = 0; i < drawCount; ++i)
+	{
+		unsorted.keys[i] = DrawList::MakeKey(
+			pipelineDist(rng), materialDist(rng), meshDist(rng), depthDist(rng));
+		unsorted.draws[i] = i;
+	}
+
+	const uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	JobSystem jobSystem{ hardwareThreads - 1 };
+	DrawListSorter sorter{ jobSystem };
+
+	// std::stable_sort of the same keys as reference
+	DrawList reference;
+	const float stableSortTime = MeasureMs(iterations, [&]() {
+		std::vector<uint32_t> order(drawCount);
+		for (uint32_t i = 0; i < drawCount; ++i)
+			order[i] = i;
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+			return unsorted.keys[a] < unsorted.keys[b];
+		});
+		reference.Resize(drawCount);
+		for (uint32_t i = 0; i < drawCount; ++i)
+		{
+			reference.keys[i] = unsorted.keys[order[i]];
+			reference.draws[i] = unsorted.draws[order[i]];
+		}
+	});
+
+	DrawList sorted;
+	const float radixSortTime = MeasureMs(iterations, [&]() {
+		sorted = unsorted;
+		sorter.Sort(sorted);
+	});
+
+	// both sorts are stable, so the payloads match as well
+	const bool isEqual = sorted.keys == reference.keys && sorted.draws == reference.draws;
+	std::printf("%u draws, %s\n", drawCount, isEqual ? "sorted" : "NOT SORTED");
+	std::printf("std::stable_sort: %.3f ms\n", static_cast<double>(stableSortTime));
+	std::printf("radix sort, %u threads: %.3f ms\n",
+		hardwareThreads,
+		static_cast<double>(radixSortTime));
+
+	return isEqual ? EXIT_SUCCESS : EXIT_FAILURE;
+}
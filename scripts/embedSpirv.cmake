@@ -0,0 +1,14 @@
+# writes the words of the SPIR-V file INPUT to OUTPUT as `uint32_t` literals, to be included into
+# an array initializer (`embeddedShaders.gen.cpp`)
+# cmake -DINPUT=<file.spv> -DOUTPUT=<file.spv.inc> -P embedSpirv.cmake
+
+file(READ "${INPUT}" SPIRV HEX)
+string(LENGTH "${SPIRV}" SPIRV_LENGTH)
+math(EXPR SPIRV_REMAINDER "${SPIRV_LENGTH} % 8")
+if(SPIRV_LENGTH EQUAL 0 OR NOT SPIRV_REMAINDER EQUAL 0)
+	message(FATAL_ERROR "${INPUT} is not a SPIR-V file")
+endif()
+
+# glslc writes the words little endian
+string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1u,\n" SPIRV_WORDS "${SPIRV}")
+file(WRITE "${OUTPUT}" "${SPIRV_WORDS}")
@@ -0,0 +1,220 @@
+#include "core/jobSystem.h"
+
+#include <algorithm>
+#include <utility>
+
+
+// the job system and the index of the worker the current thread runs; the index is only valid for
+// that job system
+thread_local const JobSystem* t_WorkerJobSystem = nullptr;
+thread_local uint32_t t_WorkerIndex = 0;
+
+
+bool JobCounter::IsDone()
+{
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+	return m_Count == 0;
+}
+
+void JobCounter::Increment(uint32_t count)
+{
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+	m_Count += count;
+}
+
+bool JobCounter::Decrement(std::vector<std::function<void()>>& continuations)
+{
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+	if (--m_Count != 0)
+		return false;
+
+	continuations.swap(m_Continuations);
+	return true;
+}
+
+JobSystem::JobSystem(uint32_t workerCount)
+{
+	m_Queues.reserve(workerCount + 1);
+	for (uint32_t i = 0; i < workerCount + 1; ++i)
+		m_Queues.push_back(std::make_unique<JobQueue>());
+
+	m_Workers.reserve(workerCount);
+	for (uint32_t i = 0; i < workerCount; ++i)
+		m_Workers.emplace_back([this, i]() { WorkerLoop(i); });
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_SleepMutex };
+		m_Stop = true;
+	}
+	m_WorkAvailable.notify_all();
+
+	for (auto& worker : m_Workers)
+		worker.join();
+}
+
+void JobSystem::Run(JobFn job, JobCounter* counter)
+{
+	if (counter != nullptr)
+		counter->Increment(1);
+
+	Push(Job{ std::move(job), counter });
+}
+
+void JobSystem::RunAfter(JobCounter& dependency, JobFn job, JobCounter* counter)
+{
+	// the job counts as unfinished while it waits for its dependency
+	if (counter != nullptr)
+		counter->Increment(1);
+
+	{
+		std::lock_guard<std::mutex> lock{ dependency.m_Mutex };
+		if (dependency.m_Count > 0)
+		{
+			dependency.m_Continuations.emplace_back(
+				[this, job = std::move(job), counter]() mutable {
+					Push(Job{ std::move(job), counter });
+				});
+			return;
+		}
+	}
+
+	Push(Job{ std::move(job), counter });
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t batchSize, RangeFn fn, JobCounter& counter)
+{
+	if (count == 0)
+		return;
+
+	batchSize = std::max(batchSize, 1u);
+	const uint32_t batchCount = (count + batchSize - 1) / batchSize;
+	counter.Increment(batchCount);
+
+	// shared by the batches, so the caller does not have to keep `fn` alive
+	const auto sharedFn = std::make_shared<RangeFn>(std::move(fn));
+	for (uint32_t batch = 0; batch < batchCount; ++batch)
+	{
+		const uint32_t begin = batch * batchSize;
+		const uint32_t end = std::min(begin + batchSize, count);
+		Push(Job{ [sharedFn, begin, end]() { (*sharedFn)(begin, end); }, &counter });
+	}
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+	while (!counter.IsDone())
+	{
+		Job job;
+		if (TryPop(job))
+		{
+			Execute(job);
+			continue;
+		}
+
+		// the remaining jobs of the counter run on other threads; `Execute()` wakes the waiting
+		// threads when a counter reaches zero
+		std::unique_lock<std::mutex> lock{ m_SleepMutex };
+		m_WorkAvailable.wait(
+			lock, [this, &counter]() { return m_QueuedJobs > 0 || counter.IsDone(); });
+	}
+}
+
+void JobSystem::WorkerLoop(uint32_t workerIndex)
+{
+	t_WorkerJobSystem = this;
+	t_WorkerIndex = workerIndex;
+
+	while (true)
+	{
+		Job job;
+		if (TryPop(job))
+		{
+			Execute(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock{ m_SleepMutex };
+		m_WorkAvailable.wait(lock, [this]() { return m_Stop || m_QueuedJobs > 0; });
+		if (m_Stop && m_QueuedJobs == 0)
+			return;
+	}
+}
+
+uint32_t JobSystem::GetQueueIndex() const
+{
+	return t_WorkerJobSystem == this ? t_WorkerIndex : GetWorkerCount();
+}
+
+void JobSystem::Push(Job job)
+{
+	// counted first, a thread that pops the job right after it is pushed decrements it
+	++m_QueuedJobs;
+	JobQueue& queue = *m_Queues[GetQueueIndex()];
+	{
+		std::lock_guard<std::mutex> lock{ queue.mutex };
+		queue.jobs.push_back(std::move(job));
+	}
+
+	// the sleep mutex is taken so that a worker cannot miss the wake up between checking
+	// `m_QueuedJobs` and starting to wait
+	{
+		std::lock_guard<std::mutex> lock{ m_SleepMutex };
+	}
+	m_WorkAvailable.notify_one();
+}
+
+bool JobSystem::TryPop(Job& job)
+{
+	const auto queueCount = static_cast<uint32_t>(m_Queues.size());
+	const uint32_t ownQueue = GetQueueIndex();
+
+	// own jobs are taken from the back (most recent, still in cache), stolen jobs from the front
+	for (uint32_t i = 0; i < queueCount; ++i)
+	{
+		const uint32_t queueIndex = (ownQueue + i) % queueCount;
+		JobQueue& queue = *m_Queues[queueIndex];
+
+		std::lock_guard<std::mutex> lock{ queue.mutex };
+		if (queue.jobs.empty())
+			continue;
+
+		if (queueIndex == ownQueue)
+		{
+			job = std::move(queue.jobs.back());
+			queue.jobs.pop_back();
+		}
+		else
+		{
+			job = std::move(queue.jobs.front());
+			queue.jobs.pop_front();
+		}
+		--m_QueuedJobs;
+
+		return true;
+	}
+
+	return false;
+}
+
+void JobSystem::Execute(Job& job)
+{
+	job.fn();
+
+	if (job.counter == nullptr)
+		return;
+
+	// the counter may be destroyed by a waiting thread as soon as it reached zero
+	std::vector<std::function<void()>> continuations;
+	if (!job.counter->Decrement(continuations))
+		return;
+
+	for (auto& continuation : continuations)
+		continuation();
+	{
+		std::lock_guard<std::mutex> lock{ m_SleepMutex };
+	}
+	m_WorkAvailable.notify_all();
+}
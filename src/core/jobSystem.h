@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <condition_variable>
+
+
+class JobSystem;
+
+// number of unfinished jobs of a group
+// continuations queued with `JobSystem::RunAfter()` run once it reaches zero
+class JobCounter
+{
+public:
+	JobCounter() = default;
+	JobCounter(const JobCounter&) = delete;
+	JobCounter(JobCounter&&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+	JobCounter& operator=(JobCounter&&) = delete;
+
+	[[nodiscard]] bool IsDone();
+
+private:
+	friend class JobSystem;
+
+	void Increment(uint32_t count);
+	// returns true once the counter reached zero, `continuations` are the ones that became ready
+	bool Decrement(std::vector<std::function<void()>>& continuations);
+
+	// the counter is only touched under the lock, so a waiting thread can destroy it as soon as
+	// `IsDone()` returns true
+	std::mutex m_Mutex;
+	uint32_t m_Count = 0;
+	std::vector<std::function<void()>> m_Continuations;
+};
+
+// work-stealing job scheduler
+// every worker owns a deque: it pushes and pops its own jobs at the back and steals from the
+// front of the others; jobs from threads outside the pool (or the workers of another job system)
+// go to a shared queue
+// waiting on a counter runs other jobs and sleeps once there are none left to run
+class JobSystem
+{
+public:
+	using JobFn = std::function<void()>;
+	using RangeFn = std::function<void(uint32_t begin, uint32_t end)>;
+
+	explicit JobSystem(uint32_t workerCount);
+	~JobSystem();
+	JobSystem(const JobSystem&) = delete;
+	JobSystem(JobSystem&&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+	JobSystem& operator=(JobSystem&&) = delete;
+
+	// jobs must not throw
+	void Run(JobFn job, JobCounter* counter = nullptr);
+	// queues `job` once `dependency` reached zero
+	void RunAfter(JobCounter& dependency, JobFn job, JobCounter* counter = nullptr);
+	// splits [0, count) into jobs of at most `batchSize` indices
+	void ParallelFor(uint32_t count, uint32_t batchSize, RangeFn fn, JobCounter& counter);
+	// runs queued jobs on the calling thread until `counter` reached zero
+	void Wait(JobCounter& counter);
+
+	[[nodiscard]] inline uint32_t GetWorkerCount() const
+	{
+		return static_cast<uint32_t>(m_Workers.size());
+	}
+
+private:
+	struct Job
+	{
+		JobFn fn;
+		JobCounter* counter = nullptr;
+	};
+
+	struct JobQueue
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	void WorkerLoop(uint32_t workerIndex);
+	// the deque of the calling worker, the shared queue for other threads
+	[[nodiscard]] uint32_t GetQueueIndex() const;
+	void Push(Job job);
+	bool TryPop(Job& job);
+	void Execute(Job& job);
+
+	std::vector<std::thread> m_Workers;
+	// one deque per worker, the last one is shared by the threads outside the pool
+	std::vector<std::unique_ptr<JobQueue>> m_Queues;
+
+	// counted before a job is pushed, so a pop never sees it below zero
+	std::atomic<uint32_t> m_QueuedJobs{ 0 };
+	std::mutex m_SleepMutex;
+	// new jobs for the workers and the waiting threads, finished counters for the waiting threads
+	std::condition_variable m_WorkAvailable;
+	bool m_Stop = false;
+};
@@ -22,6 +22,8 @@ public:
 		return m_ViewProjectionMatrix;
 	}
 	[[nodiscard]] inline glm::vec3 GetCameraPosition() const { return m_CameraPos; }
+	[[nodiscard]] inline float GetZNear() const { return m_ZNear; }
+	[[nodiscard]] inline float GetZFar() const { return m_ZFar; }
 
 private:
 	bool m_FirstMouseMove = true;
@@ -0,0 +1,277 @@
+#include "engine/clusteredLighting.h"
+
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include "core/core.h"
+#include "engine/initializers.h"
+#include "engine/shader.h"
+#include "engine/shaderPermutation.h"
+#include "utils/utils.h"
+
+
+// local size of cluster.comp
+constexpr uint32_t g_ClusterGroupSize = 64;
+
+ClusteredLighting::ClusteredLighting(const std::unique_ptr<Device>& device,
+	VkCommandPool commandPool,
+	VkDescriptorPool descriptorPool,
+	VkPipelineCache pipelineCache,
+	const std::vector<PointLight>& lights)
+	: m_Device{ device },
+	  m_LightCount{ static_cast<uint32_t>(lights.size()) }
+{
+	CreateBuffers(commandPool, lights);
+	CreateDescriptorSetLayout();
+	CreateDescriptorSets(descriptorPool);
+	CreatePipeline(pipelineCache);
+}
+
+ClusteredLighting::~ClusteredLighting()
+{
+	vkDestroyPipeline(m_Device->GetDevice(), m_Pipeline, nullptr);
+	vkDestroyPipelineLayout(m_Device->GetDevice(), m_PipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(m_Device->GetDevice(), m_DescriptorSetLayout, nullptr);
+
+	for (size_t i = 0; i < m_UniformBuffers.size(); ++i)
+	{
+		vkDestroyBuffer(m_Device->GetDevice(), m_UniformBuffers[i], nullptr);
+		vkFreeMemory(m_Device->GetDevice(), m_UniformBufferMemory[i], nullptr);
+		vkDestroyBuffer(m_Device->GetDevice(), m_LightGridBuffers[i], nullptr);
+		vkFreeMemory(m_Device->GetDevice(), m_LightGridBufferMemory[i], nullptr);
+		vkDestroyBuffer(m_Device->GetDevice(), m_LightIndexBuffers[i], nullptr);
+		vkFreeMemory(m_Device->GetDevice(), m_LightIndexBufferMemory[i], nullptr);
+	}
+
+	vkDestroyBuffer(m_Device->GetDevice(), m_LightBuffer, nullptr);
+	vkFreeMemory(m_Device->GetDevice(), m_LightBufferMemory, nullptr);
+}
+
+void ClusteredLighting::RecordAssign(VkCommandBuffer cmdBuff,
+	uint32_t frameIndex,
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	float zNear,
+	float zFar,
+	VkExtent2D extent,
+	uint32_t lightCount)
+{
+	// exponential slices, so the clusters keep roughly the same proportions at any depth
+	const float logDepthRange = std::log(zFar / zNear);
+
+	ClusterUniforms uniforms{};
+	uniforms.view = view;
+	uniforms.inverseProjection = glm::inverse(projection);
+	uniforms.gridSize = glm::uvec4{ GRID_SIZE_X,
+		GRID_SIZE_Y,
+		GRID_SIZE_Z,
+		std::min(lightCount, m_LightCount) };
+	uniforms.screenSize = glm::vec2{ static_cast<float>(extent.width),
+		static_cast<float>(extent.height) };
+	// rounded up, so the tiles cover the whole screen
+	const uint32_t tileWidth = (extent.width + GRID_SIZE_X - 1) / GRID_SIZE_X;
+	const uint32_t tileHeight = (extent.height + GRID_SIZE_Y - 1) / GRID_SIZE_Y;
+	uniforms.tileSize = glm::vec2{ static_cast<float>(tileWidth), static_cast<float>(tileHeight) };
+	uniforms.zNear = zNear;
+	uniforms.zFar = zFar;
+	uniforms.sliceScale = static_cast<float>(GRID_SIZE_Z) / logDepthRange;
+	uniforms.sliceBias = -static_cast<float>(GRID_SIZE_Z) * std::log(zNear) / logDepthRange;
+	// the frame that last used the buffer is done
+	memcpy(m_UniformBufferMapped[frameIndex], &uniforms, sizeof(ClusterUniforms));
+
+	vkCmdBindPipeline(cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline);
+	vkCmdBindDescriptorSets(cmdBuff,
+		VK_PIPELINE_BIND_POINT_COMPUTE,
+		m_PipelineLayout,
+		0,
+		1,
+		&m_DescriptorSets[frameIndex],
+		0,
+		nullptr);
+	vkCmdDispatch(cmdBuff, (CLUSTER_COUNT + g_ClusterGroupSize - 1) / g_ClusterGroupSize, 1, 1);
+
+	// the light lists are read by the fragment shaders
+	VkMemoryBarrier assignBarrier{};
+	assignBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	assignBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	assignBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(cmdBuff,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		0,
+		1,
+		&assignBarrier,
+		0,
+		nullptr,
+		0,
+		nullptr);
+}
+
+void ClusteredLighting::CreateBuffers(VkCommandPool commandPool,
+	const std::vector<PointLight>& lights)
+{
+	// an empty buffer can't be created or bound
+	const VkDeviceSize lightBufferSize = sizeof(PointLight) * std::max<size_t>(lights.size(), 1);
+	VkBuffer stagingBuffer = nullptr;
+	VkDeviceMemory stagingBufferMemory = nullptr;
+	utils::CreateBuffer(m_Device,
+		lightBufferSize,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		stagingBuffer,
+		stagingBufferMemory);
+
+	void* mapped = nullptr;
+	vkMapMemory(m_Device->GetDevice(), stagingBufferMemory, 0, lightBufferSize, 0, &mapped);
+	memset(mapped, 0, lightBufferSize);
+	memcpy(mapped, lights.data(), sizeof(PointLight) * lights.size());
+	vkUnmapMemory(m_Device->GetDevice(), stagingBufferMemory);
+
+	utils::CreateBuffer(m_Device,
+		lightBufferSize,
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		m_LightBuffer,
+		m_LightBufferMemory);
+	utils::CopyBuffer(m_Device, commandPool, stagingBuffer, m_LightBuffer, lightBufferSize);
+
+	vkFreeMemory(m_Device->GetDevice(), stagingBufferMemory, nullptr);
+	vkDestroyBuffer(m_Device->GetDevice(), stagingBuffer, nullptr);
+
+	m_UniformBuffers.resize(Config::maxFramesInFlight);
+	m_UniformBufferMemory.resize(Config::maxFramesInFlight);
+	m_UniformBufferMapped.resize(Config::maxFramesInFlight);
+	m_LightGridBuffers.resize(Config::maxFramesInFlight);
+	m_LightGridBufferMemory.resize(Config::maxFramesInFlight);
+	m_LightIndexBuffers.resize(Config::maxFramesInFlight);
+	m_LightIndexBufferMemory.resize(Config::maxFramesInFlight);
+	for (uint32_t i = 0; i < Config::maxFramesInFlight; ++i)
+	{
+		// kept mapped, written while recording
+		utils::CreateBuffer(m_Device,
+			sizeof(ClusterUniforms),
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			m_UniformBuffers[i],
+			m_UniformBufferMemory[i]);
+		vkMapMemory(m_Device->GetDevice(),
+			m_UniformBufferMemory[i],
+			0,
+			sizeof(ClusterUniforms),
+			0,
+			&m_UniformBufferMapped[i]);
+
+		// every cluster writes its own count, so nothing has to be cleared
+		utils::CreateBuffer(m_Device,
+			sizeof(uint32_t) * CLUSTER_COUNT,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			m_LightGridBuffers[i],
+			m_LightGridBufferMemory[i]);
+		utils::CreateBuffer(m_Device,
+			sizeof(uint32_t) * CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			m_LightIndexBuffers[i],
+			m_LightIndexBufferMemory[i]);
+	}
+}
+
+void ClusteredLighting::CreateDescriptorSetLayout()
+{
+	// uniforms, lights, light grid, light indices
+	std::array<VkDescriptorSetLayoutBinding, 4> layoutBindings{};
+	for (uint32_t i = 0; i < layoutBindings.size(); ++i)
+	{
+		layoutBindings[i] = inits::DescriptorSetLayoutBinding(
+			i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+	}
+	layoutBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+
+	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
+	descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
+	descriptorSetLayoutInfo.pBindings = layoutBindings.data();
+
+	ErrCheck(vkCreateDescriptorSetLayout(
+				 m_Device->GetDevice(), &descriptorSetLayoutInfo, nullptr, &m_DescriptorSetLayout)
+				 != VK_SUCCESS,
+		"Failed to create light cluster descriptor set layout!");
+}
+
+void ClusteredLighting::CreateDescriptorSets(VkDescriptorPool descriptorPool)
+{
+	std::vector<VkDescriptorSetLayout> setLayouts{ Config::maxFramesInFlight,
+		m_DescriptorSetLayout };
+	VkDescriptorSetAllocateInfo descriptorSetAllocInfo{};
+	descriptorSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	descriptorSetAllocInfo.descriptorPool = descriptorPool;
+	descriptorSetAllocInfo.descriptorSetCount = static_cast<uint32_t>(setLayouts.size());
+	descriptorSetAllocInfo.pSetLayouts = setLayouts.data();
+
+	m_DescriptorSets.resize(Config::maxFramesInFlight);
+	ErrCheck(vkAllocateDescriptorSets(
+				 m_Device->GetDevice(), &descriptorSetAllocInfo, m_DescriptorSets.data())
+				 != VK_SUCCESS,
+		"Failed to allocate light cluster descriptor sets!");
+
+	for (uint32_t i = 0; i < Config::maxFramesInFlight; ++i)
+	{
+		const std::array<VkDescriptorBufferInfo, 4> bufferInfos{
+			inits::DescriptorBufferInfo(m_UniformBuffers[i], 0, VK_WHOLE_SIZE),
+			inits::DescriptorBufferInfo(m_LightBuffer, 0, VK_WHOLE_SIZE),
+			inits::DescriptorBufferInfo(m_LightGridBuffers[i], 0, VK_WHOLE_SIZE),
+			inits::DescriptorBufferInfo(m_LightIndexBuffers[i], 0, VK_WHOLE_SIZE),
+		};
+
+		std::array<VkWriteDescriptorSet, 4> descWrites{};
+		for (uint32_t j = 0; j < descWrites.size(); ++j)
+		{
+			descWrites[j] = inits::WriteDescriptorSet(m_DescriptorSets[i],
+				j,
+				j == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				1,
+				&bufferInfos[j],
+				nullptr);
+		}
+
+		vkUpdateDescriptorSets(m_Device->GetDevice(),
+			static_cast<uint32_t>(descWrites.size()),
+			descWrites.data(),
+			0,
+			nullptr);
+	}
+}
+
+void ClusteredLighting::CreatePipeline(VkPipelineCache pipelineCache)
+{
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &m_DescriptorSetLayout;
+	ErrCheck(vkCreatePipelineLayout(
+				 m_Device->GetDevice(), &pipelineLayoutInfo, nullptr, &m_PipelineLayout)
+				 != VK_SUCCESS,
+		"Failed to create light cluster pipeline layout!");
+
+	// `MAX_LIGHTS_PER_CLUSTER` of the shader
+	const ShaderSpecialization specialization;
+	const Shader computeShader{ m_Device->GetDevice(),
+		"assets/shaders/out/cluster.comp.spv",
+		ShaderType::COMPUTE,
+		specialization.Get() };
+
+	VkComputePipelineCreateInfo computePipelineInfo{};
+	computePipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	computePipelineInfo.stage = computeShader.GetShaderStage();
+	computePipelineInfo.layout = m_PipelineLayout;
+	ErrCheck(vkCreateComputePipelines(m_Device->GetDevice(),
+				 pipelineCache,
+				 1,
+				 &computePipelineInfo,
+				 nullptr,
+				 &m_Pipeline)
+				 != VK_SUCCESS,
+		"Failed to create light cluster pipeline!");
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include "engine/device.h"
+
+
+// clustered forward lighting
+// the view frustum is split into froxels, screen tiles times exponential depth slices; a compute
+// pass assigns the point lights to the froxels they touch, so every fragment only shades the
+// lights of its own froxel instead of all of them
+class ClusteredLighting
+{
+public:
+	// std430 layout of `PointLight` in cluster.comp and the shaders that read the lights
+	struct PointLight
+	{
+		glm::vec4 positionRadius; // world space; xyz position, w range
+		glm::vec4 color; // rgb intensity
+	};
+
+	// froxel grid; the shaders read it from the cluster uniforms
+	static constexpr uint32_t GRID_SIZE_X = 16;
+	static constexpr uint32_t GRID_SIZE_Y = 9;
+	static constexpr uint32_t GRID_SIZE_Z = 24;
+	static constexpr uint32_t CLUSTER_COUNT = GRID_SIZE_X * GRID_SIZE_Y * GRID_SIZE_Z;
+	// the lights beyond it are dropped; the shaders are specialized with it
+	static constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 256;
+
+	// the lights don't change, so they are uploaded once
+	ClusteredLighting(const std::unique_ptr<Device>& device,
+		VkCommandPool commandPool,
+		VkDescriptorPool descriptorPool,
+		VkPipelineCache pipelineCache,
+		const std::vector<PointLight>& lights);
+	~ClusteredLighting();
+	ClusteredLighting(const ClusteredLighting&) = delete;
+	ClusteredLighting(ClusteredLighting&&) = delete;
+	ClusteredLighting& operator=(const ClusteredLighting&) = delete;
+	ClusteredLighting& operator=(ClusteredLighting&&) = delete;
+
+	// recorded outside of a render pass, before the draws that shade with the clusters
+	// only the first `lightCount` lights are assigned
+	void RecordAssign(VkCommandBuffer cmdBuff,
+		uint32_t frameIndex,
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		float zNear,
+		float zFar,
+		VkExtent2D extent,
+		uint32_t lightCount);
+
+	[[nodiscard]] inline uint32_t GetLightCount() const { return m_LightCount; }
+
+	// read by the fragment shaders, per frame in flight except the lights
+	[[nodiscard]] inline VkBuffer GetUniformBuffer(uint32_t frameIndex) const
+	{
+		return m_UniformBuffers[frameIndex];
+	}
+	[[nodiscard]] inline VkBuffer GetLightBuffer() const { return m_LightBuffer; }
+	// light count per cluster
+	[[nodiscard]] inline VkBuffer GetLightGridBuffer(uint32_t frameIndex) const
+	{
+		return m_LightGridBuffers[frameIndex];
+	}
+	// `MAX_LIGHTS_PER_CLUSTER` light indices per cluster
+	[[nodiscard]] inline VkBuffer GetLightIndexBuffer(uint32_t frameIndex) const
+	{
+		return m_LightIndexBuffers[frameIndex];
+	}
+
+private:
+	// std140 layout of `ClusterUniforms` in cluster.comp
+	struct ClusterUniforms
+	{
+		glm::mat4 view;
+		glm::mat4 inverseProjection;
+		glm::uvec4 gridSize; // xyz clusters, w light count
+		glm::vec2 tileSize; // pixels
+		glm::vec2 screenSize;
+		float zNear;
+		float zFar;
+		// slice = log(view depth) * sliceScale + sliceBias
+		float sliceScale;
+		float sliceBias;
+	};
+
+	void CreateBuffers(VkCommandPool commandPool, const std::vector<PointLight>& lights);
+	void CreateDescriptorSetLayout();
+	void CreateDescriptorSets(VkDescriptorPool descriptorPool);
+	void CreatePipeline(VkPipelineCache pipelineCache);
+
+	const std::unique_ptr<Device>& m_Device;
+
+	uint32_t m_LightCount = 0;
+
+	VkBuffer m_LightBuffer{};
+	VkDeviceMemory m_LightBufferMemory{};
+	// per frame in flight, the previous frames may still shade with theirs
+	std::vector<VkBuffer> m_UniformBuffers;
+	std::vector<VkDeviceMemory> m_UniformBufferMemory;
+	std::vector<void*> m_UniformBufferMapped;
+	std::vector<VkBuffer> m_LightGridBuffers;
+	std::vector<VkDeviceMemory> m_LightGridBufferMemory;
+	std::vector<VkBuffer> m_LightIndexBuffers;
+	std::vector<VkDeviceMemory> m_LightIndexBufferMemory;
+
+	VkDescriptorSetLayout m_DescriptorSetLayout{};
+	std::vector<VkDescriptorSet> m_DescriptorSets;
+	VkPipelineLayout m_PipelineLayout{};
+	VkPipeline m_Pipeline{};
+};
@@ -0,0 +1,241 @@
+#include "engine/cpuCulling.h"
+
+#include <array>
+#include <algorithm>
+#include "engine/simd.h"
+
+
+// the number of objects tested by one job
+constexpr uint32_t g_CullChunkSize = 16384;
+
+void CullingBounds::Reserve(uint32_t count)
+{
+	for (auto* component : { &m_CenterX,
+			 &m_CenterY,
+			 &m_CenterZ,
+			 &m_Radius,
+			 &m_MinX,
+			 &m_MinY,
+			 &m_MinZ,
+			 &m_MaxX,
+			 &m_MaxY,
+			 &m_MaxZ })
+		component->reserve(count);
+}
+
+void CullingBounds::Clear()
+{
+	for (auto* component : { &m_CenterX,
+			 &m_CenterY,
+			 &m_CenterZ,
+			 &m_Radius,
+			 &m_MinX,
+			 &m_MinY,
+			 &m_MinZ,
+			 &m_MaxX,
+			 &m_MaxY,
+			 &m_MaxZ })
+		component->clear();
+}
+
+uint32_t CullingBounds::Add(const glm::vec4& sphere,
+	const glm::vec3& aabbMin,
+	const glm::vec3& aabbMax)
+{
+	m_CenterX.push_back(sphere.x);
+	m_CenterY.push_back(sphere.y);
+	m_CenterZ.push_back(sphere.z);
+	m_Radius.push_back(sphere.w);
+	m_MinX.push_back(aabbMin.x);
+	m_MinY.push_back(aabbMin.y);
+	m_MinZ.push_back(aabbMin.z);
+	m_MaxX.push_back(aabbMax.x);
+	m_MaxY.push_back(aabbMax.y);
+	m_MaxZ.push_back(aabbMax.z);
+
+	return GetCount() - 1;
+}
+
+uint32_t CullingBounds::Add(const glm::mat4& model,
+	const glm::vec4& sphere,
+	const glm::vec3& aabbMin,
+	const glm::vec3& aabbMax)
+{
+	// the radius grows with the largest scale of the model matrix
+	const float maxScale = std::max({ glm::length(glm::vec3(model[0])),
+		glm::length(glm::vec3(model[1])),
+		glm::length(glm::vec3(model[2])) });
+	const glm::vec4 worldSphere{ glm::vec3(model * glm::vec4(glm::vec3(sphere), 1.0f)),
+		sphere.w * maxScale };
+
+	// the world AABB of the transformed box (Arvo)
+	glm::vec3 worldMin{ model[3] };
+	glm::vec3 worldMax{ model[3] };
+	for (glm::length_t col = 0; col < 3; ++col)
+	{
+		const glm::vec3 a = glm::vec3(model[col]) * aabbMin[col];
+		const glm::vec3 b = glm::vec3(model[col]) * aabbMax[col];
+		worldMin += glm::min(a, b);
+		worldMax += glm::max(a, b);
+	}
+
+	return Add(worldSphere, worldMin, worldMax);
+}
+
+void CpuCulling::Cull(const CullingBounds& bounds,
+	const Frustum& frustum,
+	uint32_t count,
+	std::vector<uint32_t>& visible)
+{
+	count = std::min(count, bounds.GetCount());
+	visible.resize(count);
+
+	// every chunk writes its visible indices to its own part of `visible`
+	const uint32_t chunkCount = (count + g_CullChunkSize - 1) / g_CullChunkSize;
+	m_ChunkVisibleCounts.assign(chunkCount, 0);
+
+	JobCounter cullCounter;
+	m_JobSystem.ParallelFor(
+		chunkCount,
+		1,
+		[this, &bounds, &frustum, &visible, count](uint32_t begin, uint32_t end) {
+			for (uint32_t chunk = begin; chunk < end; ++chunk)
+			{
+				const uint32_t first = chunk * g_CullChunkSize;
+				m_ChunkVisibleCounts[chunk] = CullRange(bounds,
+					frustum,
+					first,
+					std::min(first + g_CullChunkSize, count),
+					visible.data() + first);
+			}
+		},
+		cullCounter);
+	m_JobSystem.Wait(cullCounter);
+
+	// the chunks are moved together in order, so the indices stay sorted
+	uint32_t visibleCount = 0;
+	for (uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+	{
+		const auto first = visible.begin() + chunk * g_CullChunkSize;
+		std::copy(first, first + m_ChunkVisibleCounts[chunk], visible.begin() + visibleCount);
+		visibleCount += m_ChunkVisibleCounts[chunk];
+	}
+	visible.resize(visibleCount);
+}
+
+uint32_t CpuCulling::CullRange(const CullingBounds& bounds,
+	const Frustum& frustum,
+	uint32_t begin,
+	uint32_t end,
+	uint32_t* visible)
+{
+	uint32_t visibleCount = 0;
+
+#if defined(VKPBR_SIMD)
+	begin = CullRangeSimd<SimdNative>(bounds, frustum, begin, end, visible, visibleCount);
+#endif
+
+	// the objects that don't fill a whole register
+	for (uint32_t i = begin; i < end; ++i)
+	{
+		visible[visibleCount] = i;
+		visibleCount += IsVisible(bounds, frustum, i) ? 1 : 0;
+	}
+
+	return visibleCount;
+}
+
+template<typename Simd>
+uint32_t CpuCulling::CullRangeSimd(const CullingBounds& bounds,
+	const Frustum& frustum,
+	uint32_t begin,
+	uint32_t end,
+	uint32_t* visible,
+	uint32_t& visibleCount)
+{
+	using Float = typename Simd::Float;
+
+	struct SimdPlane
+	{
+		Float x;
+		Float y;
+		Float z;
+		Float w;
+		// the AABB corner that is furthest along the plane normal
+		const float* cornerX;
+		const float* cornerY;
+		const float* cornerZ;
+	};
+
+	std::array<SimdPlane, Frustum::PLANE_COUNT> planes{};
+	for (uint32_t p = 0; p < Frustum::PLANE_COUNT; ++p)
+	{
+		const glm::vec4& plane = frustum.planes[p];
+		planes[p].x = Simd::Set(plane.x);
+		planes[p].y = Simd::Set(plane.y);
+		planes[p].z = Simd::Set(plane.z);
+		planes[p].w = Simd::Set(plane.w);
+		planes[p].cornerX = plane.x >= 0.0f ? bounds.m_MaxX.data() : bounds.m_MinX.data();
+		planes[p].cornerY = plane.y >= 0.0f ? bounds.m_MaxY.data() : bounds.m_MinY.data();
+		planes[p].cornerZ = plane.z >= 0.0f ? bounds.m_MaxZ.data() : bounds.m_MinZ.data();
+	}
+
+	const Float zero = Simd::Set(0.0f);
+	const Float minusOne = Simd::Set(-1.0f);
+
+	uint32_t i = begin;
+	for (; i + Simd::width <= end; i += Simd::width)
+	{
+		const Float centerX = Simd::Load(bounds.m_CenterX.data() + i);
+		const Float centerY = Simd::Load(bounds.m_CenterY.data() + i);
+		const Float centerZ = Simd::Load(bounds.m_CenterZ.data() + i);
+		const Float minusRadius = Simd::Mul(Simd::Load(bounds.m_Radius.data() + i), minusOne);
+
+		Float inside = Simd::GreaterEqual(zero, zero); // all bits set
+		for (const auto& plane : planes)
+		{
+			const Float sphereDist = Simd::Add(
+				Simd::Add(Simd::Mul(plane.x, centerX), Simd::Mul(plane.y, centerY)),
+				Simd::Add(Simd::Mul(plane.z, centerZ), plane.w));
+			inside = Simd::And(inside, Simd::GreaterEqual(sphereDist, minusRadius));
+
+			const Float cornerDist = Simd::Add(
+				Simd::Add(Simd::Mul(plane.x, Simd::Load(plane.cornerX + i)),
+					Simd::Mul(plane.y, Simd::Load(plane.cornerY + i))),
+				Simd::Add(Simd::Mul(plane.z, Simd::Load(plane.cornerZ + i)), plane.w));
+			inside = Simd::And(inside, Simd::GreaterEqual(cornerDist, zero));
+		}
+
+		// branchless compaction, every lane is written but only the visible ones are kept
+		const uint32_t mask = Simd::MoveMask(inside);
+		for (uint32_t lane = 0; lane < Simd::width; ++lane)
+		{
+			visible[visibleCount] = i + lane;
+			visibleCount += (mask >> lane) & 1u;
+		}
+	}
+
+	return i;
+}
+
+bool CpuCulling::IsVisible(const CullingBounds& bounds, const Frustum& frustum, uint32_t index)
+{
+	const glm::vec3 center{ bounds.m_CenterX[index],
+		bounds.m_CenterY[index],
+		bounds.m_CenterZ[index] };
+	if (!frustum.IsSphereVisible(center, bounds.m_Radius[index]))
+		return false;
+
+	for (const auto& plane : frustum.planes)
+	{
+		const glm::vec3 corner{
+			plane.x >= 0.0f ? bounds.m_MaxX[index] : bounds.m_MinX[index],
+			plane.y >= 0.0f ? bounds.m_MaxY[index] : bounds.m_MinY[index],
+			plane.z >= 0.0f ? bounds.m_MaxZ[index] : bounds.m_MinZ[index],
+		};
+		if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "core/jobSystem.h"
+#include "engine/frustum.h"
+
+
+// world space bounding spheres and AABBs of many objects in SoA form, so one SIMD register holds
+// the same component of 4 (SSE) or 8 (AVX) objects
+class CullingBounds
+{
+public:
+	void Reserve(uint32_t count);
+	void Clear();
+	// returns the index of the object
+	uint32_t Add(const glm::vec4& sphere, const glm::vec3& aabbMin, const glm::vec3& aabbMax);
+	// model space bounds transformed into world space
+	uint32_t Add(const glm::mat4& model,
+		const glm::vec4& sphere,
+		const glm::vec3& aabbMin,
+		const glm::vec3& aabbMax);
+
+	[[nodiscard]] inline uint32_t GetCount() const
+	{
+		return static_cast<uint32_t>(m_Radius.size());
+	}
+
+private:
+	friend class CpuCulling;
+	friend class SoftwareOcclusion;
+
+	std::vector<float> m_CenterX;
+	std::vector<float> m_CenterY;
+	std::vector<float> m_CenterZ;
+	std::vector<float> m_Radius;
+	std::vector<float> m_MinX;
+	std::vector<float> m_MinY;
+	std::vector<float> m_MinZ;
+	std::vector<float> m_MaxX;
+	std::vector<float> m_MaxY;
+	std::vector<float> m_MaxZ;
+};
+
+// frustum culls `CullingBounds` on the CPU
+// an object is visible if both its sphere and its AABB intersect the frustum; the objects are
+// tested in chunks on the job system, several objects per SIMD instruction
+class CpuCulling
+{
+public:
+	explicit CpuCulling(JobSystem& jobSystem) : m_JobSystem{ jobSystem } {}
+
+	// writes the indices of the visible objects in [0, count) to `visible` in ascending order
+	void Cull(const CullingBounds& bounds,
+		const Frustum& frustum,
+		uint32_t count,
+		std::vector<uint32_t>& visible);
+
+	// single threaded; writes the visible indices of [begin, end) to `visible` and returns their
+	// count
+	static uint32_t CullRange(const CullingBounds& bounds,
+		const Frustum& frustum,
+		uint32_t begin,
+		uint32_t end,
+		uint32_t* visible);
+
+private:
+	// tests `Simd::width` objects at a time and returns the first untested index
+	template<typename Simd>
+	static uint32_t CullRangeSimd(const CullingBounds& bounds,
+		const Frustum& frustum,
+		uint32_t begin,
+		uint32_t end,
+		uint32_t* visible,
+		uint32_t& visibleCount);
+	[[nodiscard]] static bool IsVisible(const CullingBounds& bounds,
+		const Frustum& frustum,
+		uint32_t index);
+
+	JobSystem& m_JobSystem;
+	std::vector<uint32_t> m_ChunkVisibleCounts;
+};
@@ -0,0 +1,61 @@
+#include "engine/deletionQueue.h"
+
+#include <vector>
+#include <utility>
+
+
+void DeletionQueue::Push(DeleteFn fn)
+{
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+	m_Entries.push_back(Entry{ m_PublishedPacket + 1, std::move(fn) });
+}
+
+uint64_t DeletionQueue::PublishPacket()
+{
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+	return ++m_PublishedPacket;
+}
+
+void DeletionQueue::BeginFrame(uint64_t frame, uint64_t packet, uint64_t completedFrame)
+{
+	// a frame that was not submitted is recorded again with the next packet
+	m_RecordedPackets.push_back(RecordedPacket{ packet, frame });
+	while (!m_RecordedPackets.empty() && m_RecordedPackets.front().frame <= completedFrame)
+	{
+		m_CompletedPacket = m_RecordedPackets.front().packet;
+		m_RecordedPackets.pop_front();
+	}
+
+	Run(m_CompletedPacket);
+}
+
+void DeletionQueue::Flush()
+{
+	// a deletion can push another one
+	while (true)
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			if (m_Entries.empty())
+				return;
+		}
+		Run(UINT64_MAX);
+	}
+}
+
+void DeletionQueue::Run(uint64_t completedPacket)
+{
+	// the deletions run without holding the lock, so they can push new entries
+	std::vector<DeleteFn> deletions;
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		while (!m_Entries.empty() && m_Entries.front().lastPacket <= completedPacket)
+		{
+			deletions.push_back(std::move(m_Entries.front().fn));
+			m_Entries.pop_front();
+		}
+	}
+
+	for (auto& deletion : deletions)
+		deletion();
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <functional>
+
+
+// defers the destruction of gpu resources until every frame that might still use them is done,
+// so resources can be released at runtime without waiting for the device to be idle
+// resources can be pushed from any thread; the main thread counts the published frame packets
+// and the render thread advances the frames
+// a resource can be referenced by the packet the main thread is building, so a deletion waits
+// for the frame that records that packet instead of the frame that is recorded right now
+class DeletionQueue
+{
+public:
+	using DeleteFn = std::function<void()>;
+
+	// `fn` runs once the packet that is built now (or the next one, if none is) is recorded and
+	// its frame and all frames before it are done
+	void Push(DeleteFn fn);
+
+	// main thread, right before a packet is published; returns the number of the packet
+	[[nodiscard]] uint64_t PublishPacket();
+	// called by the render thread before it records `packet` in `frame`
+	// runs everything whose packet was recorded in a frame up to `completedFrame`
+	void BeginFrame(uint64_t frame, uint64_t packet, uint64_t completedFrame);
+	// runs everything; only at shutdown, once the device is idle and no packet is recorded anymore
+	void Flush();
+
+private:
+	struct Entry
+	{
+		uint64_t lastPacket = 0; // last packet that might use the resource
+		DeleteFn fn;
+	};
+
+	struct RecordedPacket
+	{
+		uint64_t packet = 0;
+		uint64_t frame = 0;
+	};
+
+	void Run(uint64_t completedPacket);
+
+	std::mutex m_Mutex;
+	std::deque<Entry> m_Entries; // sorted by `lastPacket`
+	uint64_t m_PublishedPacket = 0;
+
+	// render thread
+	std::deque<RecordedPacket> m_RecordedPackets; // whose frames are not done yet
+	uint64_t m_CompletedPacket = 0;
+};
@@ -1,5 +1,6 @@
 #include "engine/device.h"
 
+#include <cstring>
 #include <vector>
 #include <set>
 #include "core/core.h"
@@ -43,6 +44,7 @@ void Device::PickPhysicalDevice(VkInstance vulkanInstance, VkSurfaceKHR windowSu
 		{
 			m_PhysicalDevice = phyDevice;
 			vkGetPhysicalDeviceFeatures(m_PhysicalDevice, &m_PhysicalDeviceFeatures);
+			m_PhysicalDeviceVulkan12Features = QueryVulkan12Features(m_PhysicalDevice);
 			vkGetPhysicalDeviceProperties(m_PhysicalDevice, &m_PhysicalDeviceProperties);
 			vkGetPhysicalDeviceMemoryProperties(
 				m_PhysicalDevice, &m_PhysicalDeviceMemoryProperties);
@@ -84,15 +86,100 @@ void Device::CreateLogicalDevice(VkSurfaceKHR windowSurface)
 	VkPhysicalDeviceFeatures deviceFeatures{};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
 	deviceFeatures.sampleRateShading = VK_TRUE; // enable sample shading
+	// optional; gpu culling
+	deviceFeatures.multiDrawIndirect = m_PhysicalDeviceFeatures.multiDrawIndirect;
+	deviceFeatures.drawIndirectFirstInstance = m_PhysicalDeviceFeatures.drawIndirectFirstInstance;
+
+	// the frames are synchronized with a timeline semaphore
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	vulkan12Features.timelineSemaphore = VK_TRUE;
+	// optional; gpu culling
+	vulkan12Features.drawIndirectCount = m_PhysicalDeviceVulkan12Features.drawIndirectCount;
+
+	std::vector<const char*> extensions{ Config::deviceExtensions.begin(),
+		Config::deviceExtensions.end() };
+	// the optional features are appended to the chain
+	void** featureChain = &vulkan12Features.pNext;
+
+#if defined(VK_EXT_shader_module_identifier)
+	// optional; a pipeline created from module identifiers has to fail instead of compiling when
+	// it is not in the pipeline cache, which needs `pipelineCreationCacheControl`
+	VkPhysicalDevicePipelineCreationCacheControlFeaturesEXT cacheControlFeatures{};
+	cacheControlFeatures.sType =
+		VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PIPELINE_CREATION_CACHE_CONTROL_FEATURES_EXT;
+	VkPhysicalDeviceShaderModuleIdentifierFeaturesEXT identifierFeatures{};
+	identifierFeatures.sType =
+		VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_MODULE_IDENTIFIER_FEATURES_EXT;
+	if (IsExtensionAvailable(m_PhysicalDevice, VK_EXT_SHADER_MODULE_IDENTIFIER_EXTENSION_NAME)
+		&& IsExtensionAvailable(
+			m_PhysicalDevice, VK_EXT_PIPELINE_CREATION_CACHE_CONTROL_EXTENSION_NAME))
+	{
+		cacheControlFeatures.pNext = &identifierFeatures;
+		VkPhysicalDeviceFeatures2 features{};
+		features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features.pNext = &cacheControlFeatures;
+		vkGetPhysicalDeviceFeatures2(m_PhysicalDevice, &features);
+
+		m_ShaderModuleIdentifierEnabled = cacheControlFeatures.pipelineCreationCacheControl
+										  && identifierFeatures.shaderModuleIdentifier;
+		if (m_ShaderModuleIdentifierEnabled)
+		{
+			extensions.push_back(VK_EXT_PIPELINE_CREATION_CACHE_CONTROL_EXTENSION_NAME);
+			extensions.push_back(VK_EXT_SHADER_MODULE_IDENTIFIER_EXTENSION_NAME);
+			*featureChain = &cacheControlFeatures;
+			featureChain = &identifierFeatures.pNext;
+		}
+	}
+#endif
+
+#if defined(VK_EXT_graphics_pipeline_library)
+	// optional; without it, or if linking isn't fast, the pipelines are compiled as a whole
+	VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT libraryFeatures{};
+	libraryFeatures.sType =
+		VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+	if (IsExtensionAvailable(m_PhysicalDevice, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME)
+		&& IsExtensionAvailable(m_PhysicalDevice, VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME))
+	{
+		VkPhysicalDeviceFeatures2 features{};
+		features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features.pNext = &libraryFeatures;
+		vkGetPhysicalDeviceFeatures2(m_PhysicalDevice, &features);
+
+		VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT libraryProperties{};
+		libraryProperties.sType =
+			VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT;
+		VkPhysicalDeviceProperties2 properties{};
+		properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties.pNext = &libraryProperties;
+		vkGetPhysicalDeviceProperties2(m_PhysicalDevice, &properties);
+
+		m_GraphicsPipelineLibraryEnabled = libraryFeatures.graphicsPipelineLibrary
+										   && libraryProperties.graphicsPipelineLibraryFastLinking;
+		if (m_GraphicsPipelineLibraryEnabled)
+		{
+			extensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+			extensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+			libraryFeatures.pNext = nullptr;
+			*featureChain = &libraryFeatures;
+			featureChain = &libraryFeatures.pNext;
+		}
+	}
+#endif
+	*featureChain = nullptr;
+	Logger::Info("Shader module identifiers: {}, graphics pipeline libraries: {}",
+		m_ShaderModuleIdentifierEnabled ? "enabled" : "not supported",
+		m_GraphicsPipelineLibraryEnabled ? "enabled" : "not supported");
 
 	// create logical device
 	VkDeviceCreateInfo deviceInfo{};
 	deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	deviceInfo.pNext = &vulkan12Features;
 	deviceInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 	deviceInfo.pQueueCreateInfos = queueCreateInfos.data();
 	deviceInfo.pEnabledFeatures = &deviceFeatures;
-	deviceInfo.enabledExtensionCount = static_cast<uint32_t>(Config::deviceExtensions.size());
-	deviceInfo.ppEnabledExtensionNames = Config::deviceExtensions.data();
+	deviceInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+	deviceInfo.ppEnabledExtensionNames = extensions.data();
 	if (Config::enableValidationLayers)
 	{
 		deviceInfo.enabledLayerCount = static_cast<uint32_t>(Config::validationLayers.size());
@@ -113,6 +200,22 @@ void Device::CreateLogicalDevice(VkSurfaceKHR windowSurface)
 		m_VulkanDevice, m_QueueFamilyIndices.presentFamily.value(), 0, &m_PresentQueue);
 }
 
+bool Device::IsExtensionAvailable(VkPhysicalDevice physicalDevice, const char* extension)
+{
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> availableExtensions{ extensionCount };
+	vkEnumerateDeviceExtensionProperties(
+		physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+	for (const auto& availableExtension : availableExtensions)
+	{
+		if (std::strcmp(availableExtension.extensionName, extension) == 0)
+			return true;
+	}
+	return false;
+}
+
 VkSampleCountFlagBits Device::GetMaxUsableSampleCount(VkPhysicalDeviceProperties properties)
 {
 	const uint64_t counts = properties.limits.framebufferColorSampleCounts
@@ -198,8 +301,28 @@ bool Device::IsDeviceSuitable(VkPhysicalDevice physicalDevice, VkSurfaceKHR wind
 	VkPhysicalDeviceFeatures supportedFeatures;
 	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
 
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	const bool vulkan12Supported = properties.apiVersion >= VK_API_VERSION_1_2
+								   && QueryVulkan12Features(physicalDevice).timelineSemaphore;
+
 	return indicies.IsComplete() && extensionsSupported && swapchainAdequate
-		   && (supportedFeatures.samplerAnisotropy != 0u);
+		   && (supportedFeatures.samplerAnisotropy != 0u) && vulkan12Supported;
+}
+
+VkPhysicalDeviceVulkan12Features Device::QueryVulkan12Features(VkPhysicalDevice physicalDevice)
+{
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+	VkPhysicalDeviceFeatures2 features{};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &vulkan12Features;
+	vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+	// the chain points into this function
+	vulkan12Features.pNext = nullptr;
+	return vulkan12Features;
 }
 
 QueueFamilyIndices Device::FindQueueFamilies(VkPhysicalDevice physicalDevice,
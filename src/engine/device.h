@@ -28,6 +28,10 @@ public:
 	{
 		return m_PhysicalDeviceFeatures;
 	}
+	[[nodiscard]] inline VkPhysicalDeviceVulkan12Features GetDeviceVulkan12Features() const
+	{
+		return m_PhysicalDeviceVulkan12Features;
+	}
 	[[nodiscard]] inline VkPhysicalDeviceProperties GetDeviceProperties() const
 	{
 		return m_PhysicalDeviceProperties;
@@ -39,6 +43,19 @@ public:
 
 	[[nodiscard]] inline VkSampleCountFlagBits GetMsaaSamples() const { return m_MsaaSamples; }
 
+	// optional; pipelines can be looked up in the pipeline cache by the identifiers of their
+	// shader modules, without creating the modules (VK_EXT_shader_module_identifier)
+	[[nodiscard]] inline bool IsShaderModuleIdentifierEnabled() const
+	{
+		return m_ShaderModuleIdentifierEnabled;
+	}
+	// optional; pipelines are linked from separately compiled parts
+	// (VK_EXT_graphics_pipeline_library)
+	[[nodiscard]] inline bool IsGraphicsPipelineLibraryEnabled() const
+	{
+		return m_GraphicsPipelineLibraryEnabled;
+	}
+
 	static SwapchainSupportDetails QuerySwapchainSupport(VkPhysicalDevice physicalDevice,
 		VkSurfaceKHR windowSurface);
 
@@ -47,9 +64,11 @@ private:
 	void Cleanup();
 
 	static bool IsDeviceSuitable(VkPhysicalDevice physicalDevice, VkSurfaceKHR windowSurface);
+	static VkPhysicalDeviceVulkan12Features QueryVulkan12Features(VkPhysicalDevice physicalDevice);
 	static QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice physicalDevice,
 		VkSurfaceKHR windowSurface);
 	static VkSampleCountFlagBits GetMaxUsableSampleCount(VkPhysicalDeviceProperties properties);
+	static bool IsExtensionAvailable(VkPhysicalDevice physicalDevice, const char* extension);
 
 	void PickPhysicalDevice(VkInstance vulkanInstance, VkSurfaceKHR windowSurface);
 	void CreateLogicalDevice(VkSurfaceKHR windowSurface);
@@ -59,6 +78,7 @@ private:
 	VkDevice m_VulkanDevice{};
 
 	VkPhysicalDeviceFeatures m_PhysicalDeviceFeatures{};
+	VkPhysicalDeviceVulkan12Features m_PhysicalDeviceVulkan12Features{};
 	VkPhysicalDeviceProperties m_PhysicalDeviceProperties{};
 	VkPhysicalDeviceMemoryProperties m_PhysicalDeviceMemoryProperties{};
 
@@ -67,4 +87,6 @@ private:
 	VkQueue m_GraphicsQueue{};
 
 	VkSampleCountFlagBits m_MsaaSamples{};
+	bool m_ShaderModuleIdentifierEnabled = false;
+	bool m_GraphicsPipelineLibraryEnabled = false;
 };
\ No newline at end of file
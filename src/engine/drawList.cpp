@@ -0,0 +1,144 @@
+#include "engine/drawList.h"
+
+#include <algorithm>
+
+
+// the minimum number of keys sorted by one job
+constexpr uint32_t g_SortChunkSize = 16384;
+
+void DrawList::Resize(uint32_t count)
+{
+	keys.resize(count);
+	draws.resize(count);
+}
+
+void DrawList::Clear()
+{
+	keys.clear();
+	draws.clear();
+}
+
+uint64_t DrawList::MakeKey(uint32_t pipeline, uint32_t material, uint32_t mesh, float depth)
+{
+	constexpr uint32_t maxDepth = (1u << DEPTH_BITS) - 1;
+	const auto quantizedDepth =
+		static_cast<uint32_t>(std::clamp(depth, 0.0f, 1.0f) * static_cast<float>(maxDepth));
+
+	// the fields are masked, so a too large index does not spill into the next one
+	uint64_t key = pipeline & ((1u << PIPELINE_BITS) - 1);
+	key = (key << MATERIAL_BITS) | (material & ((1u << MATERIAL_BITS) - 1));
+	key = (key << MESH_BITS) | (mesh & ((1u << MESH_BITS) - 1));
+	key = (key << DEPTH_BITS) | quantizedDepth;
+	return key;
+}
+
+void DrawListSorter::Sort(DrawList& drawList)
+{
+	const uint32_t count = drawList.GetCount();
+	if (count < 2)
+		return;
+
+	// one chunk per thread, unless the chunks get too small to be worth a job
+	const uint32_t threadCount = m_JobSystem.GetWorkerCount() + 1;
+	const uint32_t chunkSize = std::max(g_SortChunkSize, (count + threadCount - 1) / threadCount);
+	const uint32_t chunkCount = (count + chunkSize - 1) / chunkSize;
+	m_Histograms.resize(chunkCount);
+	m_ChunkOrBits.resize(chunkCount);
+	m_ChunkAndBits.resize(chunkCount);
+	m_TempKeys.resize(count);
+	m_TempDraws.resize(count);
+
+	// the bits that differ between any two keys
+	JobCounter bitsCounter;
+	m_JobSystem.ParallelFor(
+		chunkCount,
+		1,
+		[this, &drawList, chunkSize, count](uint32_t begin, uint32_t end) {
+			for (uint32_t chunk = begin; chunk < end; ++chunk)
+			{
+				uint64_t orBits = 0;
+				uint64_t andBits = ~uint64_t{ 0 };
+				const uint32_t last = std::min((chunk + 1) * chunkSize, count);
+				for (uint32_t i = chunk * chunkSize; i < last; ++i)
+				{
+					orBits |= drawList.keys[i];
+					andBits &= drawList.keys[i];
+				}
+				m_ChunkOrBits[chunk] = orBits;
+				m_ChunkAndBits[chunk] = andBits;
+			}
+		},
+		bitsCounter);
+	m_JobSystem.Wait(bitsCounter);
+
+	uint64_t orBits = 0;
+	uint64_t andBits = ~uint64_t{ 0 };
+	for (uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+	{
+		orBits |= m_ChunkOrBits[chunk];
+		andBits &= m_ChunkAndBits[chunk];
+	}
+	const uint64_t varyingBits = orBits ^ andBits;
+
+	for (uint32_t shift = 0; shift < 64; shift += RADIX_BITS)
+	{
+		if (((varyingBits >> shift) & (RADIX_SIZE - 1)) == 0)
+			continue;
+
+		const uint64_t* keys = drawList.keys.data();
+		const uint32_t* draws = drawList.draws.data();
+
+		JobCounter histogramCounter;
+		m_JobSystem.ParallelFor(
+			chunkCount,
+			1,
+			[this, keys, chunkSize, count, shift](uint32_t begin, uint32_t end) {
+				for (uint32_t chunk = begin; chunk < end; ++chunk)
+				{
+					auto& histogram = m_Histograms[chunk];
+					histogram.fill(0);
+					const uint32_t last = std::min((chunk + 1) * chunkSize, count);
+					for (uint32_t i = chunk * chunkSize; i < last; ++i)
+						++histogram[(keys[i] >> shift) & (RADIX_SIZE - 1)];
+				}
+			},
+			histogramCounter);
+		m_JobSystem.Wait(histogramCounter);
+
+		// the first output index of every digit of every chunk; a digit of an earlier chunk goes
+		// before the same digit of a later one
+		uint32_t offset = 0;
+		for (uint32_t digit = 0; digit < RADIX_SIZE; ++digit)
+		{
+			for (uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+			{
+				const uint32_t digitCount = m_Histograms[chunk][digit];
+				m_Histograms[chunk][digit] = offset;
+				offset += digitCount;
+			}
+		}
+
+		JobCounter scatterCounter;
+		m_JobSystem.ParallelFor(
+			chunkCount,
+			1,
+			[this, keys, draws, chunkSize, count, shift](uint32_t begin, uint32_t end) {
+				for (uint32_t chunk = begin; chunk < end; ++chunk)
+				{
+					auto& offsets = m_Histograms[chunk];
+					const uint32_t last = std::min((chunk + 1) * chunkSize, count);
+					for (uint32_t i = chunk * chunkSize; i < last; ++i)
+					{
+						const uint32_t target = offsets[(keys[i] >> shift) & (RADIX_SIZE - 1)]++;
+						m_TempKeys[target] = keys[i];
+						m_TempDraws[target] = draws[i];
+					}
+				}
+			},
+			scatterCounter);
+		m_JobSystem.Wait(scatterCounter);
+
+		drawList.keys.swap(m_TempKeys);
+		drawList.draws.swap(m_TempDraws);
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "core/jobSystem.h"
+
+
+// the draws of a pass as 64 bit sort keys and a payload per key
+// sorted ascending, the draws are grouped by pipeline, then material, then mesh, and within a
+// group go front to back, so the state changes between neighbours are rare and the nearest
+// surfaces fill the depth buffer first
+struct DrawList
+{
+	// most significant first
+	static constexpr uint32_t PIPELINE_BITS = 8;
+	static constexpr uint32_t MATERIAL_BITS = 12;
+	static constexpr uint32_t MESH_BITS = 20;
+	static constexpr uint32_t DEPTH_BITS = 24;
+
+	void Resize(uint32_t count);
+	void Clear();
+
+	// `depth` is the normalized view depth in [0, 1], 0 on the near plane
+	[[nodiscard]] static uint64_t MakeKey(uint32_t pipeline,
+		uint32_t material,
+		uint32_t mesh,
+		float depth);
+	[[nodiscard]] static inline uint32_t GetPipeline(uint64_t key)
+	{
+		return static_cast<uint32_t>(key >> (MATERIAL_BITS + MESH_BITS + DEPTH_BITS));
+	}
+	[[nodiscard]] static inline uint32_t GetMaterial(uint64_t key)
+	{
+		return static_cast<uint32_t>(key >> (MESH_BITS + DEPTH_BITS)) & ((1u << MATERIAL_BITS) - 1);
+	}
+	[[nodiscard]] static inline uint32_t GetMesh(uint64_t key)
+	{
+		return static_cast<uint32_t>(key >> DEPTH_BITS) & ((1u << MESH_BITS) - 1);
+	}
+
+	[[nodiscard]] inline uint32_t GetCount() const { return static_cast<uint32_t>(keys.size()); }
+
+	std::vector<uint64_t> keys;
+	std::vector<uint32_t> draws; // payload of the key with the same index
+};
+
+// sorts draw lists on the job system
+// LSD radix sort with 8 bit digits: every job counts the digits of its chunk, the chunks then
+// scatter to disjoint ranges, so the sort is stable; digits that are the same in every key (e.g.
+// an unused pipeline or material field) are skipped
+class DrawListSorter
+{
+public:
+	explicit DrawListSorter(JobSystem& jobSystem) : m_JobSystem{ jobSystem } {}
+
+	void Sort(DrawList& drawList);
+
+private:
+	static constexpr uint32_t RADIX_BITS = 8;
+	static constexpr uint32_t RADIX_SIZE = 1u << RADIX_BITS;
+
+	JobSystem& m_JobSystem;
+	// per chunk
+	std::vector<std::array<uint32_t, RADIX_SIZE>> m_Histograms;
+	std::vector<uint64_t> m_ChunkOrBits;
+	std::vector<uint64_t> m_ChunkAndBits;
+	// the other buffer of every pass
+	std::vector<uint64_t> m_TempKeys;
+	std::vector<uint32_t> m_TempDraws;
+};
@@ -0,0 +1,48 @@
+#include "engine/embeddedShaders.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include "core/core.h"
+
+
+namespace EmbeddedShaders {
+
+SpirvView Find([[maybe_unused]] std::string_view path)
+{
+#if defined(VKPBR_EMBED_SHADERS)
+	if (UseFiles())
+		return {};
+
+	const size_t separator = path.find_last_of("/\\");
+	const std::string_view fileName =
+		separator == std::string_view::npos ? path : path.substr(separator + 1);
+
+	const Entry* const end = g_EmbeddedShaders + g_EmbeddedShaderCount;
+	const Entry* const entry = std::lower_bound(g_EmbeddedShaders,
+		end,
+		fileName,
+		[](const Entry& candidate, std::string_view name) {
+			return std::string_view{ candidate.fileName } < name;
+		});
+	if (entry == end || std::string_view{ entry->fileName } != fileName)
+		return {};
+	return { entry->code, entry->wordCount };
+#else
+	return {};
+#endif
+}
+
+bool UseFiles()
+{
+	// read once, it doesn't change while running
+	static const bool useFiles = [] {
+		const char* value = std::getenv("VKPBR_SHADER_FILES");
+		const bool isSet = value != nullptr && *value != '\0' && std::string_view{ value } != "0";
+		if (isSet)
+			Logger::Info("VKPBR_SHADER_FILES is set, loading the shaders from assets/shaders");
+		return isSet;
+	}();
+	return useFiles;
+}
+
+} // namespace EmbeddedShaders
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "engine/shader.h"
+
+
+// the `.spv` files of the `shaders` target, linked into the executable as `uint32_t` arrays with
+// `VKPBR_EMBED_SHADERS`, so the shader modules are created from read-only memory without opening
+// a file; with the `VKPBR_SHADER_FILES` environment variable set the files are read instead, so
+// shaders can be changed without rebuilding the executable
+namespace EmbeddedShaders {
+
+// an entry of the generated table, sorted by `fileName`
+struct Entry
+{
+	const char* fileName; // in assets/shaders/out
+	const uint32_t* code;
+	size_t wordCount;
+};
+
+// looks up the file name of `path`; empty if it isn't embedded or the files are used
+[[nodiscard]] SpirvView Find(std::string_view path);
+[[nodiscard]] bool UseFiles();
+
+} // namespace EmbeddedShaders
+
+#if defined(VKPBR_EMBED_SHADERS)
+// defined in `embeddedShaders.gen.cpp`, which CMakeLists.txt writes to the build directory
+extern const EmbeddedShaders::Entry g_EmbeddedShaders[];
+extern const size_t g_EmbeddedShaderCount;
+#endif
@@ -1,20 +1,58 @@
 #include "engine/engine.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <exception>
 #include "stb_image.h"
 #include "glm/gtc/matrix_inverse.hpp"
 #include "core/core.h"
 #include "core/input.h"
 #include "engine/initializers.h"
-#include "engine/shader.h"
 #include "ui/imGuiOverlay.h"
 #include "utils/utils.h"
 
 Engine* Engine::s_Instance = nullptr;
 
-Engine::Engine(const char* title, const uint64_t width, const uint64_t height)
+// upper limit of the synthetic draws in the profiler
+constexpr int32_t g_MaxBenchmarkDraws = 65536;
+// the number of benchmark draws whose sort keys are built by one job
+constexpr uint32_t g_DrawListBatchSize = 4096;
+// the software occlusion depth buffer and the number of benchmark instances that occlude
+constexpr uint32_t g_SoftwareOcclusionWidth = 320;
+constexpr uint32_t g_SoftwareOcclusionHeight = 180;
+constexpr uint32_t g_SoftwareOccluderCount = 1024;
+// upper limit of the point lights of the clustered shading
+constexpr int32_t g_MaxPointLights = 8192;
+// relative to the working directory, like the assets
+constexpr const char* g_PipelineCachePath = "pipelineCache.bin";
+constexpr const char* g_ShaderCachePath = "shaderCache";
+// timestamp queries of a frame
+constexpr uint32_t g_TimestampSceneBegin = 0;
+constexpr uint32_t g_TimestampDepthPrepassEnd = 1;
+constexpr uint32_t g_TimestampSceneEnd = 2;
+constexpr uint32_t g_TimestampLateSceneBegin = 3;
+constexpr uint32_t g_TimestampLateSceneEnd = 4;
+constexpr uint32_t g_TimestampLightClustersBegin = 5;
+constexpr uint32_t g_TimestampLightClustersEnd = 6;
+constexpr uint32_t g_TimestampCount = 7;
+// how often the main thread polls events while the render thread is busy
+constexpr std::chrono::milliseconds g_EventPollInterval{ 1 };
+// how long the framebuffer size has to stay the same before the swapchain is recreated
+constexpr std::chrono::milliseconds g_ResizeDebounceTime{ 100 };
+// how often the shader sources are checked for changes
+constexpr std::chrono::milliseconds g_ShaderPollInterval{ 500 };
+
+Engine::Engine(const char* title,
+	const uint64_t width,
+	const uint64_t height,
+	const RenderSettings& settings)
 {
 	s_Instance = this;
-	Init(title, width, height);
+	Init(title, width, height, settings);
 }
 
 Engine::~Engine()
@@ -22,16 +60,25 @@ Engine::~Engine()
 	Cleanup();
 }
 
-Engine* Engine::Create(const char* title, const uint64_t width, const uint64_t height)
+Engine* Engine::Create(const char* title,
+	const uint64_t width,
+	const uint64_t height,
+	const RenderSettings& settings)
 {
 	if (s_Instance == nullptr)
-		return new Engine(title, width, height);
+		return new Engine(title, width, height, settings);
 
 	return s_Instance;
 }
 
-void Engine::Init(const char* title, const uint64_t width, const uint64_t height)
+void Engine::Init(const char* title,
+	const uint64_t width,
+	const uint64_t height,
+	const RenderSettings& settings)
 {
+	m_Settings = settings;
+	m_PendingSettings = settings;
+
 	m_Window = std::make_unique<Window>(WindowProps{ title, width, height });
 	// set window event callbacks
 	m_Window->SetCloseEventCallbackFn(BIND_FN(Engine::OnCloseEvent));
@@ -43,16 +90,48 @@ void Engine::Init(const char* title, const uint64_t width, const uint64_t height
 	m_Window->CreateWindowSurface(m_VulkanContext->GetInstance());
 	m_Device =
 		std::make_unique<Device>(m_VulkanContext->GetInstance(), m_Window->GetWindowSurface());
+	// the thread waiting on a job counter runs jobs too
+	const uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	m_JobSystem = std::make_unique<JobSystem>(hardwareThreads - 1);
+	m_PipelineCache = std::make_unique<PipelineCache>(m_Device, g_PipelineCachePath);
+	m_ShaderCompiler = std::make_unique<ShaderCompiler>(g_ShaderCachePath);
+	m_PipelineStates = std::make_unique<PipelineStateCache>(m_Device,
+		*m_JobSystem,
+		*m_ShaderCompiler,
+		m_PipelineCache->Get(),
+		&RetirePipeline);
 
 	Logger::Info("{} application initialized!", title);
+
+	// decided by the device alone; with push constants the UI can still switch to the UBO path
+	m_PushConstantsSupported = PerDrawData::FitsInPushConstants(
+		m_Device->GetDeviceProperties().limits.maxPushConstantsSize);
+	m_UsePushConstants = m_PushConstantsSupported;
+	if (!m_PushConstantsSupported)
+		Logger::Warn("Per-draw data exceeds `maxPushConstantsSize`; using dynamic UBO fallback");
+
 	CreateCommandPool();
 	CreateDescriptorPool();
 
+	int framebufferWidth = 0;
+	int framebufferHeight = 0;
+	m_Window->GetFramebufferSize(&framebufferWidth, &framebufferHeight);
+	m_FramebufferExtent = { static_cast<uint32_t>(framebufferWidth),
+		static_cast<uint32_t>(framebufferHeight) };
+	m_PublishedFramebufferExtent = m_FramebufferExtent;
+	// the present modes are only offered in the ui, so they are queried once; an unsupported mode
+	// from the command line is replaced here, otherwise the settings would never match the mode
+	// the swapchain uses
+	m_AvailablePresentModes =
+		Device::QuerySwapchainSupport(m_Device->GetPhysicalDevice(), m_Window->GetWindowSurface())
+			.presentModes;
+	m_Settings.presentMode =
+		utils::ChoosePresentMode(m_AvailablePresentModes, m_Settings.presentMode);
+	m_PendingSettings = m_Settings;
 	CreateSwapchain();
 	CreateSwapchainImageViews();
 	CreateRenderPass();
-	CreateColorResource();
-	CreateDepthResource();
+	BuildRenderGraph();
 	CreateFramebuffers();
 
 	CreateCommandBuffers();
@@ -74,10 +153,46 @@ void Engine::Init(const char* title, const uint64_t width, const uint64_t height
 	m_TextureImageViews.resize(texturePaths.size());
 	m_TextureImageMems.resize(texturePaths.size());
 
+	// the textures are decoded in parallel, the uploads stay on this thread
+	struct DecodedImage
+	{
+		stbi_uc* data = nullptr;
+		int width = 0;
+		int height = 0;
+	};
+	std::vector<DecodedImage> decodedImages(texturePaths.size());
+	JobCounter decodeCounter;
+	m_JobSystem->ParallelFor(
+		static_cast<uint32_t>(texturePaths.size()),
+		1,
+		[&texturePaths, &decodedImages](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				int channels = 0;
+				decodedImages[i].data = stbi_load(texturePaths[i].c_str(),
+					&decodedImages[i].width,
+					&decodedImages[i].height,
+					&channels,
+					STBI_rgb_alpha);
+			}
+		},
+		decodeCounter);
+	m_JobSystem->Wait(decodeCounter);
+
 	for (int32_t i = 0; i < texturePaths.size(); ++i)
 	{
-		CreateTextureImage(
-			texturePaths[i].c_str(), m_TextureImages[i], m_TextureImageMems[i], format, miplevels);
+		ErrCheck(!decodedImages[i].data,
+			"Unable to load texture: \"{}\"; ERROR: {}",
+			texturePaths[i],
+			stbi_failure_reason());
+		CreateTextureImage(decodedImages[i].data,
+			decodedImages[i].width,
+			decodedImages[i].height,
+			m_TextureImages[i],
+			m_TextureImageMems[i],
+			format,
+			miplevels);
+		stbi_image_free(decodedImages[i].data);
 		m_TextureImageViews[i] = utils::CreateImageView(m_Device->GetDevice(),
 			m_TextureImages[i],
 			format,
@@ -87,16 +202,142 @@ void Engine::Init(const char* title, const uint64_t width, const uint64_t height
 			1);
 	}
 
+	// world space bounds of every benchmark instance for the cpu culling
+	m_CpuCulling = std::make_unique<CpuCulling>(*m_JobSystem);
+	m_BenchmarkBounds.Reserve(g_MaxBenchmarkDraws);
+	for (uint32_t i = 0; i < g_MaxBenchmarkDraws; ++i)
+	{
+		m_BenchmarkBounds.Add(GetBenchmarkModelMatrix(i),
+			m_Model->GetBoundingSphere(),
+			m_Model->GetAabbMin(),
+			m_Model->GetAabbMax());
+	}
+
+	m_DrawListSorter = std::make_unique<DrawListSorter>(*m_JobSystem);
+
+	// the model has no low-poly occluder mesh, a box inside its AABB stands in for it; only the
+	// front layer of the grid occludes, the layers behind it are hidden by it anyway
+	m_SoftwareOcclusion = std::make_unique<SoftwareOcclusion>(
+		*m_JobSystem, g_SoftwareOcclusionWidth, g_SoftwareOcclusionHeight);
+	const glm::vec3 occluderCenter = (m_Model->GetAabbMin() + m_Model->GetAabbMax()) * 0.5f;
+	const glm::vec3 occluderHalfExtent = (m_Model->GetAabbMax() - m_Model->GetAabbMin()) * 0.25f;
+	for (uint32_t i = 0; i < g_SoftwareOccluderCount; ++i)
+	{
+		m_SoftwareOcclusion->AddOccluderBox(GetBenchmarkModelMatrix(i),
+			occluderCenter - occluderHalfExtent,
+			occluderCenter + occluderHalfExtent);
+	}
+
+	// the benchmark instances are culled on the gpu when indirect count draws are supported
+	m_GpuCullingSupported = GpuCulling::IsSupported(m_Device);
+	if (m_GpuCullingSupported)
+	{
+		std::vector<glm::mat4> instances(g_MaxBenchmarkDraws);
+		for (uint32_t i = 0; i < instances.size(); ++i)
+			instances[i] = GetBenchmarkModelMatrix(i);
+		m_GpuCulling = std::make_unique<GpuCulling>(m_Device,
+			m_CommandPool,
+			m_DescriptorPool,
+			m_PipelineCache->Get(),
+			*m_Model,
+			instances);
+
+		// the render graph was built before, without the occlusion culling passes
+		m_OcclusionCullingSupported = HiZPyramid::IsSupported(m_Device);
+		if (m_OcclusionCullingSupported)
+		{
+			m_HiZ =
+				std::make_unique<HiZPyramid>(m_Device, m_DescriptorPool, m_PipelineCache->Get());
+			m_HiZ->Resize(m_SwapchainExtent, VK_NULL_HANDLE);
+			m_GpuCulling->SetHiZ(*m_HiZ);
+		}
+		else
+		{
+			Logger::Warn("A sampleable msaa depth buffer is not supported; occlusion culling "
+						 "disabled");
+		}
+	}
+	else
+	{
+		Logger::Warn("`vkCmdDrawIndexedIndirectCount()` is not supported; gpu culling disabled");
+	}
+
+	m_ClusteredLighting = std::make_unique<ClusteredLighting>(m_Device,
+		m_CommandPool,
+		m_DescriptorPool,
+		m_PipelineCache->Get(),
+		GetBenchmarkLights());
+
 	CreateDescriptorSetLayout();
 	CreateDescriptorSets();
 	CreatePipelineLayout();
 
-	if (pbr)
-		CreatePipeline("assets/shaders/out/normalMapInvTBN.vert.spv",
-			"assets/shaders/out/normalMapInvTBN.frag.spv");
+	// the scene shaders are requested as permutations of their feature bits; the phong shaders
+	// declare no specialized features
+	m_SceneShader = pbr ? "normalMapTBN" : "phongLighting";
+	m_SceneFeatures = pbr ? ShaderFeature::NORMAL_MAPPING : 0;
+	m_FallbackSceneFeatures = m_SceneFeatures;
+
+	// only the push constant and UBO pipelines without the pre-pass are compiled before the first
+	// frame, the frames fall back to them until the other permutations are done
+	std::vector<GraphicsPipelineDesc> pipelineDescs;
+	if (m_PushConstantsSupported)
+		pipelineDescs.push_back(GetScenePipelineDesc(m_FallbackSceneFeatures));
+	pipelineDescs.push_back(
+		GetScenePipelineDesc(m_FallbackSceneFeatures | ShaderFeature::PER_DRAW_UBO));
+
+	// the pipelines are compiled in parallel, every job into its own cache
+	const auto pipelineStartTime = std::chrono::high_resolution_clock::now();
+	const auto pipelineCount = static_cast<uint32_t>(pipelineDescs.size());
+	m_PipelineCache->CreateWorkerCaches(pipelineCount);
+	std::vector<std::exception_ptr> pipelineErrors(pipelineCount);
+	JobCounter pipelineCounter;
+	m_JobSystem->ParallelFor(
+		pipelineCount,
+		1,
+		[this, &pipelineDescs, &pipelineErrors](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				// jobs must not throw, the first error is rethrown once all are done
+				try
+				{
+					m_PipelineStates->Create(pipelineDescs[i], m_PipelineCache->GetWorkerCache(i));
+				}
+				catch (...)
+				{
+					pipelineErrors[i] = std::current_exception();
+				}
+			}
+		},
+		pipelineCounter);
+	m_JobSystem->Wait(pipelineCounter);
+	m_PipelineCache->MergeWorkerCaches();
+	m_PipelineStates->QueueDeferredOptimizations();
+	for (const auto& error : pipelineErrors)
+	{
+		if (error)
+			std::rethrow_exception(error);
+	}
+
+	// the rest of the default permutations; the jobs share the main cache, the worker caches are
+	// merged into it by now
+	if (m_PushConstantsSupported)
+		RequestScenePipelines(m_FallbackSceneFeatures);
+	RequestScenePipelines(m_FallbackSceneFeatures | ShaderFeature::PER_DRAW_UBO);
+	RequestScenePipelines(m_FallbackSceneFeatures | ShaderFeature::INSTANCED);
+	Logger::Info("Created {} scene pipelines in {:.1f} ms ({} pipeline cache), {} more are "
+				 "compiled in the background",
+		pipelineCount,
+		std::chrono::duration<float, std::chrono::milliseconds::period>(
+			std::chrono::high_resolution_clock::now() - pipelineStartTime)
+			.count(),
+		m_PipelineCache->IsWarm() ? "warm" : "cold",
+		m_PipelineStates->GetPendingCount());
+
+	if (GpuTimestamps::IsSupported(m_Device))
+		m_GpuTimestamps = std::make_unique<GpuTimestamps>(m_Device, g_TimestampCount);
 	else
-		CreatePipeline("assets/shaders/out/phongLighting.vert.spv",
-			"assets/shaders/out/phongLighting.frag.spv");
+		Logger::Warn("The graphics queue doesn't support timestamps; gpu times disabled");
 
 	// skybox
 	std::array<const char*, 6> cubemapPaths{
@@ -117,11 +358,11 @@ void Engine::Init(const char* title, const uint64_t width, const uint64_t height
 	CreateCubemapDescriptorSetLayout();
 	CreateCubemapDescriptorSets();
 	CreateCubemapPipelineLayout();
-	CreateCubemapPipeline(
-		"assets/shaders/out/skybox.vert.spv", "assets/shaders/out/skybox.frag.spv");
+	CreateCubemapPipeline("skybox");
 	CreateCubemapVertexBuffer();
 
 	CreateSyncObjects();
+	CreateFrameTimeline();
 
 	m_Camera = std::make_unique<Camera>(m_AspectRatio);
 
@@ -140,23 +381,21 @@ void Engine::Init(const char* title, const uint64_t width, const uint64_t height
 
 void Engine::Cleanup()
 {
+	// reloaded and optimized pipelines retire the old ones into the deletion queue
+	m_PipelineStates->Wait();
 	vkDeviceWaitIdle(m_Device->GetDevice());
+	m_DeletionQueue.Flush();
 
 	ImGuiOverlay::Cleanup(m_Device->GetDevice());
 
-	for (size_t i = 0; i < Config::maxFramesInFlight; ++i)
-	{
-		vkDestroySemaphore(m_Device->GetDevice(), m_ImageAvailableSemaphores[i], nullptr);
-		vkDestroySemaphore(m_Device->GetDevice(), m_RenderFinishedSemaphores[i], nullptr);
-		vkDestroyFence(m_Device->GetDevice(), m_InFlightFences[i], nullptr);
-	}
+	CleanupSyncObjects();
+	vkDestroySemaphore(m_Device->GetDevice(), m_FrameTimeline, nullptr);
 
 	// skybox
 	vkDestroyImage(m_Device->GetDevice(), m_CubemapImage, nullptr);
 	vkFreeMemory(m_Device->GetDevice(), m_CubemapImageMem, nullptr);
 	vkDestroyImageView(m_Device->GetDevice(), m_CubemapImageView, nullptr);
 	vkDestroyPipelineLayout(m_Device->GetDevice(), m_CubemapPipelineLayout, nullptr);
-	vkDestroyPipeline(m_Device->GetDevice(), m_CubemapPipeline, nullptr);
 	vkDestroyDescriptorSetLayout(m_Device->GetDevice(), m_CubemapDescriptorSetLayout, nullptr);
 	vkFreeMemory(m_Device->GetDevice(), m_CubemapVertexBufferMem, nullptr);
 	vkDestroyBuffer(m_Device->GetDevice(), m_CubemapVertexBuffer, nullptr);
@@ -172,53 +411,620 @@ void Engine::Cleanup()
 
 	m_Model->Cleanup(m_Device->GetDevice());
 
-	vkDestroyPipeline(m_Device->GetDevice(), m_Pipeline, nullptr);
+	// waits for the pipelines that are still compiling
+	m_PipelineStates.reset();
+	m_ShaderCompiler.reset();
+	m_GpuTimestamps.reset();
+	m_ClusteredLighting.reset();
+	m_GpuCulling.reset();
+	m_HiZ.reset();
 	vkDestroyPipelineLayout(m_Device->GetDevice(), m_PipelineLayout, nullptr);
 	vkDestroyDescriptorSetLayout(m_Device->GetDevice(), m_DescriptorSetLayout, nullptr);
+	vkDestroyDescriptorSetLayout(m_Device->GetDevice(), m_InstanceDescriptorSetLayout, nullptr);
 
 	for (uint64_t i = 0; i < Config::maxFramesInFlight; ++i)
 	{
 		vkFreeMemory(m_Device->GetDevice(), m_CubemapUniformBufferMem[i], nullptr);
 		vkDestroyBuffer(m_Device->GetDevice(), m_CubemapUniformBuffers[i], nullptr);
 
+		vkUnmapMemory(m_Device->GetDevice(), m_MatUniformBufferMemory[i]);
 		vkFreeMemory(m_Device->GetDevice(), m_MatUniformBufferMemory[i], nullptr);
 		vkDestroyBuffer(m_Device->GetDevice(), m_MatUniformBuffers[i], nullptr);
 
+		vkUnmapMemory(m_Device->GetDevice(), m_InstanceBufferMemory[i]);
+		vkFreeMemory(m_Device->GetDevice(), m_InstanceBufferMemory[i], nullptr);
+		vkDestroyBuffer(m_Device->GetDevice(), m_InstanceBuffers[i], nullptr);
+
 		vkFreeMemory(m_Device->GetDevice(), m_SceneUniformBufferMemory[i], nullptr);
 		vkDestroyBuffer(m_Device->GetDevice(), m_SceneUniformBuffers[i], nullptr);
 	}
 
 	CleanupSwapchain();
 	vkDestroyRenderPass(m_Device->GetDevice(), m_RenderPass, nullptr);
+	vkDestroyRenderPass(m_Device->GetDevice(), m_LoadRenderPass, nullptr);
 
 	vkDestroyDescriptorPool(m_Device->GetDevice(), m_DescriptorPool, nullptr);
+	for (const auto& slicePools : m_SliceCommandPools)
+	{
+		for (const auto& commandPool : slicePools)
+			vkDestroyCommandPool(m_Device->GetDevice(), commandPool, nullptr);
+	}
 	vkDestroyCommandPool(m_Device->GetDevice(), m_CommandPool, nullptr);
 
+	// every pipeline of the run is in the cache by now
+	m_PipelineCache->Save();
+	m_PipelineCache.reset();
+
 	m_Window->DestroyWindowSurface(m_VulkanContext->GetInstance());
 }
 
 void Engine::Run()
 {
-	m_LastFrameTime = std::chrono::high_resolution_clock::now();
+	m_LastUpdateTime = std::chrono::high_resolution_clock::now();
+	m_RenderThread = std::thread(&Engine::RenderLoop, this);
+
+	// the main thread handles events and input and builds the frame packets
+	// blocking vulkan calls only stall the render thread
 	while (m_IsRunning)
 	{
-		const float deltatime = CalcFps();
-		Draw(deltatime);
+		{
+			// the glfw backend of the ui writes the events into the ImGui context
+			const auto uiLock = ImGuiOverlay::LockContext();
+			m_Window->OnUpdate();
+		}
 		ProcessInput();
-		m_Window->OnUpdate();
+
+		if (m_Window->IsMinimized())
+		{
+			// a frame that is still recording its ui waits for the next event, nothing is shown
+			const auto uiLock = ImGuiOverlay::LockContext();
+			m_Window->WaitEvents();
+			continue;
+		}
+
+		// a new packet is built once the render thread picked up the previous one, so it carries
+		// the latest input; events are still polled while waiting
+		if (m_FramePackets.WaitUntilConsumed(g_EventPollInterval))
+			Update();
 	}
+
+	m_FramePackets.Stop();
+	m_RenderThread.join();
+	if (m_RenderThreadException)
+		std::rethrow_exception(m_RenderThreadException);
 }
 
-void Engine::Draw(float deltatime)
+void Engine::Update()
 {
-	BeginScene();
+	const auto currentTime = std::chrono::high_resolution_clock::now();
+	const float deltatime = std::chrono::duration<float, std::chrono::milliseconds::period>(
+		currentTime - m_LastUpdateTime)
+								.count();
+	m_LastUpdateTime = currentTime;
 
-	uint32_t dynamicOffset = 0;
-	VkDeviceSize offset = 0;
+	FramePacket& packet = m_FramePackets.GetWritePacket();
+
+	// the new size is only passed on once it stopped changing, so dragging the window border does
+	// not recreate the swapchain every frame
+	if (currentTime - m_LastResizeTime >= g_ResizeDebounceTime)
+	{
+		int width = 0;
+		int height = 0;
+		m_Window->GetFramebufferSize(&width, &height);
+		m_PublishedFramebufferExtent = { static_cast<uint32_t>(width),
+			static_cast<uint32_t>(height) };
+	}
+	packet.framebufferExtent = m_PublishedFramebufferExtent;
+
+	m_Camera->OnUpdate(deltatime);
+	packet.viewMatrix = m_Camera->GetViewMatrix();
+	packet.projectionMatrix = m_Camera->GetProjectionMatrix();
+	packet.viewProjectionMatrix = m_Camera->GetViewProjectionMatrix();
+	packet.cameraPos = m_Camera->GetCameraPosition();
+	packet.zNear = m_Camera->GetZNear();
+	packet.zFar = m_Camera->GetZFar();
+
+	packet.pointLightCount = static_cast<uint32_t>(m_PointLightCount);
+
+	packet.settings = m_PendingSettings;
+	packet.usePushConstants = m_UsePushConstants;
+	packet.useInstancing = m_UseInstancing;
+	packet.useGpuCulling = m_UseGpuCulling;
+	packet.useOcclusionCulling =
+		m_UseGpuCulling && m_UseOcclusionCulling && m_OcclusionCullingSupported;
+	packet.useCpuCulling = m_UseCpuCulling && !m_UseGpuCulling;
+	packet.useDepthPrepass = m_UseDepthPrepass;
+	packet.useDrawSorting = m_UseDrawSorting && !m_UseGpuCulling;
+	if (currentTime - m_LastShaderPollTime >= g_ShaderPollInterval)
+	{
+		m_LastShaderPollTime = currentTime;
+		ReloadChangedShaders();
+	}
+	ResolveScenePipelines(packet);
+	auto drawCount = static_cast<uint32_t>(m_BenchmarkDrawCount);
+	if (packet.useCpuCulling)
+	{
+		const auto cullStartTime = std::chrono::high_resolution_clock::now();
+		m_CpuCulling->Cull(m_BenchmarkBounds,
+			Frustum::FromViewProjection(packet.viewProjectionMatrix),
+			drawCount,
+			packet.visibleDraws);
+		m_CpuCullTime = std::chrono::duration<float, std::chrono::milliseconds::period>(
+			std::chrono::high_resolution_clock::now() - cullStartTime)
+							.count();
+		drawCount = static_cast<uint32_t>(packet.visibleDraws.size());
+
+		m_SoftwareOccludedCount = 0;
+		if (m_UseSoftwareOcclusion)
+		{
+			const auto occlusionStartTime = std::chrono::high_resolution_clock::now();
+			m_SoftwareOcclusion->Rasterize(packet.viewProjectionMatrix);
+			m_SoftwareOcclusion->Cull(m_BenchmarkBounds, packet.visibleDraws);
+			m_SoftwareOcclusionTime =
+				std::chrono::duration<float, std::chrono::milliseconds::period>(
+					std::chrono::high_resolution_clock::now() - occlusionStartTime)
+					.count();
+			m_SoftwareOccludedCount = drawCount - static_cast<uint32_t>(packet.visibleDraws.size());
+			drawCount = static_cast<uint32_t>(packet.visibleDraws.size());
+		}
+	}
+	// only the UBO path is limited by the number of UBO slots; the sorted draws use one slot per
+	// mesh
+	const uint32_t slotsPerDraw = packet.useDrawSorting ? m_Model->GetMeshCount() : 1;
+	packet.drawCount = packet.usePushConstants || packet.useInstancing || packet.useGpuCulling
+						   ? drawCount
+						   : std::min(drawCount, Config::maxDrawsPerFrame / slotsPerDraw);
+	// the gpu-driven draws have no other path to fall back to
+	const bool skipDraws = packet.useGpuCulling && !packet.useDepthPrepass
+						   && packet.pipelines.pipeline == VK_NULL_HANDLE;
+	m_SkippedDrawCount = skipDraws ? packet.drawCount : 0;
+	packet.recordSliceCount = static_cast<uint32_t>(m_RecordSliceCount);
+
+	if (packet.useDrawSorting)
+	{
+		const auto sortStartTime = std::chrono::high_resolution_clock::now();
+		BuildDrawList(packet);
+		m_DrawSortTime = std::chrono::duration<float, std::chrono::milliseconds::period>(
+			std::chrono::high_resolution_clock::now() - sortStartTime)
+							 .count();
+	}
+
+	{
+		// the render thread may be recording the ui of the previous packet
+		const auto uiLock = ImGuiOverlay::LockContext();
+		ImGuiOverlay::Begin();
+		OnUiRender();
+		ImGuiOverlay::End(packet.ui);
+	}
+
+	packet.number = m_DeletionQueue.PublishPacket();
+	m_FramePackets.Publish();
+}
+
+void Engine::RenderLoop()
+{
+	try
+	{
+		while (m_FramePackets.Consume(m_RenderPacket))
+		{
+			CalcFps();
+			Draw();
+		}
+	}
+	catch (...)
+	{
+		// rethrown on the main thread
+		m_RenderThreadException = std::current_exception();
+		m_IsRunning = false;
+	}
+}
+
+void Engine::Draw()
+{
+	ApplySettings(m_RenderPacket.settings);
+	// the occlusion culling passes are part of the render graph, which is rebuilt with the
+	// swapchain
+	if (m_RenderPacket.framebufferExtent.width != m_FramebufferExtent.width
+		|| m_RenderPacket.framebufferExtent.height != m_FramebufferExtent.height
+		|| m_RenderPacket.useOcclusionCulling != m_OcclusionGraph)
+	{
+		m_FramebufferExtent = m_RenderPacket.framebufferExtent;
+		m_OcclusionGraph = m_RenderPacket.useOcclusionCulling;
+		RecreateSwapchain();
+	}
+
+	if (!BeginScene())
+		return;
+
+	// the per-draw UBO slots are written while recording, so the shared data has to be updated
+	// before that
+	UpdateUniformBuffers();
+
+	// the frame that last used the slot is done
+	if (m_GpuTimestamps)
+	{
+		m_GpuTimestamps->RecordReset(m_ActiveCommandBuffer, m_CurrentFrameIndex);
+		m_DepthPrepassGpuTime =
+			m_GpuTimestamps->GetElapsedMs(g_TimestampSceneBegin, g_TimestampDepthPrepassEnd);
+		m_SceneGpuTime =
+			m_GpuTimestamps->GetElapsedMs(g_TimestampSceneBegin, g_TimestampSceneEnd)
+			+ m_GpuTimestamps->GetElapsedMs(g_TimestampLateSceneBegin, g_TimestampLateSceneEnd);
+		m_LightClusterGpuTime = m_GpuTimestamps->GetElapsedMs(
+			g_TimestampLightClustersBegin, g_TimestampLightClustersEnd);
+	}
+
+	m_RenderGraphBackend->SetImportedImage(m_SwapchainAttachment,
+		m_SwapchainImages[m_NextFrameIndex],
+		m_SwapchainImageViews[m_NextFrameIndex]);
+	m_RenderGraphBackend->Execute(*m_RenderGraph, m_ActiveCommandBuffer);
+
+	EndScene();
+}
+
+void Engine::RecordLightClusterPass(VkCommandBuffer cmdBuff)
+{
+	if (m_GpuTimestamps)
+	{
+		m_GpuTimestamps->RecordTimestamp(cmdBuff,
+			m_CurrentFrameIndex,
+			g_TimestampLightClustersBegin,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+	}
+	m_ClusteredLighting->RecordAssign(cmdBuff,
+		m_CurrentFrameIndex,
+		m_RenderPacket.viewMatrix,
+		m_RenderPacket.projectionMatrix,
+		m_RenderPacket.zNear,
+		m_RenderPacket.zFar,
+		m_SwapchainExtent,
+		m_RenderPacket.pointLightCount);
+	if (m_GpuTimestamps)
+	{
+		m_GpuTimestamps->RecordTimestamp(cmdBuff,
+			m_CurrentFrameIndex,
+			g_TimestampLightClustersEnd,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+	}
+}
+
+void Engine::RecordCullPass(VkCommandBuffer cmdBuff)
+{
+	if (!m_RenderPacket.useGpuCulling)
+		return;
+
+	// the frame that last used the slot is done
+	const GpuCulling::Stats stats = m_GpuCulling->GetStats(m_CurrentFrameIndex);
+	m_FrustumCulledCount = stats.frustumCulled;
+	m_OccludedCount = stats.occluded;
+
+	if (m_HiZ)
+		m_HiZ->RecordLayoutTransition(cmdBuff);
+	m_GpuCulling->RecordCull(cmdBuff,
+		m_CurrentFrameIndex,
+		m_RenderPacket.viewProjectionMatrix,
+		m_RenderPacket.drawCount,
+		m_OcclusionGraph ? GpuCulling::Phase::EARLY : GpuCulling::Phase::ALL);
+}
+
+void Engine::RecordScenePass(VkCommandBuffer cmdBuff)
+{
+	if (m_GpuTimestamps)
+	{
+		m_GpuTimestamps->RecordTimestamp(
+			cmdBuff, m_CurrentFrameIndex, g_TimestampSceneBegin, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+	}
+	BeginRenderPass(cmdBuff, m_RenderPass);
+
+	// everything inside the render pass is recorded into secondary command buffers
+	const auto recordStartTime = std::chrono::high_resolution_clock::now();
+	uint32_t sliceCount = 1;
+	if (m_RenderPacket.useGpuCulling)
+	{
+		// a fixed number of indirect draws, the cull pass selected the visible instances
+		vkResetCommandPool(m_Device->GetDevice(), m_SliceCommandPools[m_CurrentFrameIndex][0], 0);
+		RecordGpuDrivenDraws(m_SliceCommandBuffers[m_CurrentFrameIndex][0],
+			m_OcclusionGraph ? GpuCulling::Phase::EARLY : GpuCulling::Phase::ALL);
+	}
+	else
+	{
+		// the model draws are split into slices that are recorded in parallel; the slices are
+		// executed in order, so the sorted draws stay front to back
+		const uint32_t drawCount = m_RenderPacket.useDrawSorting
+									   ? m_RenderPacket.drawList.GetCount()
+									   : m_RenderPacket.drawCount;
+		// an empty slice is still recorded when everything was culled
+		const uint32_t drawsPerSlice = std::max(
+			(drawCount + m_RenderPacket.recordSliceCount - 1) / m_RenderPacket.recordSliceCount,
+			1u);
+		sliceCount = std::max((drawCount + drawsPerSlice - 1) / drawsPerSlice, 1u);
+
+		std::atomic<uint32_t> issuedBindCount{ 0 };
+		std::atomic<uint32_t> savedBindCount{ 0 };
+		JobCounter recordCounter;
+		m_JobSystem->ParallelFor(
+			sliceCount,
+			1,
+			[this, drawsPerSlice, drawCount, &issuedBindCount, &savedBindCount](
+				uint32_t begin, uint32_t end) {
+				for (uint32_t slice = begin; slice < end; ++slice)
+				{
+					const uint32_t firstDraw = std::min(slice * drawsPerSlice, drawCount);
+					const DrawBindCounts bindCounts = RecordModelDraws(
+						slice, firstDraw, std::min(firstDraw + drawsPerSlice, drawCount));
+					issuedBindCount += bindCounts.issued;
+					savedBindCount += bindCounts.saved;
+				}
+			},
+			recordCounter);
+		m_JobSystem->Wait(recordCounter);
+		m_IssuedBindCount = issuedBindCount.load();
+		m_SavedBindCount = savedBindCount.load();
+	}
+
+	m_DrawRecordTime = std::chrono::duration<float, std::chrono::milliseconds::period>(
+		std::chrono::high_resolution_clock::now() - recordStartTime)
+						   .count();
+
+	// the depth of every slice has to be written before any slice is shaded; the gpu-driven
+	// draws record both into one command buffer
+	std::vector<VkCommandBuffer> secondaryCmdBuffs;
+	if (m_RenderPacket.useDepthPrepass && !m_RenderPacket.useGpuCulling)
+	{
+		secondaryCmdBuffs.insert(secondaryCmdBuffs.end(),
+			m_PrepassSliceCommandBuffers[m_CurrentFrameIndex].begin(),
+			m_PrepassSliceCommandBuffers[m_CurrentFrameIndex].begin() + sliceCount);
+	}
+	secondaryCmdBuffs.insert(secondaryCmdBuffs.end(),
+		m_SliceCommandBuffers[m_CurrentFrameIndex].begin(),
+		m_SliceCommandBuffers[m_CurrentFrameIndex].begin() + sliceCount);
+	// skybox and ui are drawn at the last; with occlusion culling after the late draws
+	if (!m_OcclusionGraph)
+	{
+		RecordOverlay();
+		secondaryCmdBuffs.push_back(m_OverlayCommandBuffers[m_CurrentFrameIndex]);
+	}
+	vkCmdExecuteCommands(
+		cmdBuff, static_cast<uint32_t>(secondaryCmdBuffs.size()), secondaryCmdBuffs.data());
+
+	vkCmdEndRenderPass(cmdBuff);
+	if (m_GpuTimestamps)
+	{
+		m_GpuTimestamps->RecordTimestamp(cmdBuff,
+			m_CurrentFrameIndex,
+			g_TimestampSceneEnd,
+			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+	}
+}
+
+void Engine::RecordHiZPass(VkCommandBuffer cmdBuff)
+{
+	m_HiZ->RecordBuild(cmdBuff);
+}
+
+void Engine::RecordLateCullPass(VkCommandBuffer cmdBuff)
+{
+	m_GpuCulling->RecordCull(cmdBuff,
+		m_CurrentFrameIndex,
+		m_RenderPacket.viewProjectionMatrix,
+		m_RenderPacket.drawCount,
+		GpuCulling::Phase::LATE);
+}
+
+void Engine::RecordLateScenePass(VkCommandBuffer cmdBuff)
+{
+	if (m_GpuTimestamps)
+	{
+		m_GpuTimestamps->RecordTimestamp(cmdBuff,
+			m_CurrentFrameIndex,
+			g_TimestampLateSceneBegin,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+	}
+	BeginRenderPass(cmdBuff, m_LoadRenderPass);
+
+	// the instances that became visible since the last frame
+	VkCommandBuffer lateCmdBuff = m_LateCommandBuffers[m_CurrentFrameIndex];
+	vkResetCommandBuffer(lateCmdBuff, 0);
+	RecordGpuDrivenDraws(lateCmdBuff, GpuCulling::Phase::LATE);
+	RecordOverlay();
+
+	const std::array<VkCommandBuffer, 2> secondaryCmdBuffs{ lateCmdBuff,
+		m_OverlayCommandBuffers[m_CurrentFrameIndex] };
+	vkCmdExecuteCommands(
+		cmdBuff, static_cast<uint32_t>(secondaryCmdBuffs.size()), secondaryCmdBuffs.data());
+
+	vkCmdEndRenderPass(cmdBuff);
+	if (m_GpuTimestamps)
+	{
+		m_GpuTimestamps->RecordTimestamp(cmdBuff,
+			m_CurrentFrameIndex,
+			g_TimestampLateSceneEnd,
+			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+	}
+}
+
+Engine::DrawBindCounts Engine::RecordModelDraws(uint32_t slice,
+	uint32_t firstDraw,
+	uint32_t lastDraw)
+{
+	// every slice has its own command pool, so slices can be recorded on any thread
+	VkCommandBuffer cmdBuff = m_SliceCommandBuffers[m_CurrentFrameIndex][slice];
+	VkCommandBuffer prepassCmdBuff = m_PrepassSliceCommandBuffers[m_CurrentFrameIndex][slice];
+	const bool usePrepass = m_RenderPacket.useDepthPrepass;
+	vkResetCommandPool(m_Device->GetDevice(), m_SliceCommandPools[m_CurrentFrameIndex][slice], 0);
+	BeginSecondaryCommandBuffer(cmdBuff);
+	if (usePrepass)
+		BeginSecondaryCommandBuffer(prepassCmdBuff);
+
+	// every bind is recorded into both command buffers with the pre-pass
+	const uint32_t cmdBuffCount = usePrepass ? 2 : 1;
+	const uint32_t meshCount = m_Model->GetMeshCount();
+	DrawBindCounts bindCounts;
+
+	const bool useInstancing = m_RenderPacket.useInstancing;
+	const auto bindPipeline = [this, useInstancing, &bindCounts](VkCommandBuffer commandBuffer,
+								  VkPipeline pipeline) {
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+		++bindCounts.issued;
+		// in the UBO path the descriptor set is bound per draw with the slot's dynamic offset
+		if (m_RenderPacket.usePushConstants || useInstancing)
+		{
+			uint32_t dynamicOffset = 0;
+			vkCmdBindDescriptorSets(commandBuffer,
+				VK_PIPELINE_BIND_POINT_GRAPHICS,
+				m_PipelineLayout,
+				0,
+				1,
+				&m_DescriptorSets[m_CurrentFrameIndex],
+				1,
+				&dynamicOffset);
+			++bindCounts.issued;
+		}
+		if (useInstancing)
+		{
+			vkCmdBindDescriptorSets(commandBuffer,
+				VK_PIPELINE_BIND_POINT_GRAPHICS,
+				m_PipelineLayout,
+				1,
+				1,
+				&m_InstanceDescriptorSets[m_CurrentFrameIndex],
+				0,
+				nullptr);
+			++bindCounts.issued;
+		}
+	};
+	const ScenePipelines& pipelines = m_RenderPacket.pipelines;
+	if (usePrepass)
+	{
+		bindPipeline(prepassCmdBuff, pipelines.prepass);
+		bindPipeline(cmdBuff, pipelines.depthEqual);
+		// the pre-pass buffers of all slices are executed before the first slice
+		if (slice == 0 && m_GpuTimestamps)
+		{
+			m_GpuTimestamps->RecordTimestamp(cmdBuff,
+				m_CurrentFrameIndex,
+				g_TimestampDepthPrepassEnd,
+				VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+		}
+	}
+	else
+	{
+		bindPipeline(cmdBuff, pipelines.pipeline);
+	}
+
+	// the UBO and instance slot stays `i`, so the visible draws use consecutive slots
+	const DrawList& drawList = m_RenderPacket.drawList;
+	const bool useDrawSorting = m_RenderPacket.useDrawSorting;
+	if (useInstancing)
+	{
+		// the slices write disjoint ranges of the frame's instance buffer; sorted, the instances
+		// are drawn front to back
+		auto* instances = static_cast<glm::mat4*>(m_InstanceBufferMapped[m_CurrentFrameIndex]);
+		for (uint32_t i = firstDraw; i < lastDraw; ++i)
+		{
+			const uint32_t draw = useDrawSorting ? drawList.draws[i] : i;
+			instances[i] = GetBenchmarkModelMatrix(
+				m_RenderPacket.useCpuCulling ? m_RenderPacket.visibleDraws[draw] : draw);
+		}
+
+		if (usePrepass)
+		{
+			m_Model->Draw(
+				prepassCmdBuff, Model::VertexStream::POSITION, firstDraw, lastDraw - firstDraw);
+		}
+		m_Model->Draw(cmdBuff, Model::VertexStream::ALL, firstDraw, lastDraw - firstDraw);
+		bindCounts.issued += 2 * meshCount * cmdBuffCount;
+	}
+	else if (useDrawSorting)
+	{
+		// one item per mesh of a draw; the UBO slot is the item, so the slot of every draw is
+		// only written by one slice
+		// the state of the previous item is only bound again if it changed
+		uint32_t boundDraw = std::numeric_limits<uint32_t>::max();
+		uint32_t boundMesh = std::numeric_limits<uint32_t>::max();
+		const uint32_t perDrawBinds = m_RenderPacket.usePushConstants ? 0 : cmdBuffCount;
+		for (uint32_t i = firstDraw; i < lastDraw; ++i)
+		{
+			const uint32_t draw = drawList.draws[i];
+			const uint32_t mesh = DrawList::GetMesh(drawList.keys[i]);
+			if (draw != boundDraw)
+			{
+				const uint32_t drawIndex =
+					m_RenderPacket.useCpuCulling ? m_RenderPacket.visibleDraws[draw] : draw;
+				const PerDrawData drawData = GetBenchmarkDrawData(drawIndex);
+				if (usePrepass)
+					BindPerDrawData(prepassCmdBuff, i, drawData);
+				BindPerDrawData(cmdBuff, i, drawData);
+				bindCounts.issued += perDrawBinds;
+				boundDraw = draw;
+			}
+			else
+			{
+				bindCounts.saved += perDrawBinds;
+			}
+
+			if (mesh != boundMesh)
+			{
+				if (usePrepass)
+					m_Model->BindMesh(prepassCmdBuff, mesh, Model::VertexStream::POSITION);
+				m_Model->BindMesh(cmdBuff, mesh);
+				bindCounts.issued += 2 * cmdBuffCount;
+				boundMesh = mesh;
+			}
+			else
+			{
+				bindCounts.saved += 2 * cmdBuffCount;
+			}
+
+			if (usePrepass)
+				m_Model->DrawMesh(prepassCmdBuff, mesh);
+			m_Model->DrawMesh(cmdBuff, mesh);
+		}
+	}
+	else
+	{
+		for (uint32_t i = firstDraw; i < lastDraw; ++i)
+		{
+			const uint32_t drawIndex =
+				m_RenderPacket.useCpuCulling ? m_RenderPacket.visibleDraws[i] : i;
+			const PerDrawData drawData = GetBenchmarkDrawData(drawIndex);
+			if (usePrepass)
+			{
+				BindPerDrawData(prepassCmdBuff, i, drawData);
+				m_Model->Draw(prepassCmdBuff, Model::VertexStream::POSITION);
+			}
+			BindPerDrawData(cmdBuff, i, drawData);
+			m_Model->Draw(cmdBuff);
+		}
+		const uint32_t perDrawBinds = (m_RenderPacket.usePushConstants ? 0 : 1) + 2 * meshCount;
+		bindCounts.issued += perDrawBinds * cmdBuffCount * (lastDraw - firstDraw);
+	}
+
+	if (usePrepass)
+	{
+		ErrCheck(vkEndCommandBuffer(prepassCmdBuff) != VK_SUCCESS,
+			"Failed to record command buffer!");
+	}
+	ErrCheck(vkEndCommandBuffer(cmdBuff) != VK_SUCCESS, "Failed to record command buffer!");
+
+	return bindCounts;
+}
+
+void Engine::RecordGpuDrivenDraws(VkCommandBuffer cmdBuff, GpuCulling::Phase phase)
+{
+	BeginSecondaryCommandBuffer(cmdBuff);
+
+	// an empty command buffer until the instanced pipeline is compiled
+	const ScenePipelines& pipelines = m_RenderPacket.pipelines;
+	if (!m_RenderPacket.useDepthPrepass && pipelines.pipeline == VK_NULL_HANDLE)
+	{
+		ErrCheck(vkEndCommandBuffer(cmdBuff) != VK_SUCCESS, "Failed to record command buffer!");
+		return;
+	}
 
-	// model
-	vkCmdBindPipeline(m_ActiveCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline);
-	vkCmdBindDescriptorSets(m_ActiveCommandBuffer,
+	// the view projection matrix is read from slot 0 of the dynamic matrix UBO
+	// every pipeline has the same layout, so the set stays bound when the pipeline changes
+	uint32_t dynamicOffset = 0;
+	vkCmdBindDescriptorSets(cmdBuff,
 		VK_PIPELINE_BIND_POINT_GRAPHICS,
 		m_PipelineLayout,
 		0,
@@ -226,37 +1032,124 @@ void Engine::Draw(float deltatime)
 		&m_DescriptorSets[m_CurrentFrameIndex],
 		1,
 		&dynamicOffset);
-
-	m_Model->Draw(m_ActiveCommandBuffer);
-
-	// skybox // draw skybox at the last
-	vkCmdBindPipeline(m_ActiveCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_CubemapPipeline);
-	vkCmdBindDescriptorSets(m_ActiveCommandBuffer,
+	// the draw commands index the instances the culling was created with
+	vkCmdBindDescriptorSets(cmdBuff,
 		VK_PIPELINE_BIND_POINT_GRAPHICS,
-		m_CubemapPipelineLayout,
-		0,
+		m_PipelineLayout,
 		1,
-		&m_CubemapDescriptorSets[m_CurrentFrameIndex],
 		1,
-		&dynamicOffset);
-	vkCmdBindVertexBuffers(m_ActiveCommandBuffer, 0, 1, &m_CubemapVertexBuffer, &offset);
-	vkCmdDraw(m_ActiveCommandBuffer, static_cast<uint32_t>(m_CubemapVertices.size()), 1, 0, 0);
+		&m_GpuCullingInstanceDescriptorSet,
+		0,
+		nullptr);
+	if (m_RenderPacket.useDepthPrepass)
+	{
+		vkCmdBindPipeline(cmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.prepass);
+		m_GpuCulling->RecordDraws(
+			cmdBuff, m_CurrentFrameIndex, *m_Model, phase, Model::VertexStream::POSITION);
+		if (phase != GpuCulling::Phase::LATE && m_GpuTimestamps)
+		{
+			m_GpuTimestamps->RecordTimestamp(cmdBuff,
+				m_CurrentFrameIndex,
+				g_TimestampDepthPrepassEnd,
+				VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+		}
+		vkCmdBindPipeline(cmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.depthEqual);
+	}
+	else
+	{
+		vkCmdBindPipeline(cmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.pipeline);
+	}
+	m_GpuCulling->RecordDraws(cmdBuff, m_CurrentFrameIndex, *m_Model, phase);
 
-	UpdateUniformBuffers();
-	m_Camera->OnUpdate(deltatime);
-	OnUiRender();
+	ErrCheck(vkEndCommandBuffer(cmdBuff) != VK_SUCCESS, "Failed to record command buffer!");
+}
 
-	EndScene();
+void Engine::RecordOverlay()
+{
+	VkCommandBuffer cmdBuff = m_OverlayCommandBuffers[m_CurrentFrameIndex];
+	vkResetCommandBuffer(cmdBuff, 0);
+	BeginSecondaryCommandBuffer(cmdBuff);
+
+	uint32_t dynamicOffset = 0;
+	VkDeviceSize offset = 0;
+
+	// skybox
+	if (m_RenderPacket.cubemapPipeline != VK_NULL_HANDLE)
+	{
+		vkCmdBindPipeline(
+			cmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, m_RenderPacket.cubemapPipeline);
+		vkCmdBindDescriptorSets(cmdBuff,
+			VK_PIPELINE_BIND_POINT_GRAPHICS,
+			m_CubemapPipelineLayout,
+			0,
+			1,
+			&m_CubemapDescriptorSets[m_CurrentFrameIndex],
+			1,
+			&dynamicOffset);
+		vkCmdBindVertexBuffers(cmdBuff, 0, 1, &m_CubemapVertexBuffer, &offset);
+		vkCmdDraw(cmdBuff, static_cast<uint32_t>(m_CubemapVertices.size()), 1, 0, 0);
+	}
+
+	ImGuiOverlay::Draw(m_RenderPacket.ui, cmdBuff);
+
+	ErrCheck(vkEndCommandBuffer(cmdBuff) != VK_SUCCESS, "Failed to record command buffer!");
+}
+
+void Engine::BeginRenderPass(VkCommandBuffer cmdBuff, VkRenderPass renderPass)
+{
+	// clear values for each attachment; ignored by the load render pass
+	std::array<VkClearValue, 3> clearValues{};
+	clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
+	clearValues[1].depthStencil = { 1.0f, 0 };
+	clearValues[2].color = clearValues[0].color;
+
+	VkRenderPassBeginInfo renderPassBeginInfo{};
+	renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassBeginInfo.renderPass = renderPass;
+	renderPassBeginInfo.framebuffer = m_SwapchainFramebuffers[m_NextFrameIndex];
+	renderPassBeginInfo.renderArea.offset = { 0, 0 };
+	renderPassBeginInfo.renderArea.extent = m_SwapchainExtent;
+	renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+	renderPassBeginInfo.pClearValues = clearValues.data();
+	vkCmdBeginRenderPass(cmdBuff, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+}
+
+void Engine::BeginSecondaryCommandBuffer(VkCommandBuffer cmdBuff)
+{
+	VkCommandBufferInheritanceInfo inheritanceInfo{};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = m_RenderPass;
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = m_SwapchainFramebuffers[m_NextFrameIndex];
+
+	VkCommandBufferBeginInfo cmdBuffBeginInfo{};
+	cmdBuffBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	cmdBuffBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT
+							 | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	cmdBuffBeginInfo.pInheritanceInfo = &inheritanceInfo;
+	ErrCheck(vkBeginCommandBuffer(cmdBuff, &cmdBuffBeginInfo) != VK_SUCCESS,
+		"Failed to begin recording command buffer!");
+
+	// dynamic states are not inherited from the primary command buffer
+	VkViewport viewport{};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = static_cast<float>(m_SwapchainExtent.width);
+	viewport.height = static_cast<float>(m_SwapchainExtent.height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(cmdBuff, 0, 1, &viewport);
+	VkRect2D scissor{};
+	scissor.offset = { 0, 0 };
+	scissor.extent = m_SwapchainExtent;
+	vkCmdSetScissor(cmdBuff, 0, 1, &scissor);
 }
 
 void Engine::UpdateUniformBuffers()
 {
 	SceneUBO scene{};
-	scene.cameraPos = m_Camera->GetCameraPosition();
-	scene.lightPos[0] = glm::vec4(0.0f, 0.0f, 30.0f, 0.0f);
-	scene.lightPos[1] = glm::vec4(0.0f, 30.0f, 0.0f, 0.0f);
-	scene.lightPos[2] = glm::vec4(30.0f, 0.0f, 0.0f, 0.0f);
-	scene.lightPos[3] = glm::vec4(-30.0f, 0.0f, 0.0f, 0.0f);
+	scene.cameraPos = m_RenderPacket.cameraPos;
+	scene.lightPos = glm::vec3(0.0f, 0.0f, 30.0f);
 	scene.lightColors = glm::vec3(500.0f);
 
 	void* data = nullptr;
@@ -269,42 +1162,230 @@ void Engine::UpdateUniformBuffers()
 	memcpy(data, &scene, SceneUBO::GetSize());
 	vkUnmapMemory(m_Device->GetDevice(), m_SceneUniformBufferMemory[m_CurrentFrameIndex]);
 
+	// slot 0; the model matrix is overwritten per draw in the UBO path
 	MatrixUBO mat{};
-	mat.model = glm::mat4(1.0);
-	mat.model = glm::translate(mat.model, glm::vec3(0.0f, 0.0f, 0.0f));
-	mat.model = glm::scale(mat.model, glm::vec3(0.5f));
-	mat.viewProj = m_Camera->GetViewProjectionMatrix();
+	mat.model = GetBenchmarkModelMatrix(0);
+	mat.viewProj = m_RenderPacket.viewProjectionMatrix;
 	mat.normal = glm::inverseTranspose(mat.model);
+	memcpy(m_MatUniformBufferMapped[m_CurrentFrameIndex], &mat, MatrixUBO::GetSize());
 
+	// skybox
+	mat.viewProj =
+		m_RenderPacket.projectionMatrix
+		* glm::mat4(glm::mat3(
+			m_RenderPacket.viewMatrix)); // remove the translation component from the view matrix
 	vkMapMemory(m_Device->GetDevice(),
-		m_MatUniformBufferMemory[m_CurrentFrameIndex],
+		m_CubemapUniformBufferMem[m_CurrentFrameIndex],
 		0,
 		MatrixUBO::GetSize(),
 		0,
 		&data);
 	memcpy(data, &mat, MatrixUBO::GetSize());
-	vkUnmapMemory(m_Device->GetDevice(), m_MatUniformBufferMemory[m_CurrentFrameIndex]);
+	vkUnmapMemory(m_Device->GetDevice(), m_CubemapUniformBufferMem[m_CurrentFrameIndex]);
+}
+
+void Engine::BindPerDrawData(VkCommandBuffer cmdBuff,
+	uint32_t drawIndex,
+	const PerDrawData& drawData)
+{
+	if (m_RenderPacket.usePushConstants)
+	{
+		vkCmdPushConstants(cmdBuff,
+			m_PipelineLayout,
+			VK_SHADER_STAGE_VERTEX_BIT,
+			0,
+			PerDrawData::GetSize(),
+			&drawData);
+		return;
+	}
+
+	// fallback: write the draw's matrices into its own slot of the dynamic UBO
+	MatrixUBO mat{};
+	mat.model = drawData.model;
+	mat.viewProj = m_RenderPacket.viewProjectionMatrix;
+	mat.normal = drawData.normal;
+
+	const VkDeviceSize slotOffset = m_MatUniformBufferStride * drawIndex;
+	memcpy(static_cast<char*>(m_MatUniformBufferMapped[m_CurrentFrameIndex]) + slotOffset,
+		&mat,
+		MatrixUBO::GetSize());
+
+	const auto dynamicOffset = static_cast<uint32_t>(slotOffset);
+	vkCmdBindDescriptorSets(cmdBuff,
+		VK_PIPELINE_BIND_POINT_GRAPHICS,
+		m_PipelineLayout,
+		0,
+		1,
+		&m_DescriptorSets[m_CurrentFrameIndex],
+		1,
+		&dynamicOffset);
+}
+
+glm::mat4 Engine::GetBenchmarkModelMatrix(uint32_t drawIndex)
+{
+	// place the benchmark copies of the model in a 32x32xN grid around the original
+	constexpr uint32_t gridSize = 32;
+	constexpr float spacing = 2.0f;
+	const glm::vec3 gridPos{ static_cast<float>(drawIndex % gridSize),
+		static_cast<float>((drawIndex / gridSize) % gridSize),
+		-static_cast<float>(drawIndex / (gridSize * gridSize)) };
+
+	glm::mat4 model = glm::mat4(1.0);
+	model = glm::translate(model, gridPos * spacing);
+	model = glm::scale(model, glm::vec3(0.5f));
+	return model;
+}
+
+PerDrawData Engine::GetBenchmarkDrawData(uint32_t drawIndex)
+{
+	const glm::mat4 model = GetBenchmarkModelMatrix(drawIndex);
+	return PerDrawData{ model, glm::inverseTranspose(model) };
+}
+
+void Engine::ResolveScenePipelines(FramePacket& packet)
+{
+	const auto resolve = [this](const ScenePipelineIds& ids) {
+		return ScenePipelines{ m_PipelineStates->TryGet(ids.pipeline),
+			m_PipelineStates->TryGet(ids.prepass),
+			m_PipelineStates->TryGet(ids.depthEqual) };
+	};
+	m_PipelineFallbackCount = 0;
+	packet.cubemapPipeline = m_PipelineStates->TryGet(m_CubemapPipeline);
+
+	uint32_t features = m_SceneFeatures;
+	if (!m_UseNormalMapping)
+		features &= ~ShaderFeature::NORMAL_MAPPING;
+	// the gpu-driven draws are always instanced
+	features |= ShaderFeature::GetPerDrawFeatures(
+		packet.useInstancing || packet.useGpuCulling, packet.usePushConstants);
+	packet.pipelines = resolve(RequestScenePipelines(features));
+
+	// the push constant and UBO pipelines of the default features are compiled at startup
+	if (packet.pipelines.pipeline == VK_NULL_HANDLE && !packet.useGpuCulling)
+	{
+		packet.useInstancing = false;
+		packet.usePushConstants = m_PushConstantsSupported;
+		packet.pipelines = resolve(RequestScenePipelines(m_FallbackSceneFeatures
+			| ShaderFeature::GetPerDrawFeatures(false, m_PushConstantsSupported)));
+		++m_PipelineFallbackCount;
+	}
+	if (packet.useDepthPrepass
+		&& (packet.pipelines.prepass == VK_NULL_HANDLE
+			|| packet.pipelines.depthEqual == VK_NULL_HANDLE))
+	{
+		packet.useDepthPrepass = false;
+		++m_PipelineFallbackCount;
+	}
+}
+
+Engine::ScenePipelineIds Engine::RequestScenePipelines(uint32_t features)
+{
+	const auto [it, isNew] = m_ScenePipelines.try_emplace(features);
+	if (isNew)
+	{
+		// an already compiled description, like a fallback pipeline, is not compiled again
+		ScenePipelineIds& ids = it->second;
+		const VkPipelineCache pipelineCache = m_PipelineCache->Get();
+		ids.pipeline = m_PipelineStates->CreateAsync(GetScenePipelineDesc(features), pipelineCache);
+		ids.prepass = m_PipelineStates->CreateAsync(
+			GetScenePipelineDesc(features, PipelineDepthMode::PREPASS), pipelineCache);
+		ids.depthEqual = m_PipelineStates->CreateAsync(
+			GetScenePipelineDesc(features, PipelineDepthMode::EQUAL), pipelineCache);
+	}
+	return it->second;
+}
+
+void Engine::ReloadChangedShaders()
+{
+	const std::vector<std::string> changedShaders = m_ShaderCompiler->PollChangedShaders();
+	if (changedShaders.empty())
+		return;
+
+	// the pipelines are swapped once they are compiled, until then the old ones are drawn
+	const uint32_t pipelineCount =
+		m_PipelineStates->Reload(changedShaders, m_PipelineCache->Get());
+	for (const auto& shader : changedShaders)
+		Logger::Info("Shader \"{}\" changed, reloading its pipelines", shader);
+	Logger::Info("{} pipelines queued for reload", pipelineCount);
+}
+
+void Engine::BuildDrawList(FramePacket& packet)
+{
+	// one item per mesh, so the draws of a mesh can share its vertex buffer binds; the instanced
+	// draws are already drawn mesh by mesh, only their instances are sorted
+	const bool perMesh = !packet.useInstancing;
+	const uint32_t meshCount = perMesh ? m_Model->GetMeshCount() : 1;
+	const std::vector<glm::vec4>& meshSpheres = m_Model->GetBoundingSpheres();
+	const glm::vec4 modelSphere = m_Model->GetBoundingSphere();
+	const float depthScale = 1.0f / (packet.zFar - packet.zNear);
+	packet.drawList.Resize(packet.drawCount * meshCount);
+
+	JobCounter keyCounter;
+	m_JobSystem->ParallelFor(
+		packet.drawCount,
+		g_DrawListBatchSize,
+		[&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				const uint32_t drawIndex = packet.useCpuCulling ? packet.visibleDraws[i] : i;
+				const glm::mat4 modelView = packet.viewMatrix * GetBenchmarkModelMatrix(drawIndex);
+				for (uint32_t mesh = 0; mesh < meshCount; ++mesh)
+				{
+					const glm::vec4& sphere = perMesh ? meshSpheres[mesh] : modelSphere;
+					// the view looks down -z
+					const float viewDepth = -(modelView * glm::vec4(glm::vec3(sphere), 1.0f)).z;
+					// every benchmark draw has the same pipeline and material
+					const uint32_t item = i * meshCount + mesh;
+					packet.drawList.keys[item] =
+						DrawList::MakeKey(0, 0, mesh, (viewDepth - packet.zNear) * depthScale);
+					packet.drawList.draws[item] = i;
+				}
+			}
+		},
+		keyCounter);
+	m_JobSystem->Wait(keyCounter);
+
+	m_DrawListSorter->Sort(packet.drawList);
+}
+
+std::vector<ClusteredLighting::PointLight> Engine::GetBenchmarkLights()
+{
+	// the four lights of the scene, their range covers the whole benchmark grid
+	std::vector<ClusteredLighting::PointLight> lights;
+	lights.reserve(g_MaxPointLights);
+	for (const glm::vec3& position : { glm::vec3{ 0.0f, 0.0f, 30.0f },
+			 glm::vec3{ 0.0f, 30.0f, 0.0f },
+			 glm::vec3{ 30.0f, 0.0f, 0.0f },
+			 glm::vec3{ -30.0f, 0.0f, 0.0f } })
+	{
+		lights.push_back({ glm::vec4{ position, 200.0f }, glm::vec4{ 500.0f } });
+	}
 
-	// skybox
-	mat.viewProj =
-		m_Camera->GetProjectionMatrix()
-		* glm::mat4(glm::mat3(
-			m_Camera->GetViewMatrix())); // remove the translation component from the view matrix
-	vkMapMemory(m_Device->GetDevice(),
-		m_CubemapUniformBufferMem[m_CurrentFrameIndex],
-		0,
-		MatrixUBO::GetSize(),
-		0,
-		&data);
-	memcpy(data, &mat, MatrixUBO::GetSize());
-	vkUnmapMemory(m_Device->GetDevice(), m_CubemapUniformBufferMem[m_CurrentFrameIndex]);
+	// followed by small colored lights scattered over the front layers of the grid
+	std::mt19937 rng{ 1234 };
+	std::uniform_real_distribution<float> sideDist{ -2.0f, 64.0f };
+	std::uniform_real_distribution<float> depthDist{ -16.0f, 2.0f };
+	std::uniform_real_distribution<float> rangeDist{ 1.5f, 4.0f };
+	std::uniform_real_distribution<float> colorDist{ 0.0f, 1.0f };
+	while (lights.size() < static_cast<size_t>(g_MaxPointLights))
+	{
+		const glm::vec3 position{ sideDist(rng), sideDist(rng), depthDist(rng) };
+		const glm::vec3 color{ colorDist(rng), colorDist(rng), colorDist(rng) };
+		lights.push_back(
+			{ glm::vec4{ position, rangeDist(rng) }, glm::vec4{ color * 10.0f, 0.0f } });
+	}
+
+	return lights;
 }
 
-void Engine::BeginScene()
+bool Engine::BeginScene()
 {
-	// wait for previous frame to signal the fence
-	vkWaitForFences(
-		m_Device->GetDevice(), 1, &m_InFlightFences[m_CurrentFrameIndex], VK_TRUE, UINT64_MAX);
+	// the per-frame resources of this frame are free once the frame that used them before is done
+	const uint64_t nextFrame = m_FrameNumber + 1;
+	if (nextFrame > m_Settings.framesInFlight)
+		WaitForFrame(nextFrame - m_Settings.framesInFlight);
+
+	m_DeletionQueue.BeginFrame(nextFrame, m_RenderPacket.number, GetCompletedFrame());
 
 	const VkResult result = vkAcquireNextImageKHR(m_Device->GetDevice(),
 		m_Swapchain,
@@ -313,13 +1394,15 @@ void Engine::BeginScene()
 		VK_NULL_HANDLE,
 		&m_NextFrameIndex);
 
+	// the window can be resized before the main thread publishes the new extent
+	if (result == VK_ERROR_OUT_OF_DATE_KHR)
+	{
+		RecreateSwapchain();
+		return false;
+	}
 	ErrCheck(
 		result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR, "Failed to acquire swapchain image!");
 
-	// resetting the fence has been set after the result is checked to avoid a deadlock
-	// reset the fence to unsignaled state
-	vkResetFences(m_Device->GetDevice(), 1, &m_InFlightFences[m_CurrentFrameIndex]);
-
 	// begin command buffer
 	m_ActiveCommandBuffer = m_CommandBuffers[m_CurrentFrameIndex];
 	vkResetCommandBuffer(m_ActiveCommandBuffer, 0);
@@ -328,39 +1411,11 @@ void Engine::BeginScene()
 	ErrCheck(vkBeginCommandBuffer(m_ActiveCommandBuffer, &cmdBuffBeginInfo) != VK_SUCCESS,
 		"Failed to begin recording command buffer!");
 
-	// begin render pass
-	// clear values for each attachment
-	std::array<VkClearValue, 3> clearValues{};
-	clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
-	clearValues[1].depthStencil = { 1.0f, 0 };
-	clearValues[2].color = clearValues[0].color;
-	VkViewport viewport{};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = static_cast<float>(m_SwapchainExtent.width);
-	viewport.height = static_cast<float>(m_SwapchainExtent.height);
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-	vkCmdSetViewport(m_ActiveCommandBuffer, 0, 1, &viewport);
-	VkRect2D scissor{};
-	scissor.offset = { 0, 0 };
-	scissor.extent = m_SwapchainExtent;
-	vkCmdSetScissor(m_ActiveCommandBuffer, 0, 1, &scissor);
-
-	VkRenderPassBeginInfo renderPassBeginInfo{};
-	renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassBeginInfo.renderPass = m_RenderPass;
-	renderPassBeginInfo.framebuffer = m_SwapchainFramebuffers[m_NextFrameIndex];
-	renderPassBeginInfo.renderArea.offset = { 0, 0 };
-	renderPassBeginInfo.renderArea.extent = m_SwapchainExtent;
-	renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-	renderPassBeginInfo.pClearValues = clearValues.data();
-	vkCmdBeginRenderPass(m_ActiveCommandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+	return true;
 }
 
 void Engine::EndScene()
 {
-	vkCmdEndRenderPass(m_ActiveCommandBuffer);
 	ErrCheck(vkEndCommandBuffer(m_ActiveCommandBuffer) != VK_SUCCESS,
 		"Failed to record command buffer!");
 
@@ -372,14 +1427,23 @@ void Engine::EndScene()
 	submitInfo.pWaitDstStageMask = waitStages.data();
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &m_ActiveCommandBuffer;
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = &m_RenderFinishedSemaphores[m_CurrentFrameIndex];
 
-	// signals the fence after executing the command buffer
-	ErrCheck(
-		vkQueueSubmit(
-			m_Device->GetGraphicsQueue(), 1, &submitInfo, m_InFlightFences[m_CurrentFrameIndex])
-			!= VK_SUCCESS,
+	// signals the frame number on the timeline after executing the command buffer
+	// the value of the binary semaphore is ignored
+	const std::array<VkSemaphore, 2> signalSemaphores{
+		m_RenderFinishedSemaphores[m_CurrentFrameIndex], m_FrameTimeline
+	};
+	const std::array<uint64_t, 2> signalValues{ 0, m_FrameNumber + 1 };
+	VkTimelineSemaphoreSubmitInfo timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+	timelineInfo.pSignalSemaphoreValues = signalValues.data();
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+	submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+	ErrCheck(vkQueueSubmit(m_Device->GetGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE)
+				 != VK_SUCCESS,
 		"Failed to submit draw command buffer!");
 
 	std::array<VkSwapchainKHR, 1> swapchains{ m_Swapchain };
@@ -395,30 +1459,121 @@ void Engine::EndScene()
 	vkQueuePresentKHR(m_Device->GetPresentQueue(), &presentInfo);
 
 	// update current frame index
-	m_CurrentFrameIndex = (m_CurrentFrameIndex + 1) % Config::maxFramesInFlight;
+	++m_FrameNumber;
+	m_CurrentFrameIndex = (m_CurrentFrameIndex + 1) % m_Settings.framesInFlight;
 }
 
 void Engine::OnUiRender()
 {
-	ImGuiOverlay::Begin();
-
 	ImGui::Begin("Profiler");
-	ImGui::Text("%.2f ms/frame (%d fps)", (1000.0f / static_cast<float>(m_LastFps)), m_LastFps);
+	const uint32_t lastFps = m_LastFps;
+	ImGui::Text("%.2f ms/frame (%d fps)", (1000.0f / static_cast<float>(lastFps)), lastFps);
+	ImGui::Separator();
+
+	// compares the cost of recording the draws with push constants and with dynamic UBO offsets
+	ImGui::Text("Draw recording: %.3f ms", m_DrawRecordTime.load());
+	ImGui::SliderInt("Draws", &m_BenchmarkDrawCount, 1, g_MaxBenchmarkDraws);
+	ImGui::SliderInt("Record slices",
+		&m_RecordSliceCount,
+		1,
+		static_cast<int>(m_JobSystem->GetWorkerCount() + 1));
+	ImGui::BeginDisabled(!m_PushConstantsSupported);
+	ImGui::Checkbox("Push constants", &m_UsePushConstants);
+	ImGui::EndDisabled();
+	// one draw per mesh and slice instead of one per model; the gpu culling draws are instanced
+	ImGui::Checkbox("Instancing", &m_UseInstancing);
+	// sorted by mesh and front to back, the draws of a mesh only bind its buffers once
+	ImGui::BeginDisabled(m_UseGpuCulling);
+	ImGui::Checkbox("Sort draws", &m_UseDrawSorting);
+	ImGui::EndDisabled();
+	ImGui::Text("Draw sorting: %.3f ms", m_UseDrawSorting ? m_DrawSortTime : 0.0f);
+	if (!m_UseGpuCulling)
+		ImGui::Text("Binds: %u (%u saved)", m_IssuedBindCount.load(), m_SavedBindCount.load());
+	// the draws fall back to compiled pipelines while the others are compiled in the background
+	ImGui::Text("Pipelines compiling: %u, optimizing: %u",
+		m_PipelineStates->GetPendingCount(),
+		m_PipelineStates->GetOptimizingCount());
+	ImGui::Text("Shader modules: %u, pipelines from module identifiers: %u",
+		m_PipelineStates->GetShaderModuleCount(),
+		m_PipelineStates->GetIdentifierPipelineCount());
+	ImGui::Text("Pipeline fallbacks: %u, skipped draws: %u",
+		m_PipelineFallbackCount,
+		m_SkippedDrawCount);
+	ImGui::Separator();
+
+	// compares the gpu time of the scene with and without the depth pre-pass
+	ImGui::Checkbox("Depth pre-pass", &m_UseDepthPrepass);
+	// a specialization constant; the permutation is compiled the first time it is requested
+	ImGui::BeginDisabled(!(m_SceneFeatures & ShaderFeature::NORMAL_MAPPING));
+	ImGui::Checkbox("Normal mapping", &m_UseNormalMapping);
+	ImGui::EndDisabled();
+	if (m_GpuTimestamps)
+	{
+		ImGui::Text("Scene GPU: %.3f ms", m_SceneGpuTime.load());
+		ImGui::Text("Depth pre-pass GPU: %.3f ms",
+			m_UseDepthPrepass ? m_DepthPrepassGpuTime.load() : 0.0f);
+	}
+	ImGui::Separator();
+
+	// the cost of the clustered shading with the number of lights
+	ImGui::SliderInt("Point lights", &m_PointLightCount, 0, g_MaxPointLights);
+	if (m_GpuTimestamps)
+		ImGui::Text("Light clusters GPU: %.3f ms", m_LightClusterGpuTime.load());
+	ImGui::Separator();
+
+	ImGui::BeginDisabled(m_UseGpuCulling);
+	ImGui::Checkbox("CPU culling", &m_UseCpuCulling);
+	ImGui::EndDisabled();
+	ImGui::Text("CPU culling: %.3f ms", m_UseCpuCulling && !m_UseGpuCulling ? m_CpuCullTime : 0.0f);
+	ImGui::BeginDisabled(!m_UseCpuCulling || m_UseGpuCulling);
+	ImGui::Checkbox("Software occlusion culling", &m_UseSoftwareOcclusion);
+	ImGui::EndDisabled();
+	const bool softwareOcclusionActive =
+		m_UseCpuCulling && !m_UseGpuCulling && m_UseSoftwareOcclusion;
+	ImGui::Text("Software occlusion: %.3f ms, %u occluded",
+		softwareOcclusionActive ? m_SoftwareOcclusionTime : 0.0f,
+		softwareOcclusionActive ? m_SoftwareOccludedCount : 0u);
+	ImGui::BeginDisabled(!m_GpuCullingSupported);
+	ImGui::Checkbox("GPU culling", &m_UseGpuCulling);
+	ImGui::EndDisabled();
+	ImGui::BeginDisabled(!m_UseGpuCulling || !m_OcclusionCullingSupported);
+	ImGui::Checkbox("Occlusion culling (Hi-Z)", &m_UseOcclusionCulling);
+	ImGui::EndDisabled();
+	// of the meshes of every instance, read back from a previous frame
+	ImGui::Text("Frustum culled: %u", m_UseGpuCulling ? m_FrustumCulledCount.load() : 0u);
+	ImGui::Text("Occluded: %u",
+		m_UseGpuCulling && m_UseOcclusionCulling && m_OcclusionCullingSupported
+			? m_OccludedCount.load()
+			: 0u);
+	ImGui::End();
+
+	// changes are applied at the start of the next frame
+	ImGui::Begin("Settings");
+	auto framesInFlight = static_cast<int>(m_PendingSettings.framesInFlight);
+	if (ImGui::SliderInt(
+			"Frames in flight", &framesInFlight, 1, static_cast<int>(Config::maxFramesInFlight)))
+		m_PendingSettings.framesInFlight = static_cast<uint32_t>(framesInFlight);
+
+	if (ImGui::BeginCombo(
+			"Present mode", RenderSettings::PresentModeToString(m_PendingSettings.presentMode)))
+	{
+		for (const auto presentMode : m_AvailablePresentModes)
+		{
+			if (ImGui::Selectable(RenderSettings::PresentModeToString(presentMode),
+					presentMode == m_PendingSettings.presentMode))
+				m_PendingSettings.presentMode = presentMode;
+		}
+		ImGui::EndCombo();
+	}
 	ImGui::End();
-	ImGuiOverlay::End(m_ActiveCommandBuffer);
 }
 
-float Engine::CalcFps()
+void Engine::CalcFps()
 {
 	++m_FrameCounter;
 	const std::chrono::time_point<std::chrono::high_resolution_clock> currentFrameTime =
 		std::chrono::high_resolution_clock::now();
 
-	const float deltatime = std::chrono::duration<float, std::chrono::milliseconds::period>(
-		currentFrameTime - m_LastFrameTime)
-								.count();
-	m_LastFrameTime = currentFrameTime;
-
 	const float fpsTimer = std::chrono::duration<float, std::chrono::milliseconds::period>(
 		currentFrameTime - m_FpsTimePoint)
 							   .count();
@@ -430,8 +1585,33 @@ float Engine::CalcFps()
 		m_FrameCounter = 0;
 		m_FpsTimePoint = currentFrameTime;
 	}
+}
+
+void Engine::ApplySettings(const RenderSettings& settings)
+{
+	if (settings == m_Settings)
+		return;
+
+	// the deletion queue is not flushed, the packets that are still in use may reference retired
+	// pipelines; `BeginFrame()` runs the deletions of the finished packets
+	vkDeviceWaitIdle(m_Device->GetDevice());
+
+	const RenderSettings oldSettings = m_Settings;
+	m_Settings = settings;
+
+	if (m_Settings.framesInFlight != oldSettings.framesInFlight)
+	{
+		CleanupSyncObjects();
+		CreateSyncObjects();
+		m_CurrentFrameIndex = 0;
+	}
+
+	if (m_Settings.presentMode != oldSettings.presentMode)
+		RecreateSwapchain();
 
-	return deltatime;
+	Logger::Info("Settings applied: {} frames in flight, present mode \"{}\"",
+		m_Settings.framesInFlight,
+		RenderSettings::PresentModeToString(m_PresentMode));
 }
 
 void Engine::CreateCommandPool()
@@ -468,14 +1648,19 @@ void Engine::CreateDescriptorPool()
 		"Failed to create descriptor pool!");
 }
 
-void Engine::CreateSwapchain()
+void Engine::CreateSwapchain(VkSwapchainKHR oldSwapchain)
 {
 	const SwapchainSupportDetails swapchainSupport =
 		Device::QuerySwapchainSupport(m_Device->GetPhysicalDevice(), m_Window->GetWindowSurface());
 	const VkSurfaceFormatKHR surfaceFormat = utils::ChooseSurfaceFormat(swapchainSupport.formats);
-	const VkPresentModeKHR presentMode = utils::ChoosePresentMode(swapchainSupport.presentModes);
+	// the settings keep the requested mode, so a fallback doesn't look like a settings change
+	m_PresentMode = utils::ChoosePresentMode(swapchainSupport.presentModes, m_Settings.presentMode);
+	// the framebuffer size is queried on the main thread and passed in the frame packet
 	const VkExtent2D extent =
-		utils::ChooseExtent(swapchainSupport.capabilities, BIND_FN(m_Window->GetFramebufferSize));
+		utils::ChooseExtent(swapchainSupport.capabilities, [this](int* width, int* height) {
+			*width = static_cast<int>(m_FramebufferExtent.width);
+			*height = static_cast<int>(m_FramebufferExtent.height);
+		});
 
 	uint32_t imageCount = swapchainSupport.capabilities.minImageCount + 1;
 	if (swapchainSupport.capabilities.maxImageCount > 0
@@ -506,9 +1691,10 @@ void Engine::CreateSwapchain()
 	}
 	swapchainInfo.preTransform = swapchainSupport.capabilities.currentTransform;
 	swapchainInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-	swapchainInfo.presentMode = presentMode;
+	swapchainInfo.presentMode = m_PresentMode;
 	swapchainInfo.clipped = VK_TRUE;
-	swapchainInfo.oldSwapchain = VK_NULL_HANDLE;
+	// lets the driver reuse the resources of the old swapchain
+	swapchainInfo.oldSwapchain = oldSwapchain;
 
 	ErrCheck(vkCreateSwapchainKHR(m_Device->GetDevice(), &swapchainInfo, nullptr, &m_Swapchain)
 				 != VK_SUCCESS,
@@ -544,39 +1730,50 @@ void Engine::CreateSwapchainImageViews()
 
 void Engine::RecreateSwapchain()
 {
-	while (m_Window->IsMinimized())
-	{
-		m_Window->WaitEvents();
-	}
-
-	vkDeviceWaitIdle(m_Device->GetDevice());
-	CleanupSwapchain();
-
-	CreateSwapchain();
+	// no packets are published while the window is minimized
+	// frames that are still in flight keep using the retired resources
+	CreateSwapchain(RetireSwapchain());
 	CreateSwapchainImageViews();
-	CreateColorResource();
-	CreateDepthResource();
+	BuildRenderGraph();
 	CreateFramebuffers();
 }
 
-void Engine::CleanupSwapchain()
+VkSwapchainKHR Engine::RetireSwapchain()
 {
-	vkDestroyImageView(m_Device->GetDevice(), m_DepthImageView, nullptr);
-	vkDestroyImage(m_Device->GetDevice(), m_DepthImage, nullptr);
-	vkFreeMemory(m_Device->GetDevice(), m_DepthImageMemory, nullptr);
-
-	vkDestroyImageView(m_Device->GetDevice(), m_ColorImageView, nullptr);
-	vkDestroyImage(m_Device->GetDevice(), m_ColorImage, nullptr);
-	vkFreeMemory(m_Device->GetDevice(), m_ColorImageMemory, nullptr);
-
-	for (const auto& framebuffer : m_SwapchainFramebuffers)
-		vkDestroyFramebuffer(m_Device->GetDevice(), framebuffer, nullptr);
-
-	for (const auto& imageView : m_SwapchainImageViews)
-		vkDestroyImageView(m_Device->GetDevice(), imageView, nullptr);
+	const VkSwapchainKHR swapchain = m_Swapchain;
+	// shared, since the deletion has to be copyable
+	const std::shared_ptr<VulkanRenderGraphBackend> renderGraphBackend =
+		std::move(m_RenderGraphBackend);
+	m_DeletionQueue.Push([this,
+							 swapchain,
+							 imageViews = std::move(m_SwapchainImageViews),
+							 framebuffers = std::move(m_SwapchainFramebuffers),
+							 renderGraphBackend]() mutable {
+		// the transient attachments are released with the backend
+		renderGraphBackend.reset();
+
+		for (const auto& framebuffer : framebuffers)
+			vkDestroyFramebuffer(m_Device->GetDevice(), framebuffer, nullptr);
+
+		for (const auto& imageView : imageViews)
+			vkDestroyImageView(m_Device->GetDevice(), imageView, nullptr);
+
+		// swapchain images are destroyed with `vkDestroySwapchainKHR()`
+		vkDestroySwapchainKHR(m_Device->GetDevice(), swapchain, nullptr);
+	});
+
+	m_Swapchain = VK_NULL_HANDLE;
+	m_SwapchainImageViews.clear();
+	m_SwapchainFramebuffers.clear();
+
+	return swapchain;
+}
 
-	// swapchain images are destroyed with `vkDestroySwapchainKHR()`
-	vkDestroySwapchainKHR(m_Device->GetDevice(), m_Swapchain, nullptr);
+void Engine::CleanupSwapchain()
+{
+	// only called once the device is idle
+	RetireSwapchain();
+	m_DeletionQueue.Flush();
 }
 
 void Engine::CreateRenderPass()
@@ -584,20 +1781,22 @@ void Engine::CreateRenderPass()
 	const VkFormat depthFormat = utils::FindDepthFormat(m_Device->GetPhysicalDevice());
 
 	// attachment descriptions
+	// the layout transitions and the synchronization with the other passes are done by the
+	// render graph barriers
 	const VkAttachmentDescription colorAttachment =
 		inits::AttachmentDescription(m_SwapchainImageFormat,
 			m_Device->GetMsaaSamples(),
-			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
 			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 	const VkAttachmentDescription depthAttachment = inits::AttachmentDescription(depthFormat,
 		m_Device->GetMsaaSamples(),
-		VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
 		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
 	const VkAttachmentDescription colorResolveAttachment =
 		inits::AttachmentDescription(m_SwapchainImageFormat,
 			VK_SAMPLE_COUNT_1_BIT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 
 	std::array<VkAttachmentDescription, 3> attachments{
 		colorAttachment, depthAttachment, colorResolveAttachment
@@ -614,80 +1813,80 @@ void Engine::CreateRenderPass()
 	// subpass
 	const VkSubpassDescription subpass =
 		inits::SubpassDescription(1, &colorRef, &depthRef, &colorResolveRef);
-	const VkSubpassDependency subpassDependency = inits::SubpassDependency(VK_SUBPASS_EXTERNAL,
-		0,
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-		0,
-		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
 
 	// render pass
-	VkRenderPassCreateInfo renderPassInfo =
-		inits::RenderPassCreateInfo(static_cast<uint32_t>(attachments.size()),
-			attachments.data(),
-			1,
-			&subpass,
-			1,
-			&subpassDependency);
+	VkRenderPassCreateInfo renderPassInfo = inits::RenderPassCreateInfo(
+		static_cast<uint32_t>(attachments.size()), attachments.data(), 1, &subpass, 0, nullptr);
 	ErrCheck(vkCreateRenderPass(m_Device->GetDevice(), &renderPassInfo, nullptr, &m_RenderPass)
 				 != VK_SUCCESS,
 		"Failed to create render pass!");
-}
-
-void Engine::CreateColorResource()
-{
-	const VkFormat colorFormat = m_SwapchainImageFormat;
-	const uint32_t miplevels = 1;
 
-	utils::CreateImage(m_Device,
-		m_SwapchainExtent.width,
-		m_SwapchainExtent.height,
-		miplevels,
-		1,
-		m_Device->GetMsaaSamples(),
-		colorFormat,
-		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-		0,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		m_ColorImage,
-		m_ColorImageMemory);
-
-	m_ColorImageView = utils::CreateImageView(m_Device->GetDevice(),
-		m_ColorImage,
-		colorFormat,
-		VK_IMAGE_VIEW_TYPE_2D,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		miplevels,
-		1);
+	// compatible with `m_RenderPass`, so it shares the framebuffers and secondary command buffers
+	// the resolve overwrites the whole swapchain image
+	attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+	attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+	attachments[2].loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	ErrCheck(
+		vkCreateRenderPass(m_Device->GetDevice(), &renderPassInfo, nullptr, &m_LoadRenderPass)
+			!= VK_SUCCESS,
+		"Failed to create load render pass!");
 }
 
-void Engine::CreateDepthResource()
+void Engine::BuildRenderGraph()
 {
+	// the previous backend is retired with the swapchain
+	m_RenderGraph = std::make_unique<RenderGraph>();
+	m_RenderGraphBackend = std::make_unique<VulkanRenderGraphBackend>(m_Device);
+
 	const VkFormat depthFormat = utils::FindDepthFormat(m_Device->GetPhysicalDevice());
-	const uint32_t miplevels = 1;
+	m_ColorAttachment = m_RenderGraph->CreateImage(
+		"color", { m_SwapchainImageFormat, m_SwapchainExtent, m_Device->GetMsaaSamples() });
+	m_DepthAttachment = m_RenderGraph->CreateImage(
+		"depth", { depthFormat, m_SwapchainExtent, m_Device->GetMsaaSamples() });
+	// the acquire semaphore is waited on at the color attachment output stage
+	m_SwapchainAttachment = m_RenderGraph->ImportImage("swapchain",
+		{ m_SwapchainImageFormat, m_SwapchainExtent, VK_SAMPLE_COUNT_1_BIT },
+		{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0 },
+		{ VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0 });
+
+	// fills the light lists of the clusters and the indirect draw commands of the scene pass; the
+	// buffers are not tracked by the graph
+	m_RenderGraph->AddPass("light clusters", BIND_FN(Engine::RecordLightClusterPass))
+		.SetSideEffect();
+	m_RenderGraph->AddPass("cull", BIND_FN(Engine::RecordCullPass)).SetSideEffect();
+
+	// msaa color and depth, resolved into the swapchain image
+	m_RenderGraph->AddPass("scene", BIND_FN(Engine::RecordScenePass))
+		.Write(m_ColorAttachment, RenderGraphAccess::ColorAttachment)
+		.Write(m_DepthAttachment, RenderGraphAccess::DepthAttachment)
+		.Write(m_SwapchainAttachment, RenderGraphAccess::ColorAttachment);
+
+	// the scene pass only drew what was visible last frame; the hi-z pyramid of its depth decides
+	// which of the other instances are drawn on top
+	if (m_OcclusionGraph)
+	{
+		m_RenderGraph->AddPass("hi-z", BIND_FN(Engine::RecordHiZPass))
+			.Read(m_DepthAttachment, RenderGraphAccess::ComputeRead)
+			.SetSideEffect();
+		m_RenderGraph->AddPass("cull late", BIND_FN(Engine::RecordLateCullPass)).SetSideEffect();
+		m_RenderGraph->AddPass("scene late", BIND_FN(Engine::RecordLateScenePass))
+			.Read(m_ColorAttachment, RenderGraphAccess::ColorAttachment)
+			.Read(m_DepthAttachment, RenderGraphAccess::DepthAttachment)
+			.Write(m_ColorAttachment, RenderGraphAccess::ColorAttachment)
+			.Write(m_DepthAttachment, RenderGraphAccess::DepthAttachment)
+			.Write(m_SwapchainAttachment, RenderGraphAccess::ColorAttachment);
+	}
 
-	utils::CreateImage(m_Device,
-		m_SwapchainExtent.width,
-		m_SwapchainExtent.height,
-		miplevels,
-		1,
-		m_Device->GetMsaaSamples(),
-		depthFormat,
-		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-		0,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		m_DepthImage,
-		m_DepthImageMemory);
-
-	m_DepthImageView = utils::CreateImageView(m_Device->GetDevice(),
-		m_DepthImage,
-		depthFormat,
-		VK_IMAGE_VIEW_TYPE_2D,
-		VK_IMAGE_ASPECT_DEPTH_BIT,
-		miplevels,
-		1);
+	m_RenderGraph->Compile(*m_RenderGraphBackend);
+	m_RenderGraphBackend->Realize(*m_RenderGraph);
+
+	if (m_HiZ)
+	{
+		m_HiZ->Resize(m_SwapchainExtent,
+			m_OcclusionGraph ? m_RenderGraphBackend->GetImageView(m_DepthAttachment)
+							 : VK_NULL_HANDLE);
+		m_GpuCulling->SetHiZ(*m_HiZ);
+	}
 }
 
 void Engine::CreateFramebuffers()
@@ -697,8 +1896,8 @@ void Engine::CreateFramebuffers()
 	for (size_t i = 0; i < m_SwapchainImages.size(); ++i)
 	{
 		std::array<VkImageView, 3> fbAttachments{
-			m_ColorImageView,
-			m_DepthImageView,
+			m_RenderGraphBackend->GetImageView(m_ColorAttachment),
+			m_RenderGraphBackend->GetImageView(m_DepthAttachment),
 			m_SwapchainImageViews[i],
 		};
 		VkFramebufferCreateInfo framebufferInfo{};
@@ -723,9 +1922,23 @@ void Engine::CreateUniformBuffers()
 	m_SceneUniformBuffers.resize(Config::maxFramesInFlight);
 	m_SceneUniformBufferMemory.resize(Config::maxFramesInFlight);
 
-	const VkDeviceSize dBufferSize = MatrixUBO::GetSize();
+	// the dynamic matrix UBO holds one slot per draw; dynamic offsets have to be aligned to
+	// `minUniformBufferOffsetAlignment`
+	const VkDeviceSize minAlignment =
+		m_Device->GetDeviceProperties().limits.minUniformBufferOffsetAlignment;
+	m_MatUniformBufferStride = MatrixUBO::GetSize();
+	if (minAlignment > 0)
+		m_MatUniformBufferStride = (m_MatUniformBufferStride + minAlignment - 1) & ~(minAlignment - 1);
+	const VkDeviceSize dBufferSize = m_MatUniformBufferStride * Config::maxDrawsPerFrame;
 	m_MatUniformBuffers.resize(Config::maxFramesInFlight);
 	m_MatUniformBufferMemory.resize(Config::maxFramesInFlight);
+	m_MatUniformBufferMapped.resize(Config::maxFramesInFlight);
+
+	// one model matrix per draw slot of the instanced draws
+	const VkDeviceSize instanceBufferSize = sizeof(glm::mat4) * g_MaxBenchmarkDraws;
+	m_InstanceBuffers.resize(Config::maxFramesInFlight);
+	m_InstanceBufferMemory.resize(Config::maxFramesInFlight);
+	m_InstanceBufferMapped.resize(Config::maxFramesInFlight);
 
 	m_CubemapUniformBuffers.resize(Config::maxFramesInFlight);
 	m_CubemapUniformBufferMem.resize(Config::maxFramesInFlight);
@@ -745,9 +1958,30 @@ void Engine::CreateUniformBuffers()
 			VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
 			m_MatUniformBuffers[i],
 			m_MatUniformBufferMemory[i]);
+		// kept mapped, the per-draw slots are written while recording
+		vkMapMemory(m_Device->GetDevice(),
+			m_MatUniformBufferMemory[i],
+			0,
+			dBufferSize,
+			0,
+			&m_MatUniformBufferMapped[i]);
 
 		utils::CreateBuffer(m_Device,
-			dBufferSize,
+			instanceBufferSize,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+			m_InstanceBuffers[i],
+			m_InstanceBufferMemory[i]);
+		// kept mapped, the instances are written while recording
+		vkMapMemory(m_Device->GetDevice(),
+			m_InstanceBufferMemory[i],
+			0,
+			instanceBufferSize,
+			0,
+			&m_InstanceBufferMapped[i]);
+
+		utils::CreateBuffer(m_Device,
+			MatrixUBO::GetSize(),
 			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
 			VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
 			m_CubemapUniformBuffers[i],
@@ -769,6 +2003,14 @@ void Engine::CreateDescriptorSetLayout()
 		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
 		static_cast<uint32_t>(m_TextureImages.size()),
 		VK_SHADER_STAGE_FRAGMENT_BIT));
+	// clustered lighting; cluster uniforms, lights, light grid and light indices
+	layoutBindings.push_back(inits::DescriptorSetLayoutBinding(
+		3, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT));
+	for (uint32_t binding = 4; binding <= 6; ++binding)
+	{
+		layoutBindings.push_back(inits::DescriptorSetLayoutBinding(
+			binding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT));
+	}
 
 	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
 	descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
@@ -779,6 +2021,19 @@ void Engine::CreateDescriptorSetLayout()
 				 m_Device->GetDevice(), &descriptorSetLayoutInfo, nullptr, &m_DescriptorSetLayout)
 				 != VK_SUCCESS,
 		"Failed to create descriptor set layout!");
+
+	// set 1, the model matrices of the instanced draws
+	const VkDescriptorSetLayoutBinding instanceBinding = inits::DescriptorSetLayoutBinding(
+		0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT);
+	descriptorSetLayoutInfo.bindingCount = 1;
+	descriptorSetLayoutInfo.pBindings = &instanceBinding;
+
+	ErrCheck(vkCreateDescriptorSetLayout(m_Device->GetDevice(),
+				 &descriptorSetLayoutInfo,
+				 nullptr,
+				 &m_InstanceDescriptorSetLayout)
+				 != VK_SUCCESS,
+		"Failed to create instance descriptor set layout!");
 }
 
 void Engine::CreateDescriptorSets()
@@ -823,6 +2078,24 @@ void Engine::CreateDescriptorSets()
 			static_cast<uint32_t>(m_TextureImages.size()),
 			nullptr,
 			textureImageInfos.data()));
+		const std::array<VkDescriptorBufferInfo, 4> clusterBufferInfos{
+			inits::DescriptorBufferInfo(
+				m_ClusteredLighting->GetUniformBuffer(i), 0, VK_WHOLE_SIZE),
+			inits::DescriptorBufferInfo(m_ClusteredLighting->GetLightBuffer(), 0, VK_WHOLE_SIZE),
+			inits::DescriptorBufferInfo(
+				m_ClusteredLighting->GetLightGridBuffer(i), 0, VK_WHOLE_SIZE),
+			inits::DescriptorBufferInfo(
+				m_ClusteredLighting->GetLightIndexBuffer(i), 0, VK_WHOLE_SIZE),
+		};
+		for (uint32_t j = 0; j < clusterBufferInfos.size(); ++j)
+		{
+			descWrites.push_back(inits::WriteDescriptorSet(m_DescriptorSets[i],
+				3 + j,
+				j == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				1,
+				&clusterBufferInfos[j],
+				nullptr));
+		}
 
 		vkUpdateDescriptorSets(m_Device->GetDevice(),
 			static_cast<uint32_t>(descWrites.size()),
@@ -830,16 +2103,76 @@ void Engine::CreateDescriptorSets()
 			0,
 			nullptr);
 	}
+
+	// the instance buffers of the frames, followed by the one of the gpu culling
+	std::vector<VkDescriptorSetLayout> instanceSetLayouts{ Config::maxFramesInFlight + 1,
+		m_InstanceDescriptorSetLayout };
+	descriptorSetAllocInfo.descriptorSetCount = static_cast<uint32_t>(instanceSetLayouts.size());
+	descriptorSetAllocInfo.pSetLayouts = instanceSetLayouts.data();
+
+	std::vector<VkDescriptorSet> instanceSets(instanceSetLayouts.size());
+	ErrCheck(vkAllocateDescriptorSets(
+				 m_Device->GetDevice(), &descriptorSetAllocInfo, instanceSets.data())
+				 != VK_SUCCESS,
+		"Failed to allocate instance descriptor sets!");
+	m_InstanceDescriptorSets.assign(instanceSets.begin(), instanceSets.end() - 1);
+	m_GpuCullingInstanceDescriptorSet = instanceSets.back();
+
+	std::vector<VkDescriptorBufferInfo> instanceBufferInfos;
+	for (const VkBuffer instanceBuffer : m_InstanceBuffers)
+	{
+		instanceBufferInfos.push_back(
+			inits::DescriptorBufferInfo(instanceBuffer, 0, VK_WHOLE_SIZE));
+	}
+	// the gpu culling set stays empty when it is not supported; it is never bound then
+	if (m_GpuCulling)
+	{
+		instanceBufferInfos.push_back(inits::DescriptorBufferInfo(
+			m_GpuCulling->GetInstanceBuffer(), 0, m_GpuCulling->GetInstanceBufferSize()));
+	}
+
+	std::vector<VkWriteDescriptorSet> instanceWrites;
+	for (size_t i = 0; i < instanceBufferInfos.size(); ++i)
+	{
+		instanceWrites.push_back(inits::WriteDescriptorSet(instanceSets[i],
+			0,
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			1,
+			&instanceBufferInfos[i],
+			nullptr));
+	}
+	vkUpdateDescriptorSets(m_Device->GetDevice(),
+		static_cast<uint32_t>(instanceWrites.size()),
+		instanceWrites.data(),
+		0,
+		nullptr);
 }
 
 void Engine::CreatePipelineLayout()
 {
+	// set 0 is shared by all pipelines, set 1 is only read by the instanced ones
+	const std::array<VkDescriptorSetLayout, 2> setLayouts{ m_DescriptorSetLayout,
+		m_InstanceDescriptorSetLayout };
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = &m_DescriptorSetLayout;
-	pipelineLayoutInfo.pushConstantRangeCount = 0;
-	pipelineLayoutInfo.pPushConstantRanges = nullptr;
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+	pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+
+	// per-draw data
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = PerDrawData::GetSize();
+	if (m_PushConstantsSupported)
+	{
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+	}
+	else
+	{
+		pipelineLayoutInfo.pushConstantRangeCount = 0;
+		pipelineLayoutInfo.pPushConstantRanges = nullptr;
+	}
 
 	ErrCheck(vkCreatePipelineLayout(
 				 m_Device->GetDevice(), &pipelineLayoutInfo, nullptr, &m_PipelineLayout)
@@ -847,74 +2180,36 @@ void Engine::CreatePipelineLayout()
 		"Failed to create pipeline layout!");
 }
 
-void Engine::CreatePipeline(const char* vertShaderPath, const char* fragShaderPath)
-{
-	// shader stages
-	const Shader vertexShader{ m_Device->GetDevice(), vertShaderPath, ShaderType::VERTEX };
-	const Shader fragmentShader{ m_Device->GetDevice(), fragShaderPath, ShaderType::FRAGMENT };
-	std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages{ vertexShader.GetShaderStage(),
-		fragmentShader.GetShaderStage() };
-
-	// vertex descriptions
-	auto vertexBindingDesc = Vertex::GetBindingDescription();
-	auto vertexAttrDesc = Vertex::GetAttributeDescription();
-
-	// fixed functions
-	const VkPipelineVertexInputStateCreateInfo vertexInputInfo =
-		inits::PipelineVertexInputStateCreateInfo(1,
-			&vertexBindingDesc,
-			static_cast<uint32_t>(vertexAttrDesc.size()),
-			vertexAttrDesc.data());
-	const VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo =
-		inits::PipelineInputAssemblyStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
-	const VkPipelineViewportStateCreateInfo viewportStateInfo =
-		inits::PipelineViewportStateCreateInfo(1, 1);
-	const VkPipelineRasterizationStateCreateInfo rasterizationStateInfo =
-		inits::PipelineRasterizationStateCreateInfo(
-			VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE);
-	const VkPipelineMultisampleStateCreateInfo multisampleStateInfo =
-		inits::PipelineMultisampleStateCreateInfo(VK_TRUE, m_Device->GetMsaaSamples(), 0.2f);
-	const VkPipelineDepthStencilStateCreateInfo depthStencilStateInfo =
-		inits::PipelineDepthStencilStateCreateInfo(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS);
-
-	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT
-										  | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	colorBlendAttachment.blendEnable = VK_FALSE;
-	const VkPipelineColorBlendStateCreateInfo colorBlendStateInfo =
-		inits::PipelineColorBlendStateCreateInfo(colorBlendAttachment);
-
-	// dynamic states
-	std::array<VkDynamicState, 2> dynamicStates{ VK_DYNAMIC_STATE_VIEWPORT,
-		VK_DYNAMIC_STATE_SCISSOR };
-	VkPipelineDynamicStateCreateInfo dynamicStateInfo = inits::PipelineDynamicStateCreateInfo(
-		static_cast<uint32_t>(dynamicStates.size()), dynamicStates.data());
-
-	// graphics pipeline
-	VkGraphicsPipelineCreateInfo graphicsPipelineInfo{};
-	graphicsPipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	// config all previos objects
-	graphicsPipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
-	graphicsPipelineInfo.pStages = shaderStages.data();
-	graphicsPipelineInfo.pVertexInputState = &vertexInputInfo;
-	graphicsPipelineInfo.pInputAssemblyState = &inputAssemblyInfo;
-	graphicsPipelineInfo.pViewportState = &viewportStateInfo;
-	graphicsPipelineInfo.pRasterizationState = &rasterizationStateInfo;
-	graphicsPipelineInfo.pMultisampleState = &multisampleStateInfo;
-	graphicsPipelineInfo.pDepthStencilState = &depthStencilStateInfo;
-	graphicsPipelineInfo.pColorBlendState = &colorBlendStateInfo;
-	graphicsPipelineInfo.pDynamicState = &dynamicStateInfo;
-	graphicsPipelineInfo.layout = m_PipelineLayout;
-	graphicsPipelineInfo.renderPass = m_RenderPass;
-	graphicsPipelineInfo.subpass = 0; // index of subpass
-	graphicsPipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-	graphicsPipelineInfo.basePipelineIndex = -1;
+GraphicsPipelineDesc Engine::GetScenePipelineDesc(uint32_t features,
+	PipelineDepthMode depthMode) const
+{
+	GraphicsPipelineDesc desc{};
+	desc.samples = m_Device->GetMsaaSamples();
+	desc.layout = m_PipelineLayout;
+	desc.renderPass = m_RenderPass;
 
-	ErrCheck(
-		vkCreateGraphicsPipelines(
-			m_Device->GetDevice(), VK_NULL_HANDLE, 1, &graphicsPipelineInfo, nullptr, &m_Pipeline)
-			!= VK_SUCCESS,
-		"Failed to create graphics pipeline!");
+	// the depth pre-pass reads the position stream and writes no color
+	if (depthMode == PipelineDepthMode::PREPASS)
+	{
+		desc.vertShader = { "depthOnly", ShaderType::VERTEX, features & ShaderFeature::COMPILED };
+		desc.vertexLayout = GraphicsPipelineDesc::VertexLayout::POSITION;
+		return desc;
+	}
+
+	// the fragment shaders have no compile time permutations
+	desc.vertShader = { m_SceneShader, ShaderType::VERTEX, features };
+	desc.fragShader = { m_SceneShader,
+		ShaderType::FRAGMENT,
+		features & ShaderFeature::SPECIALIZED };
+	desc.sampleShading = true;
+	desc.minSampleShading = 0.2f;
+	// after the pre-pass only the nearest fragment of every sample passes
+	if (depthMode == PipelineDepthMode::EQUAL)
+	{
+		desc.depthWrite = false;
+		desc.depthCompareOp = VK_COMPARE_OP_EQUAL;
+	}
+	return desc;
 }
 
 void Engine::CreateCommandBuffers()
@@ -931,52 +2226,97 @@ void Engine::CreateCommandBuffers()
 		vkAllocateCommandBuffers(m_Device->GetDevice(), &cmdBuffAllocInfo, m_CommandBuffers.data())
 			!= VK_SUCCESS,
 		"Failed to allocate command buffers!");
+
+	// skybox and ui; recorded on the main thread
+	m_OverlayCommandBuffers.resize(Config::maxFramesInFlight);
+	cmdBuffAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+	ErrCheck(vkAllocateCommandBuffers(
+				 m_Device->GetDevice(), &cmdBuffAllocInfo, m_OverlayCommandBuffers.data())
+				 != VK_SUCCESS,
+		"Failed to allocate command buffers!");
+	m_LateCommandBuffers.resize(Config::maxFramesInFlight);
+	ErrCheck(vkAllocateCommandBuffers(
+				 m_Device->GetDevice(), &cmdBuffAllocInfo, m_LateCommandBuffers.data())
+				 != VK_SUCCESS,
+		"Failed to allocate command buffers!");
+
+	// model draw slices; command pools must be externally synchronized, so every slice gets its
+	// own pool (per frame) and can be recorded on any thread
+	const uint32_t maxSliceCount = m_JobSystem->GetWorkerCount() + 1;
+	const VkCommandPoolCreateInfo commandPoolInfo =
+		inits::CommandPoolCreateInfo(m_Device->GetQueueFamilyIndices());
+	m_SliceCommandPools.resize(Config::maxFramesInFlight);
+	m_SliceCommandBuffers.resize(Config::maxFramesInFlight);
+	m_PrepassSliceCommandBuffers.resize(Config::maxFramesInFlight);
+	for (uint32_t i = 0; i < Config::maxFramesInFlight; ++i)
+	{
+		m_SliceCommandPools[i].resize(maxSliceCount);
+		m_SliceCommandBuffers[i].resize(maxSliceCount);
+		m_PrepassSliceCommandBuffers[i].resize(maxSliceCount);
+		for (uint32_t slice = 0; slice < maxSliceCount; ++slice)
+		{
+			ErrCheck(vkCreateCommandPool(m_Device->GetDevice(),
+						 &commandPoolInfo,
+						 nullptr,
+						 &m_SliceCommandPools[i][slice])
+						 != VK_SUCCESS,
+				"Failed to create command pool!");
+
+			cmdBuffAllocInfo.commandPool = m_SliceCommandPools[i][slice];
+			cmdBuffAllocInfo.commandBufferCount = 1;
+			ErrCheck(vkAllocateCommandBuffers(m_Device->GetDevice(),
+						 &cmdBuffAllocInfo,
+						 &m_SliceCommandBuffers[i][slice])
+						 != VK_SUCCESS,
+				"Failed to allocate command buffers!");
+			ErrCheck(vkAllocateCommandBuffers(m_Device->GetDevice(),
+						 &cmdBuffAllocInfo,
+						 &m_PrepassSliceCommandBuffers[i][slice])
+						 != VK_SUCCESS,
+				"Failed to allocate command buffers!");
+		}
+	}
 }
 
 void Engine::CreateVertexBuffer(const std::vector<Vertex>& vertices,
 	VkBuffer& vertexBuffer,
 	VkDeviceMemory& vertexBufferMemory)
 {
-	VkDeviceSize size = sizeof(vertices[0]) * vertices.size();
-
-	VkBuffer stagingBuffer = nullptr;
-	VkDeviceMemory stagingBufferMemory = nullptr;
-	utils::CreateBuffer(Engine::GetInstance()->m_Device,
-		size,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		stagingBuffer,
-		stagingBufferMemory);
-
-	void* data = nullptr;
-	vkMapMemory(
-		Engine::GetInstance()->m_Device->GetDevice(), stagingBufferMemory, 0, size, 0, &data);
-	memcpy(data, vertices.data(), size);
-	vkUnmapMemory(Engine::GetInstance()->m_Device->GetDevice(), stagingBufferMemory);
-
-	utils::CreateBuffer(Engine::GetInstance()->m_Device,
-		size,
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+	CreateDeviceLocalBuffer(vertices.data(),
+		sizeof(vertices[0]) * vertices.size(),
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
 		vertexBuffer,
 		vertexBufferMemory);
+}
 
-	utils::CopyBuffer(Engine::GetInstance()->m_Device,
-		Engine::GetInstance()->m_CommandPool,
-		stagingBuffer,
+void Engine::CreateVertexBuffer(const std::vector<glm::vec3>& positions,
+	VkBuffer& vertexBuffer,
+	VkDeviceMemory& vertexBufferMemory)
+{
+	CreateDeviceLocalBuffer(positions.data(),
+		sizeof(positions[0]) * positions.size(),
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
 		vertexBuffer,
-		size);
-
-	vkFreeMemory(Engine::GetInstance()->m_Device->GetDevice(), stagingBufferMemory, nullptr);
-	vkDestroyBuffer(Engine::GetInstance()->m_Device->GetDevice(), stagingBuffer, nullptr);
+		vertexBufferMemory);
 }
 
 void Engine::CreateIndexBuffer(const std::vector<uint32_t>& indices,
 	VkBuffer& indexBuffer,
 	VkDeviceMemory& indexBufferMemory)
 {
-	VkDeviceSize size = sizeof(indices[0]) * indices.size();
+	CreateDeviceLocalBuffer(indices.data(),
+		sizeof(indices[0]) * indices.size(),
+		VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+		indexBuffer,
+		indexBufferMemory);
+}
 
+void Engine::CreateDeviceLocalBuffer(const void* srcData,
+	VkDeviceSize size,
+	VkBufferUsageFlags usage,
+	VkBuffer& buffer,
+	VkDeviceMemory& bufferMemory)
+{
 	VkBuffer stagingBuffer = nullptr;
 	VkDeviceMemory stagingBufferMemory = nullptr;
 	utils::CreateBuffer(Engine::GetInstance()->m_Device,
@@ -989,41 +2329,46 @@ void Engine::CreateIndexBuffer(const std::vector<uint32_t>& indices,
 	void* data = nullptr;
 	vkMapMemory(
 		Engine::GetInstance()->m_Device->GetDevice(), stagingBufferMemory, 0, size, 0, &data);
-	memcpy(data, indices.data(), size);
+	memcpy(data, srcData, size);
 	vkUnmapMemory(Engine::GetInstance()->m_Device->GetDevice(), stagingBufferMemory);
 
 	utils::CreateBuffer(Engine::GetInstance()->m_Device,
 		size,
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		indexBuffer,
-		indexBufferMemory);
+		buffer,
+		bufferMemory);
 
 	utils::CopyBuffer(Engine::GetInstance()->m_Device,
 		Engine::GetInstance()->m_CommandPool,
 		stagingBuffer,
-		indexBuffer,
+		buffer,
 		size);
 
 	vkFreeMemory(Engine::GetInstance()->m_Device->GetDevice(), stagingBufferMemory, nullptr);
 	vkDestroyBuffer(Engine::GetInstance()->m_Device->GetDevice(), stagingBuffer, nullptr);
 }
 
-void Engine::CreateTextureImage(const char* texturePath,
+void Engine::DestroyDeferred(DeletionQueue::DeleteFn fn)
+{
+	s_Instance->m_DeletionQueue.Push(std::move(fn));
+}
+
+void Engine::RetirePipeline(VkPipeline pipeline)
+{
+	DestroyDeferred([pipeline]() {
+		vkDestroyPipeline(s_Instance->m_Device->GetDevice(), pipeline, nullptr);
+	});
+}
+
+void Engine::CreateTextureImage(const unsigned char* imageData,
+	int width,
+	int height,
 	VkImage& textureImage,
 	VkDeviceMemory& textureImageMem,
 	VkFormat format,
 	uint32_t& miplevels)
 {
-	int width = 0;
-	int height = 0;
-	int channels = 0;
-	auto* imageData = stbi_load(texturePath, &width, &height, &channels, STBI_rgb_alpha);
-	ErrCheck(!imageData,
-		"Unable to load texture: \"{}\"; ERROR: {}",
-		texturePath,
-		stbi_failure_reason());
-
 	VkDeviceSize size = static_cast<uint64_t>(width) * static_cast<uint64_t>(height) * 4;
 	miplevels = static_cast<uint32_t>(std::log2(std::max(width, height))) + 1;
 
@@ -1041,8 +2386,6 @@ void Engine::CreateTextureImage(const char* texturePath,
 	memcpy(data, imageData, size);
 	vkUnmapMemory(m_Device->GetDevice(), stagingBufferMem);
 
-	stbi_image_free(imageData);
-
 	utils::CreateImage(m_Device,
 		width,
 		height,
@@ -1277,80 +2620,20 @@ void Engine::CreateCubemapPipelineLayout()
 		"Failed to create pipeline layout!");
 }
 
-void Engine::CreateCubemapPipeline(const char* vertShaderPath, const char* fragShaderPath)
-{
-	// shader stages
-	const Shader vertexShader{ m_Device->GetDevice(), vertShaderPath, ShaderType::VERTEX };
-	const Shader fragmentShader{ m_Device->GetDevice(), fragShaderPath, ShaderType::FRAGMENT };
-	std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages{ vertexShader.GetShaderStage(),
-		fragmentShader.GetShaderStage() };
-
-	// vertex descriptions
-	auto vertexBindingDesc = Vertex::GetBindingDescription();
-	auto vertexAttrDesc = Vertex::GetAttributeDescription();
-
-	// fixed functions
-	const VkPipelineVertexInputStateCreateInfo vertexInputInfo =
-		inits::PipelineVertexInputStateCreateInfo(1,
-			&vertexBindingDesc,
-			static_cast<uint32_t>(vertexAttrDesc.size()),
-			vertexAttrDesc.data());
-	const VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo =
-		inits::PipelineInputAssemblyStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
-	const VkPipelineViewportStateCreateInfo viewportStateInfo =
-		inits::PipelineViewportStateCreateInfo(1, 1);
-	const VkPipelineRasterizationStateCreateInfo rasterizationStateInfo =
-		inits::PipelineRasterizationStateCreateInfo(
-			VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE);
-	const VkPipelineMultisampleStateCreateInfo multisampleStateInfo =
-		inits::PipelineMultisampleStateCreateInfo(VK_TRUE, m_Device->GetMsaaSamples(), 0.2f);
-	const VkPipelineDepthStencilStateCreateInfo depthStencilStateInfo =
-		inits::PipelineDepthStencilStateCreateInfo(VK_TRUE,
-			VK_TRUE,
-			VK_COMPARE_OP_LESS_OR_EQUAL); // less or equal because the depth buffer for skybox will
-										  // be filled with 1.0
-
-	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT
-										  | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	colorBlendAttachment.blendEnable = VK_FALSE;
-	const VkPipelineColorBlendStateCreateInfo colorBlendStateInfo =
-		inits::PipelineColorBlendStateCreateInfo(colorBlendAttachment);
-
-	// dynamic states
-	std::array<VkDynamicState, 2> dynamicStates{ VK_DYNAMIC_STATE_VIEWPORT,
-		VK_DYNAMIC_STATE_SCISSOR };
-	VkPipelineDynamicStateCreateInfo dynamicStateInfo = inits::PipelineDynamicStateCreateInfo(
-		static_cast<uint32_t>(dynamicStates.size()), dynamicStates.data());
-
-	// graphics pipeline
-	VkGraphicsPipelineCreateInfo graphicsPipelineInfo{};
-	graphicsPipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	// config all previos objects
-	graphicsPipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
-	graphicsPipelineInfo.pStages = shaderStages.data();
-	graphicsPipelineInfo.pVertexInputState = &vertexInputInfo;
-	graphicsPipelineInfo.pInputAssemblyState = &inputAssemblyInfo;
-	graphicsPipelineInfo.pViewportState = &viewportStateInfo;
-	graphicsPipelineInfo.pRasterizationState = &rasterizationStateInfo;
-	graphicsPipelineInfo.pMultisampleState = &multisampleStateInfo;
-	graphicsPipelineInfo.pDepthStencilState = &depthStencilStateInfo;
-	graphicsPipelineInfo.pColorBlendState = &colorBlendStateInfo;
-	graphicsPipelineInfo.pDynamicState = &dynamicStateInfo;
-	graphicsPipelineInfo.layout = m_CubemapPipelineLayout;
-	graphicsPipelineInfo.renderPass = m_RenderPass;
-	graphicsPipelineInfo.subpass = 0; // index of subpass
-	graphicsPipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-	graphicsPipelineInfo.basePipelineIndex = -1;
-
-	ErrCheck(vkCreateGraphicsPipelines(m_Device->GetDevice(),
-				 VK_NULL_HANDLE,
-				 1,
-				 &graphicsPipelineInfo,
-				 nullptr,
-				 &m_CubemapPipeline)
-				 != VK_SUCCESS,
-		"Failed to create graphics pipeline!");
+void Engine::CreateCubemapPipeline(const char* shaderName)
+{
+	GraphicsPipelineDesc desc{};
+	desc.vertShader = { shaderName, ShaderType::VERTEX };
+	desc.fragShader = { shaderName, ShaderType::FRAGMENT };
+	// less or equal because the depth buffer for skybox will be filled with 1.0
+	desc.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+	desc.samples = m_Device->GetMsaaSamples();
+	desc.sampleShading = true;
+	desc.minSampleShading = 0.2f;
+	desc.layout = m_CubemapPipelineLayout;
+	desc.renderPass = m_RenderPass;
+
+	m_CubemapPipeline = m_PipelineStates->Create(desc, m_PipelineCache->Get());
 }
 
 void Engine::CreateCubemapVertexBuffer()
@@ -1387,19 +2670,14 @@ void Engine::CreateCubemapVertexBuffer()
 
 void Engine::CreateSyncObjects()
 {
-	m_ImageAvailableSemaphores.resize(Config::maxFramesInFlight);
-	m_RenderFinishedSemaphores.resize(Config::maxFramesInFlight);
-	m_InFlightFences.resize(Config::maxFramesInFlight);
+	// the swapchain only works with binary semaphores
+	m_ImageAvailableSemaphores.resize(m_Settings.framesInFlight);
+	m_RenderFinishedSemaphores.resize(m_Settings.framesInFlight);
 
 	VkSemaphoreCreateInfo semaphoreInfo{};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	// create the fence in signaled state so that the first frame doesnt have to wait
-	VkFenceCreateInfo fenceInfo{};
-	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-	for (uint32_t i = 0; i < Config::maxFramesInFlight; ++i)
+	for (uint32_t i = 0; i < m_Settings.framesInFlight; ++i)
 	{
 		ErrCheck(
 			vkCreateSemaphore(
@@ -1409,13 +2687,59 @@ void Engine::CreateSyncObjects()
 					   &semaphoreInfo,
 					   nullptr,
 					   &m_RenderFinishedSemaphores[i])
-					   != VK_SUCCESS
-				|| vkCreateFence(m_Device->GetDevice(), &fenceInfo, nullptr, &m_InFlightFences[i])
 					   != VK_SUCCESS,
 			"Failed to create synchronization objects!");
 	}
 }
 
+void Engine::CleanupSyncObjects()
+{
+	for (size_t i = 0; i < m_ImageAvailableSemaphores.size(); ++i)
+	{
+		vkDestroySemaphore(m_Device->GetDevice(), m_ImageAvailableSemaphores[i], nullptr);
+		vkDestroySemaphore(m_Device->GetDevice(), m_RenderFinishedSemaphores[i], nullptr);
+	}
+
+	m_ImageAvailableSemaphores.clear();
+	m_RenderFinishedSemaphores.clear();
+}
+
+void Engine::CreateFrameTimeline()
+{
+	// frame N signals N, so the value is the last frame the gpu finished
+	VkSemaphoreTypeCreateInfo semaphoreTypeInfo{};
+	semaphoreTypeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	semaphoreTypeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	semaphoreTypeInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &semaphoreTypeInfo;
+
+	ErrCheck(vkCreateSemaphore(m_Device->GetDevice(), &semaphoreInfo, nullptr, &m_FrameTimeline)
+				 != VK_SUCCESS,
+		"Failed to create frame timeline semaphore!");
+}
+
+void Engine::WaitForFrame(uint64_t frame) const
+{
+	VkSemaphoreWaitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &m_FrameTimeline;
+	waitInfo.pValues = &frame;
+	ErrCheck(vkWaitSemaphores(m_Device->GetDevice(), &waitInfo, UINT64_MAX) != VK_SUCCESS,
+		"Failed to wait for frame {}!",
+		frame);
+}
+
+uint64_t Engine::GetCompletedFrame() const
+{
+	uint64_t completedFrame = 0;
+	vkGetSemaphoreCounterValue(m_Device->GetDevice(), m_FrameTimeline, &completedFrame);
+	return completedFrame;
+}
+
 // event callbacks
 void Engine::ProcessInput()
 {
@@ -1443,8 +2767,17 @@ void Engine::OnCloseEvent()
 
 void Engine::OnResizeEvent(int width, int height)
 {
-	RecreateSwapchain();
-	m_Camera->SetAspectRatio(m_AspectRatio);
+	// the render thread recreates the swapchain once it sees the new extent in a frame packet
+	m_LastResizeTime = std::chrono::high_resolution_clock::now();
+
+	int framebufferWidth = 0;
+	int framebufferHeight = 0;
+	m_Window->GetFramebufferSize(&framebufferWidth, &framebufferHeight);
+	if (framebufferWidth == 0 || framebufferHeight == 0)
+		return;
+
+	m_Camera->SetAspectRatio(
+		static_cast<float>(framebufferWidth) / static_cast<float>(framebufferHeight));
 }
 
 void Engine::OnMouseMoveEvent(double xpos, double ypos)
@@ -3,13 +3,34 @@
 #include <cstdint>
 #include <memory>
 #include <chrono>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <exception>
+#include <string>
+#include <unordered_map>
 #include <vulkan/vulkan.h>
 #include "core/window.h"
+#include "core/jobSystem.h"
 #include "engine/types.h"
 #include "engine/vulkanContext.h"
 #include "engine/device.h"
 #include "engine/camera.h"
 #include "engine/model.h"
+#include "engine/settings.h"
+#include "engine/framePacket.h"
+#include "engine/deletionQueue.h"
+#include "engine/renderGraph.h"
+#include "engine/vulkanRenderGraph.h"
+#include "engine/gpuCulling.h"
+#include "engine/hiZPyramid.h"
+#include "engine/cpuCulling.h"
+#include "engine/softwareOcclusion.h"
+#include "engine/drawList.h"
+#include "engine/gpuTimestamps.h"
+#include "engine/clusteredLighting.h"
+#include "engine/pipelineCache.h"
+#include "engine/pipelineStateCache.h"
 
 class Engine
 {
@@ -22,7 +43,8 @@ public:
 
 	[[nodiscard]] static Engine* Create(const char* title,
 		const uint64_t width = 1280,
-		const uint64_t height = 720);
+		const uint64_t height = 720,
+		const RenderSettings& settings = RenderSettings{});
 	[[nodiscard]] static inline Engine* GetInstance() { return s_Instance; }
 	[[nodiscard]] static inline GLFWwindow* GetWindowHandle()
 	{
@@ -34,47 +56,126 @@ public:
 	static void CreateVertexBuffer(const std::vector<Vertex>& vertices,
 		VkBuffer& vertexBuffer,
 		VkDeviceMemory& vertexBufferMemory);
+	// position-only stream of the depth pre-pass
+	static void CreateVertexBuffer(const std::vector<glm::vec3>& positions,
+		VkBuffer& vertexBuffer,
+		VkDeviceMemory& vertexBufferMemory);
 	static void CreateIndexBuffer(const std::vector<uint32_t>& indices,
 		VkBuffer& indexBuffer,
 		VkDeviceMemory& indexBufferMemory);
+	// `fn` destroys resources once the gpu is done with every frame that might use them
+	// can be called from any thread
+	static void DestroyDeferred(DeletionQueue::DeleteFn fn);
 
 private:
-	explicit Engine(const char* title, const uint64_t width = 1280, const uint64_t height = 720);
-
-	void Init(const char* title, const uint64_t width, const uint64_t height);
+	// depth state of the scene pipelines
+	enum class PipelineDepthMode
+	{
+		LESS = 0,
+		PREPASS, // depth only, from the position stream
+		EQUAL, // shades the fragments the depth pre-pass left visible, without depth writes
+	};
+	// the scene pipelines of a permutation, for the depth pre-pass and the shading after it too
+	struct ScenePipelineIds
+	{
+		PipelineStateCache::PipelineId pipeline = PipelineStateCache::INVALID_ID;
+		PipelineStateCache::PipelineId prepass = PipelineStateCache::INVALID_ID;
+		PipelineStateCache::PipelineId depthEqual = PipelineStateCache::INVALID_ID;
+	};
+
+	explicit Engine(const char* title,
+		const uint64_t width,
+		const uint64_t height,
+		const RenderSettings& settings);
+
+	void Init(const char* title,
+		const uint64_t width,
+		const uint64_t height,
+		const RenderSettings& settings);
 	void Cleanup();
-	void Draw(float deltatime);
-	void BeginScene();
-	void EndScene();
+	// main thread
+	void Update();
 	void OnUiRender();
-	float CalcFps();
+	// render thread
+	void RenderLoop();
+	void Draw();
+	void RecordLightClusterPass(VkCommandBuffer cmdBuff);
+	void RecordCullPass(VkCommandBuffer cmdBuff);
+	void RecordScenePass(VkCommandBuffer cmdBuff);
+	// occlusion culling
+	void RecordHiZPass(VkCommandBuffer cmdBuff);
+	void RecordLateCullPass(VkCommandBuffer cmdBuff);
+	void RecordLateScenePass(VkCommandBuffer cmdBuff);
+	bool BeginScene(); // returns false if the frame has to be skipped
+	void EndScene();
+	void CalcFps();
+	void ApplySettings(const RenderSettings& settings);
 
 
 	void CreateCommandPool();
 	void CreateDescriptorPool();
 
-	void CreateSwapchain();
+	void CreateSwapchain(VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE);
 	void CreateSwapchainImageViews();
 	void RecreateSwapchain();
+	// returns the retired swapchain, which is still valid as `oldSwapchain`
+	VkSwapchainKHR RetireSwapchain();
 	void CleanupSwapchain();
 
 	void CreateRenderPass();
-	void CreateColorResource();
-	void CreateDepthResource();
+	void BuildRenderGraph();
 	void CreateFramebuffers();
 
 	void CreateUniformBuffers();
+	// uploads `srcData` through a staging buffer
+	static void CreateDeviceLocalBuffer(const void* srcData,
+		VkDeviceSize size,
+		VkBufferUsageFlags usage,
+		VkBuffer& buffer,
+		VkDeviceMemory& bufferMemory);
 	void UpdateUniformBuffers();
+	void BindPerDrawData(VkCommandBuffer cmdBuff, uint32_t drawIndex, const PerDrawData& drawData);
+	static glm::mat4 GetBenchmarkModelMatrix(uint32_t drawIndex);
+	static PerDrawData GetBenchmarkDrawData(uint32_t drawIndex);
+	// the compiled scene pipelines of the packet's per-draw data path and features; falls back to
+	// the pipelines compiled at startup or no depth pre-pass while they are compiling
+	void ResolveScenePipelines(FramePacket& packet);
+	// `ShaderFeature` bits; the pipelines of a new permutation are compiled on the job system
+	ScenePipelineIds RequestScenePipelines(uint32_t features);
+	// recompiles the pipelines of the shaders that changed on disk
+	void ReloadChangedShaders();
+	// `PipelineStateCache::RetireFn`
+	static void RetirePipeline(VkPipeline pipeline);
+	// sort keys of the drawn benchmark draws into `packet.drawList`
+	void BuildDrawList(FramePacket& packet);
+	static std::vector<ClusteredLighting::PointLight> GetBenchmarkLights();
 
 	void CreateDescriptorSetLayout();
 	void CreateDescriptorSets();
 	void CreatePipelineLayout();
 
-	void CreatePipeline(const char* vertShaderPath, const char* fragShaderPath);
+	// the depth pre-pass only uses the per-draw data bits of `features`
+	[[nodiscard]] GraphicsPipelineDesc GetScenePipelineDesc(uint32_t features,
+		PipelineDepthMode depthMode = PipelineDepthMode::LESS) const;
 	void CreateCommandBuffers();
+	void BeginRenderPass(VkCommandBuffer cmdBuff, VkRenderPass renderPass);
+	void BeginSecondaryCommandBuffer(VkCommandBuffer cmdBuff);
+	// the pipeline, descriptor set and vertex/index buffer binds of the recorded draws
+	struct DrawBindCounts
+	{
+		uint32_t issued = 0;
+		uint32_t saved = 0; // skipped because the state was already bound
+	};
+	// records the draws [firstDraw, lastDraw), or the items of the draw list with sorting
+	DrawBindCounts RecordModelDraws(uint32_t slice, uint32_t firstDraw, uint32_t lastDraw);
+	// `cmdBuff` has to be reset
+	void RecordGpuDrivenDraws(VkCommandBuffer cmdBuff, GpuCulling::Phase phase);
+	void RecordOverlay();
 
 	void CreateTextureSampler();
-	void CreateTextureImage(const char* texturePath,
+	void CreateTextureImage(const unsigned char* imageData,
+		int width,
+		int height,
 		VkImage& textureImage,
 		VkDeviceMemory& textureImageMem,
 		VkFormat format,
@@ -90,10 +191,16 @@ private:
 	void CreateCubemapDescriptorSetLayout();
 	void CreateCubemapDescriptorSets();
 	void CreateCubemapPipelineLayout();
-	void CreateCubemapPipeline(const char* vertShaderPath, const char* fragShaderPath);
+	// `shaderName` is the source file of the vertex and fragment shader
+	void CreateCubemapPipeline(const char* shaderName);
 	void CreateCubemapVertexBuffer();
 
 	void CreateSyncObjects();
+	void CleanupSyncObjects();
+	void CreateFrameTimeline();
+	// blocks until the gpu finished `frame`
+	void WaitForFrame(uint64_t frame) const;
+	[[nodiscard]] uint64_t GetCompletedFrame() const;
 
 	// event callbacks
 	void ProcessInput();
@@ -103,12 +210,23 @@ private:
 	void OnKeyEvent(int key, int scancode, int action, int mods);
 
 
-	bool m_IsRunning = true;
+	std::atomic<bool> m_IsRunning{ true };
 	static Engine* s_Instance;
 
+	RenderSettings m_Settings; // currently applied
+	RenderSettings m_PendingSettings; // applied at the start of the next frame
+
+	// the main thread publishes frame packets, the render thread draws them
+	FramePacketBuffer m_FramePackets;
+	FramePacket m_RenderPacket; // owned by the render thread
+	std::thread m_RenderThread;
+	std::exception_ptr m_RenderThreadException;
+
 	std::unique_ptr<Window> m_Window;
 	std::unique_ptr<VulkanContext> m_VulkanContext;
 	std::unique_ptr<Device> m_Device;
+	std::unique_ptr<JobSystem> m_JobSystem;
+	DeletionQueue m_DeletionQueue;
 
 	VkCommandPool m_CommandPool{};
 	VkDescriptorPool m_DescriptorPool{};
@@ -118,25 +236,40 @@ private:
 	VkFormat m_SwapchainImageFormat{};
 	VkExtent2D m_SwapchainExtent{};
 	std::vector<VkImageView> m_SwapchainImageViews;
+	std::vector<VkPresentModeKHR> m_AvailablePresentModes;
+	VkPresentModeKHR m_PresentMode = VK_PRESENT_MODE_FIFO_KHR; // of the swapchain, render thread
+	VkExtent2D m_FramebufferExtent{}; // the swapchain was created for
 
 	VkRenderPass m_RenderPass{};
-
-	VkImage m_ColorImage{};
-	VkDeviceMemory m_ColorImageMemory{};
-	VkImageView m_ColorImageView{};
-	VkImage m_DepthImage{};
-	VkDeviceMemory m_DepthImageMemory{};
-	VkImageView m_DepthImageView{};
+	// loads the attachments of `m_RenderPass`; continues the scene after the hi-z pass
+	VkRenderPass m_LoadRenderPass{};
+
+	// rebuilt with the swapchain; owns the msaa color and depth attachments
+	std::unique_ptr<RenderGraph> m_RenderGraph;
+	std::unique_ptr<VulkanRenderGraphBackend> m_RenderGraphBackend;
+	RenderGraphResource m_ColorAttachment = 0;
+	RenderGraphResource m_DepthAttachment = 0;
+	RenderGraphResource m_SwapchainAttachment = 0;
 	std::vector<VkFramebuffer> m_SwapchainFramebuffers;
 
 	VkDescriptorSetLayout m_DescriptorSetLayout{};
 	VkPipelineLayout m_PipelineLayout{};
 	std::vector<VkDescriptorSet> m_DescriptorSets;
+	// set 1 of the instanced pipelines, the model matrices of the instances
+	VkDescriptorSetLayout m_InstanceDescriptorSetLayout{};
+	std::vector<VkDescriptorSet> m_InstanceDescriptorSets; // per frame, `m_InstanceBuffers`
+	VkDescriptorSet m_GpuCullingInstanceDescriptorSet{}; // the instances of the gpu culling
 
 	std::vector<VkBuffer> m_SceneUniformBuffers;
 	std::vector<VkDeviceMemory> m_SceneUniformBufferMemory;
 	std::vector<VkBuffer> m_MatUniformBuffers;
 	std::vector<VkDeviceMemory> m_MatUniformBufferMemory;
+	std::vector<void*> m_MatUniformBufferMapped;
+	VkDeviceSize m_MatUniformBufferStride = 0; // aligned size of a per-draw slot
+	// written while recording the instanced draws, one matrix per draw slot
+	std::vector<VkBuffer> m_InstanceBuffers;
+	std::vector<VkDeviceMemory> m_InstanceBufferMemory;
+	std::vector<void*> m_InstanceBufferMapped;
 	std::vector<VkBuffer> m_LightUniformBuffers;
 	std::vector<VkDeviceMemory> m_LightUniformBufferMemory;
 
@@ -145,8 +278,85 @@ private:
 	std::vector<VkImageView> m_TextureImageViews;
 	std::vector<VkDeviceMemory> m_TextureImageMems;
 
-	VkPipeline m_Pipeline{};
+	// loaded at startup and saved at shutdown, so the pipelines are only compiled once
+	std::unique_ptr<PipelineCache> m_PipelineCache;
+	// the SPIR-V of the graphics pipelines; watches their sources for changes
+	std::unique_ptr<ShaderCompiler> m_ShaderCompiler;
+	// owns the graphics pipelines; the pipelines that are not needed by the first frame are
+	// compiled on the job system
+	std::unique_ptr<PipelineStateCache> m_PipelineStates;
+	// the scene shader permutations by their `ShaderFeature` bits, requested on the main thread
+	// without per-draw data bits the shaders read it from push constants; `PER_DRAW_UBO` reads
+	// it from the dynamic matrix UBO and `INSTANCED` from the instance buffer of set 1
+	std::unordered_map<uint32_t, ScenePipelineIds> m_ScenePipelines;
+	std::string m_SceneShader; // source file of the scene shaders
+	uint32_t m_SceneFeatures = 0; // the specialized features the scene shaders declare
+	// compiled at startup, a requested permutation falls back to them
+	uint32_t m_FallbackSceneFeatures = 0;
+	bool m_UseNormalMapping = true;
+	// paths of the last frame that fell back to another one, and the gpu-driven draws that were
+	// skipped, because their pipelines were still compiling
+	uint32_t m_PipelineFallbackCount = 0;
+	uint32_t m_SkippedDrawCount = 0;
 	std::vector<VkCommandBuffer> m_CommandBuffers;
+	std::vector<VkCommandBuffer> m_OverlayCommandBuffers; // secondary; skybox and ui
+	std::vector<VkCommandBuffer> m_LateCommandBuffers; // secondary; late occlusion culling draws
+	// [frame][slice] secondary command buffers for the model draws
+	std::vector<std::vector<VkCommandPool>> m_SliceCommandPools;
+	std::vector<std::vector<VkCommandBuffer>> m_SliceCommandBuffers;
+	// [frame][slice] depth pre-pass draws of the slices, allocated from the slice pools
+	std::vector<std::vector<VkCommandBuffer>> m_PrepassSliceCommandBuffers;
+	int32_t m_RecordSliceCount = 1;
+
+	// per-draw data path
+	bool m_PushConstantsSupported = false; // `PerDrawData` fits in `maxPushConstantsSize`
+	bool m_UsePushConstants = false;
+	// the draws of a slice are one instanced draw per mesh
+	bool m_UseInstancing = false;
+	int32_t m_BenchmarkDrawCount = 1;
+	std::atomic<float> m_DrawRecordTime{ 0.0f }; // ms
+	std::atomic<uint32_t> m_IssuedBindCount{ 0 };
+	std::atomic<uint32_t> m_SavedBindCount{ 0 };
+
+	// the draws are sorted by state and front to back on the main thread, and the recording
+	// skips the binds of the state that is already bound
+	std::unique_ptr<DrawListSorter> m_DrawListSorter;
+	bool m_UseDrawSorting = false;
+	float m_DrawSortTime = 0.0f; // ms
+
+	// the model draws are preceded by a depth-only pass, so every pixel is shaded once
+	bool m_UseDepthPrepass = false;
+	// gpu time of the scene passes, read back from a previous frame
+	std::unique_ptr<GpuTimestamps> m_GpuTimestamps; // null if not supported
+	std::atomic<float> m_SceneGpuTime{ 0.0f }; // ms
+	std::atomic<float> m_DepthPrepassGpuTime{ 0.0f }; // ms
+
+	// the pbr shaders only shade the point lights of their cluster
+	std::unique_ptr<ClusteredLighting> m_ClusteredLighting;
+	int32_t m_PointLightCount = 4; // the first four are the original scene lights
+	std::atomic<float> m_LightClusterGpuTime{ 0.0f }; // ms
+
+	// frustum culling of the benchmark draws on the cpu, runs on the main thread
+	std::unique_ptr<CpuCulling> m_CpuCulling;
+	CullingBounds m_BenchmarkBounds;
+	bool m_UseCpuCulling = true;
+	float m_CpuCullTime = 0.0f; // ms
+	// occlusion culling of the frustum culled draws against a few rasterized occluders
+	std::unique_ptr<SoftwareOcclusion> m_SoftwareOcclusion;
+	bool m_UseSoftwareOcclusion = false;
+	float m_SoftwareOcclusionTime = 0.0f; // ms
+	uint32_t m_SoftwareOccludedCount = 0;
+
+	// frustum and occlusion culling of the benchmark draws on the gpu
+	std::unique_ptr<GpuCulling> m_GpuCulling;
+	std::unique_ptr<HiZPyramid> m_HiZ; // resized with the render graph
+	bool m_GpuCullingSupported = false;
+	bool m_OcclusionCullingSupported = false; // needs the hi-z pyramid, with gpu culling only
+	bool m_UseGpuCulling = false;
+	bool m_UseOcclusionCulling = false;
+	bool m_OcclusionGraph = false; // the render graph has the occlusion culling passes
+	std::atomic<uint32_t> m_FrustumCulledCount{ 0 };
+	std::atomic<uint32_t> m_OccludedCount{ 0 };
 
 	std::unique_ptr<Model> m_Model;
 
@@ -160,27 +370,34 @@ private:
 	VkDescriptorSetLayout m_CubemapDescriptorSetLayout{};
 	std::vector<VkDescriptorSet> m_CubemapDescriptorSets;
 	VkPipelineLayout m_CubemapPipelineLayout{};
-	VkPipeline m_CubemapPipeline{};
+	// resolved into every frame packet, a reload or an optimized link retires the old pipeline
+	PipelineStateCache::PipelineId m_CubemapPipeline = PipelineStateCache::INVALID_ID;
 	VkBuffer m_CubemapVertexBuffer{};
 	VkDeviceMemory m_CubemapVertexBufferMem{};
 
 	// synchronization objects
 	// used to acquire swapchain images
 	std::vector<VkSemaphore> m_ImageAvailableSemaphores;
-	// signaled when command buffers have finished execution
+	// signaled when command buffers have finished execution; waited on by the present
 	std::vector<VkSemaphore> m_RenderFinishedSemaphores;
-	std::vector<VkFence> m_InFlightFences;
+	// signaled with the frame number once the gpu finished a frame
+	VkSemaphore m_FrameTimeline{};
 
 	std::unique_ptr<Camera> m_Camera;
 
 	VkCommandBuffer m_ActiveCommandBuffer{};
 	uint32_t m_CurrentFrameIndex = 0;
 	uint32_t m_NextFrameIndex = 0; // acquired from swapchain
-	bool m_FramebufferResized = false;
+	uint64_t m_FrameNumber = 0; // number of submitted frames
 	float m_AspectRatio = 0.0f;
 
-	uint32_t m_LastFps = 0;
+	std::atomic<uint32_t> m_LastFps{ 0 };
 	uint32_t m_FrameCounter = 0;
-	std::chrono::time_point<std::chrono::high_resolution_clock> m_LastFrameTime;
+	std::chrono::time_point<std::chrono::high_resolution_clock> m_LastUpdateTime; // main thread
+
+	// resize events are debounced on the main thread
+	std::chrono::time_point<std::chrono::high_resolution_clock> m_LastResizeTime;
+	VkExtent2D m_PublishedFramebufferExtent{};
+	std::chrono::time_point<std::chrono::high_resolution_clock> m_LastShaderPollTime;
 	std::chrono::time_point<std::chrono::high_resolution_clock> m_FpsTimePoint;
 };
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include "engine/framePacket.h"
+
+#include <utility>
+
+
+void FramePacketBuffer::Publish()
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_WriteIndex ^= 1;
+		m_HasPublished = true;
+	}
+	m_Published.notify_one();
+}
+
+bool FramePacketBuffer::WaitUntilConsumed(std::chrono::milliseconds timeout)
+{
+	std::unique_lock<std::mutex> lock{ m_Mutex };
+	return m_Consumed.wait_for(lock, timeout, [this]() { return !m_HasPublished || m_Stop; });
+}
+
+void FramePacketBuffer::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_Stop = true;
+	}
+	m_Published.notify_all();
+	m_Consumed.notify_all();
+}
+
+bool FramePacketBuffer::Consume(FramePacket& packet)
+{
+	{
+		std::unique_lock<std::mutex> lock{ m_Mutex };
+		m_Published.wait(lock, [this]() { return m_HasPublished || m_Stop; });
+		if (m_Stop)
+			return false;
+
+		// the previous packet of the render thread is reused as the next write packet
+		std::swap(packet, m_Packets[m_WriteIndex ^ 1]);
+		m_HasPublished = false;
+	}
+	m_Consumed.notify_one();
+
+	return true;
+}
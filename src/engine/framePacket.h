@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include "engine/settings.h"
+#include "engine/drawList.h"
+#include "ui/imGuiOverlay.h"
+
+
+// the scene pipelines of the per-draw data path of a frame
+struct ScenePipelines
+{
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkPipeline prepass = VK_NULL_HANDLE;
+	VkPipeline depthEqual = VK_NULL_HANDLE;
+};
+
+// everything the render thread needs to draw a frame
+// built on the main thread from the latest input
+struct FramePacket
+{
+	uint64_t number = 0; // counts the published packets, resources are deleted per packet
+
+	RenderSettings settings;
+	VkExtent2D framebufferExtent{};
+
+	// camera
+	glm::mat4 viewMatrix{};
+	glm::mat4 projectionMatrix{};
+	glm::mat4 viewProjectionMatrix{};
+	glm::vec3 cameraPos{};
+	float zNear = 0.0f;
+	float zFar = 0.0f;
+
+	// the first lights of the clustered shading
+	uint32_t pointLightCount = 0;
+
+	// per-draw data path
+	bool usePushConstants = false;
+	bool useInstancing = false;
+	bool useGpuCulling = false;
+	bool useOcclusionCulling = false; // with gpu culling only
+	bool useCpuCulling = false;
+	bool useDepthPrepass = false;
+	bool useDrawSorting = false; // not with gpu culling
+	// of the path above; the paths whose pipelines are still compiling were replaced by one
+	// that is compiled
+	ScenePipelines pipelines;
+	VkPipeline cubemapPipeline = VK_NULL_HANDLE;
+	uint32_t drawCount = 1;
+	std::vector<uint32_t> visibleDraws; // benchmark draw indices that passed the cpu culling
+	// sorted draws, the payload is the index in [0, drawCount); one item per mesh of a draw,
+	// except with instancing
+	DrawList drawList;
+	uint32_t recordSliceCount = 1;
+
+	ImGuiDrawSnapshot ui;
+};
+
+// hands frame packets from the main thread over to the render thread
+// the main thread fills the write packet while the render thread draws its own copy of the last
+// published one, so neither thread waits for the other to finish a frame
+class FramePacketBuffer
+{
+public:
+	// main thread
+	[[nodiscard]] inline FramePacket& GetWritePacket() { return m_Packets[m_WriteIndex]; }
+	// a published packet that has not been picked up yet is replaced
+	void Publish();
+	// returns false if the last published packet is still pending after `timeout`
+	bool WaitUntilConsumed(std::chrono::milliseconds timeout);
+	void Stop();
+
+	// render thread
+	// blocks until a packet is published and swaps it into `packet`
+	// returns false once the buffer is stopped
+	bool Consume(FramePacket& packet);
+
+private:
+	std::array<FramePacket, 2> m_Packets;
+	uint32_t m_WriteIndex = 0; // the other packet is the last published one
+
+	std::mutex m_Mutex;
+	std::condition_variable m_Published;
+	std::condition_variable m_Consumed;
+	bool m_HasPublished = false;
+	bool m_Stop = false;
+};
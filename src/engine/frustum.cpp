@@ -0,0 +1,34 @@
+#include "engine/frustum.h"
+
+
+Frustum Frustum::FromViewProjection(const glm::mat4& viewProjection)
+{
+	// glm matrices are column major
+	const glm::mat4 m = glm::transpose(viewProjection);
+
+	Frustum frustum{};
+	frustum.planes[LEFT] = m[3] + m[0];
+	frustum.planes[RIGHT] = m[3] - m[0];
+	frustum.planes[BOTTOM] = m[3] + m[1];
+	frustum.planes[TOP] = m[3] - m[1];
+	// -w <= z also holds for a [0, 1] depth range, it only keeps a bit more behind the near plane
+	frustum.planes[NEAR] = m[3] + m[2];
+	frustum.planes[FAR] = m[3] - m[2];
+
+	// normalized, so the distance to a plane can be compared with a radius
+	for (auto& plane : frustum.planes)
+		plane /= glm::length(glm::vec3(plane));
+
+	return frustum;
+}
+
+bool Frustum::IsSphereVisible(const glm::vec3& center, float radius) const
+{
+	for (const auto& plane : planes)
+	{
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+			return false;
+	}
+
+	return true;
+}
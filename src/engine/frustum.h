@@ -0,0 +1,27 @@
+#pragma once
+
+#include <array>
+#include <glm/glm.hpp>
+
+
+// world space planes of a view frustum; xyz is the normal pointing inside, w the distance
+struct Frustum
+{
+	enum Plane
+	{
+		LEFT = 0,
+		RIGHT,
+		BOTTOM,
+		TOP,
+		NEAR,
+		FAR,
+		PLANE_COUNT
+	};
+
+	std::array<glm::vec4, PLANE_COUNT> planes{};
+
+	// the planes are extracted from the rows of the view projection matrix
+	[[nodiscard]] static Frustum FromViewProjection(const glm::mat4& viewProjection);
+
+	[[nodiscard]] bool IsSphereVisible(const glm::vec3& center, float radius) const;
+};
@@ -0,0 +1,488 @@
+#include "engine/gpuCulling.h"
+
+#include <cstring>
+#include <algorithm>
+#include "core/core.h"
+#include "engine/initializers.h"
+#include "engine/shader.h"
+#include "utils/utils.h"
+
+
+// local size of cull.comp
+constexpr uint32_t g_CullGroupSize = 64;
+
+GpuCulling::GpuCulling(const std::unique_ptr<Device>& device,
+	VkCommandPool commandPool,
+	VkDescriptorPool descriptorPool,
+	VkPipelineCache pipelineCache,
+	const Model& model,
+	const std::vector<glm::mat4>& instances)
+	: m_Device{ device },
+	  m_MeshCount{ model.GetMeshCount() },
+	  m_MaxDrawsPerMesh{ static_cast<uint32_t>(instances.size()) }
+{
+	CreateBuffers(commandPool, model, instances);
+	CreateFallbackHiZ(commandPool);
+	CreateDescriptorSetLayout();
+	CreateDescriptorSets(descriptorPool);
+	CreatePipeline(pipelineCache);
+}
+
+GpuCulling::~GpuCulling()
+{
+	vkDestroyPipeline(m_Device->GetDevice(), m_Pipeline, nullptr);
+	vkDestroyPipelineLayout(m_Device->GetDevice(), m_PipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(m_Device->GetDevice(), m_DescriptorSetLayout, nullptr);
+
+	for (size_t i = 0; i < m_DrawCommandBuffers.size(); ++i)
+	{
+		vkDestroyBuffer(m_Device->GetDevice(), m_DrawCommandBuffers[i], nullptr);
+		vkFreeMemory(m_Device->GetDevice(), m_DrawCommandBufferMemory[i], nullptr);
+		vkDestroyBuffer(m_Device->GetDevice(), m_DrawCountBuffers[i], nullptr);
+		vkFreeMemory(m_Device->GetDevice(), m_DrawCountBufferMemory[i], nullptr);
+		vkDestroyBuffer(m_Device->GetDevice(), m_UniformBuffers[i], nullptr);
+		vkFreeMemory(m_Device->GetDevice(), m_UniformBufferMemory[i], nullptr);
+		vkDestroyBuffer(m_Device->GetDevice(), m_StatsBuffers[i], nullptr);
+		vkFreeMemory(m_Device->GetDevice(), m_StatsBufferMemory[i], nullptr);
+	}
+
+	vkDestroySampler(m_Device->GetDevice(), m_FallbackHiZSampler, nullptr);
+	vkDestroyImageView(m_Device->GetDevice(), m_FallbackHiZView, nullptr);
+	vkDestroyImage(m_Device->GetDevice(), m_FallbackHiZImage, nullptr);
+	vkFreeMemory(m_Device->GetDevice(), m_FallbackHiZImageMemory, nullptr);
+
+	vkDestroyBuffer(m_Device->GetDevice(), m_VisibilityBuffer, nullptr);
+	vkFreeMemory(m_Device->GetDevice(), m_VisibilityBufferMemory, nullptr);
+	vkDestroyBuffer(m_Device->GetDevice(), m_MeshBuffer, nullptr);
+	vkFreeMemory(m_Device->GetDevice(), m_MeshBufferMemory, nullptr);
+	vkDestroyBuffer(m_Device->GetDevice(), m_InstanceBuffer, nullptr);
+	vkFreeMemory(m_Device->GetDevice(), m_InstanceBufferMemory, nullptr);
+}
+
+bool GpuCulling::IsSupported(const std::unique_ptr<Device>& device)
+{
+	const VkPhysicalDeviceFeatures features = device->GetDeviceFeatures();
+	return device->GetDeviceVulkan12Features().drawIndirectCount && features.multiDrawIndirect
+		   && features.drawIndirectFirstInstance;
+}
+
+void GpuCulling::SetHiZ(const HiZPyramid& hiZ)
+{
+	m_HiZView = hiZ.GetImageView();
+	m_HiZSampler = hiZ.GetSampler();
+	m_HiZExtent = hiZ.GetExtent();
+	m_HiZMipCount = hiZ.GetMipCount();
+	std::fill(m_HiZDirty.begin(), m_HiZDirty.end(), true);
+}
+
+void GpuCulling::RecordCull(VkCommandBuffer cmdBuff,
+	uint32_t frameIndex,
+	const glm::mat4& viewProjection,
+	uint32_t instanceCount,
+	Phase phase)
+{
+	// the frame that last used the set is done
+	if (m_HiZDirty[frameIndex])
+		UpdateHiZDescriptor(frameIndex);
+
+	const VkDeviceSize countRegionSize = sizeof(uint32_t) * m_MeshCount;
+	if (phase != Phase::LATE)
+	{
+		CullUniforms uniforms{};
+		uniforms.frustumPlanes = Frustum::FromViewProjection(viewProjection).planes;
+		uniforms.viewProjection = viewProjection;
+		uniforms.hiZWidth = static_cast<int32_t>(m_HiZExtent.width);
+		uniforms.hiZHeight = static_cast<int32_t>(m_HiZExtent.height);
+		uniforms.hiZMipCount = static_cast<int32_t>(m_HiZMipCount);
+		memcpy(m_UniformBufferMapped[frameIndex], &uniforms, sizeof(CullUniforms));
+
+		vkCmdFillBuffer(cmdBuff, m_StatsBuffers[frameIndex], 0, VK_WHOLE_SIZE, 0);
+	}
+
+	// the draw counts are accumulated with atomics
+	vkCmdFillBuffer(cmdBuff,
+		m_DrawCountBuffers[frameIndex],
+		phase == Phase::LATE ? countRegionSize : 0,
+		countRegionSize,
+		0);
+
+	// also orders the visibility writes of the previous phase before this one
+	VkMemoryBarrier clearBarrier{};
+	clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(cmdBuff,
+		VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0,
+		1,
+		&clearBarrier,
+		0,
+		nullptr,
+		0,
+		nullptr);
+
+	CullData cullData{};
+	cullData.instanceCount = std::min(instanceCount, m_MaxDrawsPerMesh);
+	cullData.meshCount = m_MeshCount;
+	cullData.maxDrawsPerMesh = m_MaxDrawsPerMesh;
+	cullData.phase = static_cast<uint32_t>(phase);
+
+	vkCmdBindPipeline(cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline);
+	vkCmdBindDescriptorSets(cmdBuff,
+		VK_PIPELINE_BIND_POINT_COMPUTE,
+		m_PipelineLayout,
+		0,
+		1,
+		&m_DescriptorSets[frameIndex],
+		0,
+		nullptr);
+	vkCmdPushConstants(
+		cmdBuff, m_PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullData), &cullData);
+	vkCmdDispatch(cmdBuff, (cullData.instanceCount + g_CullGroupSize - 1) / g_CullGroupSize, 1, 1);
+
+	// the draw commands and counts are read by the indirect draws, the stats by the host
+	VkMemoryBarrier cullBarrier{};
+	cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(cmdBuff,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+		0,
+		1,
+		&cullBarrier,
+		0,
+		nullptr,
+		0,
+		nullptr);
+}
+
+void GpuCulling::RecordDraws(VkCommandBuffer cmdBuff,
+	uint32_t frameIndex,
+	Model& model,
+	Phase phase,
+	Model::VertexStream stream) const
+{
+	// the late commands and counts follow the early ones
+	const VkDeviceSize region = phase == Phase::LATE ? 1 : 0;
+	model.DrawIndirectCount(cmdBuff,
+		m_DrawCommandBuffers[frameIndex],
+		region * sizeof(VkDrawIndexedIndirectCommand) * m_MaxDrawsPerMesh * m_MeshCount,
+		m_DrawCountBuffers[frameIndex],
+		region * sizeof(uint32_t) * m_MeshCount,
+		m_MaxDrawsPerMesh,
+		stream);
+}
+
+void GpuCulling::CreateBuffers(VkCommandPool commandPool,
+	const Model& model,
+	const std::vector<glm::mat4>& instances)
+{
+	// the instances and meshes don't change, so they are uploaded once
+	UploadBuffer(commandPool,
+		instances.data(),
+		GetInstanceBufferSize(),
+		m_InstanceBuffer,
+		m_InstanceBufferMemory);
+
+	std::vector<GpuMesh> meshes(m_MeshCount);
+	for (uint32_t i = 0; i < m_MeshCount; ++i)
+	{
+		meshes[i].boundingSphere = model.GetBoundingSpheres()[i];
+		meshes[i].indexCount = static_cast<uint32_t>(model.GetIndexCounts()[i]);
+	}
+	UploadBuffer(commandPool,
+		meshes.data(),
+		sizeof(GpuMesh) * meshes.size(),
+		m_MeshBuffer,
+		m_MeshBufferMemory);
+
+	// nothing was drawn before the first frame
+	const std::vector<uint32_t> visibility(static_cast<size_t>(m_MaxDrawsPerMesh) * m_MeshCount, 0);
+	UploadBuffer(commandPool,
+		visibility.data(),
+		sizeof(uint32_t) * visibility.size(),
+		m_VisibilityBuffer,
+		m_VisibilityBufferMemory);
+
+	m_DrawCommandBuffers.resize(Config::maxFramesInFlight);
+	m_DrawCommandBufferMemory.resize(Config::maxFramesInFlight);
+	m_DrawCountBuffers.resize(Config::maxFramesInFlight);
+	m_DrawCountBufferMemory.resize(Config::maxFramesInFlight);
+	m_UniformBuffers.resize(Config::maxFramesInFlight);
+	m_UniformBufferMemory.resize(Config::maxFramesInFlight);
+	m_UniformBufferMapped.resize(Config::maxFramesInFlight);
+	m_StatsBuffers.resize(Config::maxFramesInFlight);
+	m_StatsBufferMemory.resize(Config::maxFramesInFlight);
+	m_StatsBufferMapped.resize(Config::maxFramesInFlight);
+	for (uint32_t i = 0; i < Config::maxFramesInFlight; ++i)
+	{
+		// early and late commands
+		utils::CreateBuffer(m_Device,
+			sizeof(VkDrawIndexedIndirectCommand) * m_MaxDrawsPerMesh * m_MeshCount * 2,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			m_DrawCommandBuffers[i],
+			m_DrawCommandBufferMemory[i]);
+		utils::CreateBuffer(m_Device,
+			sizeof(uint32_t) * m_MeshCount * 2,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+				| VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			m_DrawCountBuffers[i],
+			m_DrawCountBufferMemory[i]);
+
+		// kept mapped, written while recording and read once the frame is done
+		utils::CreateBuffer(m_Device,
+			sizeof(CullUniforms),
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			m_UniformBuffers[i],
+			m_UniformBufferMemory[i]);
+		vkMapMemory(m_Device->GetDevice(),
+			m_UniformBufferMemory[i],
+			0,
+			sizeof(CullUniforms),
+			0,
+			&m_UniformBufferMapped[i]);
+		utils::CreateBuffer(m_Device,
+			sizeof(Stats),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			m_StatsBuffers[i],
+			m_StatsBufferMemory[i]);
+		vkMapMemory(m_Device->GetDevice(),
+			m_StatsBufferMemory[i],
+			0,
+			sizeof(Stats),
+			0,
+			&m_StatsBufferMapped[i]);
+		memset(m_StatsBufferMapped[i], 0, sizeof(Stats));
+	}
+}
+
+void GpuCulling::UploadBuffer(VkCommandPool commandPool,
+	const void* data,
+	VkDeviceSize size,
+	VkBuffer& buffer,
+	VkDeviceMemory& bufferMemory) const
+{
+	VkBuffer stagingBuffer = nullptr;
+	VkDeviceMemory stagingBufferMemory = nullptr;
+	utils::CreateBuffer(m_Device,
+		size,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		stagingBuffer,
+		stagingBufferMemory);
+
+	void* mapped = nullptr;
+	vkMapMemory(m_Device->GetDevice(), stagingBufferMemory, 0, size, 0, &mapped);
+	memcpy(mapped, data, size);
+	vkUnmapMemory(m_Device->GetDevice(), stagingBufferMemory);
+
+	utils::CreateBuffer(m_Device,
+		size,
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		buffer,
+		bufferMemory);
+
+	utils::CopyBuffer(m_Device, commandPool, stagingBuffer, buffer, size);
+
+	vkFreeMemory(m_Device->GetDevice(), stagingBufferMemory, nullptr);
+	vkDestroyBuffer(m_Device->GetDevice(), stagingBuffer, nullptr);
+}
+
+void GpuCulling::CreateFallbackHiZ(VkCommandPool commandPool)
+{
+	constexpr VkFormat format = VK_FORMAT_R32_SFLOAT;
+	utils::CreateImage(m_Device,
+		1,
+		1,
+		1,
+		1,
+		VK_SAMPLE_COUNT_1_BIT,
+		format,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_SAMPLED_BIT,
+		0,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		m_FallbackHiZImage,
+		m_FallbackHiZImageMemory);
+	m_FallbackHiZView = utils::CreateImageView(m_Device->GetDevice(),
+		m_FallbackHiZImage,
+		format,
+		VK_IMAGE_VIEW_TYPE_2D,
+		VK_IMAGE_ASPECT_COLOR_BIT,
+		1,
+		1);
+
+	// the pyramid is read in the general layout
+	VkCommandBuffer cmdBuff = utils::BeginSingleTimeCommands(m_Device->GetDevice(), commandPool);
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = m_FallbackHiZImage;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	vkCmdPipelineBarrier(cmdBuff,
+		VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0,
+		0,
+		nullptr,
+		0,
+		nullptr,
+		1,
+		&barrier);
+	utils::EndSingleTimeCommands(
+		cmdBuff, m_Device->GetDevice(), commandPool, m_Device->GetGraphicsQueue());
+
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	ErrCheck(vkCreateSampler(m_Device->GetDevice(), &samplerInfo, nullptr, &m_FallbackHiZSampler)
+				 != VK_SUCCESS,
+		"Failed to create the fallback hi-z sampler!");
+
+	m_HiZView = m_FallbackHiZView;
+	m_HiZSampler = m_FallbackHiZSampler;
+	m_HiZExtent = { 1, 1 };
+	m_HiZMipCount = 1;
+}
+
+void GpuCulling::CreateDescriptorSetLayout()
+{
+	// instances, meshes, draw commands, draw counts, uniforms, hi-z, visibility, stats
+	std::array<VkDescriptorSetLayoutBinding, 8> layoutBindings{};
+	for (uint32_t i = 0; i < layoutBindings.size(); ++i)
+	{
+		layoutBindings[i] = inits::DescriptorSetLayoutBinding(
+			i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+	}
+	layoutBindings[4].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	layoutBindings[5].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
+	descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
+	descriptorSetLayoutInfo.pBindings = layoutBindings.data();
+
+	ErrCheck(vkCreateDescriptorSetLayout(
+				 m_Device->GetDevice(), &descriptorSetLayoutInfo, nullptr, &m_DescriptorSetLayout)
+				 != VK_SUCCESS,
+		"Failed to create culling descriptor set layout!");
+}
+
+void GpuCulling::CreateDescriptorSets(VkDescriptorPool descriptorPool)
+{
+	std::vector<VkDescriptorSetLayout> setLayouts{ Config::maxFramesInFlight,
+		m_DescriptorSetLayout };
+	VkDescriptorSetAllocateInfo descriptorSetAllocInfo{};
+	descriptorSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	descriptorSetAllocInfo.descriptorPool = descriptorPool;
+	descriptorSetAllocInfo.descriptorSetCount = static_cast<uint32_t>(setLayouts.size());
+	descriptorSetAllocInfo.pSetLayouts = setLayouts.data();
+
+	m_DescriptorSets.resize(Config::maxFramesInFlight);
+	ErrCheck(vkAllocateDescriptorSets(
+				 m_Device->GetDevice(), &descriptorSetAllocInfo, m_DescriptorSets.data())
+				 != VK_SUCCESS,
+		"Failed to allocate culling descriptor sets!");
+	// the hi-z (or the fallback until `SetHiZ()`) is written the first time a frame culls
+	m_HiZDirty.resize(Config::maxFramesInFlight, true);
+
+	for (uint32_t i = 0; i < Config::maxFramesInFlight; ++i)
+	{
+		const std::array<VkDescriptorBufferInfo, 7> bufferInfos{
+			inits::DescriptorBufferInfo(m_InstanceBuffer, 0, VK_WHOLE_SIZE),
+			inits::DescriptorBufferInfo(m_MeshBuffer, 0, VK_WHOLE_SIZE),
+			inits::DescriptorBufferInfo(m_DrawCommandBuffers[i], 0, VK_WHOLE_SIZE),
+			inits::DescriptorBufferInfo(m_DrawCountBuffers[i], 0, VK_WHOLE_SIZE),
+			inits::DescriptorBufferInfo(m_UniformBuffers[i], 0, VK_WHOLE_SIZE),
+			inits::DescriptorBufferInfo(m_VisibilityBuffer, 0, VK_WHOLE_SIZE),
+			inits::DescriptorBufferInfo(m_StatsBuffers[i], 0, VK_WHOLE_SIZE),
+		};
+		constexpr std::array<uint32_t, 7> bindings{ 0, 1, 2, 3, 4, 6, 7 };
+
+		std::array<VkWriteDescriptorSet, 7> descWrites{};
+		for (size_t j = 0; j < descWrites.size(); ++j)
+		{
+			descWrites[j] = inits::WriteDescriptorSet(m_DescriptorSets[i],
+				bindings[j],
+				bindings[j] == 4 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER
+								 : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				1,
+				&bufferInfos[j],
+				nullptr);
+		}
+
+		vkUpdateDescriptorSets(m_Device->GetDevice(),
+			static_cast<uint32_t>(descWrites.size()),
+			descWrites.data(),
+			0,
+			nullptr);
+	}
+}
+
+void GpuCulling::UpdateHiZDescriptor(uint32_t frameIndex)
+{
+	VkDescriptorImageInfo hiZInfo = inits::DescriptorImageInfo(m_HiZSampler, m_HiZView);
+	hiZInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+	const VkWriteDescriptorSet descWrite = inits::WriteDescriptorSet(m_DescriptorSets[frameIndex],
+		5,
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		1,
+		nullptr,
+		&hiZInfo);
+	vkUpdateDescriptorSets(m_Device->GetDevice(), 1, &descWrite, 0, nullptr);
+
+	m_HiZDirty[frameIndex] = false;
+}
+
+void GpuCulling::CreatePipeline(VkPipelineCache pipelineCache)
+{
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(CullData);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &m_DescriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+	ErrCheck(vkCreatePipelineLayout(
+				 m_Device->GetDevice(), &pipelineLayoutInfo, nullptr, &m_PipelineLayout)
+				 != VK_SUCCESS,
+		"Failed to create culling pipeline layout!");
+
+	const Shader computeShader{ m_Device->GetDevice(),
+		"assets/shaders/out/cull.comp.spv",
+		ShaderType::COMPUTE };
+
+	VkComputePipelineCreateInfo computePipelineInfo{};
+	computePipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	computePipelineInfo.stage = computeShader.GetShaderStage();
+	computePipelineInfo.layout = m_PipelineLayout;
+	ErrCheck(vkCreateComputePipelines(m_Device->GetDevice(),
+				 pipelineCache,
+				 1,
+				 &computePipelineInfo,
+				 nullptr,
+				 &m_Pipeline)
+				 != VK_SUCCESS,
+		"Failed to create culling pipeline!");
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include "engine/device.h"
+#include "engine/model.h"
+#include "engine/frustum.h"
+#include "engine/hiZPyramid.h"
+
+
+// frustum and occlusion culls the instances of a model on the gpu
+// a compute pass tests the bounding sphere of every mesh of every instance and compacts the visible
+// ones into indirect draw commands, so recording the draws costs the same for any instance count
+// occlusion culling runs in two phases: the early phase draws what was visible last frame, the
+// late phase tests everything else against the hi-z pyramid of the early depth and draws the rest
+class GpuCulling
+{
+public:
+	enum class Phase
+	{
+		ALL = 0, // frustum culling only
+		EARLY,
+		LATE,
+	};
+
+	// read back once the frame is done
+	struct Stats
+	{
+		uint32_t frustumCulled;
+		uint32_t occluded;
+	};
+
+	GpuCulling(const std::unique_ptr<Device>& device,
+		VkCommandPool commandPool,
+		VkDescriptorPool descriptorPool,
+		VkPipelineCache pipelineCache,
+		const Model& model,
+		const std::vector<glm::mat4>& instances);
+	~GpuCulling();
+	GpuCulling(const GpuCulling&) = delete;
+	GpuCulling(GpuCulling&&) = delete;
+	GpuCulling& operator=(const GpuCulling&) = delete;
+	GpuCulling& operator=(GpuCulling&&) = delete;
+
+	// `vkCmdDrawIndexedIndirectCount()` and reading the instance index from `firstInstance`;
+	// occlusion culling also needs `HiZPyramid::IsSupported()`
+	[[nodiscard]] static bool IsSupported(const std::unique_ptr<Device>& device);
+
+	// has to be called again whenever the pyramid is resized
+	// without a pyramid only `Phase::ALL` can be used
+	void SetHiZ(const HiZPyramid& hiZ);
+
+	// recorded outside of the render pass, before the draws of the same phase
+	// the late phase reuses the view projection of the early phase and needs a built pyramid
+	void RecordCull(VkCommandBuffer cmdBuff,
+		uint32_t frameIndex,
+		const glm::mat4& viewProjection,
+		uint32_t instanceCount,
+		Phase phase);
+	// a pipeline that reads the model matrices from the instance buffer has to be bound
+	void RecordDraws(VkCommandBuffer cmdBuff,
+		uint32_t frameIndex,
+		Model& model,
+		Phase phase,
+		Model::VertexStream stream = Model::VertexStream::ALL) const;
+
+	// only valid once the frame that last used `frameIndex` is done
+	[[nodiscard]] inline Stats GetStats(uint32_t frameIndex) const
+	{
+		return *static_cast<const Stats*>(m_StatsBufferMapped[frameIndex]);
+	}
+
+	// one model matrix per instance; read with `gl_InstanceIndex`
+	[[nodiscard]] inline VkBuffer GetInstanceBuffer() const { return m_InstanceBuffer; }
+	[[nodiscard]] inline VkDeviceSize GetInstanceBufferSize() const
+	{
+		return sizeof(glm::mat4) * m_MaxDrawsPerMesh;
+	}
+
+private:
+	// std430 layout of `Mesh` in cull.comp
+	struct alignas(16) GpuMesh
+	{
+		glm::vec4 boundingSphere;
+		uint32_t indexCount;
+	};
+
+	// std140 layout of `CullUniforms` in cull.comp, too large for push constants
+	struct CullUniforms
+	{
+		std::array<glm::vec4, Frustum::PLANE_COUNT> frustumPlanes;
+		glm::mat4 viewProjection;
+		int32_t hiZWidth;
+		int32_t hiZHeight;
+		int32_t hiZMipCount;
+	};
+
+	// push constants of cull.comp
+	struct CullData
+	{
+		uint32_t instanceCount;
+		uint32_t meshCount;
+		uint32_t maxDrawsPerMesh;
+		uint32_t phase;
+	};
+
+	void CreateBuffers(VkCommandPool commandPool,
+		const Model& model,
+		const std::vector<glm::mat4>& instances);
+	void UploadBuffer(VkCommandPool commandPool,
+		const void* data,
+		VkDeviceSize size,
+		VkBuffer& buffer,
+		VkDeviceMemory& bufferMemory) const;
+	void CreateDescriptorSetLayout();
+	void CreateDescriptorSets(VkDescriptorPool descriptorPool);
+	void UpdateHiZDescriptor(uint32_t frameIndex);
+	void CreateFallbackHiZ(VkCommandPool commandPool);
+	void CreatePipeline(VkPipelineCache pipelineCache);
+
+	const std::unique_ptr<Device>& m_Device;
+
+	uint32_t m_MeshCount = 0;
+	uint32_t m_MaxDrawsPerMesh = 0; // the number of instances
+
+	VkBuffer m_InstanceBuffer{};
+	VkDeviceMemory m_InstanceBufferMemory{};
+	VkBuffer m_MeshBuffer{};
+	VkDeviceMemory m_MeshBufferMemory{};
+	// one flag per mesh of every instance, whether it was drawn last frame
+	// shared by the frames, they run one after another
+	VkBuffer m_VisibilityBuffer{};
+	VkDeviceMemory m_VisibilityBufferMemory{};
+	// per frame in flight, the previous frames may still draw with theirs
+	// the command and count buffers hold the early commands followed by the late ones
+	std::vector<VkBuffer> m_DrawCommandBuffers;
+	std::vector<VkDeviceMemory> m_DrawCommandBufferMemory;
+	std::vector<VkBuffer> m_DrawCountBuffers;
+	std::vector<VkDeviceMemory> m_DrawCountBufferMemory;
+	std::vector<VkBuffer> m_UniformBuffers;
+	std::vector<VkDeviceMemory> m_UniformBufferMemory;
+	std::vector<void*> m_UniformBufferMapped;
+	std::vector<VkBuffer> m_StatsBuffers;
+	std::vector<VkDeviceMemory> m_StatsBufferMemory;
+	std::vector<void*> m_StatsBufferMapped;
+
+	// written into the sets of the frames the next time they cull
+	VkImageView m_HiZView{};
+	VkSampler m_HiZSampler{};
+	VkExtent2D m_HiZExtent{};
+	uint32_t m_HiZMipCount = 0;
+	std::vector<bool> m_HiZDirty;
+	// bound until a pyramid is set; the shader uses the binding statically, so it has to be valid
+	// even though only the late phase reads it
+	VkImage m_FallbackHiZImage{};
+	VkDeviceMemory m_FallbackHiZImageMemory{};
+	VkImageView m_FallbackHiZView{};
+	VkSampler m_FallbackHiZSampler{};
+
+	VkDescriptorSetLayout m_DescriptorSetLayout{};
+	std::vector<VkDescriptorSet> m_DescriptorSets;
+	VkPipelineLayout m_PipelineLayout{};
+	VkPipeline m_Pipeline{};
+};
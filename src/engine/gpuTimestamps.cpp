@@ -0,0 +1,89 @@
+#include "engine/gpuTimestamps.h"
+
+#include "core/core.h"
+#include "engine/types.h"
+
+
+static uint32_t GetTimestampValidBits(const std::unique_ptr<Device>& device)
+{
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(
+		device->GetPhysicalDevice(), &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(
+		device->GetPhysicalDevice(), &queueFamilyCount, queueFamilies.data());
+
+	return queueFamilies[device->GetQueueFamilyIndices().graphicsFamily.value()].timestampValidBits;
+}
+
+GpuTimestamps::GpuTimestamps(const std::unique_ptr<Device>& device, uint32_t queryCount)
+	: m_Device{ device },
+	  m_QueryCount{ queryCount },
+	  m_TimestampPeriod{ device->GetDeviceProperties().limits.timestampPeriod },
+	  m_QueryPools(Config::maxFramesInFlight),
+	  m_Recorded(Config::maxFramesInFlight, false),
+	  m_Results(static_cast<size_t>(queryCount) * 2, 0)
+{
+	const uint32_t validBits = GetTimestampValidBits(m_Device);
+	m_TimestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	VkQueryPoolCreateInfo queryPoolInfo{};
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount = m_QueryCount;
+	for (auto& queryPool : m_QueryPools)
+	{
+		ErrCheck(
+			vkCreateQueryPool(m_Device->GetDevice(), &queryPoolInfo, nullptr, &queryPool)
+				!= VK_SUCCESS,
+			"Failed to create timestamp query pool!");
+	}
+}
+
+GpuTimestamps::~GpuTimestamps()
+{
+	for (const auto& queryPool : m_QueryPools)
+		vkDestroyQueryPool(m_Device->GetDevice(), queryPool, nullptr);
+}
+
+bool GpuTimestamps::IsSupported(const std::unique_ptr<Device>& device)
+{
+	return device->GetDeviceProperties().limits.timestampPeriod > 0.0f
+		   && GetTimestampValidBits(device) != 0;
+}
+
+void GpuTimestamps::RecordReset(VkCommandBuffer cmdBuff, uint32_t frameIndex)
+{
+	// queries that were not written in that frame stay unavailable
+	if (m_Recorded[frameIndex])
+	{
+		vkGetQueryPoolResults(m_Device->GetDevice(),
+			m_QueryPools[frameIndex],
+			0,
+			m_QueryCount,
+			m_Results.size() * sizeof(uint64_t),
+			m_Results.data(),
+			2 * sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+	}
+
+	vkCmdResetQueryPool(cmdBuff, m_QueryPools[frameIndex], 0, m_QueryCount);
+	m_Recorded[frameIndex] = true;
+}
+
+void GpuTimestamps::RecordTimestamp(VkCommandBuffer cmdBuff,
+	uint32_t frameIndex,
+	uint32_t query,
+	VkPipelineStageFlagBits stage) const
+{
+	vkCmdWriteTimestamp(cmdBuff, stage, m_QueryPools[frameIndex], query);
+}
+
+float GpuTimestamps::GetElapsedMs(uint32_t beginQuery, uint32_t endQuery) const
+{
+	if (m_Results[2 * beginQuery + 1] == 0 || m_Results[2 * endQuery + 1] == 0)
+		return 0.0f;
+
+	const uint64_t ticks = (m_Results[2 * endQuery] - m_Results[2 * beginQuery]) & m_TimestampMask;
+	return static_cast<float>(ticks) * m_TimestampPeriod * 1e-6f;
+}
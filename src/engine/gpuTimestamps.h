@@ -0,0 +1,47 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "engine/device.h"
+
+
+// timestamp queries, one set per frame in flight
+// the results of a frame are read once the gpu is done with it, so they lag a few frames behind
+class GpuTimestamps
+{
+public:
+	GpuTimestamps(const std::unique_ptr<Device>& device, uint32_t queryCount);
+	~GpuTimestamps();
+	GpuTimestamps(const GpuTimestamps&) = delete;
+	GpuTimestamps(GpuTimestamps&&) = delete;
+	GpuTimestamps& operator=(const GpuTimestamps&) = delete;
+	GpuTimestamps& operator=(GpuTimestamps&&) = delete;
+
+	// the graphics queue has to support timestamps
+	[[nodiscard]] static bool IsSupported(const std::unique_ptr<Device>& device);
+
+	// only valid once the frame that last used `frameIndex` is done; reads the results of that
+	// frame before its queries are reset
+	// recorded outside of a render pass, before any timestamp of the frame
+	void RecordReset(VkCommandBuffer cmdBuff, uint32_t frameIndex);
+	// `stage` of the commands recorded before it
+	void RecordTimestamp(VkCommandBuffer cmdBuff,
+		uint32_t frameIndex,
+		uint32_t query,
+		VkPipelineStageFlagBits stage) const;
+
+	// ms between two timestamps of the last read frame; 0 if one of them was not written
+	[[nodiscard]] float GetElapsedMs(uint32_t beginQuery, uint32_t endQuery) const;
+
+private:
+	const std::unique_ptr<Device>& m_Device;
+	uint32_t m_QueryCount;
+	float m_TimestampPeriod; // ns per tick
+	uint64_t m_TimestampMask; // the valid bits of a timestamp
+
+	std::vector<VkQueryPool> m_QueryPools; // per frame in flight
+	std::vector<bool> m_Recorded; // the pool was reset by a submitted frame
+	// value and availability per query of the last read frame
+	std::vector<uint64_t> m_Results;
+};
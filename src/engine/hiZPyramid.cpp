@@ -0,0 +1,365 @@
+#include "engine/hiZPyramid.h"
+
+#include <array>
+#include <cmath>
+#include "core/core.h"
+#include "engine/engine.h"
+#include "engine/initializers.h"
+#include "engine/shader.h"
+#include "utils/utils.h"
+
+
+// local size of hiz.comp
+constexpr uint32_t g_HiZGroupSize = 8;
+
+HiZPyramid::HiZPyramid(const std::unique_ptr<Device>& device,
+	VkDescriptorPool descriptorPool,
+	VkPipelineCache pipelineCache)
+	: m_Device{ device },
+	  m_DescriptorPool{ descriptorPool }
+{
+	CreateDescriptorSetLayout();
+	CreatePipeline(pipelineCache);
+	CreateSampler();
+}
+
+HiZPyramid::~HiZPyramid()
+{
+	// only destroyed once the device is idle
+	for (const auto& mipView : m_MipViews)
+		vkDestroyImageView(m_Device->GetDevice(), mipView, nullptr);
+	vkDestroyImageView(m_Device->GetDevice(), m_ImageView, nullptr);
+	vkDestroyImage(m_Device->GetDevice(), m_Image, nullptr);
+	vkFreeMemory(m_Device->GetDevice(), m_ImageMemory, nullptr);
+
+	vkDestroySampler(m_Device->GetDevice(), m_Sampler, nullptr);
+	vkDestroyPipeline(m_Device->GetDevice(), m_Pipeline, nullptr);
+	vkDestroyPipelineLayout(m_Device->GetDevice(), m_PipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(m_Device->GetDevice(), m_DescriptorSetLayout, nullptr);
+}
+
+bool HiZPyramid::IsSupported(const std::unique_ptr<Device>& device)
+{
+	VkFormatProperties formatProperties{};
+	vkGetPhysicalDeviceFormatProperties(device->GetPhysicalDevice(),
+		utils::FindDepthFormat(device->GetPhysicalDevice()),
+		&formatProperties);
+
+	return (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0
+		   && device->GetMsaaSamples() != VK_SAMPLE_COUNT_1_BIT
+		   && (device->GetDeviceProperties().limits.sampledImageDepthSampleCounts
+				  & device->GetMsaaSamples())
+				  != 0;
+}
+
+void HiZPyramid::Resize(VkExtent2D extent, VkImageView depthView)
+{
+	Retire();
+
+	m_Extent = extent;
+	m_MipCount =
+		static_cast<uint32_t>(std::floor(std::log2(std::max(extent.width, extent.height)))) + 1;
+	CreateImage();
+	if (depthView != VK_NULL_HANDLE)
+		CreateDescriptorSets(depthView);
+}
+
+void HiZPyramid::RecordLayoutTransition(VkCommandBuffer cmdBuff)
+{
+	if (!m_LayoutPending)
+		return;
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = m_Image;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_MipCount, 0, 1 };
+	vkCmdPipelineBarrier(cmdBuff,
+		VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0,
+		0,
+		nullptr,
+		0,
+		nullptr,
+		1,
+		&barrier);
+
+	m_LayoutPending = false;
+}
+
+void HiZPyramid::RecordBuild(VkCommandBuffer cmdBuff) const
+{
+	vkCmdBindPipeline(cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline);
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = m_Image;
+
+	// the previous frame's culling may still read the pyramid
+	barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_MipCount, 0, 1 };
+	vkCmdPipelineBarrier(cmdBuff,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0,
+		0,
+		nullptr,
+		0,
+		nullptr,
+		1,
+		&barrier);
+
+	for (uint32_t mip = 0; mip < m_MipCount; ++mip)
+	{
+		const VkExtent2D srcExtent = GetMipExtent(mip == 0 ? 0 : mip - 1);
+		const VkExtent2D dstExtent = GetMipExtent(mip);
+
+		HiZData hizData{};
+		hizData.srcWidth = static_cast<int32_t>(srcExtent.width);
+		hizData.srcHeight = static_cast<int32_t>(srcExtent.height);
+		hizData.dstWidth = static_cast<int32_t>(dstExtent.width);
+		hizData.dstHeight = static_cast<int32_t>(dstExtent.height);
+		hizData.level = static_cast<int32_t>(mip);
+		hizData.sampleCount = static_cast<int32_t>(m_Device->GetMsaaSamples());
+
+		vkCmdBindDescriptorSets(cmdBuff,
+			VK_PIPELINE_BIND_POINT_COMPUTE,
+			m_PipelineLayout,
+			0,
+			1,
+			&m_DescriptorSets[mip],
+			0,
+			nullptr);
+		vkCmdPushConstants(
+			cmdBuff, m_PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(HiZData), &hizData);
+		vkCmdDispatch(cmdBuff,
+			(dstExtent.width + g_HiZGroupSize - 1) / g_HiZGroupSize,
+			(dstExtent.height + g_HiZGroupSize - 1) / g_HiZGroupSize,
+			1);
+
+		// read by the next level, and all of them by the culling
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, mip, 1, 0, 1 };
+		vkCmdPipelineBarrier(cmdBuff,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0,
+			0,
+			nullptr,
+			0,
+			nullptr,
+			1,
+			&barrier);
+	}
+}
+
+void HiZPyramid::CreateImage()
+{
+	constexpr VkFormat format = VK_FORMAT_R32_SFLOAT;
+	utils::CreateImage(m_Device,
+		m_Extent.width,
+		m_Extent.height,
+		m_MipCount,
+		1,
+		VK_SAMPLE_COUNT_1_BIT,
+		format,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		0,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		m_Image,
+		m_ImageMemory);
+	m_ImageView = utils::CreateImageView(m_Device->GetDevice(),
+		m_Image,
+		format,
+		VK_IMAGE_VIEW_TYPE_2D,
+		VK_IMAGE_ASPECT_COLOR_BIT,
+		m_MipCount,
+		1);
+
+	m_MipViews.resize(m_MipCount);
+	for (uint32_t mip = 0; mip < m_MipCount; ++mip)
+	{
+		VkImageViewCreateInfo imgViewInfo{};
+		imgViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		imgViewInfo.image = m_Image;
+		imgViewInfo.format = format;
+		imgViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		imgViewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, mip, 1, 0, 1 };
+		ErrCheck(
+			vkCreateImageView(m_Device->GetDevice(), &imgViewInfo, nullptr, &m_MipViews[mip])
+				!= VK_SUCCESS,
+			"Failed to create hi-z mip view!");
+	}
+
+	m_LayoutPending = true;
+}
+
+void HiZPyramid::CreateDescriptorSets(VkImageView depthView)
+{
+	std::vector<VkDescriptorSetLayout> setLayouts{ m_MipCount, m_DescriptorSetLayout };
+	VkDescriptorSetAllocateInfo descriptorSetAllocInfo{};
+	descriptorSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	descriptorSetAllocInfo.descriptorPool = m_DescriptorPool;
+	descriptorSetAllocInfo.descriptorSetCount = static_cast<uint32_t>(setLayouts.size());
+	descriptorSetAllocInfo.pSetLayouts = setLayouts.data();
+
+	m_DescriptorSets.resize(m_MipCount);
+	ErrCheck(vkAllocateDescriptorSets(
+				 m_Device->GetDevice(), &descriptorSetAllocInfo, m_DescriptorSets.data())
+				 != VK_SUCCESS,
+		"Failed to allocate hi-z descriptor sets!");
+
+	for (uint32_t mip = 0; mip < m_MipCount; ++mip)
+	{
+		const VkDescriptorImageInfo depthInfo = inits::DescriptorImageInfo(m_Sampler, depthView);
+		// level 0 does not read the previous level, any valid view will do
+		VkDescriptorImageInfo srcInfo =
+			inits::DescriptorImageInfo(VK_NULL_HANDLE, m_MipViews[mip == 0 ? 0 : mip - 1]);
+		srcInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+		VkDescriptorImageInfo dstInfo = inits::DescriptorImageInfo(VK_NULL_HANDLE, m_MipViews[mip]);
+		dstInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		const std::array<VkWriteDescriptorSet, 3> descWrites{
+			inits::WriteDescriptorSet(m_DescriptorSets[mip],
+				0,
+				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				1,
+				nullptr,
+				&depthInfo),
+			inits::WriteDescriptorSet(
+				m_DescriptorSets[mip], 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, nullptr, &srcInfo),
+			inits::WriteDescriptorSet(
+				m_DescriptorSets[mip], 2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, nullptr, &dstInfo),
+		};
+		vkUpdateDescriptorSets(m_Device->GetDevice(),
+			static_cast<uint32_t>(descWrites.size()),
+			descWrites.data(),
+			0,
+			nullptr);
+	}
+}
+
+void HiZPyramid::Retire()
+{
+	if (m_Image == VK_NULL_HANDLE)
+		return;
+
+	Engine::DestroyDeferred([device = m_Device->GetDevice(),
+								descriptorPool = m_DescriptorPool,
+								image = m_Image,
+								imageMemory = m_ImageMemory,
+								imageView = m_ImageView,
+								mipViews = std::move(m_MipViews),
+								descriptorSets = std::move(m_DescriptorSets)]() {
+		if (!descriptorSets.empty())
+		{
+			vkFreeDescriptorSets(device,
+				descriptorPool,
+				static_cast<uint32_t>(descriptorSets.size()),
+				descriptorSets.data());
+		}
+
+		for (const auto& mipView : mipViews)
+			vkDestroyImageView(device, mipView, nullptr);
+		vkDestroyImageView(device, imageView, nullptr);
+		vkDestroyImage(device, image, nullptr);
+		vkFreeMemory(device, imageMemory, nullptr);
+	});
+
+	m_Image = VK_NULL_HANDLE;
+	m_ImageMemory = VK_NULL_HANDLE;
+	m_ImageView = VK_NULL_HANDLE;
+	m_MipViews.clear();
+	m_DescriptorSets.clear();
+}
+
+void HiZPyramid::CreateDescriptorSetLayout()
+{
+	const std::array<VkDescriptorSetLayoutBinding, 3> layoutBindings{
+		// depth buffer
+		inits::DescriptorSetLayoutBinding(
+			0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT),
+		// previous and current level
+		inits::DescriptorSetLayoutBinding(
+			1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT),
+		inits::DescriptorSetLayoutBinding(
+			2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT),
+	};
+
+	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
+	descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
+	descriptorSetLayoutInfo.pBindings = layoutBindings.data();
+
+	ErrCheck(vkCreateDescriptorSetLayout(
+				 m_Device->GetDevice(), &descriptorSetLayoutInfo, nullptr, &m_DescriptorSetLayout)
+				 != VK_SUCCESS,
+		"Failed to create hi-z descriptor set layout!");
+}
+
+void HiZPyramid::CreatePipeline(VkPipelineCache pipelineCache)
+{
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(HiZData);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &m_DescriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+	ErrCheck(vkCreatePipelineLayout(
+				 m_Device->GetDevice(), &pipelineLayoutInfo, nullptr, &m_PipelineLayout)
+				 != VK_SUCCESS,
+		"Failed to create hi-z pipeline layout!");
+
+	const Shader computeShader{ m_Device->GetDevice(),
+		"assets/shaders/out/hiz.comp.spv",
+		ShaderType::COMPUTE };
+
+	VkComputePipelineCreateInfo computePipelineInfo{};
+	computePipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	computePipelineInfo.stage = computeShader.GetShaderStage();
+	computePipelineInfo.layout = m_PipelineLayout;
+	ErrCheck(vkCreateComputePipelines(m_Device->GetDevice(),
+				 pipelineCache,
+				 1,
+				 &computePipelineInfo,
+				 nullptr,
+				 &m_Pipeline)
+				 != VK_SUCCESS,
+		"Failed to create hi-z pipeline!");
+}
+
+void HiZPyramid::CreateSampler()
+{
+	// only read with `texelFetch()`
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+	ErrCheck(
+		vkCreateSampler(m_Device->GetDevice(), &samplerInfo, nullptr, &m_Sampler) != VK_SUCCESS,
+		"Failed to create hi-z sampler!");
+}
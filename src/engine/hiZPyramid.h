@@ -0,0 +1,84 @@
+#pragma once
+
+#include <memory>
+#include <algorithm>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "engine/device.h"
+
+
+// mip chain of the farthest depth per texel, built from the msaa depth buffer with a compute shader
+// used by `GpuCulling` to test the bounds of the instances for occlusion
+// the image stays in `VK_IMAGE_LAYOUT_GENERAL`
+class HiZPyramid
+{
+public:
+	HiZPyramid(const std::unique_ptr<Device>& device,
+		VkDescriptorPool descriptorPool,
+		VkPipelineCache pipelineCache);
+	~HiZPyramid();
+	HiZPyramid(const HiZPyramid&) = delete;
+	HiZPyramid(HiZPyramid&&) = delete;
+	HiZPyramid& operator=(const HiZPyramid&) = delete;
+	HiZPyramid& operator=(HiZPyramid&&) = delete;
+
+	// the msaa depth buffer has to be sampleable
+	[[nodiscard]] static bool IsSupported(const std::unique_ptr<Device>& device);
+
+	// recreates the pyramid for a new depth buffer; the old one is destroyed once the frames that
+	// use it are done
+	// without a `depthView` (depth buffer not sampled by the render graph) it can't be built
+	void Resize(VkExtent2D extent, VkImageView depthView);
+
+	// transitions a new image into the general layout; recorded before anything reads it
+	void RecordLayoutTransition(VkCommandBuffer cmdBuff);
+	// the depth buffer has to be in `VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL`
+	void RecordBuild(VkCommandBuffer cmdBuff) const;
+
+	[[nodiscard]] inline VkImageView GetImageView() const { return m_ImageView; }
+	[[nodiscard]] inline VkSampler GetSampler() const { return m_Sampler; }
+	[[nodiscard]] inline VkExtent2D GetExtent() const { return m_Extent; }
+	[[nodiscard]] inline uint32_t GetMipCount() const { return m_MipCount; }
+
+private:
+	// push constants of hiz.comp
+	struct HiZData
+	{
+		int32_t srcWidth;
+		int32_t srcHeight;
+		int32_t dstWidth;
+		int32_t dstHeight;
+		int32_t level;
+		int32_t sampleCount;
+	};
+
+	void CreateImage();
+	void CreateDescriptorSets(VkImageView depthView);
+	void Retire();
+	void CreateDescriptorSetLayout();
+	void CreatePipeline(VkPipelineCache pipelineCache);
+	void CreateSampler();
+
+	[[nodiscard]] inline VkExtent2D GetMipExtent(uint32_t mip) const
+	{
+		return { std::max(m_Extent.width >> mip, 1u), std::max(m_Extent.height >> mip, 1u) };
+	}
+
+	const std::unique_ptr<Device>& m_Device;
+	VkDescriptorPool m_DescriptorPool;
+
+	VkExtent2D m_Extent{};
+	uint32_t m_MipCount = 0;
+	bool m_LayoutPending = false;
+
+	VkImage m_Image{};
+	VkDeviceMemory m_ImageMemory{};
+	VkImageView m_ImageView{}; // every mip, sampled by the culling
+	std::vector<VkImageView> m_MipViews; // one per mip, written by hiz.comp
+	std::vector<VkDescriptorSet> m_DescriptorSets; // one per mip, empty without a depth buffer
+
+	VkDescriptorSetLayout m_DescriptorSetLayout{};
+	VkPipelineLayout m_PipelineLayout{};
+	VkPipeline m_Pipeline{};
+	VkSampler m_Sampler{};
+};
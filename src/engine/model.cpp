@@ -1,5 +1,6 @@
 #include "engine/model.h"
 
+#include <limits>
 #include "assimp/Importer.hpp"
 #include "assimp/postprocess.h"
 #include "core/core.h"
@@ -15,19 +16,88 @@ Model::Model(const char* path, bool loadPbrTextures, bool flipUVs)
 	Logger::Info("Model loaded");
 }
 
-void Model::Draw(VkCommandBuffer activeCommandBuffer)
+void Model::Draw(VkCommandBuffer activeCommandBuffer,
+	VertexStream stream,
+	uint32_t firstInstance,
+	uint32_t instanceCount)
 {
+	const std::vector<VkBuffer>& vertexBuffers =
+		stream == VertexStream::POSITION ? m_PositionBuffers : m_VertexBuffers;
 	VkDeviceSize offset = 0;
 	// vertexCounts, indexCounts have the same size
 	for (uint64_t i = 0; i < m_VertexCounts.size(); ++i)
 	{
-		vkCmdBindVertexBuffers(activeCommandBuffer, 0, 1, &m_VertexBuffers[i], &offset);
+		vkCmdBindVertexBuffers(activeCommandBuffer, 0, 1, &vertexBuffers[i], &offset);
 		vkCmdBindIndexBuffer(activeCommandBuffer, m_IndexBuffers[i], 0, VK_INDEX_TYPE_UINT32);
 
-		vkCmdDrawIndexed(activeCommandBuffer, static_cast<uint32_t>(m_IndexCounts[i]), 1, 0, 0, 0);
+		vkCmdDrawIndexed(activeCommandBuffer,
+			static_cast<uint32_t>(m_IndexCounts[i]),
+			instanceCount,
+			0,
+			0,
+			firstInstance);
 	}
 }
 
+void Model::BindMesh(VkCommandBuffer activeCommandBuffer, uint32_t mesh, VertexStream stream)
+{
+	const VkBuffer vertexBuffer =
+		stream == VertexStream::POSITION ? m_PositionBuffers[mesh] : m_VertexBuffers[mesh];
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(activeCommandBuffer, 0, 1, &vertexBuffer, &offset);
+	vkCmdBindIndexBuffer(activeCommandBuffer, m_IndexBuffers[mesh], 0, VK_INDEX_TYPE_UINT32);
+}
+
+void Model::DrawMesh(VkCommandBuffer activeCommandBuffer,
+	uint32_t mesh,
+	uint32_t firstInstance,
+	uint32_t instanceCount)
+{
+	vkCmdDrawIndexed(activeCommandBuffer,
+		static_cast<uint32_t>(m_IndexCounts[mesh]),
+		instanceCount,
+		0,
+		0,
+		firstInstance);
+}
+
+void Model::DrawIndirectCount(VkCommandBuffer activeCommandBuffer,
+	VkBuffer commandBuffer,
+	VkDeviceSize commandOffset,
+	VkBuffer countBuffer,
+	VkDeviceSize countOffset,
+	uint32_t maxDrawsPerMesh,
+	VertexStream stream)
+{
+	const std::vector<VkBuffer>& vertexBuffers =
+		stream == VertexStream::POSITION ? m_PositionBuffers : m_VertexBuffers;
+	VkDeviceSize offset = 0;
+	for (uint64_t i = 0; i < m_VertexCounts.size(); ++i)
+	{
+		vkCmdBindVertexBuffers(activeCommandBuffer, 0, 1, &vertexBuffers[i], &offset);
+		vkCmdBindIndexBuffer(activeCommandBuffer, m_IndexBuffers[i], 0, VK_INDEX_TYPE_UINT32);
+
+		vkCmdDrawIndexedIndirectCount(activeCommandBuffer,
+			commandBuffer,
+			commandOffset + i * maxDrawsPerMesh * sizeof(VkDrawIndexedIndirectCommand),
+			countBuffer,
+			countOffset + i * sizeof(uint32_t),
+			maxDrawsPerMesh,
+			sizeof(VkDrawIndexedIndirectCommand));
+	}
+}
+
+glm::vec4 Model::GetBoundingSphere() const
+{
+	// around the center of the model's AABB, enclosing the spheres of all meshes
+	const glm::vec3 center = (m_AabbMin + m_AabbMax) * 0.5f;
+	float radius = 0.0f;
+	for (const auto& sphere : m_BoundingSpheres)
+		radius = glm::max(radius, glm::length(glm::vec3(sphere) - center) + sphere.w);
+
+	return glm::vec4{ center, radius };
+}
+
 void Model::Cleanup(VkDevice deviceVk)
 {
 	for (uint64_t i = 0; i < m_VertexCounts.size(); ++i)
@@ -36,6 +106,8 @@ void Model::Cleanup(VkDevice deviceVk)
 		vkDestroyBuffer(deviceVk, m_VertexBuffers[i], nullptr);
 		vkFreeMemory(deviceVk, m_IndexBufferMems[i], nullptr);
 		vkFreeMemory(deviceVk, m_VertexBufferMems[i], nullptr);
+		vkDestroyBuffer(deviceVk, m_PositionBuffers[i], nullptr);
+		vkFreeMemory(deviceVk, m_PositionBufferMems[i], nullptr);
 	}
 }
 
@@ -97,6 +169,22 @@ void Model::ProcessMesh(aiMesh* mesh, const aiScene* scene)
 		vertices.push_back(vertex);
 	}
 
+	// bounding sphere around the center of the mesh's AABB
+	glm::vec3 minPos{ std::numeric_limits<float>::max() };
+	glm::vec3 maxPos{ std::numeric_limits<float>::lowest() };
+	for (const auto& vertex : vertices)
+	{
+		minPos = glm::min(minPos, vertex.pos);
+		maxPos = glm::max(maxPos, vertex.pos);
+	}
+	const glm::vec3 center = (minPos + maxPos) * 0.5f;
+	float radius = 0.0f;
+	for (const auto& vertex : vertices)
+		radius = glm::max(radius, glm::length(vertex.pos - center));
+	m_BoundingSpheres.emplace_back(center, radius);
+	m_AabbMin = glm::min(m_AabbMin, minPos);
+	m_AabbMax = glm::max(m_AabbMax, maxPos);
+
 	VkBuffer vertexBuffer = nullptr;
 	VkDeviceMemory vertexBufferMemory = nullptr;
 	Engine::CreateVertexBuffer(vertices, vertexBuffer, vertexBufferMemory);
@@ -104,6 +192,16 @@ void Model::ProcessMesh(aiMesh* mesh, const aiScene* scene)
 	m_VertexBufferMems.push_back(vertexBufferMemory);
 	m_VertexCounts.push_back(vertices.size());
 
+	// the depth pre-pass reads about a quarter of the data per vertex
+	std::vector<glm::vec3> positions(vertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i)
+		positions[i] = vertices[i].pos;
+	VkBuffer positionBuffer = nullptr;
+	VkDeviceMemory positionBufferMemory = nullptr;
+	Engine::CreateVertexBuffer(positions, positionBuffer, positionBufferMemory);
+	m_PositionBuffers.push_back(positionBuffer);
+	m_PositionBufferMems.push_back(positionBufferMemory);
+
 	// process indices
 	for (uint32_t i = 0; i < mesh->mNumFaces; ++i)
 	{
@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <string>
+#include <limits>
 #include <unordered_map>
 #include <vulkan/vulkan.h>
 #include "assimp/scene.h"
@@ -11,9 +12,40 @@
 class Model
 {
 public:
+	// the vertex buffers a draw binds
+	enum class VertexStream
+	{
+		ALL = 0, // `Vertex`
+		POSITION, // positions only, for the depth pre-pass
+	};
+
 	explicit Model(const char* path, bool loadPbrTextures = true, bool flipUVs = false);
 
-	void Draw(VkCommandBuffer activeCommandBuffer);
+	// one draw per mesh for the whole instance range; instanced shaders read the instance's data
+	// with `gl_InstanceIndex`, which starts at `firstInstance`
+	void Draw(VkCommandBuffer activeCommandBuffer,
+		VertexStream stream = VertexStream::ALL,
+		uint32_t firstInstance = 0,
+		uint32_t instanceCount = 1);
+	// binds the vertex and index buffers of one mesh, `DrawMesh()` then draws it; draws of the
+	// same mesh in a row only bind once
+	void BindMesh(VkCommandBuffer activeCommandBuffer,
+		uint32_t mesh,
+		VertexStream stream = VertexStream::ALL);
+	void DrawMesh(VkCommandBuffer activeCommandBuffer,
+		uint32_t mesh,
+		uint32_t firstInstance = 0,
+		uint32_t instanceCount = 1);
+	// draws the commands of every mesh with `vkCmdDrawIndexedIndirectCount()`
+	// mesh `i` reads up to `maxDrawsPerMesh` commands from `i * maxDrawsPerMesh` and its count
+	// from the `i`th `uint32_t` of `countBuffer`, both after their offset
+	void DrawIndirectCount(VkCommandBuffer activeCommandBuffer,
+		VkBuffer commandBuffer,
+		VkDeviceSize commandOffset,
+		VkBuffer countBuffer,
+		VkDeviceSize countOffset,
+		uint32_t maxDrawsPerMesh,
+		VertexStream stream = VertexStream::ALL);
 	void Cleanup(VkDevice deviceVk);
 
 	// [[nodiscard]] inline std::pair<std::vector<Vertex>, std::vector<uint32_t>> GetModelData()
@@ -39,6 +71,24 @@ public:
 		return m_LoadedTextures;
 	}
 
+	[[nodiscard]] inline uint32_t GetMeshCount() const
+	{
+		return static_cast<uint32_t>(m_IndexCounts.size());
+	}
+	[[nodiscard]] inline const std::vector<uint64_t>& GetIndexCounts() const
+	{
+		return m_IndexCounts;
+	}
+	// model space; xyz center, w radius
+	[[nodiscard]] inline const std::vector<glm::vec4>& GetBoundingSpheres() const
+	{
+		return m_BoundingSpheres;
+	}
+	// model space, around all meshes
+	[[nodiscard]] inline const glm::vec3& GetAabbMin() const { return m_AabbMin; }
+	[[nodiscard]] inline const glm::vec3& GetAabbMax() const { return m_AabbMax; }
+	[[nodiscard]] glm::vec4 GetBoundingSphere() const;
+
 
 private:
 	void LoadModel(const std::string& path, bool flipUVs);
@@ -53,8 +103,13 @@ private:
 	std::vector<uint64_t> m_IndexCounts;
 	std::vector<VkBuffer> m_VertexBuffers;
 	std::vector<VkDeviceMemory> m_VertexBufferMems;
+	std::vector<VkBuffer> m_PositionBuffers;
+	std::vector<VkDeviceMemory> m_PositionBufferMems;
 	std::vector<VkBuffer> m_IndexBuffers;
 	std::vector<VkDeviceMemory> m_IndexBufferMems;
+	std::vector<glm::vec4> m_BoundingSpheres; // per mesh
+	glm::vec3 m_AabbMin{ std::numeric_limits<float>::max() };
+	glm::vec3 m_AabbMax{ std::numeric_limits<float>::lowest() };
 
 	std::vector<std::string> m_LoadedTextures;
 };
\ No newline at end of file
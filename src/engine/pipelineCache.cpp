@@ -0,0 +1,186 @@
+#include "engine/pipelineCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include "core/core.h"
+
+
+// "VPCF" and the file layout version
+constexpr uint32_t g_PipelineCacheMagic = 0x46435056;
+constexpr uint32_t g_PipelineCacheVersion = 1;
+
+// FNV-1a, catches files that were cut short or overwritten
+static uint64_t HashData(const std::vector<char>& data)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (const char byte : data)
+	{
+		hash ^= static_cast<uint8_t>(byte);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+PipelineCache::PipelineCache(const std::unique_ptr<Device>& device, std::string path)
+	: m_Device{ device },
+	  m_Path{ std::move(path) }
+{
+	m_LoadedData = Load();
+	m_Cache = CreateCache(m_LoadedData);
+}
+
+PipelineCache::~PipelineCache()
+{
+	for (const auto& workerCache : m_WorkerCaches)
+		vkDestroyPipelineCache(m_Device->GetDevice(), workerCache, nullptr);
+	vkDestroyPipelineCache(m_Device->GetDevice(), m_Cache, nullptr);
+}
+
+void PipelineCache::CreateWorkerCaches(uint32_t count)
+{
+	m_WorkerCaches.reserve(m_WorkerCaches.size() + count);
+	for (uint32_t i = 0; i < count; ++i)
+		m_WorkerCaches.push_back(CreateCache(m_LoadedData));
+}
+
+void PipelineCache::MergeWorkerCaches()
+{
+	if (m_WorkerCaches.empty())
+		return;
+
+	ErrCheck(vkMergePipelineCaches(m_Device->GetDevice(),
+				 m_Cache,
+				 static_cast<uint32_t>(m_WorkerCaches.size()),
+				 m_WorkerCaches.data())
+				 != VK_SUCCESS,
+		"Failed to merge pipeline caches!");
+
+	for (const auto& workerCache : m_WorkerCaches)
+		vkDestroyPipelineCache(m_Device->GetDevice(), workerCache, nullptr);
+	m_WorkerCaches.clear();
+}
+
+void PipelineCache::Save() const
+{
+	size_t dataSize = 0;
+	ErrCheck(vkGetPipelineCacheData(m_Device->GetDevice(), m_Cache, &dataSize, nullptr)
+				 != VK_SUCCESS,
+		"Failed to get pipeline cache data!");
+	std::vector<char> data(dataSize);
+	ErrCheck(vkGetPipelineCacheData(m_Device->GetDevice(), m_Cache, &dataSize, data.data())
+				 != VK_SUCCESS,
+		"Failed to get pipeline cache data!");
+	data.resize(dataSize);
+
+	// written next to the old file and moved over it, so a crash while writing leaves the old
+	// cache intact
+	const std::string tempPath = m_Path + ".tmp";
+	{
+		std::ofstream file{ tempPath, std::ios::binary | std::ios::trunc };
+		if (!file.is_open())
+		{
+			Logger::Warn("Unable to write pipeline cache \"{}\"", tempPath);
+			return;
+		}
+
+		const FileHeader header = MakeHeader(data);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(data.data(), static_cast<std::streamsize>(data.size()));
+		if (!file.good())
+		{
+			Logger::Warn("Unable to write pipeline cache \"{}\"", tempPath);
+			return;
+		}
+	}
+
+	// rename doesn't replace an existing file on every platform
+	std::remove(m_Path.c_str());
+	if (std::rename(tempPath.c_str(), m_Path.c_str()) != 0)
+	{
+		Logger::Warn("Unable to write pipeline cache \"{}\"", m_Path);
+		return;
+	}
+
+	Logger::Info("Saved pipeline cache \"{}\" ({} KiB)", m_Path, data.size() / 1024);
+}
+
+PipelineCache::FileHeader PipelineCache::MakeHeader(const std::vector<char>& data) const
+{
+	const VkPhysicalDeviceProperties properties = m_Device->GetDeviceProperties();
+
+	FileHeader header{};
+	header.magic = g_PipelineCacheMagic;
+	header.version = g_PipelineCacheVersion;
+	header.vendorID = properties.vendorID;
+	header.deviceID = properties.deviceID;
+	header.driverVersion = properties.driverVersion;
+	std::memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+	header.dataSize = data.size();
+	header.dataHash = HashData(data);
+	return header;
+}
+
+std::vector<char> PipelineCache::Load() const
+{
+	std::ifstream file{ m_Path, std::ios::binary | std::ios::ate };
+	if (!file.is_open())
+	{
+		Logger::Info("No pipeline cache \"{}\", the pipelines are compiled from scratch", m_Path);
+		return {};
+	}
+
+	const auto fileSize = static_cast<size_t>(file.tellg());
+	FileHeader header{};
+	std::vector<char> data;
+	if (fileSize >= sizeof(header))
+	{
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+		data.resize(fileSize - sizeof(header));
+		file.read(data.data(), static_cast<std::streamsize>(data.size()));
+	}
+
+	const FileHeader expected = MakeHeader(data);
+	if (!file.good() || header.magic != expected.magic || header.version != expected.version
+		|| header.dataSize != expected.dataSize || header.dataHash != expected.dataHash)
+	{
+		Logger::Warn("Pipeline cache \"{}\" is corrupt, it is rebuilt", m_Path);
+		return {};
+	}
+
+	// a driver update invalidates the compiled pipelines; the header of the driver's data repeats
+	// the device, a cache of another device is not handed to the driver either
+	VkPipelineCacheHeaderVersionOne driverHeader{};
+	if (data.size() >= sizeof(driverHeader))
+		std::memcpy(&driverHeader, data.data(), sizeof(driverHeader));
+	if (header.vendorID != expected.vendorID || header.deviceID != expected.deviceID
+		|| header.driverVersion != expected.driverVersion
+		|| std::memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0
+		|| driverHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+		|| driverHeader.vendorID != expected.vendorID || driverHeader.deviceID != expected.deviceID
+		|| std::memcmp(driverHeader.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE)
+			   != 0)
+	{
+		Logger::Info("Pipeline cache \"{}\" was written by another device or driver, it is rebuilt",
+			m_Path);
+		return {};
+	}
+
+	Logger::Info("Loaded pipeline cache \"{}\" ({} KiB)", m_Path, data.size() / 1024);
+	return data;
+}
+
+VkPipelineCache PipelineCache::CreateCache(const std::vector<char>& initialData) const
+{
+	VkPipelineCacheCreateInfo cacheInfo{};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.initialDataSize = initialData.size();
+	cacheInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+	VkPipelineCache cache{};
+	ErrCheck(
+		vkCreatePipelineCache(m_Device->GetDevice(), &cacheInfo, nullptr, &cache) != VK_SUCCESS,
+		"Failed to create pipeline cache!");
+	return cache;
+}
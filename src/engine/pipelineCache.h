@@ -0,0 +1,69 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "engine/device.h"
+
+
+// `VkPipelineCache` that is kept on disk between runs
+// the file starts with the device and driver that wrote it; the data of another device or driver
+// is dropped instead of handed to the driver
+// pipelines created on several threads use a worker cache each, merged into the main cache
+// afterwards, so the threads don't contend for the lock of one cache
+class PipelineCache
+{
+public:
+	// loads the cache from `path` if it is there and valid
+	PipelineCache(const std::unique_ptr<Device>& device, std::string path);
+	~PipelineCache();
+	PipelineCache(const PipelineCache&) = delete;
+	PipelineCache(PipelineCache&&) = delete;
+	PipelineCache& operator=(const PipelineCache&) = delete;
+	PipelineCache& operator=(PipelineCache&&) = delete;
+
+	[[nodiscard]] inline VkPipelineCache Get() const { return m_Cache; }
+	// the cache was loaded from disk
+	[[nodiscard]] inline bool IsWarm() const { return !m_LoadedData.empty(); }
+
+	// one cache per job that creates pipelines at the same time as the others; every worker
+	// cache starts with the data loaded from disk
+	void CreateWorkerCaches(uint32_t count);
+	[[nodiscard]] inline VkPipelineCache GetWorkerCache(uint32_t index) const
+	{
+		return m_WorkerCaches[index];
+	}
+	// once the jobs are done; destroys the worker caches
+	void MergeWorkerCaches();
+
+	// writes the main cache to the file it was loaded from
+	void Save() const;
+
+private:
+	// precedes the `vkGetPipelineCacheData()` data in the file
+	struct FileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint32_t driverVersion;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+		uint64_t dataSize;
+		uint64_t dataHash;
+	};
+
+	[[nodiscard]] FileHeader MakeHeader(const std::vector<char>& data) const;
+	// the cache data of the file, empty if it is missing or was not written by this device and
+	// driver
+	[[nodiscard]] std::vector<char> Load() const;
+	[[nodiscard]] VkPipelineCache CreateCache(const std::vector<char>& initialData) const;
+
+	const std::unique_ptr<Device>& m_Device;
+	std::string m_Path;
+
+	std::vector<char> m_LoadedData;
+	VkPipelineCache m_Cache{};
+	std::vector<VkPipelineCache> m_WorkerCaches;
+};
@@ -0,0 +1,598 @@
+#include "engine/pipelineStateCache.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <vector>
+#include "core/core.h"
+#include "engine/initializers.h"
+#include "engine/types.h"
+
+
+template<typename T>
+static void HashCombine(size_t& seed, const T& value)
+{
+	seed ^= std::hash<T>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+bool GraphicsPipelineDesc::operator==(const GraphicsPipelineDesc& other) const
+{
+	return vertShader == other.vertShader && fragShader == other.fragShader
+		   && vertexLayout == other.vertexLayout && topology == other.topology
+		   && cullMode == other.cullMode && frontFace == other.frontFace
+		   && depthTest == other.depthTest && depthWrite == other.depthWrite
+		   && depthCompareOp == other.depthCompareOp && blendEnable == other.blendEnable
+		   && colorWriteMask == other.colorWriteMask && samples == other.samples
+		   && sampleShading == other.sampleShading && minSampleShading == other.minSampleShading
+		   && layout == other.layout && renderPass == other.renderPass && subpass == other.subpass;
+}
+
+size_t GraphicsPipelineDesc::Hash() const
+{
+	size_t hash = 0;
+	for (const ShaderPermutation* shader : { &vertShader, &fragShader })
+	{
+		HashCombine(hash, shader->name);
+		HashCombine(hash, static_cast<uint32_t>(shader->type));
+		HashCombine(hash, shader->features);
+	}
+	HashCombine(hash, static_cast<uint32_t>(vertexLayout));
+	HashCombine(hash, static_cast<uint32_t>(topology));
+	HashCombine(hash, static_cast<uint32_t>(cullMode));
+	HashCombine(hash, static_cast<uint32_t>(frontFace));
+	HashCombine(hash, depthTest);
+	HashCombine(hash, depthWrite);
+	HashCombine(hash, static_cast<uint32_t>(depthCompareOp));
+	HashCombine(hash, blendEnable);
+	HashCombine(hash, static_cast<uint32_t>(colorWriteMask));
+	HashCombine(hash, static_cast<uint32_t>(samples));
+	HashCombine(hash, sampleShading);
+	HashCombine(hash, minSampleShading);
+	HashCombine(hash, layout);
+	HashCombine(hash, renderPass);
+	HashCombine(hash, subpass);
+	return hash;
+}
+
+PipelineStateCache::~PipelineStateCache()
+{
+	m_JobSystem.Wait(m_CompileCounter);
+	for (const auto& entry : m_Entries)
+	{
+		if (entry->pipeline != VK_NULL_HANDLE)
+			vkDestroyPipeline(m_Device->GetDevice(), entry->pipeline, nullptr);
+	}
+	for (const auto& libraries : m_Libraries)
+	{
+		for (const auto& [key, library] : libraries)
+			vkDestroyPipeline(m_Device->GetDevice(), library, nullptr);
+	}
+}
+
+PipelineStateCache::PipelineId PipelineStateCache::Create(const GraphicsPipelineDesc& desc,
+	VkPipelineCache pipelineCache)
+{
+	const auto [id, isNew] = Insert(desc);
+	Entry& entry = GetEntry(id);
+	if (isNew)
+		CompileEntry(entry, pipelineCache);
+
+	// rethrows the error of the compilation
+	entry.ready.get();
+	return id;
+}
+
+PipelineStateCache::PipelineId PipelineStateCache::CreateAsync(const GraphicsPipelineDesc& desc,
+	VkPipelineCache pipelineCache)
+{
+	const auto [id, isNew] = Insert(desc);
+	if (isNew)
+	{
+		Entry* entry = &GetEntry(id);
+		m_JobSystem.Run([this, entry, pipelineCache]() { CompileEntry(*entry, pipelineCache); },
+			&m_CompileCounter);
+	}
+	return id;
+}
+
+uint32_t PipelineStateCache::Reload(const std::vector<std::string>& shaderNames,
+	VkPipelineCache pipelineCache)
+{
+	const auto usesShader = [&shaderNames](const ShaderPermutation& shader) {
+		return !shader.IsEmpty()
+			   && std::find(shaderNames.begin(), shaderNames.end(), shader.name)
+					  != shaderNames.end();
+	};
+
+	// a pipeline that is still compiling for the first time reads the sources when it gets to
+	// them, it isn't reloaded
+	std::vector<Entry*> entries;
+	{
+		const std::lock_guard<std::mutex> lock{ m_Mutex };
+		for (const auto& entry : m_Entries)
+		{
+			const bool isCompiled =
+				entry->ready.wait_for(std::chrono::seconds{ 0 }) == std::future_status::ready;
+			const bool usesChangedShader =
+				usesShader(entry->desc.vertShader) || usesShader(entry->desc.fragShader);
+			if (isCompiled && usesChangedShader)
+				entries.push_back(entry.get());
+		}
+	}
+
+	for (Entry* entry : entries)
+	{
+		++m_PendingCount;
+		m_JobSystem.Run(
+			[this, entry, pipelineCache]() {
+				try
+				{
+					const VkPipeline pipeline = Compile(entry->desc, pipelineCache);
+					VkPipeline oldPipeline = VK_NULL_HANDLE;
+					uint64_t generation = 0;
+					{
+						const std::lock_guard<std::mutex> lock{ entry->swapMutex };
+						oldPipeline = entry->pipeline.exchange(pipeline);
+						generation = ++entry->generation;
+					}
+					if (oldPipeline != VK_NULL_HANDLE)
+						m_Retire(oldPipeline);
+					QueueOptimize(*entry, generation, pipelineCache);
+				}
+				catch (const std::exception& e)
+				{
+					Logger::Error("Failed to reload the pipeline of \"{}\", the old one stays: {}",
+						entry->desc.vertShader.GetSourcePath(),
+						e.what());
+				}
+				--m_PendingCount;
+			},
+			&m_CompileCounter);
+	}
+	return static_cast<uint32_t>(entries.size());
+}
+
+VkPipeline PipelineStateCache::TryGet(PipelineId id)
+{
+	if (id == INVALID_ID)
+		return VK_NULL_HANDLE;
+	return GetEntry(id).pipeline.load();
+}
+
+std::pair<PipelineStateCache::PipelineId, bool> PipelineStateCache::Insert(
+	const GraphicsPipelineDesc& desc)
+{
+	const std::lock_guard<std::mutex> lock{ m_Mutex };
+	const auto [it, isNew] = m_Ids.emplace(desc, static_cast<PipelineId>(m_Entries.size()));
+	if (isNew)
+	{
+		m_Entries.push_back(std::make_unique<Entry>(desc));
+		++m_PendingCount;
+	}
+	return { it->second, isNew };
+}
+
+PipelineStateCache::Entry& PipelineStateCache::GetEntry(PipelineId id)
+{
+	// the vector may grow on another thread, the entry itself stays where it is
+	const std::lock_guard<std::mutex> lock{ m_Mutex };
+	return *m_Entries[id];
+}
+
+void PipelineStateCache::CompileEntry(Entry& entry, VkPipelineCache pipelineCache)
+{
+	try
+	{
+		const VkPipeline pipeline = Compile(entry.desc, pipelineCache);
+		// the first generation; nothing reloads the entry before it is compiled
+		entry.pipeline = pipeline;
+		entry.compiled.set_value();
+		QueueOptimize(entry, 0, pipelineCache);
+	}
+	catch (const std::exception& e)
+	{
+		Logger::Error("Failed to compile the pipeline of \"{}\": {}",
+			entry.desc.vertShader.GetSpirvPath(),
+			e.what());
+		entry.compiled.set_exception(std::current_exception());
+	}
+	--m_PendingCount;
+}
+
+// the fixed function state of a description; `Fill()` points a create info into the object, so
+// it has to outlive the pipeline creation
+class FixedFunctionState
+{
+public:
+	explicit FixedFunctionState(const GraphicsPipelineDesc& desc) : m_Desc{ desc }
+	{
+		// vertex descriptions
+		const bool positionOnly =
+			desc.vertexLayout == GraphicsPipelineDesc::VertexLayout::POSITION;
+		m_VertexBindingDesc = positionOnly ? Vertex::GetPositionBindingDescription()
+										   : Vertex::GetBindingDescription();
+		m_VertexAttrDesc = Vertex::GetAttributeDescription();
+		m_PositionAttrDesc = Vertex::GetPositionAttributeDescription();
+
+		// fixed functions
+		m_VertexInputInfo = inits::PipelineVertexInputStateCreateInfo(1,
+			&m_VertexBindingDesc,
+			positionOnly ? 1 : static_cast<uint32_t>(m_VertexAttrDesc.size()),
+			positionOnly ? &m_PositionAttrDesc : m_VertexAttrDesc.data());
+		m_InputAssemblyInfo = inits::PipelineInputAssemblyStateCreateInfo(desc.topology);
+		m_ViewportStateInfo = inits::PipelineViewportStateCreateInfo(1, 1);
+		m_RasterizationStateInfo =
+			inits::PipelineRasterizationStateCreateInfo(desc.cullMode, desc.frontFace);
+		m_MultisampleStateInfo = inits::PipelineMultisampleStateCreateInfo(
+			desc.sampleShading ? VK_TRUE : VK_FALSE, desc.samples, desc.minSampleShading);
+		m_DepthStencilStateInfo =
+			inits::PipelineDepthStencilStateCreateInfo(desc.depthTest ? VK_TRUE : VK_FALSE,
+				desc.depthWrite ? VK_TRUE : VK_FALSE,
+				desc.depthCompareOp);
+
+		// depth only pipelines write no color
+		m_ColorBlendAttachment.colorWriteMask = desc.fragShader.IsEmpty() ? 0 : desc.colorWriteMask;
+		m_ColorBlendAttachment.blendEnable = desc.blendEnable ? VK_TRUE : VK_FALSE;
+		// premultiplied alpha over
+		m_ColorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+		m_ColorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+		m_ColorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+		m_ColorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		m_ColorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+		m_ColorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+		m_ColorBlendStateInfo = inits::PipelineColorBlendStateCreateInfo(m_ColorBlendAttachment);
+
+		// dynamic states
+		m_DynamicStateInfo = inits::PipelineDynamicStateCreateInfo(
+			static_cast<uint32_t>(m_DynamicStates.size()), m_DynamicStates.data());
+	}
+	FixedFunctionState(const FixedFunctionState&) = delete;
+	FixedFunctionState(FixedFunctionState&&) = delete;
+	FixedFunctionState& operator=(const FixedFunctionState&) = delete;
+	FixedFunctionState& operator=(FixedFunctionState&&) = delete;
+
+	// everything but the stages; a library only reads the state of its parts
+	void Fill(VkGraphicsPipelineCreateInfo& info) const
+	{
+		info.pVertexInputState = &m_VertexInputInfo;
+		info.pInputAssemblyState = &m_InputAssemblyInfo;
+		info.pViewportState = &m_ViewportStateInfo;
+		info.pRasterizationState = &m_RasterizationStateInfo;
+		info.pMultisampleState = &m_MultisampleStateInfo;
+		info.pDepthStencilState = &m_DepthStencilStateInfo;
+		info.pColorBlendState = &m_ColorBlendStateInfo;
+		info.pDynamicState = &m_DynamicStateInfo;
+		info.layout = m_Desc.layout;
+		info.renderPass = m_Desc.renderPass;
+		info.subpass = m_Desc.subpass;
+		info.basePipelineHandle = VK_NULL_HANDLE;
+		info.basePipelineIndex = -1;
+	}
+
+private:
+	const GraphicsPipelineDesc& m_Desc;
+
+	VkVertexInputBindingDescription m_VertexBindingDesc{};
+	decltype(Vertex::GetAttributeDescription()) m_VertexAttrDesc{};
+	VkVertexInputAttributeDescription m_PositionAttrDesc{};
+
+	VkPipelineVertexInputStateCreateInfo m_VertexInputInfo{};
+	VkPipelineInputAssemblyStateCreateInfo m_InputAssemblyInfo{};
+	VkPipelineViewportStateCreateInfo m_ViewportStateInfo{};
+	VkPipelineRasterizationStateCreateInfo m_RasterizationStateInfo{};
+	VkPipelineMultisampleStateCreateInfo m_MultisampleStateInfo{};
+	VkPipelineDepthStencilStateCreateInfo m_DepthStencilStateInfo{};
+	VkPipelineColorBlendAttachmentState m_ColorBlendAttachment{};
+	VkPipelineColorBlendStateCreateInfo m_ColorBlendStateInfo{};
+	std::array<VkDynamicState, 2> m_DynamicStates{ VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo m_DynamicStateInfo{};
+};
+
+static VkPipelineShaderStageCreateInfo GetShaderStage(VkShaderStageFlagBits stage,
+	const VkSpecializationInfo* specialization)
+{
+	VkPipelineShaderStageCreateInfo shaderStage{};
+	shaderStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStage.stage = stage;
+	shaderStage.pName = "main";
+	shaderStage.pSpecializationInfo = specialization;
+	return shaderStage;
+}
+
+VkPipeline PipelineStateCache::Compile(const GraphicsPipelineDesc& desc,
+	VkPipelineCache pipelineCache)
+{
+#if defined(VK_EXT_graphics_pipeline_library)
+	if (m_Device->IsGraphicsPipelineLibraryEnabled())
+		return Link(desc, pipelineCache, false);
+#endif
+
+	// shader stages, specialized with their runtime features; depth only pipelines have no
+	// fragment shader
+	const ShaderSpecialization vertSpecialization{ desc.vertShader.features };
+	const ShaderSpecialization fragSpecialization{ desc.fragShader.features };
+	const uint32_t stageCount = desc.fragShader.IsEmpty() ? 1 : 2;
+	const std::array<SpirvView, 2> spirv{ m_ShaderCompiler.GetSpirv(desc.vertShader),
+		stageCount > 1 ? m_ShaderCompiler.GetSpirv(desc.fragShader) : SpirvView{} };
+	std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages{
+		GetShaderStage(VK_SHADER_STAGE_VERTEX_BIT, vertSpecialization.Get()),
+		GetShaderStage(VK_SHADER_STAGE_FRAGMENT_BIT, fragSpecialization.Get())
+	};
+
+	const FixedFunctionState state{ desc };
+	VkGraphicsPipelineCreateInfo graphicsPipelineInfo{};
+	graphicsPipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	graphicsPipelineInfo.stageCount = stageCount;
+	graphicsPipelineInfo.pStages = shaderStages.data();
+	state.Fill(graphicsPipelineInfo);
+
+	VkPipeline pipeline{};
+#if defined(VK_EXT_shader_module_identifier)
+	// the stages whose modules were not created yet are looked up in the pipeline cache by their
+	// module identifiers; the pipeline fails instead of compiling if it is not in there
+	std::array<VkPipelineShaderStageModuleIdentifierCreateInfoEXT, 2> identifierInfos{};
+	bool usesIdentifiers = false;
+	for (uint32_t i = 0; i < stageCount; ++i)
+	{
+		const ShaderModuleIdentifier identifier = m_ShaderModules.GetIdentifier(spirv[i]);
+		if (identifier.IsEmpty())
+		{
+			shaderStages[i].module = m_ShaderModules.GetModule(spirv[i]);
+			continue;
+		}
+
+		identifierInfos[i].sType =
+			VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_MODULE_IDENTIFIER_CREATE_INFO_EXT;
+		identifierInfos[i].identifierSize = identifier.size;
+		identifierInfos[i].pIdentifier = identifier.data;
+		shaderStages[i].pNext = &identifierInfos[i];
+		usesIdentifiers = true;
+	}
+
+	if (usesIdentifiers)
+	{
+		graphicsPipelineInfo.flags = VK_PIPELINE_CREATE_FAIL_ON_PIPELINE_COMPILE_REQUIRED_BIT_EXT;
+		const VkResult result = vkCreateGraphicsPipelines(
+			m_Device->GetDevice(), pipelineCache, 1, &graphicsPipelineInfo, nullptr, &pipeline);
+		if (result == VK_SUCCESS)
+		{
+			++m_IdentifierPipelineCount;
+			return pipeline;
+		}
+		ErrCheck(result != VK_PIPELINE_COMPILE_REQUIRED_EXT, "Failed to create graphics pipeline!");
+
+		// not in the pipeline cache, compiled from the modules
+		graphicsPipelineInfo.flags = 0;
+		for (uint32_t i = 0; i < stageCount; ++i)
+			shaderStages[i].pNext = nullptr;
+	}
+#endif
+
+	for (uint32_t i = 0; i < stageCount; ++i)
+		shaderStages[i].module = m_ShaderModules.GetModule(spirv[i]);
+	ErrCheck(vkCreateGraphicsPipelines(m_Device->GetDevice(),
+				 pipelineCache,
+				 1,
+				 &graphicsPipelineInfo,
+				 nullptr,
+				 &pipeline)
+				 != VK_SUCCESS,
+		"Failed to create graphics pipeline!");
+	return pipeline;
+}
+
+GraphicsPipelineDesc PipelineStateCache::GetLibraryDesc(const GraphicsPipelineDesc& desc,
+	LibraryPart part)
+{
+	// only what the part is created from, so the pipelines that share a part share its library
+	GraphicsPipelineDesc partDesc{};
+	switch (part)
+	{
+	case LibraryPart::VERTEX_INPUT:
+		partDesc.vertexLayout = desc.vertexLayout;
+		partDesc.topology = desc.topology;
+		break;
+	case LibraryPart::PRE_RASTERIZATION:
+		partDesc.vertShader = desc.vertShader;
+		partDesc.cullMode = desc.cullMode;
+		partDesc.frontFace = desc.frontFace;
+		partDesc.layout = desc.layout;
+		partDesc.renderPass = desc.renderPass;
+		partDesc.subpass = desc.subpass;
+		break;
+	case LibraryPart::FRAGMENT_SHADER:
+		partDesc.fragShader = desc.fragShader;
+		partDesc.depthTest = desc.depthTest;
+		partDesc.depthWrite = desc.depthWrite;
+		partDesc.depthCompareOp = desc.depthCompareOp;
+		partDesc.samples = desc.samples;
+		partDesc.sampleShading = desc.sampleShading;
+		partDesc.minSampleShading = desc.minSampleShading;
+		partDesc.layout = desc.layout;
+		partDesc.renderPass = desc.renderPass;
+		partDesc.subpass = desc.subpass;
+		break;
+	case LibraryPart::FRAGMENT_OUTPUT:
+		partDesc.blendEnable = desc.blendEnable;
+		partDesc.colorWriteMask = desc.fragShader.IsEmpty() ? 0 : desc.colorWriteMask;
+		partDesc.samples = desc.samples;
+		partDesc.sampleShading = desc.sampleShading;
+		partDesc.minSampleShading = desc.minSampleShading;
+		partDesc.renderPass = desc.renderPass;
+		partDesc.subpass = desc.subpass;
+		break;
+	}
+	return partDesc;
+}
+
+#if defined(VK_EXT_graphics_pipeline_library)
+VkPipeline PipelineStateCache::GetLibrary(const GraphicsPipelineDesc& desc,
+	LibraryPart part,
+	VkPipelineCache pipelineCache)
+{
+	// the code of the shader is part of the key, so a reloaded shader gets a new library
+	SpirvView spirv{};
+	if (part == LibraryPart::PRE_RASTERIZATION)
+		spirv = m_ShaderCompiler.GetSpirv(desc.vertShader);
+	else if (part == LibraryPart::FRAGMENT_SHADER && !desc.fragShader.IsEmpty())
+		spirv = m_ShaderCompiler.GetSpirv(desc.fragShader);
+
+	const LibraryKey key{ GetLibraryDesc(desc, part), ShaderModuleCache::Hash(spirv) };
+	auto& libraries = m_Libraries[static_cast<size_t>(part)];
+	{
+		const std::lock_guard<std::mutex> lock{ m_LibraryMutex };
+		const auto it = libraries.find(key);
+		if (it != libraries.end())
+			return it->second;
+	}
+
+	const bool isVertex = part == LibraryPart::PRE_RASTERIZATION;
+	const ShaderSpecialization specialization{ isVertex ? desc.vertShader.features
+														: desc.fragShader.features };
+	VkPipelineShaderStageCreateInfo shaderStage = GetShaderStage(
+		isVertex ? VK_SHADER_STAGE_VERTEX_BIT : VK_SHADER_STAGE_FRAGMENT_BIT, specialization.Get());
+	if (!spirv.IsEmpty())
+		shaderStage.module = m_ShaderModules.GetModule(spirv);
+
+	VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo{};
+	libraryInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+	switch (part)
+	{
+	case LibraryPart::VERTEX_INPUT:
+		libraryInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT;
+		break;
+	case LibraryPart::PRE_RASTERIZATION:
+		libraryInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT;
+		break;
+	case LibraryPart::FRAGMENT_SHADER:
+		libraryInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT;
+		break;
+	case LibraryPart::FRAGMENT_OUTPUT:
+		libraryInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT;
+		break;
+	}
+
+	// the state of the other parts is ignored; the optimized link needs the retained state
+	const FixedFunctionState state{ desc };
+	VkGraphicsPipelineCreateInfo libraryPipelineInfo{};
+	libraryPipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	libraryPipelineInfo.pNext = &libraryInfo;
+	libraryPipelineInfo.flags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR
+								| VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+	libraryPipelineInfo.stageCount = spirv.IsEmpty() ? 0 : 1;
+	libraryPipelineInfo.pStages = &shaderStage;
+	state.Fill(libraryPipelineInfo);
+
+	VkPipeline library{};
+	ErrCheck(vkCreateGraphicsPipelines(m_Device->GetDevice(),
+				 pipelineCache,
+				 1,
+				 &libraryPipelineInfo,
+				 nullptr,
+				 &library)
+				 != VK_SUCCESS,
+		"Failed to create graphics pipeline library!");
+
+	// created without the lock; a thread that loses the race destroys its library
+	const std::lock_guard<std::mutex> lock{ m_LibraryMutex };
+	const auto [it, isNew] = libraries.emplace(key, library);
+	if (!isNew)
+		vkDestroyPipeline(m_Device->GetDevice(), library, nullptr);
+	return it->second;
+}
+
+VkPipeline PipelineStateCache::Link(const GraphicsPipelineDesc& desc,
+	VkPipelineCache pipelineCache,
+	bool optimize)
+{
+	std::array<VkPipeline, LIBRARY_PART_COUNT> libraries{};
+	for (size_t part = 0; part < LIBRARY_PART_COUNT; ++part)
+		libraries[part] = GetLibrary(desc, static_cast<LibraryPart>(part), pipelineCache);
+
+	VkPipelineLibraryCreateInfoKHR linkInfo{};
+	linkInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+	linkInfo.libraryCount = static_cast<uint32_t>(libraries.size());
+	linkInfo.pLibraries = libraries.data();
+
+	// a fast link puts the compiled parts together, an optimized one compiles them as a whole
+	VkGraphicsPipelineCreateInfo graphicsPipelineInfo{};
+	graphicsPipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	graphicsPipelineInfo.pNext = &linkInfo;
+	graphicsPipelineInfo.flags = optimize ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0;
+	graphicsPipelineInfo.layout = desc.layout;
+	graphicsPipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	graphicsPipelineInfo.basePipelineIndex = -1;
+
+	VkPipeline pipeline{};
+	ErrCheck(vkCreateGraphicsPipelines(m_Device->GetDevice(),
+				 pipelineCache,
+				 1,
+				 &graphicsPipelineInfo,
+				 nullptr,
+				 &pipeline)
+				 != VK_SUCCESS,
+		"Failed to link graphics pipeline!");
+	return pipeline;
+}
+#endif
+
+void PipelineStateCache::QueueDeferredOptimizations()
+{
+	std::vector<std::pair<Entry*, uint64_t>> optimizations;
+	{
+		const std::lock_guard<std::mutex> lock{ m_Mutex };
+		optimizations.swap(m_DeferredOptimizations);
+	}
+	for (const auto& [entry, generation] : optimizations)
+		QueueOptimize(*entry, generation, m_LinkCache);
+}
+
+void PipelineStateCache::QueueOptimize([[maybe_unused]] Entry& entry,
+	[[maybe_unused]] uint64_t generation,
+	[[maybe_unused]] VkPipelineCache pipelineCache)
+{
+#if defined(VK_EXT_graphics_pipeline_library)
+	if (!m_Device->IsGraphicsPipelineLibraryEnabled())
+		return;
+
+	// another cache is one of the worker caches, the link cache may be merged into right now
+	if (pipelineCache != m_LinkCache)
+	{
+		const std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_DeferredOptimizations.emplace_back(&entry, generation);
+		return;
+	}
+
+	++m_OptimizingCount;
+	m_JobSystem.Run(
+		[this, &entry, generation]() {
+			try
+			{
+				const VkPipeline optimizedPipeline = Link(entry.desc, m_LinkCache, true);
+
+				// a reload may have replaced the fast-linked pipeline in the meantime, the
+				// optimized one was never used then
+				VkPipeline fastPipeline = VK_NULL_HANDLE;
+				{
+					const std::lock_guard<std::mutex> lock{ entry.swapMutex };
+					if (entry.generation == generation)
+						fastPipeline = entry.pipeline.exchange(optimizedPipeline);
+				}
+				if (fastPipeline != VK_NULL_HANDLE)
+					m_Retire(fastPipeline);
+				else
+					vkDestroyPipeline(m_Device->GetDevice(), optimizedPipeline, nullptr);
+			}
+			catch (const std::exception& e)
+			{
+				Logger::Warn(
+					"Failed to optimize the pipeline of \"{}\", the fast-linked one stays: {}",
+					entry.desc.vertShader.GetSpirvPath(),
+					e.what());
+			}
+			--m_OptimizingCount;
+		},
+		&m_CompileCounter);
+#endif
+}
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <future>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "core/jobSystem.h"
+#include "engine/device.h"
+#include "engine/shaderCompiler.h"
+#include "engine/shaderModuleCache.h"
+#include "engine/shaderPermutation.h"
+
+
+// everything a graphics pipeline is created from
+// the viewport and scissor are dynamic, so a resize doesn't change the description
+struct GraphicsPipelineDesc
+{
+	// the vertex buffers the pipeline reads
+	enum class VertexLayout
+	{
+		FULL = 0, // `Vertex`
+		POSITION, // positions only
+	};
+
+	ShaderPermutation vertShader{ "", ShaderType::VERTEX };
+	// empty for depth only pipelines, they write no color
+	ShaderPermutation fragShader{ "", ShaderType::FRAGMENT };
+
+	VertexLayout vertexLayout = VertexLayout::FULL;
+	VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	// raster
+	VkCullModeFlags cullMode = VK_CULL_MODE_NONE;
+	VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+	// depth
+	bool depthTest = true;
+	bool depthWrite = true;
+	VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+
+	// blend of the single color attachment
+	bool blendEnable = false;
+	VkColorComponentFlags colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT
+										   | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+	// msaa
+	VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+	bool sampleShading = false;
+	float minSampleShading = 0.0f;
+
+	VkPipelineLayout layout{};
+	// the pipeline can be used with every render pass compatible with this one
+	VkRenderPass renderPass{};
+	uint32_t subpass = 0;
+
+	[[nodiscard]] bool operator==(const GraphicsPipelineDesc& other) const;
+	[[nodiscard]] bool operator!=(const GraphicsPipelineDesc& other) const
+	{
+		return !(*this == other);
+	}
+	[[nodiscard]] size_t Hash() const;
+};
+
+// the graphics pipelines of the engine, keyed by their description
+// requesting a description again returns the existing pipeline, so every shader permutation is
+// compiled once; all pipelines are compiled by the same code path, either on the calling thread
+// or on the job system
+// with graphics pipeline libraries a pipeline is fast-linked from four parts that are compiled
+// once and shared by the pipelines that have them in common, like the permutations of a
+// fragment shader; the optimized link runs on the job system and replaces the fast-linked
+// pipeline once it is done. Without the extension the pipelines are compiled as a whole
+class PipelineStateCache
+{
+public:
+	// index of a pipeline, stays valid as long as the cache
+	using PipelineId = uint32_t;
+	static constexpr PipelineId INVALID_ID = std::numeric_limits<PipelineId>::max();
+
+	// destroys a pipeline that was replaced by a reload or an optimized link, once no frame
+	// uses it anymore
+	using RetireFn = void (*)(VkPipeline pipeline);
+
+	// the optimized links run in the background with `linkCache`, the caches passed to
+	// `Create()` may be gone by then
+	PipelineStateCache(const std::unique_ptr<Device>& device,
+		JobSystem& jobSystem,
+		ShaderCompiler& shaderCompiler,
+		VkPipelineCache linkCache,
+		RetireFn retire)
+		: m_Device{ device },
+		  m_JobSystem{ jobSystem },
+		  m_ShaderCompiler{ shaderCompiler },
+		  m_ShaderModules{ device },
+		  m_LinkCache{ linkCache },
+		  m_Retire{ retire }
+	{
+	}
+	// waits for the pipelines that are still compiling
+	~PipelineStateCache();
+	PipelineStateCache(const PipelineStateCache&) = delete;
+	PipelineStateCache(PipelineStateCache&&) = delete;
+	PipelineStateCache& operator=(const PipelineStateCache&) = delete;
+	PipelineStateCache& operator=(PipelineStateCache&&) = delete;
+
+	// returns once the pipeline is compiled, also if another thread compiles it; throws if that
+	// fails
+	// `pipelineCache` is only used if the pipeline is new; with another cache than `linkCache`
+	// the optimized link waits for `QueueDeferredOptimizations()`
+	PipelineId Create(const GraphicsPipelineDesc& desc, VkPipelineCache pipelineCache);
+	// queues the compilation of a new pipeline on the job system and returns at once; a failed
+	// compilation is logged and the pipeline never becomes ready
+	// `pipelineCache` is shared by the jobs, vulkan synchronizes it internally
+	PipelineId CreateAsync(const GraphicsPipelineDesc& desc, VkPipelineCache pipelineCache);
+
+	// recompiles the pipelines that use one of `shaderNames` on the job system; a pipeline keeps
+	// its id and is swapped once the new one is compiled, it stays as it is if that fails
+	// returns the number of queued pipelines
+	uint32_t Reload(const std::vector<std::string>& shaderNames, VkPipelineCache pipelineCache);
+	// the optimized links of the pipelines created with other caches, once `linkCache` isn't
+	// merged into anymore
+	void QueueDeferredOptimizations();
+	// waits for the queued compilations, reloads and optimized links
+	void Wait() { m_JobSystem.Wait(m_CompileCounter); }
+
+	// never blocks; null until the pipeline is compiled
+	// the handle is retired once a reload or the optimized link replaces it, so it is only valid
+	// for the frame packet it was resolved for; keep the id instead
+	[[nodiscard]] VkPipeline TryGet(PipelineId id);
+	// the number of pipelines that are queued or compiling
+	[[nodiscard]] inline uint32_t GetPendingCount() const { return m_PendingCount.load(); }
+	// the fast-linked pipelines whose optimized link is queued or running
+	[[nodiscard]] inline uint32_t GetOptimizingCount() const { return m_OptimizingCount.load(); }
+	// the shader modules the pipelines share
+	[[nodiscard]] inline uint32_t GetShaderModuleCount()
+	{
+		return m_ShaderModules.GetModuleCount();
+	}
+	// the pipelines that were found in the pipeline cache by their module identifiers
+	[[nodiscard]] inline uint32_t GetIdentifierPipelineCount() const
+	{
+		return m_IdentifierPipelineCount.load();
+	}
+
+private:
+	struct DescHash
+	{
+		size_t operator()(const GraphicsPipelineDesc& desc) const { return desc.Hash(); }
+	};
+
+	// the state subsets of `VK_EXT_graphics_pipeline_library`
+	enum class LibraryPart
+	{
+		VERTEX_INPUT = 0,
+		PRE_RASTERIZATION,
+		FRAGMENT_SHADER,
+		FRAGMENT_OUTPUT,
+	};
+	static constexpr size_t LIBRARY_PART_COUNT = 4;
+
+	struct LibraryKey
+	{
+		GraphicsPipelineDesc desc; // only the members of the part are set
+		uint64_t spirvHash = 0; // the code of the part's shader
+
+		[[nodiscard]] bool operator==(const LibraryKey& other) const
+		{
+			return desc == other.desc && spirvHash == other.spirvHash;
+		}
+	};
+
+	struct LibraryKeyHash
+	{
+		size_t operator()(const LibraryKey& key) const
+		{
+			return key.desc.Hash() ^ (std::hash<uint64_t>{}(key.spirvHash) << 1);
+		}
+	};
+
+	struct Entry
+	{
+		explicit Entry(const GraphicsPipelineDesc& pipelineDesc) : desc{ pipelineDesc } {}
+
+		GraphicsPipelineDesc desc;
+		std::atomic<VkPipeline> pipeline{ VK_NULL_HANDLE };
+		// bumped by every reload; an optimized link only replaces the pipeline of the generation
+		// it was linked for, comparing the handles could match a new pipeline at the same address
+		uint64_t generation = 0;
+		std::mutex swapMutex; // the reloads and optimized links that replace `pipeline`
+		std::promise<void> compiled;
+		std::shared_future<void> ready{ compiled.get_future().share() };
+	};
+
+	// returns the entry of `desc` and whether it was added
+	std::pair<PipelineId, bool> Insert(const GraphicsPipelineDesc& desc);
+	[[nodiscard]] Entry& GetEntry(PipelineId id);
+	// doesn't throw, the error is passed on to the waiting threads
+	void CompileEntry(Entry& entry, VkPipelineCache pipelineCache);
+	// fast-linked from the libraries if they are enabled
+	[[nodiscard]] VkPipeline Compile(const GraphicsPipelineDesc& desc,
+		VkPipelineCache pipelineCache);
+
+	[[nodiscard]] static GraphicsPipelineDesc GetLibraryDesc(const GraphicsPipelineDesc& desc,
+		LibraryPart part);
+	// compiles the library on the first request
+	[[nodiscard]] VkPipeline GetLibrary(const GraphicsPipelineDesc& desc,
+		LibraryPart part,
+		VkPipelineCache pipelineCache);
+	[[nodiscard]] VkPipeline Link(const GraphicsPipelineDesc& desc,
+		VkPipelineCache pipelineCache,
+		bool optimize);
+	// replaces the fast-linked pipeline with the optimized link once it is done, unless a reload
+	// started another `generation` of the entry in the meantime
+	void QueueOptimize(Entry& entry, uint64_t generation, VkPipelineCache pipelineCache);
+
+	const std::unique_ptr<Device>& m_Device;
+	JobSystem& m_JobSystem;
+	ShaderCompiler& m_ShaderCompiler;
+	ShaderModuleCache m_ShaderModules;
+	VkPipelineCache m_LinkCache;
+	RetireFn m_Retire;
+
+	std::mutex m_Mutex;
+	std::unordered_map<GraphicsPipelineDesc, PipelineId, DescHash> m_Ids;
+	std::vector<std::unique_ptr<Entry>> m_Entries; // the entries don't move when it grows
+	std::vector<std::pair<Entry*, uint64_t>> m_DeferredOptimizations; // and their generation
+	JobCounter m_CompileCounter;
+	std::atomic<uint32_t> m_PendingCount{ 0 };
+	std::atomic<uint32_t> m_IdentifierPipelineCount{ 0 };
+
+	std::mutex m_LibraryMutex;
+	std::array<std::unordered_map<LibraryKey, VkPipeline, LibraryKeyHash>, LIBRARY_PART_COUNT>
+		m_Libraries;
+	std::atomic<uint32_t> m_OptimizingCount{ 0 };
+};
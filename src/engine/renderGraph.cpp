@@ -0,0 +1,411 @@
+#include "engine/renderGraph.h"
+
+#include <algorithm>
+#include "core/core.h"
+
+
+constexpr VkAccessFlags g_WriteAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+											| VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+											| VK_ACCESS_SHADER_WRITE_BIT
+											| VK_ACCESS_TRANSFER_WRITE_BIT;
+
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Read(RenderGraphResource resource,
+	RenderGraphAccess access)
+{
+	m_Graph.m_Passes[m_Pass].reads.push_back(ImageUse{ resource, access });
+	return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Write(RenderGraphResource resource,
+	RenderGraphAccess access)
+{
+	ErrCheck(access == RenderGraphAccess::DepthRead || access == RenderGraphAccess::ShaderRead
+				 || access == RenderGraphAccess::ComputeRead,
+		"Render graph pass \"{}\" writes \"{}\" with a read-only access!",
+		m_Graph.m_Passes[m_Pass].name,
+		m_Graph.m_Images[resource].name);
+
+	m_Graph.m_Passes[m_Pass].writes.push_back(ImageUse{ resource, access });
+	return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::SetSideEffect()
+{
+	m_Graph.m_Passes[m_Pass].sideEffect = true;
+	return *this;
+}
+
+RenderGraphResource RenderGraph::CreateImage(const char* name, const RenderGraphImageDesc& desc)
+{
+	ImageNode image{};
+	image.name = name;
+	image.desc = desc;
+	m_Images.push_back(std::move(image));
+
+	return static_cast<RenderGraphResource>(m_Images.size() - 1);
+}
+
+RenderGraphResource RenderGraph::ImportImage(const char* name,
+	const RenderGraphImageDesc& desc,
+	const RenderGraphImageState& initialState,
+	const RenderGraphImageState& finalState)
+{
+	ImageNode image{};
+	image.name = name;
+	image.desc = desc;
+	image.imported = true;
+	image.initialState = initialState;
+	image.finalState = finalState;
+	m_Images.push_back(std::move(image));
+
+	return static_cast<RenderGraphResource>(m_Images.size() - 1);
+}
+
+RenderGraph::PassBuilder RenderGraph::AddPass(const char* name, ExecuteFn execute)
+{
+	PassNode pass{};
+	pass.name = name;
+	pass.execute = std::move(execute);
+	m_Passes.push_back(std::move(pass));
+
+	return PassBuilder{ *this, static_cast<uint32_t>(m_Passes.size() - 1) };
+}
+
+void RenderGraph::Compile(RenderGraphBackend& backend)
+{
+	m_CompiledPasses.clear();
+	m_FinalBarriers.clear();
+	m_MemoryBlocks.clear();
+
+	CullPasses();
+	CalcLifetimes();
+	AssignMemoryBlocks(backend);
+	BuildBarriers();
+}
+
+void RenderGraph::ExecutePass(uint32_t pass, VkCommandBuffer cmdBuff) const
+{
+	m_Passes[pass].execute(cmdBuff);
+}
+
+void RenderGraph::CullPasses()
+{
+	for (auto& image : m_Images)
+	{
+		// imported images are used outside of the graph
+		image.refCount = image.imported ? 1 : 0;
+		image.producers.clear();
+	}
+
+	for (uint32_t i = 0; i < m_Passes.size(); ++i)
+	{
+		PassNode& pass = m_Passes[i];
+		pass.culled = false;
+		pass.refCount = static_cast<uint32_t>(pass.writes.size()) + (pass.sideEffect ? 1 : 0);
+
+		for (const auto& write : pass.writes)
+			m_Images[write.resource].producers.push_back(i);
+		// reading an image the pass writes itself does not keep the pass alive
+		for (const auto& read : pass.reads)
+		{
+			if (!UsesImage(pass.writes, read.resource))
+				++m_Images[read.resource].refCount;
+		}
+	}
+
+	std::vector<RenderGraphResource> unusedImages;
+	const auto cullPass = [this, &unusedImages](uint32_t passIndex) {
+		PassNode& pass = m_Passes[passIndex];
+		pass.culled = true;
+		for (const auto& read : pass.reads)
+		{
+			if (UsesImage(pass.writes, read.resource))
+				continue;
+			if (--m_Images[read.resource].refCount == 0)
+				unusedImages.push_back(read.resource);
+		}
+	};
+
+	for (uint32_t i = 0; i < m_Passes.size(); ++i)
+	{
+		if (m_Passes[i].refCount == 0)
+			cullPass(i);
+	}
+	for (RenderGraphResource i = 0; i < m_Images.size(); ++i)
+	{
+		if (m_Images[i].refCount == 0)
+			unusedImages.push_back(i);
+	}
+
+	while (!unusedImages.empty())
+	{
+		const RenderGraphResource resource = unusedImages.back();
+		unusedImages.pop_back();
+
+		for (const uint32_t producer : m_Images[resource].producers)
+		{
+			if (!m_Passes[producer].culled && --m_Passes[producer].refCount == 0)
+				cullPass(producer);
+		}
+	}
+}
+
+void RenderGraph::CalcLifetimes()
+{
+	for (auto& image : m_Images)
+	{
+		image.usage = 0;
+		image.firstPass = UINT32_MAX;
+		image.lastPass = 0;
+	}
+
+	for (uint32_t i = 0; i < m_Passes.size(); ++i)
+	{
+		if (m_Passes[i].culled)
+			continue;
+
+		for (const auto* uses : { &m_Passes[i].reads, &m_Passes[i].writes })
+		{
+			for (const auto& use : *uses)
+			{
+				ImageNode& image = m_Images[use.resource];
+				image.usage |= GetUsageFlags(use.access);
+				image.firstPass = std::min(image.firstPass, i);
+				image.lastPass = std::max(image.lastPass, i);
+			}
+		}
+	}
+
+	// images that are only used as attachments of a single pass never leave the tile memory
+	constexpr VkImageUsageFlags attachmentUsage =
+		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	for (auto& image : m_Images)
+	{
+		if (!image.imported && image.usage != 0 && (image.usage & ~attachmentUsage) == 0
+			&& image.firstPass == image.lastPass)
+			image.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+	}
+}
+
+void RenderGraph::AssignMemoryBlocks(RenderGraphBackend& backend)
+{
+	std::vector<RenderGraphResource> transientImages;
+	for (RenderGraphResource i = 0; i < m_Images.size(); ++i)
+	{
+		if (!m_Images[i].imported && m_Images[i].usage != 0)
+			transientImages.push_back(i);
+	}
+	std::stable_sort(transientImages.begin(),
+		transientImages.end(),
+		[this](RenderGraphResource a, RenderGraphResource b) {
+			return m_Images[a].firstPass < m_Images[b].firstPass;
+		});
+
+	// greedy; an image reuses the first block whose last image is dead by the time it is needed
+	for (const RenderGraphResource resource : transientImages)
+	{
+		const ImageNode& image = m_Images[resource];
+		const RenderGraphMemoryRequirements requirements =
+			backend.GetMemoryRequirements(image.desc, image.usage);
+
+		RenderGraphMemoryBlock* memoryBlock = nullptr;
+		for (auto& block : m_MemoryBlocks)
+		{
+			const ImageNode& lastImage = m_Images[block.resources.back()];
+			if (lastImage.lastPass < image.firstPass
+				&& (block.requirements.memoryTypeBits & requirements.memoryTypeBits) != 0)
+			{
+				memoryBlock = &block;
+				break;
+			}
+		}
+
+		if (memoryBlock == nullptr)
+		{
+			m_MemoryBlocks.push_back(RenderGraphMemoryBlock{ requirements, { resource } });
+			continue;
+		}
+
+		memoryBlock->requirements.size =
+			std::max(memoryBlock->requirements.size, requirements.size);
+		memoryBlock->requirements.alignment =
+			std::max(memoryBlock->requirements.alignment, requirements.alignment);
+		memoryBlock->requirements.memoryTypeBits &= requirements.memoryTypeBits;
+		memoryBlock->resources.push_back(resource);
+	}
+}
+
+void RenderGraph::BuildBarriers()
+{
+	// the state every image is left in by the last passes that use it; the reads after the last
+	// write are combined, like in the barriers below
+	std::vector<RenderGraphImageState> lastStates(m_Images.size());
+	for (const auto& pass : m_Passes)
+	{
+		if (pass.culled)
+			continue;
+
+		for (const auto& [resource, state] : GetPassStates(pass))
+		{
+			if (!TryMergeReads(lastStates[resource], state))
+				lastStates[resource] = state;
+		}
+	}
+
+	std::vector<RenderGraphImageState> currentStates(m_Images.size());
+	for (RenderGraphResource i = 0; i < m_Images.size(); ++i)
+	{
+		if (m_Images[i].imported)
+			currentStates[i] = m_Images[i].initialState;
+	}
+	// the contents of transient images are discarded, but they have to wait for the previous
+	// user of their memory; the first one in a block waits for the last one of the previous frame
+	for (const auto& block : m_MemoryBlocks)
+	{
+		for (size_t i = 0; i < block.resources.size(); ++i)
+		{
+			const RenderGraphResource previous =
+				block.resources[(i + block.resources.size() - 1) % block.resources.size()];
+			currentStates[block.resources[i]] = lastStates[previous];
+			currentStates[block.resources[i]].layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		}
+	}
+
+	for (uint32_t i = 0; i < m_Passes.size(); ++i)
+	{
+		const PassNode& pass = m_Passes[i];
+		if (pass.culled)
+			continue;
+
+		CompiledPass compiledPass{};
+		compiledPass.pass = i;
+		for (const auto& [resource, next] : GetPassStates(pass))
+		{
+			RenderGraphImageState& current = currentStates[resource];
+			if (TryMergeReads(current, next))
+				continue;
+
+			compiledPass.barriers.push_back(RenderGraphBarrier{ resource, current, next });
+			current = next;
+		}
+		m_CompiledPasses.push_back(std::move(compiledPass));
+	}
+
+	for (RenderGraphResource i = 0; i < m_Images.size(); ++i)
+	{
+		const ImageNode& image = m_Images[i];
+		if (!image.imported || image.usage == 0)
+			continue;
+
+		m_FinalBarriers.push_back(RenderGraphBarrier{ i, currentStates[i], image.finalState });
+	}
+}
+
+std::vector<std::pair<RenderGraphResource, RenderGraphImageState>> RenderGraph::GetPassStates(
+	const PassNode& pass) const
+{
+	// the combined state of every image the pass uses, in declaration order
+	std::vector<std::pair<RenderGraphResource, RenderGraphImageState>> passStates;
+	const auto addUse = [&](const ImageUse& use, bool write) {
+		const RenderGraphImageState state = GetImageState(use.access, write);
+		const auto it = std::find_if(passStates.begin(),
+			passStates.end(),
+			[&use](const auto& passState) { return passState.first == use.resource; });
+		if (it == passStates.end())
+		{
+			passStates.emplace_back(use.resource, state);
+			return;
+		}
+
+		ErrCheck(it->second.layout != state.layout,
+			"Render graph pass \"{}\" uses \"{}\" in two different layouts!",
+			pass.name,
+			m_Images[use.resource].name);
+		it->second.stageMask |= state.stageMask;
+		it->second.accessMask |= state.accessMask;
+	};
+	for (const auto& read : pass.reads)
+		addUse(read, false);
+	for (const auto& write : pass.writes)
+		addUse(write, true);
+
+	return passStates;
+}
+
+bool RenderGraph::TryMergeReads(RenderGraphImageState& current, const RenderGraphImageState& next)
+{
+	// reads in the same layout don't need to wait for each other; the next writer has to wait for
+	// all of them though
+	const bool hazard = ((current.accessMask | next.accessMask) & g_WriteAccessMask) != 0;
+	if (current.layout != next.layout || hazard)
+		return false;
+
+	current.stageMask |= next.stageMask;
+	current.accessMask |= next.accessMask;
+	return true;
+}
+
+bool RenderGraph::UsesImage(const std::vector<ImageUse>& uses, RenderGraphResource resource)
+{
+	return std::any_of(uses.begin(), uses.end(), [resource](const ImageUse& use) {
+		return use.resource == resource;
+	});
+}
+
+RenderGraphImageState RenderGraph::GetImageState(RenderGraphAccess access, bool write)
+{
+	RenderGraphImageState state{};
+	switch (access)
+	{
+	case RenderGraphAccess::ColorAttachment:
+		state.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		state.stageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		state.accessMask =
+			write ? VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT : VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
+		break;
+	case RenderGraphAccess::DepthAttachment:
+		state.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		state.stageMask =
+			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		state.accessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+		if (write)
+			state.accessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		break;
+	case RenderGraphAccess::DepthRead:
+		state.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		state.stageMask =
+			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		state.accessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+		break;
+	case RenderGraphAccess::ShaderRead:
+		state.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		state.stageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		state.accessMask = VK_ACCESS_SHADER_READ_BIT;
+		break;
+	case RenderGraphAccess::ComputeRead:
+		state.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		state.stageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		state.accessMask = VK_ACCESS_SHADER_READ_BIT;
+		break;
+	}
+
+	return state;
+}
+
+VkImageUsageFlags RenderGraph::GetUsageFlags(RenderGraphAccess access)
+{
+	switch (access)
+	{
+	case RenderGraphAccess::ColorAttachment:
+		return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	case RenderGraphAccess::DepthAttachment:
+	case RenderGraphAccess::DepthRead:
+		return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	case RenderGraphAccess::ShaderRead:
+	case RenderGraphAccess::ComputeRead:
+		return VK_IMAGE_USAGE_SAMPLED_BIT;
+	}
+
+	return 0;
+}
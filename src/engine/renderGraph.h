@@ -0,0 +1,214 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
+#include <functional>
+#include <vulkan/vulkan.h>
+
+
+using RenderGraphResource = uint32_t;
+
+// how a pass uses an image; decides its layout, pipeline stages and access masks
+enum class RenderGraphAccess
+{
+	ColorAttachment, // color or resolve attachment
+	DepthAttachment, // depth test and write
+	DepthRead, // depth test without write
+	ShaderRead, // sampled in the fragment shader
+	ComputeRead, // sampled in a compute shader
+};
+
+struct RenderGraphImageDesc
+{
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	VkExtent2D extent{};
+	VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+};
+
+struct RenderGraphImageState
+{
+	VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	VkPipelineStageFlags stageMask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	VkAccessFlags accessMask = 0;
+};
+
+struct RenderGraphBarrier
+{
+	RenderGraphResource resource = 0;
+	RenderGraphImageState src;
+	RenderGraphImageState dst;
+};
+
+struct RenderGraphMemoryRequirements
+{
+	VkDeviceSize size = 0;
+	VkDeviceSize alignment = 1;
+	uint32_t memoryTypeBits = ~0u;
+};
+
+// memory shared by transient images whose lifetimes don't overlap
+// every image is bound at offset 0
+struct RenderGraphMemoryBlock
+{
+	RenderGraphMemoryRequirements requirements;
+	std::vector<RenderGraphResource> resources; // in the order they are used
+};
+
+// what compiling the graph needs from the graphics API
+// can be mocked to test the compilation on the CPU
+class RenderGraphBackend
+{
+public:
+	virtual ~RenderGraphBackend() = default;
+
+	[[nodiscard]] virtual RenderGraphMemoryRequirements GetMemoryRequirements(
+		const RenderGraphImageDesc& desc,
+		VkImageUsageFlags usage) = 0;
+};
+
+// passes declare the images they read and write; compiling the graph culls the passes whose
+// results are never used, derives the image barriers between the passes and assigns the
+// transient images to memory blocks
+// passes run in the order they are added
+class RenderGraph
+{
+public:
+	using ExecuteFn = std::function<void(VkCommandBuffer cmdBuff)>;
+
+	class PassBuilder
+	{
+	public:
+		PassBuilder(RenderGraph& graph, uint32_t pass) : m_Graph{ graph }, m_Pass{ pass } {}
+
+		PassBuilder& Read(RenderGraphResource resource, RenderGraphAccess access);
+		PassBuilder& Write(RenderGraphResource resource, RenderGraphAccess access);
+		// the pass is never culled
+		PassBuilder& SetSideEffect();
+
+	private:
+		RenderGraph& m_Graph;
+		uint32_t m_Pass;
+	};
+
+	struct CompiledPass
+	{
+		uint32_t pass = 0;
+		std::vector<RenderGraphBarrier> barriers; // recorded before the pass
+	};
+
+	// created and owned by the backend
+	RenderGraphResource CreateImage(const char* name, const RenderGraphImageDesc& desc);
+	// created outside of the graph, e.g. swapchain images
+	// `initialState` is the state the image is in before the first pass that uses it,
+	// `finalState` the state it is transitioned into after the last one
+	RenderGraphResource ImportImage(const char* name,
+		const RenderGraphImageDesc& desc,
+		const RenderGraphImageState& initialState,
+		const RenderGraphImageState& finalState);
+
+	PassBuilder AddPass(const char* name, ExecuteFn execute);
+
+	void Compile(RenderGraphBackend& backend);
+	void ExecutePass(uint32_t pass, VkCommandBuffer cmdBuff) const;
+
+	[[nodiscard]] inline const std::vector<CompiledPass>& GetCompiledPasses() const
+	{
+		return m_CompiledPasses;
+	}
+	[[nodiscard]] inline const std::vector<RenderGraphBarrier>& GetFinalBarriers() const
+	{
+		return m_FinalBarriers;
+	}
+	[[nodiscard]] inline const std::vector<RenderGraphMemoryBlock>& GetMemoryBlocks() const
+	{
+		return m_MemoryBlocks;
+	}
+
+	[[nodiscard]] inline uint32_t GetImageCount() const
+	{
+		return static_cast<uint32_t>(m_Images.size());
+	}
+	[[nodiscard]] inline const std::string& GetImageName(RenderGraphResource resource) const
+	{
+		return m_Images[resource].name;
+	}
+	[[nodiscard]] inline const RenderGraphImageDesc& GetImageDesc(
+		RenderGraphResource resource) const
+	{
+		return m_Images[resource].desc;
+	}
+	// valid after compiling
+	[[nodiscard]] inline VkImageUsageFlags GetImageUsage(RenderGraphResource resource) const
+	{
+		return m_Images[resource].usage;
+	}
+	[[nodiscard]] inline bool IsImported(RenderGraphResource resource) const
+	{
+		return m_Images[resource].imported;
+	}
+	[[nodiscard]] inline bool IsCulled(uint32_t pass) const { return m_Passes[pass].culled; }
+	[[nodiscard]] inline const std::string& GetPassName(uint32_t pass) const
+	{
+		return m_Passes[pass].name;
+	}
+
+private:
+	struct ImageUse
+	{
+		RenderGraphResource resource = 0;
+		RenderGraphAccess access = RenderGraphAccess::ColorAttachment;
+	};
+
+	struct ImageNode
+	{
+		std::string name;
+		RenderGraphImageDesc desc;
+		bool imported = false;
+		RenderGraphImageState initialState;
+		RenderGraphImageState finalState;
+
+		// set while compiling
+		VkImageUsageFlags usage = 0;
+		uint32_t firstPass = UINT32_MAX;
+		uint32_t lastPass = 0;
+		uint32_t refCount = 0;
+		std::vector<uint32_t> producers;
+	};
+
+	struct PassNode
+	{
+		std::string name;
+		ExecuteFn execute;
+		std::vector<ImageUse> reads;
+		std::vector<ImageUse> writes;
+		bool sideEffect = false;
+
+		// set while compiling
+		bool culled = false;
+		uint32_t refCount = 0;
+	};
+
+	void CullPasses();
+	void CalcLifetimes();
+	void AssignMemoryBlocks(RenderGraphBackend& backend);
+	void BuildBarriers();
+
+	[[nodiscard]] std::vector<std::pair<RenderGraphResource, RenderGraphImageState>> GetPassStates(
+		const PassNode& pass) const;
+	// combines `next` into `current` if it doesn't need a barrier
+	[[nodiscard]] static bool TryMergeReads(RenderGraphImageState& current,
+		const RenderGraphImageState& next);
+	[[nodiscard]] static bool UsesImage(const std::vector<ImageUse>& uses,
+		RenderGraphResource resource);
+	[[nodiscard]] static RenderGraphImageState GetImageState(RenderGraphAccess access, bool write);
+	[[nodiscard]] static VkImageUsageFlags GetUsageFlags(RenderGraphAccess access);
+
+	std::vector<ImageNode> m_Images;
+	std::vector<PassNode> m_Passes;
+
+	std::vector<CompiledPass> m_CompiledPasses;
+	std::vector<RenderGraphBarrier> m_FinalBarriers;
+	std::vector<RenderGraphMemoryBlock> m_MemoryBlocks;
+};
@@ -0,0 +1,116 @@
+#include "engine/settings.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include "core/core.h"
+#include "engine/types.h"
+
+
+RenderSettings RenderSettings::Load(int argc, char** argv)
+{
+	RenderSettings settings{};
+
+	for (int i = 1; i + 1 < argc; ++i)
+	{
+		if (std::string{ argv[i] } == "--config")
+			settings.LoadConfigFile(argv[i + 1]);
+	}
+
+	int i = 1;
+	while (i < argc)
+	{
+		// options are `--<name> <value>` pairs
+		const std::string option = argv[i];
+		if (option.rfind("--", 0) != 0 || i + 1 >= argc)
+		{
+			Logger::Warn("Ignoring command line argument \"{}\"", option);
+			++i;
+			continue;
+		}
+
+		if (option != "--config")
+			settings.Set(option.substr(2), argv[i + 1]);
+		i += 2;
+	}
+
+	return settings;
+}
+
+const char* RenderSettings::PresentModeToString(VkPresentModeKHR presentMode)
+{
+	switch (presentMode)
+	{
+	case VK_PRESENT_MODE_IMMEDIATE_KHR:
+		return "immediate";
+	case VK_PRESENT_MODE_MAILBOX_KHR:
+		return "mailbox";
+	case VK_PRESENT_MODE_FIFO_KHR:
+		return "fifo";
+	case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+		return "fifo_relaxed";
+	default:
+		return "unknown";
+	}
+}
+
+void RenderSettings::Set(const std::string& key, const std::string& value)
+{
+	if (key == "frames-in-flight" || key == "framesInFlight")
+	{
+		const int frames = std::atoi(value.c_str());
+		framesInFlight = static_cast<uint32_t>(
+			std::clamp(frames, 1, static_cast<int>(Config::maxFramesInFlight)));
+		if (frames != static_cast<int>(framesInFlight))
+			Logger::Warn("Frames in flight clamped to {}", framesInFlight);
+	}
+	else if (key == "present-mode" || key == "presentMode")
+	{
+		constexpr VkPresentModeKHR presentModes[] = { VK_PRESENT_MODE_IMMEDIATE_KHR,
+			VK_PRESENT_MODE_MAILBOX_KHR,
+			VK_PRESENT_MODE_FIFO_KHR,
+			VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+
+		for (const auto mode : presentModes)
+		{
+			if (value == PresentModeToString(mode))
+			{
+				presentMode = mode;
+				return;
+			}
+		}
+		Logger::Warn("Unknown present mode \"{}\"", value);
+	}
+	else
+	{
+		Logger::Warn("Unknown setting \"{}\"", key);
+	}
+}
+
+void RenderSettings::LoadConfigFile(const char* path)
+{
+	// one `key = value` pair per line, `#` starts a comment
+	std::ifstream file{ path };
+	ErrCheck(!file.is_open(), "Error opening config file: {}", path);
+
+	const auto trim = [](const std::string& str) {
+		const size_t first = str.find_first_not_of(" \t\r");
+		if (first == std::string::npos)
+			return std::string{};
+		const size_t last = str.find_last_not_of(" \t\r");
+		return str.substr(first, last - first + 1);
+	};
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		line = line.substr(0, line.find('#'));
+		const size_t separator = line.find('=');
+		if (separator == std::string::npos)
+			continue;
+
+		Set(trim(line.substr(0, separator)), trim(line.substr(separator + 1)));
+	}
+
+	Logger::Info("Loaded config file \"{}\"", path);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vulkan/vulkan.h>
+
+
+// settings that can be changed at runtime (command line, config file or ImGui)
+struct RenderSettings
+{
+	uint32_t framesInFlight = 2; // clamped to [1, Config::maxFramesInFlight]
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+
+	// reads `--config <path>` first, then the other command line options override its values
+	//     --frames-in-flight <1-3>
+	//     --present-mode <immediate|mailbox|fifo|fifo_relaxed>
+	[[nodiscard]] static RenderSettings Load(int argc, char** argv);
+
+	[[nodiscard]] inline bool operator==(const RenderSettings& other) const
+	{
+		return framesInFlight == other.framesInFlight && presentMode == other.presentMode;
+	}
+	[[nodiscard]] inline bool operator!=(const RenderSettings& other) const
+	{
+		return !(*this == other);
+	}
+
+	static const char* PresentModeToString(VkPresentModeKHR presentMode);
+
+private:
+	void Set(const std::string& key, const std::string& value);
+	void LoadConfigFile(const char* path);
+};
@@ -2,17 +2,29 @@
 
 #include <fstream>
 #include "core/core.h"
+#include "engine/embeddedShaders.h"
 
 
-Shader::Shader(VkDevice deviceVk, const char* path, ShaderType type)
+Shader::Shader(VkDevice deviceVk,
+	const char* path,
+	ShaderType type,
+	const VkSpecializationInfo* specialization)
 	: m_DeviceVk{ deviceVk },
 	  m_Path{ path },
 	  m_Type{ type },
+	  m_Specialization{ specialization },
 	  m_ShaderModule{ VK_NULL_HANDLE },
 	  m_ShaderStage{} // has to be default initialized
 {
-	LoadShader();
-	CreateShaderModule();
+	SpirvView spirv = EmbeddedShaders::Find(m_Path);
+	if (spirv.IsEmpty())
+	{
+		LoadShader();
+		// code is in char but shaderModule expects it to be in uint32_t
+		spirv.code = reinterpret_cast<const uint32_t*>(m_ShaderCode.data());
+		spirv.wordCount = m_ShaderCode.size() / sizeof(uint32_t);
+	}
+	CreateShaderModule(spirv);
 	CreateShaderStage();
 }
 
@@ -34,13 +46,12 @@ void Shader::LoadShader()
 	file.close();
 }
 
-void Shader::CreateShaderModule()
+void Shader::CreateShaderModule(SpirvView spirv)
 {
 	VkShaderModuleCreateInfo shaderModuleInfo{};
 	shaderModuleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	shaderModuleInfo.codeSize = m_ShaderCode.size();
-	// code is in char but shaderModule expects it to be in uint32_t
-	shaderModuleInfo.pCode = reinterpret_cast<const uint32_t*>(m_ShaderCode.data());
+	shaderModuleInfo.codeSize = spirv.GetSize(); // bytes
+	shaderModuleInfo.pCode = spirv.code;
 
 	if (vkCreateShaderModule(m_DeviceVk, &shaderModuleInfo, nullptr, &m_ShaderModule) != VK_SUCCESS)
 		throw std::runtime_error("Failed to create shader module!");
@@ -52,4 +63,5 @@ void Shader::CreateShaderStage()
 	m_ShaderStage.stage = static_cast<VkShaderStageFlagBits>(m_Type);
 	m_ShaderStage.module = m_ShaderModule;
 	m_ShaderStage.pName = "main";
+	m_ShaderStage.pSpecializationInfo = m_Specialization;
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 #include <vulkan/vulkan.h>
 
@@ -11,10 +13,27 @@ enum class ShaderType
 	COMPUTE = VK_SHADER_STAGE_COMPUTE_BIT
 };
 
+// SPIR-V owned by someone else, like the shaders embedded in the executable
+struct SpirvView
+{
+	const uint32_t* code = nullptr;
+	size_t wordCount = 0;
+
+	[[nodiscard]] inline bool IsEmpty() const { return wordCount == 0; }
+	[[nodiscard]] inline size_t GetSize() const { return wordCount * sizeof(uint32_t); }
+};
+
+// owns its module, for the compute pipelines that are created once; the graphics pipelines
+// share theirs through `ShaderModuleCache`
 class Shader
 {
 public:
-	Shader(VkDevice deviceVk, const char* path, ShaderType type);
+	// `specialization` has to outlive the pipeline creation
+	// the embedded copy of the `.spv` file is used if there is one (`EmbeddedShaders`)
+	Shader(VkDevice deviceVk,
+		const char* path,
+		ShaderType type,
+		const VkSpecializationInfo* specialization = nullptr);
 	~Shader();
 
 	[[nodiscard]] inline VkPipelineShaderStageCreateInfo GetShaderStage() const
@@ -24,12 +43,13 @@ public:
 
 private:
 	void LoadShader();
-	void CreateShaderModule();
+	void CreateShaderModule(SpirvView spirv);
 	void CreateShaderStage();
 
 	VkDevice m_DeviceVk;
 	const char* m_Path;
 	ShaderType m_Type;
+	const VkSpecializationInfo* m_Specialization;
 
 	std::vector<char> m_ShaderCode;
 
@@ -0,0 +1,349 @@
+#include "engine/shaderCompiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include "core/core.h"
+#include "engine/embeddedShaders.h"
+
+#if defined(VKPBR_RUNTIME_SHADER_COMPILE)
+	#include <shaderc/shaderc.hpp>
+#endif
+
+
+namespace fs = std::filesystem;
+
+// `#include <file>` is resolved relative to it
+constexpr const char* g_ShaderSourceDir = "assets/shaders";
+// part of the hash, so changing the compile options invalidates the cached SPIR-V
+constexpr uint32_t g_SpirvCacheVersion = 1;
+constexpr uint32_t g_SpirvMagic = 0x07230203;
+
+// FNV-1a
+constexpr uint64_t g_HashOffset = 14695981039346656037ull;
+static void HashBytes(uint64_t& hash, const void* data, size_t size)
+{
+	const auto* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+}
+
+static bool ReadFile(const fs::path& path, std::string& content)
+{
+	std::ifstream file{ path, std::ios::binary };
+	if (!file.is_open())
+		return false;
+
+	std::ostringstream stream;
+	stream << file.rdbuf();
+	content = stream.str();
+	return true;
+}
+
+// `"file"` relative to the including file, `<file>` relative to assets/shaders
+static fs::path ResolveInclude(const std::string& requested,
+	bool isRelative,
+	const fs::path& requestingFile)
+{
+	return (isRelative ? requestingFile.parent_path() : fs::path{ g_ShaderSourceDir }) / requested;
+}
+
+#if defined(VKPBR_RUNTIME_SHADER_COMPILE)
+// resolves the includes like `ShaderCompiler::GetSourceFiles()`
+class ShaderIncluder : public shaderc::CompileOptions::IncluderInterface
+{
+public:
+	shaderc_include_result* GetInclude(const char* requestedSource,
+		shaderc_include_type type,
+		const char* requestingSource,
+		size_t /*includeDepth*/) override
+	{
+		// owned by shaderc until `ReleaseInclude()`
+		auto include = std::make_unique<Include>();
+		include->path =
+			ResolveInclude(requestedSource, type == shaderc_include_type_relative, requestingSource)
+				.generic_string();
+		if (!ReadFile(include->path, include->content))
+		{
+			// an empty source name reports the content as the error
+			include->content = "Unable to open include file " + include->path;
+			include->path.clear();
+		}
+
+		include->result.source_name = include->path.c_str();
+		include->result.source_name_length = include->path.size();
+		include->result.content = include->content.c_str();
+		include->result.content_length = include->content.size();
+		include->result.user_data = include.get();
+		return &include.release()->result;
+	}
+
+	void ReleaseInclude(shaderc_include_result* data) override
+	{
+		delete static_cast<Include*>(data->user_data);
+	}
+
+private:
+	struct Include
+	{
+		std::string path;
+		std::string content;
+		shaderc_include_result result{};
+	};
+};
+#endif
+
+// with the runtime compiler the sources win over the embedded SPIR-V, so they can be reloaded;
+// the embedded shaders are the fallback of an executable that runs without assets/shaders
+static bool CanCompile([[maybe_unused]] const ShaderPermutation& permutation)
+{
+#if defined(VKPBR_RUNTIME_SHADER_COMPILE)
+	std::error_code error;
+	return fs::exists(permutation.GetSourcePath(), error);
+#else
+	return false;
+#endif
+}
+
+ShaderCompiler::ShaderCompiler(std::string cacheDir)
+	: m_CacheDir{ std::move(cacheDir) }
+{
+#if defined(VKPBR_EMBED_SHADERS) && !defined(VKPBR_RUNTIME_SHADER_COMPILE)
+	if (!EmbeddedShaders::UseFiles())
+		Logger::Info("Using the embedded shaders, hot reload is off (set VKPBR_SHADER_FILES=1)");
+#endif
+}
+
+SpirvView ShaderCompiler::GetSpirv(const ShaderPermutation& permutation)
+{
+	// the embedded shaders don't read files, so they are not watched either
+	const SpirvView embedded = EmbeddedShaders::Find(permutation.GetSpirvPath());
+	if (!embedded.IsEmpty() && !CanCompile(permutation))
+	{
+#if defined(VKPBR_RUNTIME_SHADER_COMPILE)
+		Logger::Warn("Shader source {} not found, using the embedded shader without hot reload",
+			permutation.GetSourcePath());
+#endif
+		return embedded;
+	}
+
+	const std::vector<fs::path> files = GetSourceFiles(permutation);
+	Watch(files, permutation.name);
+
+#if defined(VKPBR_RUNTIME_SHADER_COMPILE)
+	// everything the compiler reads
+	uint64_t hash = g_HashOffset;
+	HashBytes(hash, &g_SpirvCacheVersion, sizeof(g_SpirvCacheVersion));
+	const auto type = static_cast<uint32_t>(permutation.type);
+	HashBytes(hash, &type, sizeof(type));
+	const uint32_t defines = permutation.features & ShaderFeature::COMPILED;
+	HashBytes(hash, &defines, sizeof(defines));
+	std::string source;
+	for (const auto& file : files)
+	{
+		std::string content;
+		ErrCheck(!ReadFile(file, content), "Error opening shader file: {}", file.generic_string());
+		const std::string path = file.generic_string();
+		HashBytes(hash, path.data(), path.size());
+		HashBytes(hash, content.data(), content.size());
+		if (&file == &files.front())
+			source = std::move(content);
+	}
+
+	{
+		const std::lock_guard<std::mutex> lock{ m_Mutex };
+		const auto it = m_Spirv.find(hash);
+		if (it != m_Spirv.end())
+			return { it->second.data(), it->second.size() };
+	}
+
+	std::vector<uint32_t> spirv = LoadCached(hash);
+	if (spirv.empty())
+	{
+		spirv = Compile(permutation, source);
+		SaveCached(hash, spirv);
+	}
+
+	const std::lock_guard<std::mutex> lock{ m_Mutex };
+	const std::vector<uint32_t>& cached = m_Spirv.emplace(hash, std::move(spirv)).first->second;
+	return { cached.data(), cached.size() };
+#else
+	std::string code;
+	ErrCheck(!ReadFile(files.front(), code) || code.empty() || code.size() % sizeof(uint32_t) != 0,
+		"Error opening shader file: {}",
+		files.front().generic_string());
+	uint64_t hash = g_HashOffset;
+	HashBytes(hash, code.data(), code.size());
+
+	const std::lock_guard<std::mutex> lock{ m_Mutex };
+	auto [it, isNew] = m_Spirv.try_emplace(hash);
+	if (isNew)
+	{
+		it->second.resize(code.size() / sizeof(uint32_t));
+		std::memcpy(it->second.data(), code.data(), code.size());
+	}
+	return { it->second.data(), it->second.size() };
+#endif
+}
+
+std::vector<std::string> ShaderCompiler::PollChangedShaders()
+{
+	std::unordered_set<std::string> changedShaders;
+	const std::lock_guard<std::mutex> lock{ m_Mutex };
+	for (auto& [path, watchedFile] : m_WatchedFiles)
+	{
+		// a file that is being replaced may be missing for a moment
+		std::error_code error;
+		const auto lastWriteTime = fs::last_write_time(path, error);
+		if (error || lastWriteTime == watchedFile.lastWriteTime)
+			continue;
+
+		watchedFile.lastWriteTime = lastWriteTime;
+		changedShaders.insert(watchedFile.shaderNames.begin(), watchedFile.shaderNames.end());
+	}
+	return { changedShaders.begin(), changedShaders.end() };
+}
+
+std::vector<fs::path> ShaderCompiler::GetSourceFiles(const ShaderPermutation& permutation)
+{
+#if defined(VKPBR_RUNTIME_SHADER_COMPILE)
+	// depth first, a file included twice is only listed once
+	std::vector<fs::path> files;
+	std::vector<fs::path> pending{ permutation.GetSourcePath() };
+	while (!pending.empty())
+	{
+		const fs::path file = pending.back().lexically_normal();
+		pending.pop_back();
+		if (std::find(files.begin(), files.end(), file) != files.end())
+			continue;
+		files.push_back(file);
+
+		// a missing include is reported by the compiler
+		std::ifstream stream{ file };
+		std::vector<fs::path> includes;
+		std::string line;
+		while (std::getline(stream, line))
+		{
+			const size_t directive = line.find_first_not_of(" \t");
+			if (directive == std::string::npos || line.compare(directive, 8, "#include") != 0)
+				continue;
+			const size_t begin = line.find_first_of("\"<", directive + 8);
+			if (begin == std::string::npos)
+				continue;
+			const size_t end = line.find(line[begin] == '"' ? '"' : '>', begin + 1);
+			if (end == std::string::npos)
+				continue;
+			includes.push_back(ResolveInclude(
+				line.substr(begin + 1, end - begin - 1), line[begin] == '"', file));
+		}
+		pending.insert(pending.end(), includes.rbegin(), includes.rend());
+	}
+	return files;
+#else
+	return { permutation.GetSpirvPath() };
+#endif
+}
+
+std::vector<uint32_t> ShaderCompiler::Compile(const ShaderPermutation& permutation,
+	[[maybe_unused]] const std::string& source) const
+{
+#if defined(VKPBR_RUNTIME_SHADER_COMPILE)
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	const std::string path = permutation.GetSourcePath();
+
+	shaderc_shader_kind kind = shaderc_glsl_vertex_shader;
+	if (permutation.type == ShaderType::FRAGMENT)
+		kind = shaderc_glsl_fragment_shader;
+	else if (permutation.type == ShaderType::COMPUTE)
+		kind = shaderc_glsl_compute_shader;
+
+	// the same options as the `shaders` target, which runs glslc with its default environment
+	shaderc::CompileOptions options;
+	options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_0);
+	options.SetIncluder(std::make_unique<ShaderIncluder>());
+	if (permutation.features & ShaderFeature::PER_DRAW_UBO)
+		options.AddMacroDefinition("PER_DRAW_UBO");
+	if (permutation.features & ShaderFeature::INSTANCED)
+		options.AddMacroDefinition("INSTANCED");
+
+	// the compiler object is thread safe, but cheap enough to create per shader
+	const shaderc::Compiler compiler;
+	const shaderc::SpvCompilationResult result =
+		compiler.CompileGlslToSpv(source, kind, path.c_str(), options);
+	ErrCheck(result.GetCompilationStatus() != shaderc_compilation_status_success,
+		"Failed to compile shader {}:\n{}",
+		path,
+		result.GetErrorMessage());
+
+	Logger::Info("Compiled shader {} in {:.1f} ms",
+		permutation.GetSpirvPath(),
+		std::chrono::duration<float, std::chrono::milliseconds::period>(
+			std::chrono::high_resolution_clock::now() - startTime)
+			.count());
+	return { result.cbegin(), result.cend() };
+#else
+	LogAndThrow("Unable to compile shader {}, built without VKPBR_RUNTIME_SHADER_COMPILE",
+		permutation.GetSourcePath());
+	return {};
+#endif
+}
+
+std::vector<uint32_t> ShaderCompiler::LoadCached(uint64_t hash) const
+{
+	const fs::path path = fs::path{ m_CacheDir } / fmt::format("{:016x}.spv", hash);
+	std::string code;
+	if (!ReadFile(path, code))
+		return {};
+
+	// a file that was cut short is compiled again
+	std::vector<uint32_t> spirv(code.size() / sizeof(uint32_t));
+	std::memcpy(spirv.data(), code.data(), spirv.size() * sizeof(uint32_t));
+	if (code.size() % sizeof(uint32_t) != 0 || spirv.empty() || spirv[0] != g_SpirvMagic)
+		return {};
+	return spirv;
+}
+
+void ShaderCompiler::SaveCached(uint64_t hash, const std::vector<uint32_t>& spirv) const
+{
+	std::error_code error;
+	fs::create_directories(m_CacheDir, error);
+
+	// written next to the cache file and moved over it, like the pipeline cache
+	const fs::path path = fs::path{ m_CacheDir } / fmt::format("{:016x}.spv", hash);
+	const fs::path tempPath = fs::path{ path }.concat(".tmp");
+	{
+		std::ofstream file{ tempPath, std::ios::binary | std::ios::trunc };
+		file.write(reinterpret_cast<const char*>(spirv.data()),
+			static_cast<std::streamsize>(spirv.size() * sizeof(uint32_t)));
+		if (!file.good())
+		{
+			Logger::Warn("Unable to write shader cache \"{}\"", tempPath.generic_string());
+			return;
+		}
+	}
+
+	fs::rename(tempPath, path, error);
+	if (error)
+		Logger::Warn("Unable to write shader cache \"{}\"", path.generic_string());
+}
+
+void ShaderCompiler::Watch(const std::vector<fs::path>& files, const std::string& shaderName)
+{
+	const std::lock_guard<std::mutex> lock{ m_Mutex };
+	for (const auto& file : files)
+	{
+		const auto [it, isNew] = m_WatchedFiles.try_emplace(file.generic_string());
+		if (isNew)
+		{
+			std::error_code error;
+			it->second.lastWriteTime = fs::last_write_time(file, error);
+		}
+		it->second.shaderNames.insert(shaderName);
+	}
+}
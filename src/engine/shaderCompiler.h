@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "engine/shaderPermutation.h"
+
+
+// the SPIR-V of the shader permutations
+// with `VKPBR_RUNTIME_SHADER_COMPILE` the GLSL in assets/shaders is compiled at runtime with
+// libshaderc; the SPIR-V is cached in memory and in `cacheDir`, keyed by a hash of the source,
+// its includes and the defines of the permutation, so an unchanged shader is never compiled
+// again; the SPIR-V embedded in the executable (`EmbeddedShaders`) is only used if the source
+// is missing
+// without it the embedded SPIR-V is used if there is one, otherwise the `.spv` files of the
+// `shaders` target are loaded
+// the files a permutation was read from are watched, so changed shaders can be reloaded
+// thread safe
+class ShaderCompiler
+{
+public:
+	explicit ShaderCompiler(std::string cacheDir);
+	ShaderCompiler(const ShaderCompiler&) = delete;
+	ShaderCompiler(ShaderCompiler&&) = delete;
+	ShaderCompiler& operator=(const ShaderCompiler&) = delete;
+	ShaderCompiler& operator=(ShaderCompiler&&) = delete;
+
+	// throws if the shader is missing or doesn't compile; valid as long as the compiler
+	[[nodiscard]] SpirvView GetSpirv(const ShaderPermutation& permutation);
+
+	// the names of the shaders whose files changed since the last call
+	[[nodiscard]] std::vector<std::string> PollChangedShaders();
+
+private:
+	struct WatchedFile
+	{
+		std::filesystem::file_time_type lastWriteTime;
+		std::unordered_set<std::string> shaderNames; // the shaders that read the file
+	};
+
+	// the source file of `permutation` and the files it includes, in include order
+	[[nodiscard]] static std::vector<std::filesystem::path> GetSourceFiles(
+		const ShaderPermutation& permutation);
+	[[nodiscard]] std::vector<uint32_t> Compile(const ShaderPermutation& permutation,
+		const std::string& source) const;
+	[[nodiscard]] std::vector<uint32_t> LoadCached(uint64_t hash) const;
+	void SaveCached(uint64_t hash, const std::vector<uint32_t>& spirv) const;
+	void Watch(const std::vector<std::filesystem::path>& files, const std::string& shaderName);
+
+	std::string m_CacheDir;
+
+	std::mutex m_Mutex;
+	// by source hash; the vectors don't move when it grows
+	std::unordered_map<uint64_t, std::vector<uint32_t>> m_Spirv;
+	std::unordered_map<std::string, WatchedFile> m_WatchedFiles; // by path
+};
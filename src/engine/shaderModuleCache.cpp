@@ -0,0 +1,129 @@
+#include "engine/shaderModuleCache.h"
+
+#include <algorithm>
+#include "core/core.h"
+
+
+ShaderModuleCache::ShaderModuleCache(const std::unique_ptr<Device>& device) : m_Device{ device }
+{
+#if defined(VK_EXT_shader_module_identifier)
+	if (m_Device->IsShaderModuleIdentifierEnabled())
+	{
+		m_GetCreateInfoIdentifier =
+			vkGetDeviceProcAddr(m_Device->GetDevice(), "vkGetShaderModuleCreateInfoIdentifierEXT");
+	}
+#endif
+}
+
+ShaderModuleCache::~ShaderModuleCache()
+{
+	for (const auto& [hash, entry] : m_Entries)
+		vkDestroyShaderModule(m_Device->GetDevice(), entry.module, nullptr);
+}
+
+VkShaderModule ShaderModuleCache::GetModule(SpirvView spirv)
+{
+	const uint64_t hash = Hash(spirv);
+	{
+		const std::lock_guard<std::mutex> lock{ m_Mutex };
+		const Entry* entry = Find(hash, spirv);
+		if (entry != nullptr && entry->module != VK_NULL_HANDLE)
+			return entry->module;
+	}
+
+	// created without the lock; a thread that loses the race destroys its module
+	VkShaderModuleCreateInfo shaderModuleInfo{};
+	shaderModuleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	shaderModuleInfo.codeSize = spirv.GetSize(); // bytes
+	shaderModuleInfo.pCode = spirv.code;
+	VkShaderModule module{};
+	ErrCheck(vkCreateShaderModule(m_Device->GetDevice(), &shaderModuleInfo, nullptr, &module)
+				 != VK_SUCCESS,
+		"Failed to create shader module!");
+
+	const std::lock_guard<std::mutex> lock{ m_Mutex };
+	Entry& entry = FindOrAdd(hash, spirv);
+	if (entry.module != VK_NULL_HANDLE)
+	{
+		vkDestroyShaderModule(m_Device->GetDevice(), module, nullptr);
+		return entry.module;
+	}
+	entry.module = module;
+	++m_ModuleCount;
+	return module;
+}
+
+ShaderModuleIdentifier ShaderModuleCache::GetIdentifier([[maybe_unused]] SpirvView spirv)
+{
+#if defined(VK_EXT_shader_module_identifier)
+	if (m_GetCreateInfoIdentifier == nullptr)
+		return {};
+
+	const std::lock_guard<std::mutex> lock{ m_Mutex };
+	Entry& entry = FindOrAdd(Hash(spirv), spirv);
+	if (entry.module != VK_NULL_HANDLE)
+		return {};
+
+	if (entry.identifier.empty())
+	{
+		// hashes the code like the driver does for its pipeline cache, no module is created
+		VkShaderModuleCreateInfo shaderModuleInfo{};
+		shaderModuleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		shaderModuleInfo.codeSize = spirv.GetSize();
+		shaderModuleInfo.pCode = spirv.code;
+		VkShaderModuleIdentifierEXT identifier{};
+		identifier.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_IDENTIFIER_EXT;
+		reinterpret_cast<PFN_vkGetShaderModuleCreateInfoIdentifierEXT>(m_GetCreateInfoIdentifier)(
+			m_Device->GetDevice(), &shaderModuleInfo, &identifier);
+		entry.identifier.assign(
+			identifier.identifier, identifier.identifier + identifier.identifierSize);
+	}
+	return { entry.identifier.data(), static_cast<uint32_t>(entry.identifier.size()) };
+#else
+	return {};
+#endif
+}
+
+uint32_t ShaderModuleCache::GetModuleCount()
+{
+	const std::lock_guard<std::mutex> lock{ m_Mutex };
+	return m_ModuleCount;
+}
+
+ShaderModuleCache::Entry* ShaderModuleCache::Find(uint64_t hash, SpirvView spirv)
+{
+	const auto [begin, end] = m_Entries.equal_range(hash);
+	for (auto it = begin; it != end; ++it)
+	{
+		const std::vector<uint32_t>& code = it->second.code;
+		if (code.size() == spirv.wordCount && std::equal(code.begin(), code.end(), spirv.code))
+			return &it->second;
+	}
+	return nullptr;
+}
+
+ShaderModuleCache::Entry& ShaderModuleCache::FindOrAdd(uint64_t hash, SpirvView spirv)
+{
+	if (Entry* entry = Find(hash, spirv))
+		return *entry;
+
+	Entry& entry = m_Entries.emplace(hash, Entry{})->second;
+	entry.code.assign(spirv.code, spirv.code + spirv.wordCount);
+	return entry;
+}
+
+uint64_t ShaderModuleCache::Hash(SpirvView spirv)
+{
+	if (spirv.IsEmpty())
+		return 0;
+
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < spirv.wordCount; ++i)
+	{
+		hash ^= spirv.code[i];
+		hash *= 1099511628211ull;
+	}
+	hash ^= spirv.wordCount;
+	hash *= 1099511628211ull;
+	return hash;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "engine/device.h"
+#include "engine/shader.h"
+
+
+// the identifier of a shader module that was not created (VK_EXT_shader_module_identifier)
+struct ShaderModuleIdentifier
+{
+	const uint8_t* data = nullptr;
+	uint32_t size = 0;
+
+	[[nodiscard]] inline bool IsEmpty() const { return size == 0; }
+};
+
+// shader modules by their SPIR-V, shared by every pipeline that uses the same code; looked up by
+// its hash and compared word by word, so a hash collision never returns another shader's module
+// a module is only created when a pipeline needs it; with module identifiers a pipeline that is
+// in the pipeline cache is created without its modules
+// the modules live as long as the cache; thread safe
+class ShaderModuleCache
+{
+public:
+	explicit ShaderModuleCache(const std::unique_ptr<Device>& device);
+	~ShaderModuleCache();
+	ShaderModuleCache(const ShaderModuleCache&) = delete;
+	ShaderModuleCache(ShaderModuleCache&&) = delete;
+	ShaderModuleCache& operator=(const ShaderModuleCache&) = delete;
+	ShaderModuleCache& operator=(ShaderModuleCache&&) = delete;
+
+	// creates the module on the first call
+	[[nodiscard]] VkShaderModule GetModule(SpirvView spirv);
+	// empty if the module was already created, a pipeline can use it then, or the device
+	// doesn't support module identifiers
+	[[nodiscard]] ShaderModuleIdentifier GetIdentifier(SpirvView spirv);
+
+	[[nodiscard]] uint32_t GetModuleCount();
+
+	// FNV-1a of the words and the size; 0 for no code
+	[[nodiscard]] static uint64_t Hash(SpirvView spirv);
+
+private:
+	struct Entry
+	{
+		std::vector<uint32_t> code; // a copy, the views may be gone
+		VkShaderModule module = VK_NULL_HANDLE;
+		std::vector<uint8_t> identifier; // empty until it is queried
+	};
+
+	// the entry with the same code; the caller holds `m_Mutex`
+	[[nodiscard]] Entry* Find(uint64_t hash, SpirvView spirv);
+	[[nodiscard]] Entry& FindOrAdd(uint64_t hash, SpirvView spirv);
+
+	const std::unique_ptr<Device>& m_Device;
+	// `vkGetShaderModuleCreateInfoIdentifierEXT`, null without module identifiers
+	PFN_vkVoidFunction m_GetCreateInfoIdentifier = nullptr;
+
+	std::mutex m_Mutex;
+	// by SPIR-V hash, the entries don't move; colliding code gets an entry of its own
+	std::unordered_multimap<uint64_t, Entry> m_Entries;
+	uint32_t m_ModuleCount = 0;
+};
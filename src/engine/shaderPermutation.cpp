@@ -0,0 +1,61 @@
+#include "engine/shaderPermutation.h"
+
+#include "engine/clusteredLighting.h"
+
+
+static const char* GetExtension(ShaderType type)
+{
+	switch (type)
+	{
+	case ShaderType::VERTEX:
+		return ".vert";
+	case ShaderType::FRAGMENT:
+		return ".frag";
+	case ShaderType::COMPUTE:
+		return ".comp";
+	}
+	return "";
+}
+
+std::string ShaderPermutation::GetSourcePath() const
+{
+	return "assets/shaders/" + name + GetExtension(type);
+}
+
+std::string ShaderPermutation::GetSpirvPath() const
+{
+	std::string path = "assets/shaders/out/" + name + GetExtension(type);
+
+	// the shaders read the per-draw data from one place, instancing wins like in the shaders
+	if (features & ShaderFeature::INSTANCED)
+		path += ".instanced";
+	else if (features & ShaderFeature::PER_DRAW_UBO)
+		path += ".ubo";
+	return path + ".spv";
+}
+
+ShaderSpecialization::ShaderSpecialization(uint32_t features)
+{
+	for (uint32_t bit = 0; bit < ShaderFeature::SPECIALIZED_BIT_COUNT; ++bit)
+	{
+		if (ShaderFeature::SPECIALIZED & (1u << bit))
+			Add(bit, (features & (1u << bit)) ? VK_TRUE : VK_FALSE);
+	}
+	Add(ShaderConstant::MAX_LIGHTS_PER_CLUSTER, ClusteredLighting::MAX_LIGHTS_PER_CLUSTER);
+
+	m_Info.mapEntryCount = static_cast<uint32_t>(m_Entries.size());
+	m_Info.pMapEntries = m_Entries.data();
+	m_Info.dataSize = m_Data.size() * sizeof(uint32_t);
+	m_Info.pData = m_Data.data();
+}
+
+void ShaderSpecialization::Add(uint32_t constantId, uint32_t value)
+{
+	// a constant the shader doesn't declare is ignored
+	VkSpecializationMapEntry entry{};
+	entry.constantID = constantId;
+	entry.offset = static_cast<uint32_t>(m_Data.size() * sizeof(uint32_t));
+	entry.size = sizeof(uint32_t);
+	m_Entries.push_back(entry);
+	m_Data.push_back(value);
+}
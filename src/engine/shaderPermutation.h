@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "engine/shader.h"
+
+
+// feature bits of the shader permutations; a shader ignores the bits it doesn't declare
+namespace ShaderFeature {
+
+// compile time; a `.spv` file per permutation, built with `#define`s because they change the
+// resources the shader reads (`VKPBR_PER_DRAW_SHADERS` in CMakeLists.txt)
+constexpr uint32_t PER_DRAW_UBO = 1u << 0;
+constexpr uint32_t INSTANCED = 1u << 1;
+// `bool` specialization constants, the index of the bit is the `constant_id`; they are folded
+// when the pipeline is compiled, so the code of a disabled feature is removed, not branched over
+constexpr uint32_t NORMAL_MAPPING = 1u << 2;
+
+constexpr uint32_t COMPILED = PER_DRAW_UBO | INSTANCED;
+constexpr uint32_t SPECIALIZED = NORMAL_MAPPING;
+constexpr uint32_t SPECIALIZED_BIT_COUNT = 16; // the constant ids below are the engine's
+
+// where the scene shaders read the per-draw data from; instancing wins over push constants
+[[nodiscard]] constexpr uint32_t GetPerDrawFeatures(bool instanced, bool pushConstants)
+{
+	if (instanced)
+		return INSTANCED;
+	return pushConstants ? 0 : PER_DRAW_UBO;
+}
+
+} // namespace ShaderFeature
+
+// `constant_id`s of the engine constants every shader is specialized with, so the shaders don't
+// repeat them
+namespace ShaderConstant {
+
+constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 16; // `ClusteredLighting::MAX_LIGHTS_PER_CLUSTER`
+
+} // namespace ShaderConstant
+
+// a shader requested by its source file and feature bits
+struct ShaderPermutation
+{
+	std::string name; // source file in assets/shaders without the extension; empty for none
+	ShaderType type = ShaderType::VERTEX;
+	uint32_t features = 0;
+
+	// the GLSL file in assets/shaders
+	[[nodiscard]] std::string GetSourcePath() const;
+	// the `.spv` file of the compile time features, built by the `shaders` target
+	[[nodiscard]] std::string GetSpirvPath() const;
+	[[nodiscard]] inline bool IsEmpty() const { return name.empty(); }
+
+	[[nodiscard]] bool operator==(const ShaderPermutation& other) const
+	{
+		return name == other.name && type == other.type && features == other.features;
+	}
+	[[nodiscard]] bool operator!=(const ShaderPermutation& other) const
+	{
+		return !(*this == other);
+	}
+};
+
+// the specialization constants of a permutation; `Get()` points into the object, so it has to
+// outlive the pipeline creation
+class ShaderSpecialization
+{
+public:
+	// also the engine constants for shaders without features, like the compute shaders
+	explicit ShaderSpecialization(uint32_t features = 0);
+	ShaderSpecialization(const ShaderSpecialization&) = delete;
+	ShaderSpecialization(ShaderSpecialization&&) = delete;
+	ShaderSpecialization& operator=(const ShaderSpecialization&) = delete;
+	ShaderSpecialization& operator=(ShaderSpecialization&&) = delete;
+
+	[[nodiscard]] inline const VkSpecializationInfo* Get() const { return &m_Info; }
+
+private:
+	void Add(uint32_t constantId, uint32_t value);
+
+	std::vector<uint32_t> m_Data; // `VkBool32` for the feature bits
+	std::vector<VkSpecializationMapEntry> m_Entries;
+	VkSpecializationInfo m_Info{};
+};
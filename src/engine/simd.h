@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+
+// AVX has to be enabled for the whole build (VKPBR_ENABLE_AVX), SSE2 is part of x86-64
+#if defined(__AVX__)
+	#include <immintrin.h>
+	#define VKPBR_SIMD_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define VKPBR_SIMD_SSE
+#endif
+
+
+// thin wrappers around the float intrinsics, so the SIMD loops are written once for SSE and AVX
+// `SimdNative` is the widest one the build supports; without SSE2 the loops fall back to their
+// scalar tails
+#if defined(VKPBR_SIMD_AVX)
+struct SimdAvx
+{
+	using Float = __m256;
+	static constexpr uint32_t width = 8;
+
+	static inline Float Load(const float* data) { return _mm256_loadu_ps(data); }
+	static inline void Store(float* data, Float a) { _mm256_storeu_ps(data, a); }
+	static inline Float Set(float value) { return _mm256_set1_ps(value); }
+	// 0, 1, 2, ...
+	static inline Float Ramp()
+	{
+		return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+	}
+	static inline Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+	static inline Float Sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+	static inline Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+	static inline Float Min(Float a, Float b) { return _mm256_min_ps(a, b); }
+	static inline Float Max(Float a, Float b) { return _mm256_max_ps(a, b); }
+	static inline Float And(Float a, Float b) { return _mm256_and_ps(a, b); }
+	// `mask ? a : b` per lane
+	static inline Float Select(Float mask, Float a, Float b)
+	{
+		return _mm256_blendv_ps(b, a, mask);
+	}
+	static inline Float GreaterEqual(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+	static inline uint32_t MoveMask(Float a)
+	{
+		return static_cast<uint32_t>(_mm256_movemask_ps(a));
+	}
+};
+using SimdNative = SimdAvx;
+#elif defined(VKPBR_SIMD_SSE)
+struct SimdSse
+{
+	using Float = __m128;
+	static constexpr uint32_t width = 4;
+
+	static inline Float Load(const float* data) { return _mm_loadu_ps(data); }
+	static inline void Store(float* data, Float a) { _mm_storeu_ps(data, a); }
+	static inline Float Set(float value) { return _mm_set1_ps(value); }
+	// 0, 1, 2, ...
+	static inline Float Ramp() { return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); }
+	static inline Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+	static inline Float Sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+	static inline Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+	static inline Float Min(Float a, Float b) { return _mm_min_ps(a, b); }
+	static inline Float Max(Float a, Float b) { return _mm_max_ps(a, b); }
+	static inline Float And(Float a, Float b) { return _mm_and_ps(a, b); }
+	// `mask ? a : b` per lane; SSE2 has no blend
+	static inline Float Select(Float mask, Float a, Float b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+	static inline Float GreaterEqual(Float a, Float b) { return _mm_cmpge_ps(a, b); }
+	static inline uint32_t MoveMask(Float a) { return static_cast<uint32_t>(_mm_movemask_ps(a)); }
+};
+using SimdNative = SimdSse;
+#endif
+
+#if defined(VKPBR_SIMD_AVX) || defined(VKPBR_SIMD_SSE)
+	#define VKPBR_SIMD
+#endif
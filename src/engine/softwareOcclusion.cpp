@@ -0,0 +1,351 @@
+#include "engine/softwareOcclusion.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "engine/simd.h"
+
+
+// rows rasterized by one job
+constexpr uint32_t g_OcclusionBandHeight = 8;
+// objects tested by one job
+constexpr uint32_t g_OcclusionBatchSize = 1024;
+// twice the screen area of a triangle in pixels; smaller ones are skipped
+constexpr float g_MinTriangleArea = 1e-6f;
+// the stride is padded to the widest SIMD register
+constexpr uint32_t g_MaxSimdWidth = 8;
+
+SoftwareOcclusion::SoftwareOcclusion(JobSystem& jobSystem, uint32_t width, uint32_t height)
+	: m_JobSystem{ jobSystem },
+	  m_Width{ width },
+	  m_Height{ height },
+	  m_Stride{ (width + g_MaxSimdWidth - 1) / g_MaxSimdWidth * g_MaxSimdWidth },
+	  m_Depth(static_cast<size_t>(m_Stride) * height, 1.0f)
+{}
+
+void SoftwareOcclusion::ClearOccluders()
+{
+	m_OccluderVertices.clear();
+}
+
+void SoftwareOcclusion::AddOccluder(const glm::mat4& model,
+	const std::vector<glm::vec3>& vertices,
+	const std::vector<uint32_t>& indices)
+{
+	m_OccluderVertices.reserve(m_OccluderVertices.size() + indices.size());
+	for (const uint32_t index : indices)
+		m_OccluderVertices.emplace_back(model * glm::vec4(vertices[index], 1.0f));
+}
+
+void SoftwareOcclusion::AddOccluderBox(const glm::mat4& model,
+	const glm::vec3& boxMin,
+	const glm::vec3& boxMax)
+{
+	// corner `i` takes the max of the axes whose bit is set
+	std::vector<glm::vec3> corners(8);
+	for (uint32_t i = 0; i < corners.size(); ++i)
+	{
+		corners[i] = { (i & 1) != 0 ? boxMax.x : boxMin.x,
+			(i & 2) != 0 ? boxMax.y : boxMin.y,
+			(i & 4) != 0 ? boxMax.z : boxMin.z };
+	}
+
+	// the winding does not matter, both sides are rasterized
+	static const std::vector<uint32_t> indices{
+		0, 1, 3, 0, 3, 2, // -z
+		4, 5, 7, 4, 7, 6, // +z
+		0, 1, 5, 0, 5, 4, // -y
+		2, 3, 7, 2, 7, 6, // +y
+		0, 2, 6, 0, 6, 4, // -x
+		1, 3, 7, 1, 7, 5, // +x
+	};
+	AddOccluder(model, corners, indices);
+}
+
+void SoftwareOcclusion::Rasterize(const glm::mat4& viewProjection)
+{
+	m_ViewProjection = viewProjection;
+	SetupTriangles();
+
+	// every band clears and writes its own rows
+	const uint32_t bandCount = (m_Height + g_OcclusionBandHeight - 1) / g_OcclusionBandHeight;
+	JobCounter rasterCounter;
+	m_JobSystem.ParallelFor(
+		bandCount,
+		1,
+		[this](uint32_t begin, uint32_t end) {
+			for (uint32_t band = begin; band < end; ++band)
+			{
+				const uint32_t firstRow = band * g_OcclusionBandHeight;
+				const uint32_t lastRow = std::min(firstRow + g_OcclusionBandHeight, m_Height) - 1;
+				RasterizeBand(static_cast<int32_t>(firstRow), static_cast<int32_t>(lastRow));
+			}
+		},
+		rasterCounter);
+	m_JobSystem.Wait(rasterCounter);
+}
+
+bool SoftwareOcclusion::IsOccluded(const glm::vec3& aabbMin, const glm::vec3& aabbMax) const
+{
+	glm::vec3 ndcMin{ std::numeric_limits<float>::max() };
+	glm::vec3 ndcMax{ std::numeric_limits<float>::lowest() };
+	for (uint32_t i = 0; i < 8; ++i)
+	{
+		const glm::vec3 corner{ (i & 1) != 0 ? aabbMax.x : aabbMin.x,
+			(i & 2) != 0 ? aabbMax.y : aabbMin.y,
+			(i & 4) != 0 ? aabbMax.z : aabbMin.z };
+		const glm::vec4 clip = m_ViewProjection * glm::vec4(corner, 1.0f);
+		if (clip.z < 0.0f || clip.w <= 0.0f)
+			return false;
+
+		const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		ndcMin = glm::min(ndcMin, ndc);
+		ndcMax = glm::max(ndcMax, ndc);
+	}
+
+	// every pixel the screen rectangle touches
+	const auto width = static_cast<float>(m_Width);
+	const auto height = static_cast<float>(m_Height);
+	const auto minX =
+		static_cast<int32_t>(std::clamp(std::floor((ndcMin.x * 0.5f + 0.5f) * width), 0.0f, width));
+	const auto minY = static_cast<int32_t>(
+		std::clamp(std::floor((ndcMin.y * 0.5f + 0.5f) * height), 0.0f, height));
+	const auto maxX = static_cast<int32_t>(
+		std::clamp(std::floor((ndcMax.x * 0.5f + 0.5f) * width), -1.0f, width - 1.0f));
+	const auto maxY = static_cast<int32_t>(
+		std::clamp(std::floor((ndcMax.y * 0.5f + 0.5f) * height), -1.0f, height - 1.0f));
+	if (minX > maxX || minY > maxY)
+		return false;
+
+	for (int32_t y = minY; y <= maxY; ++y)
+	{
+		if (IsRowVisible(y, minX, maxX, ndcMin.z))
+			return false;
+	}
+
+	return true;
+}
+
+void SoftwareOcclusion::Cull(const CullingBounds& bounds, std::vector<uint32_t>& visible)
+{
+	const auto count = static_cast<uint32_t>(visible.size());
+	m_Occluded.resize(count);
+
+	JobCounter cullCounter;
+	m_JobSystem.ParallelFor(
+		count,
+		g_OcclusionBatchSize,
+		[this, &bounds, &visible](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				const uint32_t index = visible[i];
+				m_Occluded[i] = IsOccluded(
+					{ bounds.m_MinX[index], bounds.m_MinY[index], bounds.m_MinZ[index] },
+					{ bounds.m_MaxX[index], bounds.m_MaxY[index], bounds.m_MaxZ[index] });
+			}
+		},
+		cullCounter);
+	m_JobSystem.Wait(cullCounter);
+
+	uint32_t visibleCount = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		visible[visibleCount] = visible[i];
+		visibleCount += 1u - m_Occluded[i];
+	}
+	visible.resize(visibleCount);
+}
+
+void SoftwareOcclusion::SetupTriangles()
+{
+	m_Triangles.clear();
+
+	const auto width = static_cast<float>(m_Width);
+	const auto height = static_cast<float>(m_Height);
+	for (size_t i = 0; i + 2 < m_OccluderVertices.size(); i += 3)
+	{
+		std::array<glm::vec3, 3> screen{};
+		bool crossesNearPlane = false;
+		for (size_t v = 0; v < screen.size(); ++v)
+		{
+			const glm::vec4 clip = m_ViewProjection * glm::vec4(m_OccluderVertices[i + v], 1.0f);
+			// skipping an occluder never hides anything, so these are not clipped
+			if (clip.z < 0.0f || clip.w <= 0.0f)
+			{
+				crossesNearPlane = true;
+				break;
+			}
+
+			const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+			screen[v] = { (ndc.x * 0.5f + 0.5f) * width, (ndc.y * 0.5f + 0.5f) * height, ndc.z };
+		}
+		if (crossesNearPlane)
+			continue;
+
+		// both windings are rasterized, the inside of the edges is made positive
+		glm::vec3 edge1 = screen[1] - screen[0];
+		glm::vec3 edge2 = screen[2] - screen[0];
+		float area = edge1.x * edge2.y - edge2.x * edge1.y;
+		if (std::abs(area) < g_MinTriangleArea)
+			continue;
+		if (area < 0.0f)
+		{
+			std::swap(screen[1], screen[2]);
+			std::swap(edge1, edge2);
+			area = -area;
+		}
+
+		Triangle triangle{};
+		triangle.minX = static_cast<int32_t>(std::clamp(
+			std::floor(std::min({ screen[0].x, screen[1].x, screen[2].x })), 0.0f, width));
+		triangle.minY = static_cast<int32_t>(std::clamp(
+			std::floor(std::min({ screen[0].y, screen[1].y, screen[2].y })), 0.0f, height));
+		triangle.maxX = static_cast<int32_t>(std::clamp(
+			std::floor(std::max({ screen[0].x, screen[1].x, screen[2].x })), -1.0f, width - 1.0f));
+		triangle.maxY = static_cast<int32_t>(std::clamp(
+			std::floor(std::max({ screen[0].y, screen[1].y, screen[2].y })), -1.0f, height - 1.0f));
+		if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+			continue;
+
+		for (size_t e = 0; e < screen.size(); ++e)
+		{
+			const glm::vec3& from = screen[e];
+			const glm::vec3& to = screen[(e + 1) % screen.size()];
+			triangle.edgeA[e] = from.y - to.y;
+			triangle.edgeB[e] = to.x - from.x;
+			triangle.edgeC[e] = from.x * to.y - from.y * to.x;
+		}
+
+		// the depth plane, moved to the farthest corner of every pixel
+		const float depthDx = (edge1.z * edge2.y - edge2.z * edge1.y) / area;
+		const float depthDy = (edge2.z * edge1.x - edge1.z * edge2.x) / area;
+		triangle.depthA = depthDx;
+		triangle.depthB = depthDy;
+		triangle.depthC = screen[0].z - depthDx * screen[0].x - depthDy * screen[0].y
+						  + 0.5f * (std::abs(depthDx) + std::abs(depthDy));
+		triangle.maxDepth = std::max({ screen[0].z, screen[1].z, screen[2].z });
+
+		m_Triangles.push_back(triangle);
+	}
+}
+
+void SoftwareOcclusion::RasterizeBand(int32_t firstRow, int32_t lastRow)
+{
+	std::fill(m_Depth.begin() + static_cast<ptrdiff_t>(firstRow) * m_Stride,
+		m_Depth.begin() + static_cast<ptrdiff_t>(lastRow + 1) * m_Stride,
+		1.0f);
+
+	for (const auto& triangle : m_Triangles)
+	{
+		const int32_t lastTriangleRow = std::min(lastRow, triangle.maxY);
+		for (int32_t y = std::max(firstRow, triangle.minY); y <= lastTriangleRow; ++y)
+			RasterizeRow(triangle, y);
+	}
+}
+
+void SoftwareOcclusion::RasterizeRow(const Triangle& triangle, int32_t y)
+{
+	// sampled at the pixel centers
+	const float centerY = static_cast<float>(y) + 0.5f;
+	const std::array<float, 3> rowEdges{ triangle.edgeB[0] * centerY + triangle.edgeC[0],
+		triangle.edgeB[1] * centerY + triangle.edgeC[1],
+		triangle.edgeB[2] * centerY + triangle.edgeC[2] };
+	const float rowDepth = triangle.depthB * centerY + triangle.depthC;
+	float* row = m_Depth.data() + static_cast<size_t>(y) * m_Stride;
+
+#if defined(VKPBR_SIMD)
+	RasterizeRowSimd<SimdNative>(triangle, rowEdges, rowDepth, row);
+#else
+	for (int32_t x = triangle.minX; x <= triangle.maxX; ++x)
+	{
+		const float centerX = static_cast<float>(x) + 0.5f;
+		if (triangle.edgeA[0] * centerX + rowEdges[0] >= 0.0f
+			&& triangle.edgeA[1] * centerX + rowEdges[1] >= 0.0f
+			&& triangle.edgeA[2] * centerX + rowEdges[2] >= 0.0f)
+		{
+			const float depth = std::min(triangle.depthA * centerX + rowDepth, triangle.maxDepth);
+			row[x] = std::min(row[x], depth);
+		}
+	}
+#endif
+}
+
+bool SoftwareOcclusion::IsRowVisible(int32_t y, int32_t minX, int32_t maxX, float depth) const
+{
+	const float* row = m_Depth.data() + static_cast<size_t>(y) * m_Stride;
+
+#if defined(VKPBR_SIMD)
+	return IsRowVisibleSimd<SimdNative>(row, minX, maxX, depth);
+#else
+	for (int32_t x = minX; x <= maxX; ++x)
+	{
+		if (row[x] >= depth)
+			return true;
+	}
+	return false;
+#endif
+}
+
+template<typename Simd>
+void SoftwareOcclusion::RasterizeRowSimd(const Triangle& triangle,
+	const std::array<float, 3>& rowEdges,
+	float rowDepth,
+	float* row)
+{
+	using Float = typename Simd::Float;
+
+	const Float zero = Simd::Set(0.0f);
+	const Float ramp = Simd::Ramp();
+	const Float edgeA0 = Simd::Set(triangle.edgeA[0]);
+	const Float edgeA1 = Simd::Set(triangle.edgeA[1]);
+	const Float edgeA2 = Simd::Set(triangle.edgeA[2]);
+	const Float rowEdge0 = Simd::Set(rowEdges[0]);
+	const Float rowEdge1 = Simd::Set(rowEdges[1]);
+	const Float rowEdge2 = Simd::Set(rowEdges[2]);
+	const Float depthA = Simd::Set(triangle.depthA);
+	const Float rowDepthV = Simd::Set(rowDepth);
+	const Float maxDepth = Simd::Set(triangle.maxDepth);
+
+	// whole registers from an aligned pixel; the pixels outside of the triangle fail the edge
+	// tests and the stride is padded
+	const auto firstX =
+		static_cast<int32_t>(static_cast<uint32_t>(triangle.minX) & ~(Simd::width - 1));
+	for (int32_t x = firstX; x <= triangle.maxX; x += static_cast<int32_t>(Simd::width))
+	{
+		const Float centerX = Simd::Add(Simd::Set(static_cast<float>(x) + 0.5f), ramp);
+		const Float inside = Simd::And(
+			Simd::And(Simd::GreaterEqual(Simd::Add(Simd::Mul(edgeA0, centerX), rowEdge0), zero),
+				Simd::GreaterEqual(Simd::Add(Simd::Mul(edgeA1, centerX), rowEdge1), zero)),
+			Simd::GreaterEqual(Simd::Add(Simd::Mul(edgeA2, centerX), rowEdge2), zero));
+		if (Simd::MoveMask(inside) == 0)
+			continue;
+
+		const Float depth = Simd::Min(Simd::Add(Simd::Mul(depthA, centerX), rowDepthV), maxDepth);
+		const Float current = Simd::Load(row + x);
+		Simd::Store(row + x, Simd::Select(inside, Simd::Min(current, depth), current));
+	}
+}
+
+template<typename Simd>
+bool SoftwareOcclusion::IsRowVisibleSimd(const float* row, int32_t minX, int32_t maxX, float depth)
+{
+	using Float = typename Simd::Float;
+
+	const Float ramp = Simd::Ramp();
+	const Float first = Simd::Set(static_cast<float>(minX));
+	const Float last = Simd::Set(static_cast<float>(maxX));
+	const Float depthV = Simd::Set(depth);
+
+	const auto firstX = static_cast<int32_t>(static_cast<uint32_t>(minX) & ~(Simd::width - 1));
+	for (int32_t x = firstX; x <= maxX; x += static_cast<int32_t>(Simd::width))
+	{
+		const Float pixelX = Simd::Add(Simd::Set(static_cast<float>(x)), ramp);
+		const Float inRect =
+			Simd::And(Simd::GreaterEqual(pixelX, first), Simd::GreaterEqual(last, pixelX));
+		const Float uncovered = Simd::GreaterEqual(Simd::Load(row + x), depthV);
+		if (Simd::MoveMask(Simd::And(inRect, uncovered)) != 0)
+			return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "core/jobSystem.h"
+#include "engine/cpuCulling.h"
+
+
+// occlusion culling on the CPU, similar to masked occlusion culling without the coverage masks
+// a few low-poly occluders are rasterized into a small depth buffer, several pixels per SIMD
+// instruction and bands of rows in parallel on the job system; an object is occluded if the
+// occluders are in front of its AABB on every pixel of its screen rectangle
+// occluders have to lie inside the geometry they stand for; coverage is sampled at the pixel
+// centers and every covered pixel keeps the farthest depth the occluder has in it
+class SoftwareOcclusion
+{
+public:
+	SoftwareOcclusion(JobSystem& jobSystem, uint32_t width, uint32_t height);
+
+	void ClearOccluders();
+	// model space triangles, 3 indices per triangle
+	void AddOccluder(const glm::mat4& model,
+		const std::vector<glm::vec3>& vertices,
+		const std::vector<uint32_t>& indices);
+	void AddOccluderBox(const glm::mat4& model, const glm::vec3& boxMin, const glm::vec3& boxMax);
+
+	// clears the depth buffer and rasterizes the occluders
+	void Rasterize(const glm::mat4& viewProjection);
+
+	// tests a world space AABB against the last rasterized depth; objects that cross the near
+	// plane or lie outside of the screen are never occluded
+	[[nodiscard]] bool IsOccluded(const glm::vec3& aabbMin, const glm::vec3& aabbMax) const;
+	// removes the occluded objects from `visible`, indices into `bounds`; keeps the order
+	void Cull(const CullingBounds& bounds, std::vector<uint32_t>& visible);
+
+	[[nodiscard]] inline uint32_t GetWidth() const { return m_Width; }
+	[[nodiscard]] inline uint32_t GetHeight() const { return m_Height; }
+	// rows of `GetStride()` floats, 0 is the near plane
+	[[nodiscard]] inline const float* GetDepth() const { return m_Depth.data(); }
+	[[nodiscard]] inline uint32_t GetStride() const { return m_Stride; }
+	[[nodiscard]] inline uint32_t GetOccluderTriangleCount() const
+	{
+		return static_cast<uint32_t>(m_OccluderVertices.size() / 3);
+	}
+
+private:
+	// a screen space triangle set up for the rasterization
+	struct Triangle
+	{
+		// `a * x + b * y + c`, positive inside
+		std::array<float, 3> edgeA;
+		std::array<float, 3> edgeB;
+		std::array<float, 3> edgeC;
+		// the farthest depth inside a pixel, clamped to `maxDepth`
+		float depthA;
+		float depthB;
+		float depthC;
+		float maxDepth;
+		// covered pixels, clamped to the depth buffer
+		int32_t minX;
+		int32_t minY;
+		int32_t maxX;
+		int32_t maxY;
+	};
+
+	void SetupTriangles();
+	void RasterizeBand(int32_t firstRow, int32_t lastRow);
+	void RasterizeRow(const Triangle& triangle, int32_t y);
+	// returns true if the occluders are not in front of `depth` on some pixel in [minX, maxX]
+	[[nodiscard]] bool IsRowVisible(int32_t y, int32_t minX, int32_t maxX, float depth) const;
+
+	template<typename Simd>
+	static void RasterizeRowSimd(const Triangle& triangle,
+		const std::array<float, 3>& rowEdges,
+		float rowDepth,
+		float* row);
+	template<typename Simd>
+	static bool IsRowVisibleSimd(const float* row, int32_t minX, int32_t maxX, float depth);
+
+	JobSystem& m_JobSystem;
+
+	uint32_t m_Width;
+	uint32_t m_Height;
+	uint32_t m_Stride; // padded to whole SIMD registers
+	glm::mat4 m_ViewProjection{ 1.0f };
+	std::vector<float> m_Depth;
+
+	std::vector<glm::vec3> m_OccluderVertices; // world space, 3 per triangle
+	std::vector<Triangle> m_Triangles; // the ones in front of the near plane
+	std::vector<uint8_t> m_Occluded; // per entry of `visible` in `Cull()`
+};
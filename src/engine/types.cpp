@@ -5,6 +5,9 @@ const bool Config::enableValidationLayers = false;
 #else // debug mode
 const bool Config::enableValidationLayers = true;
 #endif
-const uint32_t Config::maxFramesInFlight = 2;
+// upper bound; the number used at runtime is `RenderSettings::framesInFlight`
+const uint32_t Config::maxFramesInFlight = 3;
+// number of dynamic matrix UBO slots per frame (used when push constants are not available)
+const uint32_t Config::maxDrawsPerFrame = 4096;
 const std::array<const char*, 1> Config::deviceExtensions{ VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 const std::array<const char*, 1> Config::validationLayers{ "VK_LAYER_KHRONOS_validation" };
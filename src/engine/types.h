@@ -12,6 +12,7 @@ struct Config
 public:
 	const static bool enableValidationLayers;
 	const static uint32_t maxFramesInFlight;
+	const static uint32_t maxDrawsPerFrame;
 	const static std::array<const char*, 1> validationLayers;
 	const static std::array<const char*, 1> deviceExtensions;
 };
@@ -91,6 +92,28 @@ struct Vertex
 		return attrDesc;
 	}
 
+	// the position-only stream of the depth pre-pass, tightly packed positions
+	static VkVertexInputBindingDescription GetPositionBindingDescription()
+	{
+		VkVertexInputBindingDescription bindingDesc{};
+		bindingDesc.binding = 0;
+		bindingDesc.stride = sizeof(glm::vec3);
+		bindingDesc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		return bindingDesc;
+	}
+
+	static VkVertexInputAttributeDescription GetPositionAttributeDescription()
+	{
+		VkVertexInputAttributeDescription attrDesc{};
+		attrDesc.location = 0;
+		attrDesc.binding = 0;
+		attrDesc.format = VK_FORMAT_R32G32B32_SFLOAT;
+		attrDesc.offset = 0;
+
+		return attrDesc;
+	}
+
 	// hash function
 	bool operator==(const Vertex& other) const
 	{
@@ -116,8 +139,7 @@ struct hash<Vertex>
 struct SceneUBO
 {
 	alignas(16) glm::vec3 cameraPos;
-	alignas(16)
-		glm::vec4 lightPos[4]; // vec4 for alignment; the shader uses only the first 3 components
+	alignas(16) glm::vec3 lightPos; // the phong light
 	alignas(16) glm::vec3 lightColors;
 
 	[[nodiscard]] static inline uint64_t GetSize() { return sizeof(SceneUBO); }
@@ -131,3 +153,19 @@ struct MatrixUBO
 
 	[[nodiscard]] static inline uint64_t GetSize() { return sizeof(glm::mat4) * 3; }
 };
+
+// per-draw data; pushed with `vkCmdPushConstants()` when it fits in `maxPushConstantsSize`,
+// otherwise written into a slot of the dynamic matrix UBO
+// 128 bytes, the size every device guarantees; the UBO path stays for larger payloads and is run
+// on every device with the "Push constants" checkbox, which compares the recording cost of both
+struct PerDrawData
+{
+	alignas(16) glm::mat4 model;
+	alignas(16) glm::mat4 normal; // inverse transpose of `model`, once per draw, not per vertex
+
+	[[nodiscard]] static inline uint32_t GetSize() { return sizeof(PerDrawData); }
+	[[nodiscard]] static inline bool FitsInPushConstants(uint32_t maxPushConstantsSize)
+	{
+		return GetSize() <= maxPushConstantsSize;
+	}
+};
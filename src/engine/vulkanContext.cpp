@@ -30,8 +30,9 @@ void VulkanContext::Init(const char* title)
 	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 	appInfo.pEngineName = "No Engine";
 	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-	appInfo.apiVersion =
-		VK_API_VERSION_1_0; // the highest version the application is designed to use
+	// the highest version the application is designed to use
+	// 1.2 for timeline semaphores
+	appInfo.apiVersion = VK_API_VERSION_1_2;
 
 	VkInstanceCreateInfo instanceInfo{};
 	instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
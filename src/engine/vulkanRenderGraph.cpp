@@ -0,0 +1,203 @@
+#include "engine/vulkanRenderGraph.h"
+
+#include <algorithm>
+#include "core/core.h"
+#include "utils/utils.h"
+
+
+VulkanRenderGraphBackend::VulkanRenderGraphBackend(const std::unique_ptr<Device>& device)
+	: m_Device{ device }
+{}
+
+VulkanRenderGraphBackend::~VulkanRenderGraphBackend()
+{
+	Release();
+}
+
+RenderGraphMemoryRequirements VulkanRenderGraphBackend::GetMemoryRequirements(
+	const RenderGraphImageDesc& desc,
+	VkImageUsageFlags usage)
+{
+	// the requirements are only known for an existing image
+	VkImage image = CreateImage(desc, usage);
+	VkMemoryRequirements memRequirements{};
+	vkGetImageMemoryRequirements(m_Device->GetDevice(), image, &memRequirements);
+	vkDestroyImage(m_Device->GetDevice(), image, nullptr);
+
+	return RenderGraphMemoryRequirements{ memRequirements.size,
+		memRequirements.alignment,
+		memRequirements.memoryTypeBits };
+}
+
+void VulkanRenderGraphBackend::Realize(const RenderGraph& graph)
+{
+	Release();
+
+	m_Images.resize(graph.GetImageCount());
+	for (RenderGraphResource i = 0; i < graph.GetImageCount(); ++i)
+		m_Images[i].aspectMask = GetAspectMask(graph.GetImageDesc(i).format);
+
+	for (const auto& block : graph.GetMemoryBlocks())
+	{
+		VkMemoryAllocateInfo memAllocInfo{};
+		memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		memAllocInfo.allocationSize = block.requirements.size;
+		memAllocInfo.memoryTypeIndex = utils::FindMemoryType(m_Device->GetDeviceMemoryProperties(),
+			block.requirements.memoryTypeBits,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		VkDeviceMemory memory{};
+		ErrCheck(
+			vkAllocateMemory(m_Device->GetDevice(), &memAllocInfo, nullptr, &memory) != VK_SUCCESS,
+			"Failed to allocate render graph memory!");
+		m_MemoryBlocks.push_back(memory);
+
+		for (const RenderGraphResource resource : block.resources)
+		{
+			const RenderGraphImageDesc& desc = graph.GetImageDesc(resource);
+			Image& image = m_Images[resource];
+			image.image = CreateImage(desc, graph.GetImageUsage(resource));
+			vkBindImageMemory(m_Device->GetDevice(), image.image, memory, 0);
+			// the stencil aspect is only needed for the layout transitions
+			image.imageView = utils::CreateImageView(m_Device->GetDevice(),
+				image.image,
+				desc.format,
+				VK_IMAGE_VIEW_TYPE_2D,
+				image.aspectMask & ~VK_IMAGE_ASPECT_STENCIL_BIT,
+				1,
+				1);
+			image.owned = true;
+		}
+	}
+
+	const auto transientImageCount = std::count_if(
+		m_Images.begin(), m_Images.end(), [](const Image& image) { return image.owned; });
+	Logger::Info("Render graph: {} passes, {} transient images in {} memory blocks",
+		graph.GetCompiledPasses().size(),
+		transientImageCount,
+		m_MemoryBlocks.size());
+}
+
+void VulkanRenderGraphBackend::Release()
+{
+	for (const auto& image : m_Images)
+	{
+		if (!image.owned)
+			continue;
+
+		vkDestroyImageView(m_Device->GetDevice(), image.imageView, nullptr);
+		vkDestroyImage(m_Device->GetDevice(), image.image, nullptr);
+	}
+	m_Images.clear();
+
+	for (const auto& memory : m_MemoryBlocks)
+		vkFreeMemory(m_Device->GetDevice(), memory, nullptr);
+	m_MemoryBlocks.clear();
+}
+
+void VulkanRenderGraphBackend::SetImportedImage(RenderGraphResource resource,
+	VkImage image,
+	VkImageView imageView)
+{
+	m_Images[resource].image = image;
+	m_Images[resource].imageView = imageView;
+}
+
+void VulkanRenderGraphBackend::Execute(const RenderGraph& graph, VkCommandBuffer cmdBuff) const
+{
+	for (const auto& compiledPass : graph.GetCompiledPasses())
+	{
+		RecordBarriers(compiledPass.barriers, cmdBuff);
+		graph.ExecutePass(compiledPass.pass, cmdBuff);
+	}
+	RecordBarriers(graph.GetFinalBarriers(), cmdBuff);
+}
+
+VkImage VulkanRenderGraphBackend::CreateImage(const RenderGraphImageDesc& desc,
+	VkImageUsageFlags usage) const
+{
+	VkImageCreateInfo imgInfo{};
+	imgInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imgInfo.imageType = VK_IMAGE_TYPE_2D;
+	imgInfo.extent.width = desc.extent.width;
+	imgInfo.extent.height = desc.extent.height;
+	imgInfo.extent.depth = 1;
+	imgInfo.mipLevels = 1;
+	imgInfo.arrayLayers = 1;
+	imgInfo.format = desc.format;
+	imgInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imgInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imgInfo.usage = usage;
+	imgInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imgInfo.samples = desc.samples;
+
+	VkImage image{};
+	ErrCheck(vkCreateImage(m_Device->GetDevice(), &imgInfo, nullptr, &image) != VK_SUCCESS,
+		"Failed to create image object!");
+
+	return image;
+}
+
+void VulkanRenderGraphBackend::RecordBarriers(const std::vector<RenderGraphBarrier>& barriers,
+	VkCommandBuffer cmdBuff) const
+{
+	if (barriers.empty())
+		return;
+
+	// all barriers before a pass are recorded with one call
+	VkPipelineStageFlags srcStageMask = 0;
+	VkPipelineStageFlags dstStageMask = 0;
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+	imageBarriers.reserve(barriers.size());
+	for (const auto& barrier : barriers)
+	{
+		const Image& image = m_Images[barrier.resource];
+
+		VkImageMemoryBarrier imageBarrier{};
+		imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		imageBarrier.srcAccessMask = barrier.src.accessMask;
+		imageBarrier.dstAccessMask = barrier.dst.accessMask;
+		imageBarrier.oldLayout = barrier.src.layout;
+		imageBarrier.newLayout = barrier.dst.layout;
+		imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.image = image.image;
+		imageBarrier.subresourceRange.aspectMask = image.aspectMask;
+		imageBarrier.subresourceRange.baseMipLevel = 0;
+		imageBarrier.subresourceRange.levelCount = 1;
+		imageBarrier.subresourceRange.baseArrayLayer = 0;
+		imageBarrier.subresourceRange.layerCount = 1;
+		imageBarriers.push_back(imageBarrier);
+
+		srcStageMask |= barrier.src.stageMask;
+		dstStageMask |= barrier.dst.stageMask;
+	}
+
+	vkCmdPipelineBarrier(cmdBuff,
+		srcStageMask,
+		dstStageMask,
+		0,
+		0,
+		nullptr,
+		0,
+		nullptr,
+		static_cast<uint32_t>(imageBarriers.size()),
+		imageBarriers.data());
+}
+
+VkImageAspectFlags VulkanRenderGraphBackend::GetAspectMask(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_D16_UNORM:
+	case VK_FORMAT_X8_D24_UNORM_PACK32:
+	case VK_FORMAT_D32_SFLOAT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT;
+	case VK_FORMAT_D16_UNORM_S8_UINT:
+	case VK_FORMAT_D24_UNORM_S8_UINT:
+	case VK_FORMAT_D32_SFLOAT_S8_UINT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+	default:
+		return VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+}
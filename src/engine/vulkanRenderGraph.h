@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <vulkan/vulkan.h>
+#include "engine/device.h"
+#include "engine/renderGraph.h"
+
+
+// creates the transient images of a compiled render graph and records its barriers and passes
+class VulkanRenderGraphBackend : public RenderGraphBackend
+{
+public:
+	explicit VulkanRenderGraphBackend(const std::unique_ptr<Device>& device);
+	~VulkanRenderGraphBackend() override;
+
+	[[nodiscard]] RenderGraphMemoryRequirements GetMemoryRequirements(
+		const RenderGraphImageDesc& desc,
+		VkImageUsageFlags usage) override;
+
+	// allocates one memory block per `RenderGraphMemoryBlock` and binds its images at offset 0
+	void Realize(const RenderGraph& graph);
+	void Release();
+
+	// imported images can change every frame, e.g. the acquired swapchain image
+	void SetImportedImage(RenderGraphResource resource, VkImage image, VkImageView imageView);
+	void Execute(const RenderGraph& graph, VkCommandBuffer cmdBuff) const;
+
+	[[nodiscard]] inline VkImageView GetImageView(RenderGraphResource resource) const
+	{
+		return m_Images[resource].imageView;
+	}
+
+private:
+	struct Image
+	{
+		VkImage image{};
+		VkImageView imageView{};
+		VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		bool owned = false;
+	};
+
+	[[nodiscard]] VkImage CreateImage(const RenderGraphImageDesc& desc,
+		VkImageUsageFlags usage) const;
+	void RecordBarriers(const std::vector<RenderGraphBarrier>& barriers,
+		VkCommandBuffer cmdBuff) const;
+	[[nodiscard]] static VkImageAspectFlags GetAspectMask(VkFormat format);
+
+	const std::unique_ptr<Device>& m_Device;
+
+	std::vector<Image> m_Images;
+	std::vector<VkDeviceMemory> m_MemoryBlocks;
+};
@@ -1,11 +1,11 @@
 #include "core/core.h"
 #include "engine/engine.h"
 
-int main()
+int main(int argc, char** argv)
 {
 	Logger::Init();
 
-	Engine* engine = Engine::Create("Vulkan PBR", 400, 400);
+	Engine* engine = Engine::Create("Vulkan PBR", 400, 400, RenderSettings::Load(argc, argv));
 	engine->Run();
 	delete engine;
 }
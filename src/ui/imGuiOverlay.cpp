@@ -1,5 +1,7 @@
 #include "ui/imGuiOverlay.h"
 
+#include <mutex>
+#include <utility>
 #include "backends/imgui_impl_glfw.h"
 #include "backends/imgui_impl_vulkan.h"
 #include "core/core.h"
@@ -9,6 +11,7 @@
 
 
 VkDescriptorPool ImGuiOverlay::s_DescriptorPool = nullptr;
+std::mutex ImGuiOverlay::s_ContextMutex;
 
 void ImGuiOverlay::Init(VkInstance vulkanInstance,
 	VkPhysicalDevice physicalDevice,
@@ -84,17 +87,49 @@ void ImGuiOverlay::Cleanup(VkDevice deviceVk)
 	ImGui::DestroyContext();
 }
 
+std::unique_lock<std::mutex> ImGuiOverlay::LockContext()
+{
+	return std::unique_lock<std::mutex>{ s_ContextMutex };
+}
+
 void ImGuiOverlay::Begin()
 {
-	ImGui_ImplVulkan_NewFrame();
+	// `ImGui_ImplVulkan_NewFrame()` is called by `Draw()`, the Vulkan backend stays on one thread
 	ImGui_ImplGlfw_NewFrame();
 	ImGui::NewFrame();
 }
 
-void ImGuiOverlay::End(VkCommandBuffer commandBuffer)
+void ImGuiOverlay::End(ImGuiDrawSnapshot& snapshot)
 {
 	ImGui::Render();
-	ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
+	snapshot.Capture(ImGui::GetDrawData());
+}
+
+void ImGuiOverlay::Draw(const ImGuiDrawSnapshot& snapshot, VkCommandBuffer commandBuffer)
+{
+	ImDrawData drawData{};
+	drawData.Valid = true;
+	drawData.CmdListsCount = static_cast<int>(snapshot.m_DrawLists.size());
+	drawData.TotalVtxCount = snapshot.m_TotalVtxCount;
+	drawData.TotalIdxCount = snapshot.m_TotalIdxCount;
+	drawData.DisplayPos = snapshot.m_DisplayPos;
+	drawData.DisplaySize = snapshot.m_DisplaySize;
+	drawData.FramebufferScale = snapshot.m_FramebufferScale;
+#if defined(IMGUI_HAS_VIEWPORT)
+	drawData.OwnerViewport = snapshot.m_OwnerViewport;
+#endif
+	// `CmdLists` became an owned vector in 1.89.8
+#if IMGUI_VERSION_NUM >= 18980
+	for (ImDrawList* drawList : snapshot.m_DrawLists)
+		drawData.CmdLists.push_back(drawList);
+#else
+	drawData.CmdLists = const_cast<ImDrawList**>(snapshot.m_DrawLists.data());
+#endif
+
+	// the backend allocates through the context, which the main thread uses at the same time
+	const std::lock_guard<std::mutex> lock{ s_ContextMutex };
+	ImGui_ImplVulkan_NewFrame();
+	ImGui_ImplVulkan_RenderDrawData(&drawData, commandBuffer);
 }
 
 void ImGuiOverlay::CheckVkResult(VkResult err)
@@ -103,4 +138,64 @@ void ImGuiOverlay::CheckVkResult(VkResult err)
 		return;
 
 	Logger::Error("ImGui::Vulkan: {}\n", static_cast<uint32_t>(err));
-}
\ No newline at end of file
+}
+
+ImGuiDrawSnapshot::~ImGuiDrawSnapshot()
+{
+	Clear();
+}
+
+ImGuiDrawSnapshot::ImGuiDrawSnapshot(ImGuiDrawSnapshot&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+ImGuiDrawSnapshot& ImGuiDrawSnapshot::operator=(ImGuiDrawSnapshot&& other) noexcept
+{
+	if (this == &other)
+		return *this;
+
+	Clear();
+	m_DrawLists = std::move(other.m_DrawLists);
+	other.m_DrawLists.clear();
+	m_TotalVtxCount = other.m_TotalVtxCount;
+	m_TotalIdxCount = other.m_TotalIdxCount;
+	m_DisplayPos = other.m_DisplayPos;
+	m_DisplaySize = other.m_DisplaySize;
+	m_FramebufferScale = other.m_FramebufferScale;
+#if defined(IMGUI_HAS_VIEWPORT)
+	m_OwnerViewport = other.m_OwnerViewport;
+#endif
+
+	return *this;
+}
+
+void ImGuiDrawSnapshot::Capture(const ImDrawData* drawData)
+{
+	Clear();
+	if (drawData == nullptr || !drawData->Valid)
+		return;
+
+	// only the buffers and commands are copied, the texture ids stay valid
+	m_DrawLists.reserve(static_cast<size_t>(drawData->CmdListsCount));
+	for (int i = 0; i < drawData->CmdListsCount; ++i)
+		m_DrawLists.push_back(drawData->CmdLists[i]->CloneOutput());
+
+	m_TotalVtxCount = drawData->TotalVtxCount;
+	m_TotalIdxCount = drawData->TotalIdxCount;
+	m_DisplayPos = drawData->DisplayPos;
+	m_DisplaySize = drawData->DisplaySize;
+	m_FramebufferScale = drawData->FramebufferScale;
+#if defined(IMGUI_HAS_VIEWPORT)
+	m_OwnerViewport = drawData->OwnerViewport;
+#endif
+}
+
+void ImGuiDrawSnapshot::Clear()
+{
+	for (ImDrawList* drawList : m_DrawLists)
+		IM_DELETE(drawList);
+	m_DrawLists.clear();
+	m_TotalVtxCount = 0;
+	m_TotalIdxCount = 0;
+}
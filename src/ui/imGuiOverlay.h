@@ -1,9 +1,40 @@
 #pragma once
 
+#include <mutex>
+#include <vector>
 #include <vulkan/vulkan.h>
 #include "imgui.h"
 
 
+// owns a copy of the ImGui draw lists so that they can be rendered on another thread
+class ImGuiDrawSnapshot
+{
+public:
+	ImGuiDrawSnapshot() = default;
+	~ImGuiDrawSnapshot();
+	ImGuiDrawSnapshot(const ImGuiDrawSnapshot&) = delete;
+	ImGuiDrawSnapshot(ImGuiDrawSnapshot&& other) noexcept;
+	ImGuiDrawSnapshot& operator=(const ImGuiDrawSnapshot&) = delete;
+	ImGuiDrawSnapshot& operator=(ImGuiDrawSnapshot&& other) noexcept;
+
+	void Capture(const ImDrawData* drawData);
+	void Clear();
+
+private:
+	friend class ImGuiOverlay;
+
+	std::vector<ImDrawList*> m_DrawLists;
+	int m_TotalVtxCount = 0;
+	int m_TotalIdxCount = 0;
+	ImVec2 m_DisplayPos{};
+	ImVec2 m_DisplaySize{};
+	ImVec2 m_FramebufferScale{};
+#if defined(IMGUI_HAS_VIEWPORT)
+	ImGuiViewport* m_OwnerViewport = nullptr; // the backend keeps its buffers in the viewport
+#endif
+};
+
+
 class ImGuiOverlay
 {
 public:
@@ -17,11 +48,19 @@ public:
 		VkCommandPool commandPool,
 		uint32_t imageCount);
 	static void Cleanup(VkDevice deviceVk);
+
+	// the ImGui context is shared by both threads, so the main thread holds this lock while it
+	// builds the ui or polls the events that the glfw backend forwards to ImGui
+	[[nodiscard]] static std::unique_lock<std::mutex> LockContext();
+	// main thread, under `LockContext()`
 	static void Begin();
-	static void End(VkCommandBuffer commandBuffer);
+	static void End(ImGuiDrawSnapshot& snapshot);
+	// render thread; the only thread that calls into the Vulkan backend after `Init()`
+	static void Draw(const ImGuiDrawSnapshot& snapshot, VkCommandBuffer commandBuffer);
 
 private:
 	static void CheckVkResult(VkResult err);
 
 	static VkDescriptorPool s_DescriptorPool;
+	static std::mutex s_ContextMutex;
 };
\ No newline at end of file
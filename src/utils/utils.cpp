@@ -3,6 +3,7 @@
 #include "core/core.h"
 #include "core/window.h"
 #include "engine/engine.h"
+#include "engine/settings.h"
 #include <set>
 #include <string>
 #include <algorithm>
@@ -133,14 +134,19 @@ VkSurfaceFormatKHR ChooseSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& av
 	return availableFormats[0];
 }
 
-VkPresentModeKHR ChoosePresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes)
+VkPresentModeKHR ChoosePresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes,
+	VkPresentModeKHR requestedPresentMode)
 {
 	for (const auto& presentMode : availablePresentModes)
 	{
-		if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR)
+		if (presentMode == requestedPresentMode)
 			return presentMode;
 	}
 
+	// FIFO is always available
+	Logger::Warn("Present mode \"{}\" is not supported, falling back to \"{}\"",
+		RenderSettings::PresentModeToString(requestedPresentMode),
+		RenderSettings::PresentModeToString(VK_PRESENT_MODE_FIFO_KHR));
 	return VK_PRESENT_MODE_FIFO_KHR;
 }
 
@@ -33,7 +33,8 @@ VkFormat FindSupportedFormat(const VkPhysicalDevice physicalDevice,
 
 // swapchain
 VkSurfaceFormatKHR ChooseSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
-VkPresentModeKHR ChoosePresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
+VkPresentModeKHR ChoosePresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes,
+	VkPresentModeKHR requestedPresentMode);
 VkExtent2D ChooseExtent(const VkSurfaceCapabilitiesKHR& capabilities,
 	std::function<void(int* width, int* height)> pfnGetFramebufferSize);
 VkFormat FindDepthFormat(const VkPhysicalDevice physicalDevice);
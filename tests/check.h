@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+
+// minimal checks of the headless tests; a failed check is reported and the test goes on, so one
+// run shows every failure
+inline int g_FailedCheckCount = 0;
+
+#define CHECK(condition)                                                              \
+	do                                                                                \
+	{                                                                                 \
+		if (!(condition))                                                             \
+		{                                                                             \
+			std::fprintf(                                                             \
+				stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			++g_FailedCheckCount;                                                     \
+		}                                                                             \
+	} while (false)
+
+// prints whether the checks of a test function passed
+#define RUN_TEST(fn)                                                                   \
+	do                                                                                 \
+	{                                                                                  \
+		const int failedBefore = g_FailedCheckCount;                                   \
+		fn();                                                                          \
+		std::printf(                                                                   \
+			"%s %s\n", g_FailedCheckCount == failedBefore ? "passed" : "FAILED", #fn); \
+	} while (false)
+
+inline int GetTestResult()
+{
+	return g_FailedCheckCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,264 @@
+// headless test of the job system: counters, continuations, parallel-for and work stealing
+// a lost wake up or a worker that never stops hangs the test, ctest times it out
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include "core/jobSystem.h"
+#include "check.h"
+
+
+static void TestCounter()
+{
+	JobSystem jobSystem{ 3 };
+
+	constexpr uint32_t jobCount = 1000;
+	std::atomic<uint32_t> runCount{ 0 };
+	JobCounter counter;
+	CHECK(counter.IsDone());
+	for (uint32_t i = 0; i < jobCount; ++i)
+		jobSystem.Run([&runCount]() { ++runCount; }, &counter);
+	jobSystem.Wait(counter);
+	CHECK(counter.IsDone());
+	CHECK(runCount == jobCount);
+
+	// jobs that queue more jobs into the counter they are counted in
+	runCount = 0;
+	for (uint32_t i = 0; i < jobCount; ++i)
+	{
+		jobSystem.Run(
+			[&jobSystem, &runCount, &counter]() {
+				jobSystem.Run([&runCount]() { ++runCount; }, &counter);
+				++runCount;
+			},
+			&counter);
+	}
+	jobSystem.Wait(counter);
+	CHECK(runCount == 2 * jobCount);
+}
+
+static void TestContinuation()
+{
+	JobSystem jobSystem{ 3 };
+
+	// queued once every job of the dependency is done
+	constexpr uint32_t jobCount = 100;
+	std::atomic<uint32_t> runCount{ 0 };
+	std::atomic<uint32_t> runCountAtContinuation{ 0 };
+	std::atomic<bool> release{ false };
+	JobCounter dependency;
+	JobCounter counter;
+	for (uint32_t i = 0; i < jobCount; ++i)
+	{
+		jobSystem.Run(
+			[&runCount, &release]() {
+				while (!release)
+					std::this_thread::yield();
+				++runCount;
+			},
+			&dependency);
+	}
+	jobSystem.RunAfter(
+		dependency,
+		[&runCount, &runCountAtContinuation]() { runCountAtContinuation = runCount.load(); },
+		&counter);
+	// the continuation counts as unfinished while it waits
+	CHECK(!counter.IsDone());
+	release = true;
+	jobSystem.Wait(counter);
+	CHECK(dependency.IsDone());
+	CHECK(runCountAtContinuation == jobCount);
+
+	// a finished dependency queues the job right away
+	std::atomic<bool> hasRun{ false };
+	jobSystem.RunAfter(dependency, [&hasRun]() { hasRun = true; }, &counter);
+	jobSystem.Wait(counter);
+	CHECK(hasRun);
+
+	// a chain, every link waits for the previous one
+	std::vector<std::unique_ptr<JobCounter>> links;
+	std::vector<uint32_t> order;
+	links.push_back(std::make_unique<JobCounter>());
+	jobSystem.Run([&order]() { order.push_back(0); }, links.back().get());
+	for (uint32_t i = 1; i < 10; ++i)
+	{
+		JobCounter& previous = *links.back();
+		links.push_back(std::make_unique<JobCounter>());
+		jobSystem.RunAfter(previous, [&order, i]() { order.push_back(i); }, links.back().get());
+	}
+	jobSystem.Wait(*links.back());
+	CHECK(order.size() == 10);
+	CHECK(std::is_sorted(order.begin(), order.end()));
+}
+
+static void TestParallelFor()
+{
+	JobSystem jobSystem{ 3 };
+
+	// every index exactly once, in batches of at most the batch size
+	constexpr uint32_t count = 10007;
+	constexpr uint32_t batchSize = 64;
+	std::vector<std::atomic<uint32_t>> visits(count);
+	std::atomic<bool> batchTooLarge{ false };
+	JobCounter counter;
+	jobSystem.ParallelFor(
+		count,
+		batchSize,
+		[&visits, &batchTooLarge](uint32_t begin, uint32_t end) {
+			if (end - begin > batchSize)
+				batchTooLarge = true;
+			for (uint32_t i = begin; i < end; ++i)
+				++visits[i];
+		},
+		counter);
+	jobSystem.Wait(counter);
+	CHECK(!batchTooLarge);
+	CHECK(std::all_of(visits.begin(), visits.end(), [](const auto& visit) { return visit == 1; }));
+
+	// nothing to do, the counter is not touched
+	bool hasRun = false;
+	jobSystem.ParallelFor(
+		0, batchSize, [&hasRun](uint32_t, uint32_t) { hasRun = true; }, counter);
+	CHECK(counter.IsDone());
+	CHECK(!hasRun);
+
+	// a batch size of zero is one index per job
+	std::atomic<uint32_t> jobCount{ 0 };
+	jobSystem.ParallelFor(
+		10, 0, [&jobCount](uint32_t begin, uint32_t end) { jobCount += end - begin; }, counter);
+	jobSystem.Wait(counter);
+	CHECK(jobCount == 10);
+}
+
+static void TestStealing()
+{
+	JobSystem jobSystem{ 2 };
+
+	// a job queues jobs into the deque of its worker and blocks that worker until they are done;
+	// neither it nor the main thread runs them, so the other worker has to steal them
+	constexpr uint32_t jobCount = 16;
+	std::atomic<uint32_t> stolenCount{ 0 };
+	std::atomic<bool> finished{ false };
+	std::atomic<bool> timedOut{ false };
+	JobCounter parentCounter;
+	jobSystem.Run(
+		[&]() {
+			const std::thread::id parentThread = std::this_thread::get_id();
+			JobCounter counter;
+			for (uint32_t i = 0; i < jobCount; ++i)
+			{
+				jobSystem.Run(
+					[&stolenCount, parentThread]() {
+						if (std::this_thread::get_id() != parentThread)
+							++stolenCount;
+					},
+					&counter);
+			}
+
+			const auto startTime = std::chrono::steady_clock::now();
+			while (!counter.IsDone())
+			{
+				if (std::chrono::steady_clock::now() - startTime > std::chrono::seconds{ 10 })
+				{
+					timedOut = true;
+					// runs the rest itself, `counter` has to be done before it goes out of scope
+					jobSystem.Wait(counter);
+					break;
+				}
+				std::this_thread::yield();
+			}
+			finished = true;
+		},
+		&parentCounter);
+
+	// not `Wait()`, the main thread would steal the jobs too
+	while (!finished)
+		std::this_thread::yield();
+	jobSystem.Wait(parentCounter);
+	CHECK(!timedOut);
+	CHECK(stolenCount == jobCount);
+}
+
+static void TestWaitWakesUp()
+{
+	JobSystem jobSystem{ 1 };
+
+	// the waiting thread sleeps while the worker runs the job, finishing it has to wake it up
+	for (uint32_t i = 0; i < 200; ++i)
+	{
+		JobCounter counter;
+		std::atomic<bool> started{ false };
+		jobSystem.Run(
+			[&started]() {
+				started = true;
+				std::this_thread::sleep_for(std::chrono::microseconds{ 100 });
+			},
+			&counter);
+		while (!started)
+			std::this_thread::yield();
+		jobSystem.Wait(counter);
+		CHECK(counter.IsDone());
+	}
+}
+
+static void TestManyProducers()
+{
+	// threads outside the pool push into the shared queue at the same time; the job system is
+	// destroyed afterwards, which only returns if the workers saw every job popped
+	std::atomic<uint32_t> runCount{ 0 };
+	{
+		JobSystem jobSystem{ 3 };
+		std::vector<std::thread> producers;
+		for (uint32_t p = 0; p < 4; ++p)
+		{
+			producers.emplace_back([&jobSystem, &runCount]() {
+				JobCounter counter;
+				for (uint32_t i = 0; i < 10000; ++i)
+					jobSystem.Run([&runCount]() { ++runCount; }, &counter);
+				jobSystem.Wait(counter);
+			});
+		}
+		for (auto& producer : producers)
+			producer.join();
+	}
+	CHECK(runCount == 4 * 10000);
+}
+
+static void TestTwoJobSystems()
+{
+	// the workers of one job system queue into and wait on the other one
+	JobSystem outer{ 2 };
+	JobSystem inner{ 3 };
+
+	std::atomic<uint32_t> runCount{ 0 };
+	JobCounter outerCounter;
+	for (uint32_t i = 0; i < 8; ++i)
+	{
+		outer.Run(
+			[&inner, &runCount]() {
+				JobCounter innerCounter;
+				for (uint32_t j = 0; j < 100; ++j)
+					inner.Run([&runCount]() { ++runCount; }, &innerCounter);
+				inner.Wait(innerCounter);
+			},
+			&outerCounter);
+	}
+	outer.Wait(outerCounter);
+	CHECK(runCount == 8 * 100);
+}
+
+int main()
+{
+	RUN_TEST(TestCounter);
+	RUN_TEST(TestContinuation);
+	RUN_TEST(TestParallelFor);
+	RUN_TEST(TestStealing);
+	RUN_TEST(TestWaitWakesUp);
+	RUN_TEST(TestManyProducers);
+	RUN_TEST(TestTwoJobSystems);
+
+	return GetTestResult();
+}
@@ -0,0 +1,68 @@
+// headless test of the per-draw data paths: which one a device gets, which shader variant each
+// of them loads and the layouts the variants read
+// the draws themselves need a device; the "Push constants" checkbox runs the UBO path there
+
+#include <cstddef>
+#include "engine/shaderPermutation.h"
+#include "engine/types.h"
+#include "check.h"
+
+
+static void TestPathSelection()
+{
+	// 128 bytes is the `maxPushConstantsSize` every device guarantees
+	CHECK(PerDrawData::GetSize() == 128);
+	CHECK(PerDrawData::FitsInPushConstants(128));
+	CHECK(PerDrawData::FitsInPushConstants(256));
+	CHECK(!PerDrawData::FitsInPushConstants(64));
+	CHECK(!PerDrawData::FitsInPushConstants(0));
+}
+
+static void TestPerDrawFeatures()
+{
+	CHECK(ShaderFeature::GetPerDrawFeatures(false, true) == 0);
+	CHECK(ShaderFeature::GetPerDrawFeatures(false, false) == ShaderFeature::PER_DRAW_UBO);
+	// the instanced draws read the instance buffer, also on devices without push constants
+	CHECK(ShaderFeature::GetPerDrawFeatures(true, true) == ShaderFeature::INSTANCED);
+	CHECK(ShaderFeature::GetPerDrawFeatures(true, false) == ShaderFeature::INSTANCED);
+}
+
+static void TestSpirvPaths()
+{
+	// the variants CMakeLists.txt compiles for `VKPBR_PER_DRAW_SHADERS`
+	ShaderPermutation permutation{ "phongLighting", ShaderType::VERTEX };
+	CHECK(permutation.GetSpirvPath() == "assets/shaders/out/phongLighting.vert.spv");
+
+	permutation.features = ShaderFeature::GetPerDrawFeatures(false, false);
+	CHECK(permutation.GetSpirvPath() == "assets/shaders/out/phongLighting.vert.ubo.spv");
+
+	permutation.features = ShaderFeature::GetPerDrawFeatures(true, false);
+	CHECK(permutation.GetSpirvPath() == "assets/shaders/out/phongLighting.vert.instanced.spv");
+
+	// the specialized bits don't change the file
+	permutation.features =
+		ShaderFeature::GetPerDrawFeatures(false, false) | ShaderFeature::NORMAL_MAPPING;
+	CHECK(permutation.GetSpirvPath() == "assets/shaders/out/phongLighting.vert.ubo.spv");
+}
+
+static void TestLayouts()
+{
+	// std140/push constant offsets of the `PerDrawData` block and the `PER_DRAW_UBO` variant's
+	// `MatrixUBO`, which `Engine::BindPerDrawData()` fills from the same data
+	CHECK(offsetof(PerDrawData, model) == 0);
+	CHECK(offsetof(PerDrawData, normal) == 64);
+	CHECK(offsetof(MatrixUBO, model) == 0);
+	CHECK(offsetof(MatrixUBO, viewProj) == 64);
+	CHECK(offsetof(MatrixUBO, normal) == 128);
+	CHECK(MatrixUBO::GetSize() == sizeof(MatrixUBO));
+}
+
+int main()
+{
+	RUN_TEST(TestPathSelection);
+	RUN_TEST(TestPerDrawFeatures);
+	RUN_TEST(TestSpirvPaths);
+	RUN_TEST(TestLayouts);
+
+	return GetTestResult();
+}
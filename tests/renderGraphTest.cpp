@@ -0,0 +1,401 @@
+// headless test of the render graph compilation against a mock backend: pass culling, image
+// lifetimes and memory aliasing, and the barriers between the passes
+
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include "core/logger.h"
+#include "engine/renderGraph.h"
+#include "check.h"
+
+
+// 4 bytes per pixel; depth images live in a different memory type than color images
+class MockRenderGraphBackend : public RenderGraphBackend
+{
+public:
+	[[nodiscard]] RenderGraphMemoryRequirements GetMemoryRequirements(
+		const RenderGraphImageDesc& desc,
+		VkImageUsageFlags usage) override
+	{
+		m_Usages.push_back(usage);
+
+		RenderGraphMemoryRequirements requirements{};
+		requirements.size = static_cast<VkDeviceSize>(desc.extent.width) * desc.extent.height * 4;
+		requirements.alignment = desc.format == VK_FORMAT_D32_SFLOAT ? 4096 : 256;
+		requirements.memoryTypeBits = desc.format == VK_FORMAT_D32_SFLOAT ? 0b10u : 0b01u;
+		return requirements;
+	}
+
+	[[nodiscard]] inline const std::vector<VkImageUsageFlags>& GetUsages() const
+	{
+		return m_Usages;
+	}
+
+private:
+	std::vector<VkImageUsageFlags> m_Usages;
+};
+
+static RenderGraphImageDesc GetImageDesc(VkFormat format, uint32_t width, uint32_t height)
+{
+	RenderGraphImageDesc desc{};
+	desc.format = format;
+	desc.extent = VkExtent2D{ width, height };
+	return desc;
+}
+
+static RenderGraphResource ImportSwapchain(RenderGraph& graph)
+{
+	RenderGraphImageState finalState{};
+	finalState.layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	finalState.stageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+	return graph.ImportImage("swapchain",
+		GetImageDesc(VK_FORMAT_B8G8R8A8_SRGB, 64, 64),
+		RenderGraphImageState{},
+		finalState);
+}
+
+static const RenderGraph::CompiledPass* FindCompiledPass(const RenderGraph& graph, uint32_t pass)
+{
+	const auto& passes = graph.GetCompiledPasses();
+	const auto it = std::find_if(passes.begin(), passes.end(), [pass](const auto& compiledPass) {
+		return compiledPass.pass == pass;
+	});
+	return it == passes.end() ? nullptr : &*it;
+}
+
+static const RenderGraphMemoryBlock* FindMemoryBlock(const RenderGraph& graph,
+	RenderGraphResource resource)
+{
+	for (const auto& block : graph.GetMemoryBlocks())
+	{
+		if (std::find(block.resources.begin(), block.resources.end(), resource)
+			!= block.resources.end())
+			return &block;
+	}
+	return nullptr;
+}
+
+static void TestCullPasses()
+{
+	RenderGraph graph;
+	const RenderGraphResource swapchain = ImportSwapchain(graph);
+	const RenderGraphResource shadow =
+		graph.CreateImage("shadow", GetImageDesc(VK_FORMAT_D32_SFLOAT, 64, 64));
+	const RenderGraphResource debug =
+		graph.CreateImage("debug", GetImageDesc(VK_FORMAT_R8G8B8A8_UNORM, 64, 64));
+	const RenderGraphResource blurX =
+		graph.CreateImage("blur x", GetImageDesc(VK_FORMAT_R8G8B8A8_UNORM, 64, 64));
+	const RenderGraphResource blurY =
+		graph.CreateImage("blur y", GetImageDesc(VK_FORMAT_R8G8B8A8_UNORM, 64, 64));
+	const RenderGraphResource scratch =
+		graph.CreateImage("scratch", GetImageDesc(VK_FORMAT_R8G8B8A8_UNORM, 64, 64));
+
+	const uint32_t shadowPass = 0;
+	graph.AddPass("shadow", nullptr).Write(shadow, RenderGraphAccess::DepthAttachment);
+	// reads the shadow map too, but nothing reads its own result
+	const uint32_t debugPass = 1;
+	graph.AddPass("debug", nullptr)
+		.Read(shadow, RenderGraphAccess::ShaderRead)
+		.Write(debug, RenderGraphAccess::ColorAttachment);
+	// a chain whose end is never used; culling the second pass culls the first one too
+	const uint32_t blurXPass = 2;
+	graph.AddPass("blur x", nullptr).Write(blurX, RenderGraphAccess::ColorAttachment);
+	const uint32_t blurYPass = 3;
+	graph.AddPass("blur y", nullptr)
+		.Read(blurX, RenderGraphAccess::ShaderRead)
+		.Write(blurY, RenderGraphAccess::ColorAttachment);
+	// blends into its own attachment, that alone does not keep it alive
+	const uint32_t blendPass = 4;
+	graph.AddPass("blend", nullptr)
+		.Read(scratch, RenderGraphAccess::ColorAttachment)
+		.Write(scratch, RenderGraphAccess::ColorAttachment);
+	const uint32_t cullPass = 5;
+	graph.AddPass("cull", nullptr).SetSideEffect();
+	const uint32_t scenePass = 6;
+	graph.AddPass("scene", nullptr)
+		.Read(shadow, RenderGraphAccess::ShaderRead)
+		.Write(swapchain, RenderGraphAccess::ColorAttachment);
+
+	MockRenderGraphBackend backend;
+	graph.Compile(backend);
+
+	CHECK(!graph.IsCulled(shadowPass));
+	CHECK(graph.IsCulled(debugPass));
+	CHECK(graph.IsCulled(blurXPass));
+	CHECK(graph.IsCulled(blurYPass));
+	CHECK(graph.IsCulled(blendPass));
+	CHECK(!graph.IsCulled(cullPass));
+	CHECK(!graph.IsCulled(scenePass));
+
+	// only the passes that run are compiled, in the order they were added
+	const auto& passes = graph.GetCompiledPasses();
+	CHECK(passes.size() == 3);
+	CHECK(passes.size() == 3 && passes[0].pass == shadowPass && passes[1].pass == cullPass
+		  && passes[2].pass == scenePass);
+
+	// images only used by culled passes get no usage and no memory
+	CHECK(graph.GetImageUsage(debug) == 0);
+	CHECK(graph.GetImageUsage(blurX) == 0);
+	CHECK(graph.GetImageUsage(blurY) == 0);
+	CHECK(graph.GetImageUsage(scratch) == 0);
+	CHECK(FindMemoryBlock(graph, debug) == nullptr);
+	CHECK(FindMemoryBlock(graph, blurX) == nullptr);
+	CHECK(FindMemoryBlock(graph, swapchain) == nullptr);
+	CHECK(FindMemoryBlock(graph, shadow) != nullptr);
+	CHECK(backend.GetUsages().size() == 1);
+
+	// compiling again starts over
+	graph.Compile(backend);
+	CHECK(graph.GetCompiledPasses().size() == 3);
+	CHECK(graph.GetMemoryBlocks().size() == 1);
+}
+
+static void TestLifetimesAndAliasing()
+{
+	RenderGraph graph;
+	const RenderGraphResource swapchain = ImportSwapchain(graph);
+	const RenderGraphResource depth =
+		graph.CreateImage("depth", GetImageDesc(VK_FORMAT_D32_SFLOAT, 64, 64));
+	const RenderGraphResource color =
+		graph.CreateImage("color", GetImageDesc(VK_FORMAT_R16G16B16A16_SFLOAT, 64, 64));
+	const RenderGraphResource bloom =
+		graph.CreateImage("bloom", GetImageDesc(VK_FORMAT_R16G16B16A16_SFLOAT, 32, 32));
+	const RenderGraphResource tonemapped =
+		graph.CreateImage("tonemapped", GetImageDesc(VK_FORMAT_R8G8B8A8_UNORM, 128, 128));
+
+	// color: passes 0-1, bloom: 1-2, tonemapped: 2-3, depth: 0 only
+	graph.AddPass("scene", nullptr)
+		.Write(depth, RenderGraphAccess::DepthAttachment)
+		.Write(color, RenderGraphAccess::ColorAttachment);
+	graph.AddPass("bloom", nullptr)
+		.Read(color, RenderGraphAccess::ShaderRead)
+		.Write(bloom, RenderGraphAccess::ColorAttachment);
+	graph.AddPass("tonemap", nullptr)
+		.Read(bloom, RenderGraphAccess::ComputeRead)
+		.Write(tonemapped, RenderGraphAccess::ColorAttachment);
+	graph.AddPass("present", nullptr)
+		.Read(tonemapped, RenderGraphAccess::ShaderRead)
+		.Write(swapchain, RenderGraphAccess::ColorAttachment);
+
+	MockRenderGraphBackend backend;
+	graph.Compile(backend);
+
+	// an attachment of a single pass never leaves the tile memory, the others are sampled later
+	CHECK(graph.GetImageUsage(depth)
+		  == (VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT
+			  | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT));
+	CHECK(graph.GetImageUsage(color)
+		  == (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT));
+	CHECK(graph.GetImageUsage(bloom)
+		  == (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT));
+	// imported images are never transient, even when a single pass uses them
+	CHECK(graph.GetImageUsage(swapchain) == VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+	// the backend is asked with the final usage
+	const auto& usages = backend.GetUsages();
+	CHECK(std::find(usages.begin(), usages.end(), graph.GetImageUsage(depth)) != usages.end());
+
+	// tonemapped starts after color is dead, so they share a block; bloom overlaps both;
+	// depth needs another memory type
+	const RenderGraphMemoryBlock* colorBlock = FindMemoryBlock(graph, color);
+	const RenderGraphMemoryBlock* bloomBlock = FindMemoryBlock(graph, bloom);
+	const RenderGraphMemoryBlock* depthBlock = FindMemoryBlock(graph, depth);
+	CHECK(graph.GetMemoryBlocks().size() == 3);
+	CHECK(colorBlock != nullptr && colorBlock == FindMemoryBlock(graph, tonemapped));
+	CHECK(bloomBlock != nullptr && bloomBlock != colorBlock);
+	CHECK(depthBlock != nullptr && depthBlock != colorBlock && depthBlock != bloomBlock);
+	if (colorBlock != nullptr)
+	{
+		// large enough for either image, in the order they are used
+		CHECK(colorBlock->resources == std::vector<RenderGraphResource>({ color, tonemapped }));
+		CHECK(colorBlock->requirements.size == 128 * 128 * 4);
+		CHECK(colorBlock->requirements.alignment == 256);
+		CHECK(colorBlock->requirements.memoryTypeBits == 0b01u);
+	}
+	if (depthBlock != nullptr)
+		CHECK(depthBlock->requirements.alignment == 4096);
+}
+
+static void TestBuildBarriers()
+{
+	RenderGraph graph;
+	const RenderGraphResource swapchain = ImportSwapchain(graph);
+	const RenderGraphResource depth =
+		graph.CreateImage("depth", GetImageDesc(VK_FORMAT_D32_SFLOAT, 64, 64));
+	const RenderGraphResource color =
+		graph.CreateImage("color", GetImageDesc(VK_FORMAT_R8G8B8A8_UNORM, 64, 64));
+
+	const uint32_t scenePass = 0;
+	graph.AddPass("scene", nullptr)
+		.Write(depth, RenderGraphAccess::DepthAttachment)
+		.Write(color, RenderGraphAccess::ColorAttachment);
+	// the same image read twice in one layout is one barrier with both stages
+	const uint32_t blurPass = 1;
+	graph.AddPass("blur", nullptr)
+		.Read(color, RenderGraphAccess::ShaderRead)
+		.Read(color, RenderGraphAccess::ComputeRead)
+		.Read(depth, RenderGraphAccess::DepthRead)
+		.SetSideEffect();
+	// reads the same images in the same layouts again, no barrier needed
+	const uint32_t outlinePass = 2;
+	graph.AddPass("outline", nullptr)
+		.Read(color, RenderGraphAccess::ShaderRead)
+		.Read(depth, RenderGraphAccess::DepthRead)
+		.Write(swapchain, RenderGraphAccess::ColorAttachment);
+
+	MockRenderGraphBackend backend;
+	graph.Compile(backend);
+	CHECK(graph.GetCompiledPasses().size() == 3);
+
+	// the depth and color images don't alias (different memory types, overlapping lifetimes), so
+	// each one waits for its own last use in the previous frame, with the contents discarded
+	const RenderGraph::CompiledPass* scene = FindCompiledPass(graph, scenePass);
+	CHECK(scene != nullptr && scene->barriers.size() == 2);
+	if (scene != nullptr && scene->barriers.size() == 2)
+	{
+		const RenderGraphBarrier& depthBarrier = scene->barriers[0];
+		CHECK(depthBarrier.resource == depth);
+		CHECK(depthBarrier.src.layout == VK_IMAGE_LAYOUT_UNDEFINED);
+		CHECK(depthBarrier.src.accessMask == VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT);
+		CHECK(depthBarrier.dst.layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+		CHECK(depthBarrier.dst.accessMask
+			  == (VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT
+				  | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT));
+
+		const RenderGraphBarrier& colorBarrier = scene->barriers[1];
+		CHECK(colorBarrier.resource == color);
+		CHECK(colorBarrier.src.layout == VK_IMAGE_LAYOUT_UNDEFINED);
+		CHECK(colorBarrier.src.stageMask
+			  == (VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT));
+		CHECK(colorBarrier.dst.layout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		CHECK(colorBarrier.dst.accessMask == VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+	}
+
+	const RenderGraph::CompiledPass* blur = FindCompiledPass(graph, blurPass);
+	CHECK(blur != nullptr && blur->barriers.size() == 2);
+	if (blur != nullptr && blur->barriers.size() == 2)
+	{
+		const RenderGraphBarrier& colorBarrier = blur->barriers[0];
+		CHECK(colorBarrier.resource == color);
+		CHECK(colorBarrier.src.layout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		CHECK(colorBarrier.src.stageMask == VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+		CHECK(colorBarrier.dst.layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		CHECK(colorBarrier.dst.stageMask
+			  == (VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT));
+		CHECK(colorBarrier.dst.accessMask == VK_ACCESS_SHADER_READ_BIT);
+
+		CHECK(blur->barriers[1].resource == depth);
+		CHECK(blur->barriers[1].dst.layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+	}
+
+	// only the swapchain, coming from its initial state
+	const RenderGraph::CompiledPass* outline = FindCompiledPass(graph, outlinePass);
+	CHECK(outline != nullptr && outline->barriers.size() == 1);
+	if (outline != nullptr && outline->barriers.size() == 1)
+	{
+		CHECK(outline->barriers[0].resource == swapchain);
+		CHECK(outline->barriers[0].src.layout == VK_IMAGE_LAYOUT_UNDEFINED);
+		CHECK(outline->barriers[0].dst.layout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+	}
+
+	// imported images end up in their final state
+	const auto& finalBarriers = graph.GetFinalBarriers();
+	CHECK(finalBarriers.size() == 1);
+	if (finalBarriers.size() == 1)
+	{
+		CHECK(finalBarriers[0].resource == swapchain);
+		CHECK(finalBarriers[0].src.layout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		CHECK(finalBarriers[0].src.accessMask == VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+		CHECK(finalBarriers[0].dst.layout == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	}
+}
+
+static void TestAliasedBarriers()
+{
+	RenderGraph graph;
+	const RenderGraphResource swapchain = ImportSwapchain(graph);
+	const RenderGraphResource first =
+		graph.CreateImage("first", GetImageDesc(VK_FORMAT_R8G8B8A8_UNORM, 64, 64));
+	const RenderGraphResource second =
+		graph.CreateImage("second", GetImageDesc(VK_FORMAT_R8G8B8A8_UNORM, 64, 64));
+	const RenderGraphResource third =
+		graph.CreateImage("third", GetImageDesc(VK_FORMAT_R8G8B8A8_UNORM, 64, 64));
+
+	graph.AddPass("first", nullptr).Write(first, RenderGraphAccess::ColorAttachment);
+	graph.AddPass("second", nullptr)
+		.Read(first, RenderGraphAccess::ComputeRead)
+		.Write(second, RenderGraphAccess::ColorAttachment);
+	const uint32_t thirdPass = 2;
+	graph.AddPass("third", nullptr)
+		.Read(second, RenderGraphAccess::ShaderRead)
+		.Write(third, RenderGraphAccess::ColorAttachment);
+	graph.AddPass("present", nullptr)
+		.Read(third, RenderGraphAccess::ShaderRead)
+		.Write(swapchain, RenderGraphAccess::ColorAttachment);
+
+	MockRenderGraphBackend backend;
+	graph.Compile(backend);
+	CHECK(FindMemoryBlock(graph, first) != nullptr
+		  && FindMemoryBlock(graph, first) == FindMemoryBlock(graph, third));
+
+	// the third image reuses the memory of the first one, so it waits for the last read of it
+	const RenderGraph::CompiledPass* pass = FindCompiledPass(graph, thirdPass);
+	CHECK(pass != nullptr && pass->barriers.size() == 2);
+	if (pass != nullptr && pass->barriers.size() == 2)
+	{
+		const RenderGraphBarrier& barrier = pass->barriers[1];
+		CHECK(barrier.resource == third);
+		CHECK(barrier.src.layout == VK_IMAGE_LAYOUT_UNDEFINED);
+		CHECK(barrier.src.stageMask == VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+		CHECK(barrier.src.accessMask == VK_ACCESS_SHADER_READ_BIT);
+	}
+}
+
+static void TestConflictingLayouts()
+{
+	RenderGraph graph;
+	const RenderGraphResource depth =
+		graph.CreateImage("depth", GetImageDesc(VK_FORMAT_D32_SFLOAT, 64, 64));
+	graph.AddPass("scene", nullptr).Write(depth, RenderGraphAccess::DepthAttachment);
+	graph.AddPass("broken", nullptr)
+		.Read(depth, RenderGraphAccess::DepthRead)
+		.Read(depth, RenderGraphAccess::ShaderRead)
+		.SetSideEffect();
+
+	MockRenderGraphBackend backend;
+	bool threw = false;
+	try
+	{
+		graph.Compile(backend);
+	}
+	catch (const std::runtime_error&)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+
+	// writing with a read-only access is rejected right away
+	threw = false;
+	try
+	{
+		graph.AddPass("read only", nullptr).Write(depth, RenderGraphAccess::DepthRead);
+	}
+	catch (const std::runtime_error&)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+}
+
+int main()
+{
+	// the graph logs its errors before throwing
+	Logger::Init();
+
+	RUN_TEST(TestCullPasses);
+	RUN_TEST(TestLifetimesAndAliasing);
+	RUN_TEST(TestBuildBarriers);
+	RUN_TEST(TestAliasedBarriers);
+	RUN_TEST(TestConflictingLayouts);
+
+	return GetTestResult();
+}